@@ -0,0 +1,270 @@
+/*
+  ==============================================================================
+
+    CpuMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "CpuMeter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+//==============================================================================
+CpuMeter::CpuMeter()
+{
+   #if MFX_INSTRUMENTATION
+    for (auto& section : mSections)
+        section = Clock::duration::zero();
+   #endif
+}
+
+bool CpuMeter::isEnabled() const
+{
+   #if MFX_INSTRUMENTATION
+    return mEnabled.load (std::memory_order_relaxed);
+   #else
+    return false;
+   #endif
+}
+
+void CpuMeter::setEnabled (bool shouldBeEnabled)
+{
+   #if MFX_INSTRUMENTATION
+    mEnabled.store (shouldBeEnabled, std::memory_order_relaxed);
+   #else
+    (void) shouldBeEnabled;
+   #endif
+}
+
+void CpuMeter::endBlock (int numSamples, double sampleRate)
+{
+   #if MFX_INSTRUMENTATION
+    if (! mTiming)
+        return;
+
+    lap (overheadSection);
+    mTiming = false;
+
+    const auto toNs = [] (Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::nano> (duration).count();
+    };
+
+    CpuMeasurement measurement;
+    measurement.numSamples = numSamples;
+    measurement.sampleRate = sampleRate;
+    measurement.elapsedNs = toNs (mLast - mStart);
+
+    for (int section = 0; section < numTimedSections; ++section)
+        measurement.sectionNs[section] = toNs (mSections[section]);
+
+    if (! mQueue.push (measurement))
+        mNumDropped.fetch_add (1, std::memory_order_relaxed);
+   #else
+    (void) numSamples;
+    (void) sampleRate;
+   #endif
+}
+
+bool CpuMeter::pop (CpuMeasurement& measurement)
+{
+   #if MFX_INSTRUMENTATION
+    return mQueue.pop (measurement);
+   #else
+    (void) measurement;
+    return false;
+   #endif
+}
+
+long long CpuMeter::getNumDropped() const
+{
+   #if MFX_INSTRUMENTATION
+    return mNumDropped.load (std::memory_order_relaxed);
+   #else
+    return 0;
+   #endif
+}
+
+//==============================================================================
+void CpuStats::Histogram::reset()
+{
+    count = 0;
+    minimum = std::numeric_limits<double>::max();
+    maximum = 0.0;
+    sum = 0.0;
+    bins.assign ((size_t) numBins, 0);
+}
+
+void CpuStats::Histogram::add (double load)
+{
+    int bin = 0;
+
+    if (load >= lowestLoad)
+        bin = std::min (numBins - 1, 1 + (int) std::floor (std::log10 (load / lowestLoad) * binsPerDecade));
+
+    ++bins[(size_t) bin];
+    ++count;
+    minimum = std::min (minimum, load);
+    maximum = std::max (maximum, load);
+    sum += load;
+}
+
+CpuStats::Summary CpuStats::Histogram::getSummary() const
+{
+    if (count == 0)
+        return { 0.0, 0.0, 0.0, 0.0 };
+
+    // the 99th percentile is the middle of the bin it falls in, which can't be outside the extremes
+    const long long rank = (long long) std::ceil ((double) count * 0.99);
+    long long seen = 0;
+    int bin = 0;
+
+    for (; bin < numBins - 1; ++bin)
+    {
+        seen += bins[(size_t) bin];
+
+        if (seen >= rank)
+            break;
+    }
+
+    const double binCentre = lowestLoad * std::pow (10.0, (bin - 0.5) / binsPerDecade);
+    const double p99 = std::min (maximum, std::max (minimum, binCentre));
+
+    return { minimum * 100.0, sum / (double) count * 100.0, maximum * 100.0, p99 * 100.0 };
+}
+
+//==============================================================================
+CpuStats::CpuStats()
+{
+    reset();
+}
+
+void CpuStats::reset()
+{
+    mBlock.reset();
+
+    for (auto& section : mSections)
+        section.reset();
+
+    mNumBlocks = 0;
+    mNumOverruns = 0;
+    mNumDropped = 0;
+    mMinBlockSize = 0;
+    mMaxBlockSize = 0;
+    mSampleRate = 0.0;
+}
+
+void CpuStats::add (const CpuMeasurement& measurement)
+{
+    if (measurement.numSamples <= 0 || measurement.sampleRate <= 0.0)
+        return;
+
+    const double durationNs = measurement.numSamples * 1.0e9 / measurement.sampleRate;
+
+    mBlock.add (measurement.elapsedNs / durationNs);
+
+    for (int section = 0; section < numTimedSections; ++section)
+        mSections[section].add (measurement.sectionNs[section] / durationNs);
+
+    if (measurement.elapsedNs > durationNs)
+        ++mNumOverruns;
+
+    mMinBlockSize = mNumBlocks == 0 ? measurement.numSamples : std::min (mMinBlockSize, measurement.numSamples);
+    mMaxBlockSize = std::max (mMaxBlockSize, measurement.numSamples);
+    mSampleRate = measurement.sampleRate;
+    ++mNumBlocks;
+}
+
+int CpuStats::addFrom (CpuMeter& meter)
+{
+    CpuMeasurement measurement;
+    int numAdded = 0;
+
+    while (meter.pop (measurement))
+    {
+        add (measurement);
+        ++numAdded;
+    }
+
+    mNumDropped = meter.getNumDropped();
+    return numAdded;
+}
+
+CpuStats::Summary CpuStats::getBlockSummary() const
+{
+    return mBlock.getSummary();
+}
+
+CpuStats::Summary CpuStats::getSectionSummary (timedSection section) const
+{
+    return mSections[section].getSummary();
+}
+
+const char* CpuStats::getSectionName (timedSection section)
+{
+    switch (section)
+    {
+        case modulationSection:     return "modulation";
+        case distortionSection:     return "distortion";
+        case pulsingSection:        return "pulsing";
+        case overheadSection:       return "overhead";
+        default:                    return "";
+    }
+}
+
+std::string CpuStats::toText() const
+{
+    char line[256];
+    std::string text;
+
+    std::snprintf (line, sizeof (line), "%lld blocks of %d-%d samples at %g Hz, %lld overruns, %lld dropped\n",
+                   mNumBlocks, mMinBlockSize, mMaxBlockSize, mSampleRate, mNumOverruns, mNumDropped);
+    text += line;
+
+    std::snprintf (line, sizeof (line), "%-12s %9s %9s %9s %9s\n", "% of block", "min", "avg", "max", "p99");
+    text += line;
+
+    const auto addRow = [&] (const char* name, const Summary& summary)
+    {
+        std::snprintf (line, sizeof (line), "%-12s %9.3f %9.3f %9.3f %9.3f\n", name, summary.minimum, summary.mean, summary.maximum, summary.p99);
+        text += line;
+    };
+
+    addRow ("process", getBlockSummary());
+
+    for (int section = 0; section < numTimedSections; ++section)
+        addRow (getSectionName ((timedSection) section), getSectionSummary ((timedSection) section));
+
+    return text;
+}
+
+std::string CpuStats::toJson() const
+{
+    char line[256];
+    std::string json = "{\n";
+
+    std::snprintf (line, sizeof (line), "  \"blocks\": %lld,\n  \"overruns\": %lld,\n  \"dropped\": %lld,\n"
+                                        "  \"minBlockSize\": %d,\n  \"maxBlockSize\": %d,\n  \"sampleRate\": %g,\n",
+                   mNumBlocks, mNumOverruns, mNumDropped, mMinBlockSize, mMaxBlockSize, mSampleRate);
+    json += line;
+    json += "  \"unit\": \"percent of block duration\",\n";
+
+    const auto addObject = [&] (const char* name, const Summary& summary, bool isLast)
+    {
+        std::snprintf (line, sizeof (line), "  \"%s\": { \"min\": %.6g, \"avg\": %.6g, \"max\": %.6g, \"p99\": %.6g }%s\n",
+                       name, summary.minimum, summary.mean, summary.maximum, summary.p99, isLast ? "" : ",");
+        json += line;
+    };
+
+    addObject ("process", getBlockSummary(), false);
+
+    for (int section = 0; section < numTimedSections; ++section)
+        addObject (getSectionName ((timedSection) section), getSectionSummary ((timedSection) section), section == numTimedSections - 1);
+
+    json += "}\n";
+    return json;
+}
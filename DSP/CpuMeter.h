@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    CpuMeter.h
+    Times process() and the stages inside it on the audio thread, and hands the
+    figures to whoever wants to show or keep them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// build with MFX_INSTRUMENTATION=0 to leave the timing out altogether: CpuMeter is then empty
+// and all of its calls compile to nothing
+#ifndef MFX_INSTRUMENTATION
+ #define MFX_INSTRUMENTATION 1
+#endif
+
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// where the time inside process() goes. The input step (measuring the input level for the make-up
+// gain, and keeping the dry side of a bypass crossfade) counts as distortion, as do the make-up
+// gain and dist mix. Overhead is everything else: picking up parameters, writing out ramps,
+// looking for silence, the rest of the bypass and the neutral path
+enum timedSection
+{
+    modulationSection = 0,
+    distortionSection,
+    pulsingSection,
+    overheadSection,
+    numTimedSections
+};
+
+// one process() call, the times are in nanoseconds and the sections add up to the whole call
+struct CpuMeasurement
+{
+    int numSamples;
+    double sampleRate;
+    double elapsedNs;
+    double sectionNs[numTimedSections];
+};
+
+//==============================================================================
+/**
+    The audio thread calls startBlock(), lap() at the end of each stretch of work and
+    endBlock(), which queues one CpuMeasurement. One other thread takes them with pop().
+    Nothing is timed until setEnabled (true), and with the timing compiled out the
+    queue doesn't exist and pop() never returns anything.
+*/
+class CpuMeter
+{
+public:
+    static constexpr bool isCompiledIn = MFX_INSTRUMENTATION != 0;
+
+    // enough for a third of a second of 32 sample blocks at 96kHz between two reads
+    static constexpr int queueSize = 1024;
+
+    CpuMeter();
+
+    // may be called from any thread, takes effect at the next block
+    bool isEnabled() const;
+    void setEnabled (bool shouldBeEnabled);
+
+    // audio thread only
+    void startBlock()
+    {
+       #if MFX_INSTRUMENTATION
+        mTiming = mEnabled.load (std::memory_order_relaxed);
+
+        if (mTiming)
+        {
+            for (auto& section : mSections)
+                section = Clock::duration::zero();
+
+            mStart = Clock::now();
+            mLast = mStart;
+        }
+       #endif
+    }
+
+    // adds the time since the last lap (or the start of the block) to section
+    void lap (timedSection section)
+    {
+       #if MFX_INSTRUMENTATION
+        if (mTiming)
+        {
+            const auto now = Clock::now();
+            mSections[section] += now - mLast;
+            mLast = now;
+        }
+       #else
+        (void) section;
+       #endif
+    }
+
+    // the rest of the block counts as overhead. If the queue is full the measurement is dropped
+    void endBlock (int numSamples, double sampleRate);
+
+    // the reading thread only
+    bool pop (CpuMeasurement& measurement);
+
+    // measurements lost because nobody took them in time
+    long long getNumDropped() const;
+
+private:
+   #if MFX_INSTRUMENTATION
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<bool> mEnabled { false };
+    std::atomic<long long> mNumDropped { 0 };
+    SpscQueue<CpuMeasurement> mQueue { queueSize };
+
+    bool mTiming = false;
+    Clock::time_point mStart;
+    Clock::time_point mLast;
+    Clock::duration mSections[numTimedSections];
+   #endif
+};
+
+//==============================================================================
+/**
+    Collects the measurements on the reading side: the minimum, mean, maximum and 99th
+    percentile of the whole call and of each section, as a percentage of the time the
+    block lasts, and how many calls overran it. Allocates, so keep it off the audio thread.
+*/
+class CpuStats
+{
+public:
+    CpuStats();
+
+    void reset();
+    void add (const CpuMeasurement& measurement);
+
+    // adds everything waiting in the meter, returns how many there were
+    int addFrom (CpuMeter& meter);
+
+    struct Summary
+    {
+        double minimum;
+        double mean;
+        double maximum;
+        double p99;
+    };
+
+    // in percent of the block duration, all zeros before the first measurement
+    Summary getBlockSummary() const;
+    Summary getSectionSummary (timedSection section) const;
+
+    long long getNumBlocks() const      { return mNumBlocks; }
+
+    // calls that took longer than the audio they processed lasts
+    long long getNumOverruns() const    { return mNumOverruns; }
+
+    static const char* getSectionName (timedSection section);
+
+    // a table for people and the same figures as JSON for tools, to attach to a bug report
+    std::string toText() const;
+    std::string toJson() const;
+
+private:
+    // the loads go into logarithmic bins, 50 a decade from 1e-6 to 10 times the block duration
+    // (a 4.7% step), with everything below in the first one and everything above in the last
+    static constexpr int binsPerDecade = 50;
+    static constexpr int numDecades = 7;
+    static constexpr double lowestLoad = 1.0e-6;
+    static constexpr int numBins = binsPerDecade * numDecades + 2;
+
+    struct Histogram
+    {
+        long long count;
+        double minimum;
+        double maximum;
+        double sum;
+        std::vector<long long> bins;
+
+        void reset();
+        void add (double load);
+        Summary getSummary() const;
+    };
+
+    Histogram mBlock;
+    Histogram mSections[numTimedSections];
+
+    long long mNumBlocks;
+    long long mNumOverruns;
+    long long mNumDropped;
+    int mMinBlockSize;
+    int mMaxBlockSize;
+    double mSampleRate;
+};
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    DelayLine.h
+    Fixed whole-sample delay, used to line the dry signal up with the latency of
+    the oversampled distortion. The samples are kept as doubles, so float and
+    double processing can share one line and a float passes through unchanged.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "StateHash.h"
+
+#include <algorithm>
+#include <vector>
+
+//==============================================================================
+class DelayLine
+{
+public:
+    DelayLine() = default;
+
+    // allocates, so call it from prepare(). A delay of 0 makes process() do nothing
+    void setDelay (int numSamples)
+    {
+        mBuffer.assign ((size_t) std::max (0, numSamples), 0.0);
+        mPosition = 0;
+    }
+
+    int getDelay() const    { return (int) mBuffer.size(); }
+
+    void reset()
+    {
+        std::fill (mBuffer.begin(), mBuffer.end(), 0.0);
+        mPosition = 0;
+    }
+
+    // delays the samples in place
+    template <typename SampleType>
+    void process (SampleType* data, int numSamples)
+    {
+        const int delay = (int) mBuffer.size();
+
+        if (delay == 0)
+            return;
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const double delayed = mBuffer[(size_t) mPosition];
+            mBuffer[(size_t) mPosition] = data[sample];
+            data[sample] = (SampleType) delayed;
+
+            if (++mPosition == delay)
+                mPosition = 0;
+        }
+    }
+
+    // the samples waiting to come out, oldest first, so two lines that were reset at different
+    // times still hash the same once they hold the same samples
+    void addStateTo (StateHash& hash) const
+    {
+        const int delay = (int) mBuffer.size();
+
+        for (int sample = 0; sample < delay; ++sample)
+            hash.add (mBuffer[(size_t) ((mPosition + sample) % delay)]);
+    }
+
+private:
+    std::vector<double> mBuffer;
+    int mPosition = 0;
+};
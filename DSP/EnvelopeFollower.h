@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    EnvelopeFollower.h
+    One-pole attack/release follower of a signal's level, run one sample at a
+    time so it behaves the same whatever the block size.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+// what the follower tracks: the rectified signal (peak) or its square (mean square, the
+// caller takes the square root when it needs an RMS level)
+enum levelDetector
+{
+    peakLevel = 1,
+    rmsLevel
+};
+
+//==============================================================================
+class EnvelopeFollower
+{
+public:
+    EnvelopeFollower() = default;
+
+    // the times are how long the envelope takes to get 1 - 1/e of the way to a new level, rising
+    // and falling. Changing them keeps the current envelope
+    void setTimes (double sampleRate, double attackSeconds, double releaseSeconds)
+    {
+        mAttack = getCoefficient (sampleRate, attackSeconds);
+        mRelease = getCoefficient (sampleRate, releaseSeconds);
+        mAttackKeep = 1.0 - mAttack;
+        mReleaseKeep = 1.0 - mRelease;
+    }
+
+    void reset()                            { mEnvelope = 0.0; }
+
+    double getEnvelope() const              { return mEnvelope; }
+    void setEnvelope (double newEnvelope)   { mEnvelope = newEnvelope; }
+
+    // level is |x| for a peak follower or x * x for a mean square one, returns the new envelope.
+    // Both the rising and the falling envelope are worked out, which leaves a multiply, an add and
+    // a select on the path from one sample to the next. Copy the follower into a local around a
+    // loop, so the envelope can stay in a register
+    double process (double level)
+    {
+        const double rising = mEnvelope * mAttackKeep + level * mAttack;
+        const double falling = mEnvelope * mReleaseKeep + level * mRelease;
+
+        mEnvelope = level > mEnvelope ? rising : falling;
+        return mEnvelope;
+    }
+
+    // the same as numSamples calls to process (0.0), for a stretch of silence that isn't processed.
+    // Silence is always below the envelope, so it only ever releases
+    void decay (double numSamples)
+    {
+        mEnvelope *= std::pow (mReleaseKeep, numSamples);
+    }
+
+    template <typename SampleType>
+    static double getLevel (SampleType sample, levelDetector detector)
+    {
+        return detector == rmsLevel ? (double) sample * (double) sample : std::abs ((double) sample);
+    }
+
+private:
+    double mEnvelope = 0.0;
+    double mAttack = 1.0;
+    double mRelease = 1.0;
+    double mAttackKeep = 0.0;
+    double mReleaseKeep = 0.0;
+
+    static double getCoefficient (double sampleRate, double seconds)
+    {
+        const double numSamples = seconds * sampleRate;
+        return numSamples > 0.0 ? 1.0 - std::exp (-1.0 / numSamples) : 1.0;
+    }
+};
@@ -0,0 +1,595 @@
+/*
+  ==============================================================================
+
+    LfoOscillator.cpp
+
+  ==============================================================================
+*/
+
+#include "LfoOscillator.h"
+#include "SharedTables.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined (__x86_64__) || defined (_M_X64)
+ #define MFX_X86 1
+ #include <emmintrin.h>
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #define MFX_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    constexpr int sineTableSize = 2048;
+
+    // one full cycle plus two guard points, so the interpolation never has to wrap even
+    // when an angle just below twoPi rounds up to the last index
+    std::vector<double> designSineTable (double size, double)
+    {
+        std::vector<double> values ((size_t) size + 2);
+
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = std::sin (LfoOscillator::twoPi * (double) i / size);
+
+        return values;
+    }
+
+    const SharedTable& getSineTable()
+    {
+        static const SharedTable& table = SharedTables::get (sineTable, (double) sineTableSize, 0.0, designSineTable);
+        return table;
+    }
+
+    //==============================================================================
+    // two lanes of doubles. SSE2 and NEON are part of the 64-bit baselines, so no runtime dispatch
+    // is needed. Only plain multiplies, adds and subtracts are used, in the same order as the scalar
+    // rotator, so every lane comes out bit-identical to it
+   #if MFX_X86
+    using DoublePair = __m128d;
+
+    inline DoublePair makePair (double low, double high)        { return _mm_set_pd (high, low); }
+    inline DoublePair splatPair (double value)                  { return _mm_set1_pd (value); }
+    inline DoublePair addPair (DoublePair a, DoublePair b)      { return _mm_add_pd (a, b); }
+    inline DoublePair subtractPair (DoublePair a, DoublePair b) { return _mm_sub_pd (a, b); }
+    inline DoublePair multiplyPair (DoublePair a, DoublePair b) { return _mm_mul_pd (a, b); }
+    inline void storeLow (double* dest, DoublePair pair)        { _mm_storel_pd (dest, pair); }
+    inline void storeHigh (double* dest, DoublePair pair)       { _mm_storeh_pd (dest, pair); }
+    inline double getLow (DoublePair pair)                      { return _mm_cvtsd_f64 (pair); }
+    inline double getHigh (DoublePair pair)                     { return _mm_cvtsd_f64 (_mm_unpackhi_pd (pair, pair)); }
+
+    // same as LfoOscillator::wrapAngle: subtracts twoPi (or exactly 0) where the angle has reached it
+    inline DoublePair wrapPair (DoublePair angle)
+    {
+        const DoublePair twoPi = _mm_set1_pd (LfoOscillator::twoPi);
+        return _mm_sub_pd (angle, _mm_and_pd (_mm_cmpge_pd (angle, twoPi), twoPi));
+    }
+   #elif MFX_NEON
+    using DoublePair = float64x2_t;
+
+    inline DoublePair makePair (double low, double high)        { return vsetq_lane_f64 (high, vdupq_n_f64 (low), 1); }
+    inline DoublePair splatPair (double value)                  { return vdupq_n_f64 (value); }
+    inline DoublePair addPair (DoublePair a, DoublePair b)      { return vaddq_f64 (a, b); }
+    inline DoublePair subtractPair (DoublePair a, DoublePair b) { return vsubq_f64 (a, b); }
+    inline DoublePair multiplyPair (DoublePair a, DoublePair b) { return vmulq_f64 (a, b); }
+    inline void storeLow (double* dest, DoublePair pair)        { *dest = vgetq_lane_f64 (pair, 0); }
+    inline void storeHigh (double* dest, DoublePair pair)       { *dest = vgetq_lane_f64 (pair, 1); }
+    inline double getLow (DoublePair pair)                      { return vgetq_lane_f64 (pair, 0); }
+    inline double getHigh (DoublePair pair)                     { return vgetq_lane_f64 (pair, 1); }
+
+    inline DoublePair wrapPair (DoublePair angle)
+    {
+        const DoublePair twoPi = vdupq_n_f64 (LfoOscillator::twoPi);
+        const uint64x2_t reached = vcgeq_f64 (angle, twoPi);
+        return vsubq_f64 (angle, vreinterpretq_f64_u64 (vandq_u64 (reached, vreinterpretq_u64_f64 (twoPi))));
+    }
+   #else
+    struct DoublePair { double low, high; };
+
+    inline DoublePair makePair (double low, double high)        { return { low, high }; }
+    inline DoublePair splatPair (double value)                  { return { value, value }; }
+    inline DoublePair addPair (DoublePair a, DoublePair b)      { return { a.low + b.low, a.high + b.high }; }
+    inline DoublePair subtractPair (DoublePair a, DoublePair b) { return { a.low - b.low, a.high - b.high }; }
+    inline DoublePair multiplyPair (DoublePair a, DoublePair b) { return { a.low * b.low, a.high * b.high }; }
+    inline void storeLow (double* dest, DoublePair pair)        { *dest = pair.low; }
+    inline void storeHigh (double* dest, DoublePair pair)       { *dest = pair.high; }
+    inline double getLow (DoublePair pair)                      { return pair.low; }
+    inline double getHigh (DoublePair pair)                     { return pair.high; }
+
+    inline DoublePair wrapPair (DoublePair angle)
+    {
+        return { LfoOscillator::wrapAngle (angle.low), LfoOscillator::wrapAngle (angle.high) };
+    }
+   #endif
+
+    // complex multiply of (sin, cos) pairs, the same sums as LfoOscillator::rotate()
+    inline void rotatePair (DoublePair& s, DoublePair& c, DoublePair ds, DoublePair dc)
+    {
+        const DoublePair nextSin = addPair (multiplyPair (s, dc), multiplyPair (c, ds));
+        c = subtractPair (multiplyPair (c, dc), multiplyPair (s, ds));
+        s = nextSin;
+    }
+}
+
+//==============================================================================
+void LfoOscillator::setBackend (lfoBackend backend)
+{
+    mBackend = backend;
+
+    // make sure the static table is built before the audio thread needs it
+    if (mBackend == wavetableLfo)
+        getSineTable();
+
+    resync (mAngle);
+}
+
+void LfoOscillator::setAngleDelta (double delta)
+{
+    mAngleDelta = delta;
+    mDeltaSin = std::sin (delta);
+    mDeltaCos = std::cos (delta);
+    mDeltaResyncPending = false;
+    mRamping = false;
+
+    mAnchorPosition = mPosition;
+    mAnchorAngle = mAngle;
+    mCurveGridPoint = -1;
+    mCurveInterval = 0;
+
+    resync (mAngle);
+}
+
+void LfoOscillator::setAngleDeltaRamp (double deltaStep)
+{
+    mDeltaStepSin = std::sin (deltaStep);
+    mDeltaStepCos = std::cos (deltaStep);
+    mDeltaResyncPending = true;
+    mRamping = true;
+}
+
+void LfoOscillator::setAngle (double angle)
+{
+    mAngle = angle;
+
+    mAnchorPosition = mPosition;
+    mAnchorAngle = mAngle;
+    mCurveGridPoint = -1;
+
+    resync (mAngle);
+}
+
+void LfoOscillator::setPosition (long long position)
+{
+    if (position == mPosition)
+        return;
+
+    // from the grid point at or before the position, or from the anchor if that's in between,
+    // stepping on from there the way rendering would
+    long long start = position - (position & (resyncInterval - 1));
+
+    if (start < mAnchorPosition && mAnchorPosition <= position)
+        start = mAnchorPosition;
+
+    mPosition = start;
+    mAngle = getAngleAt (start);
+    mDeltaSin = std::sin (mAngleDelta);
+    mDeltaCos = std::cos (mAngleDelta);
+    resync (mAngle);
+
+    for (; mPosition < position; ++mPosition)
+    {
+        rotate();
+        mAngle = wrapAngle (mAngle + mAngleDelta);
+    }
+
+    // a ramp that is still running carries on from the next delta passed in
+    if (mRamping)
+        mDeltaResyncPending = true;
+}
+
+void LfoOscillator::reset()
+{
+    mPosition = 0;
+    mDeltaResyncPending = false;
+    mRamping = false;
+
+    setAngleDelta (mAngleDelta);
+    setAngle (0.0);
+}
+
+void LfoOscillator::addStateTo (StateHash& hash) const
+{
+    for (double value : { mAngle, mAngleDelta, mAnchorAngle, mSin, mCos, mDeltaSin, mDeltaCos, mDeltaStepSin, mDeltaStepCos })
+        hash.add (value);
+
+    hash.add (mPosition);
+    hash.add (mAnchorPosition);
+    hash.add ((int) mBackend);
+    hash.add (mDeltaResyncPending);
+    hash.add (mRamping);
+}
+
+double LfoOscillator::getAngleAt (long long position) const
+{
+    // far from the anchor the product drops the low bits the phase needs, so fma gets them back.
+    // That keeps the phase as accurate hours in as at the start
+    const double numSamples = (double) (position - mAnchorPosition);
+    const double product = mAngleDelta * numSamples;
+    const double lostBits = std::fma (mAngleDelta, numSamples, -product);
+    const double angle = std::fmod (std::fmod (product, twoPi) + lostBits + mAnchorAngle, twoPi);
+    return angle < 0.0 ? angle + twoPi : angle;
+}
+
+void LfoOscillator::reachGridPoint()
+{
+    // while ramping there's no closed form to go back to, so the angle carries on from the sum
+    // of the deltas and only the rotator is put back onto it
+    if (mRamping)
+        mDeltaResyncPending = true;
+    else
+        mAngle = getAngleAt (mPosition);
+
+    resync (mAngle);
+}
+
+void LfoOscillator::getCurveGridPoint (long long gridPoint, double& s, double& c)
+{
+    if (gridPoint != mCurveGridPoint)
+    {
+        const double angle = getAngleAt (gridPoint);
+        mCurveGridPoint = gridPoint;
+        mCurveSin = std::sin (angle);
+        mCurveCos = std::cos (angle);
+    }
+
+    s = mCurveSin;
+    c = mCurveCos;
+}
+
+void LfoOscillator::renderInterpolated (double* dest, long long position, int numSamples, int interval)
+{
+    if (interval != mCurveInterval)
+    {
+        mCurveInterval = interval;
+        mCurveStepSin = std::sin (mAngleDelta * (double) interval);
+        mCurveStepCos = std::cos (mAngleDelta * (double) interval);
+    }
+
+    const double step = 1.0 / (double) interval;
+    const double ds = mCurveStepSin, dc = mCurveStepCos;
+
+    // the slopes are per interval rather than per sample, as the curve goes from 0 to 1 over one
+    const double slopeScale = mAngleDelta * (double) interval;
+
+    // the point at or before the position, rotated on from the grid point before it
+    long long point = position - (position & (interval - 1));
+    const long long gridPoint = point - (point & (resyncInterval - 1));
+    double s, c;
+    getCurveGridPoint (gridPoint, s, c);
+
+    for (long long i = gridPoint; i < point; i += interval)
+    {
+        const double nextSin = s * dc + c * ds;
+        c = c * dc - s * ds;
+        s = nextSin;
+    }
+
+    for (int done = 0; done < numSamples;)
+    {
+        const long long nextPoint = point + interval;
+        double nextSin = s * dc + c * ds;
+        double nextCos = c * dc - s * ds;
+
+        if ((nextPoint & (resyncInterval - 1)) == 0)
+            getCurveGridPoint (nextPoint, nextSin, nextCos);
+
+        // y0 + d0 t + c2 t^2 + c3 t^3 for t from 0 to 1
+        const double y0 = s, y1 = nextSin;
+        const double d0 = slopeScale * c, d1 = slopeScale * nextCos;
+        const double c2 = 3.0 * (y1 - y0) - 2.0 * d0 - d1;
+        const double c3 = 2.0 * (y0 - y1) + d0 + d1;
+
+        const int first = (int) (position + done - point);
+        const int numThisTime = std::min (interval - first, numSamples - done);
+        double* out = dest + done;
+
+        for (int j = 0; j < numThisTime; ++j)
+        {
+            const double t = (double) (first + j) * step;
+            out[j] = ((c3 * t + c2) * t + d0) * t + y0;
+        }
+
+        done += numThisTime;
+        point = nextPoint;
+        s = nextSin;
+        c = nextCos;
+    }
+}
+
+void LfoOscillator::renderBlock (double* dest, int numSamples)
+{
+    const double delta = mAngleDelta;
+
+    // in runs that end on the next grid point at the latest
+    while (numSamples > 0)
+    {
+        const int numThisTime = std::min (numSamples, getSamplesUntilGridPoint());
+        double angle = mAngle;
+
+        switch (mBackend)
+        {
+            case wavetableLfo:
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = lookUpSine (angle);
+                    angle = wrapAngle (angle + delta);
+                }
+                break;
+
+            case rotatorLfo:
+            {
+                double s = mSin, c = mCos;
+                const double ds = mDeltaSin, dc = mDeltaCos;
+
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = s;
+
+                    const double nextSin = s * dc + c * ds;
+                    c = c * dc - s * ds;
+                    s = nextSin;
+
+                    angle = wrapAngle (angle + delta);
+                }
+
+                mSin = s;
+                mCos = c;
+                break;
+            }
+
+            case exactLfo:
+            default:
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = std::sin (angle);
+                    angle = wrapAngle (angle + delta);
+                }
+                break;
+        }
+
+        mAngle = angle;
+        mPosition += numThisTime;
+
+        if ((mPosition & (resyncInterval - 1)) == 0)
+            reachGridPoint();
+
+        dest += numThisTime;
+        numSamples -= numThisTime;
+    }
+}
+
+void LfoOscillator::renderBlock (double* dest, const double* angleDeltas, int numSamples)
+{
+    while (numSamples > 0)
+    {
+        const int numThisTime = std::min (numSamples, getSamplesUntilGridPoint());
+        double angle = mAngle;
+
+        switch (mBackend)
+        {
+            case wavetableLfo:
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = lookUpSine (angle);
+                    angle = wrapAngle (angle + angleDeltas[i]);
+                }
+                break;
+
+            case rotatorLfo:
+            {
+                // every step only depends on the state carried over from the previous sample, so the
+                // output is the same however the ramp is split up into calls
+                if (mDeltaResyncPending)
+                {
+                    mDeltaSin = std::sin (angleDeltas[0]);
+                    mDeltaCos = std::cos (angleDeltas[0]);
+                    mDeltaResyncPending = false;
+                }
+
+                double s = mSin, c = mCos;
+                double ds = mDeltaSin, dc = mDeltaCos;
+                const double qs = mDeltaStepSin, qc = mDeltaStepCos;
+
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = s;
+
+                    const double nextSin = s * dc + c * ds;
+                    c = c * dc - s * ds;
+                    s = nextSin;
+
+                    const double nextDeltaSin = ds * qc + dc * qs;
+                    dc = dc * qc - ds * qs;
+                    ds = nextDeltaSin;
+
+                    angle = wrapAngle (angle + angleDeltas[i]);
+                }
+
+                mSin = s;
+                mCos = c;
+                mDeltaSin = ds;
+                mDeltaCos = dc;
+                break;
+            }
+
+            case exactLfo:
+            default:
+                for (int i = 0; i < numThisTime; ++i)
+                {
+                    dest[i] = std::sin (angle);
+                    angle = wrapAngle (angle + angleDeltas[i]);
+                }
+                break;
+        }
+
+        mAngle = angle;
+        mPosition += numThisTime;
+
+        if ((mPosition & (resyncInterval - 1)) == 0)
+            reachGridPoint();
+
+        dest += numThisTime;
+        angleDeltas += numThisTime;
+        numSamples -= numThisTime;
+    }
+}
+
+void LfoOscillator::renderLanes (LfoOscillator* oscillators, int numLanes, double* const* dest,
+                                 const double* angleDeltas, int numSamples)
+{
+    bool inStep = numLanes > 1 && numLanes <= maxLanes;
+
+    for (int lane = 0; lane < numLanes && inStep; ++lane)
+    {
+        const auto& oscillator = oscillators[lane];
+
+        inStep = oscillator.mBackend == rotatorLfo
+                  && oscillator.mPosition == oscillators[0].mPosition
+                  && oscillator.mDeltaResyncPending == oscillators[0].mDeltaResyncPending;
+    }
+
+    if (! inStep)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            if (angleDeltas != nullptr)
+                oscillators[lane].renderBlock (dest[lane], angleDeltas, numSamples);
+            else
+                oscillators[lane].renderBlock (dest[lane], numSamples);
+        }
+
+        return;
+    }
+
+    // the number of pairs is a template argument so the state arrays below live in registers
+    switch ((numLanes + 1) / 2)
+    {
+        case 1:     angleDeltas != nullptr ? renderRotatorLanes<1, true> (oscillators, numLanes, dest, angleDeltas, numSamples)
+                                           : renderRotatorLanes<1, false> (oscillators, numLanes, dest, angleDeltas, numSamples); break;
+        case 2:     angleDeltas != nullptr ? renderRotatorLanes<2, true> (oscillators, numLanes, dest, angleDeltas, numSamples)
+                                           : renderRotatorLanes<2, false> (oscillators, numLanes, dest, angleDeltas, numSamples); break;
+        case 3:     angleDeltas != nullptr ? renderRotatorLanes<3, true> (oscillators, numLanes, dest, angleDeltas, numSamples)
+                                           : renderRotatorLanes<3, false> (oscillators, numLanes, dest, angleDeltas, numSamples); break;
+        default:    angleDeltas != nullptr ? renderRotatorLanes<4, true> (oscillators, numLanes, dest, angleDeltas, numSamples)
+                                           : renderRotatorLanes<4, false> (oscillators, numLanes, dest, angleDeltas, numSamples); break;
+    }
+}
+
+template <int numPairs, bool isRamping>
+void LfoOscillator::renderRotatorLanes (LfoOscillator* oscillators, int numLanes, double* const* dest,
+                                        const double* angleDeltas, int numSamples)
+{
+    // with an odd number of lanes the last pair's high lane repeats the low one and isn't stored
+    const auto getLane = [numLanes] (int pair, int half) { return pair * 2 + half < numLanes ? pair * 2 + half : pair * 2; };
+    const bool lastPairIsFull = (numLanes & 1) == 0;
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int numThisTime = std::min (numSamples - done, oscillators[0].getSamplesUntilGridPoint());
+
+        if (isRamping && oscillators[0].mDeltaResyncPending)
+        {
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                oscillators[lane].mDeltaSin = std::sin (angleDeltas[done]);
+                oscillators[lane].mDeltaCos = std::cos (angleDeltas[done]);
+                oscillators[lane].mDeltaResyncPending = false;
+            }
+        }
+
+        DoublePair s[numPairs], c[numPairs], ds[numPairs], dc[numPairs], qs[numPairs], qc[numPairs], angle[numPairs], delta[numPairs];
+
+        for (int pair = 0; pair < numPairs; ++pair)
+        {
+            const auto& low = oscillators[getLane (pair, 0)];
+            const auto& high = oscillators[getLane (pair, 1)];
+
+            s[pair] = makePair (low.mSin, high.mSin);
+            c[pair] = makePair (low.mCos, high.mCos);
+            ds[pair] = makePair (low.mDeltaSin, high.mDeltaSin);
+            dc[pair] = makePair (low.mDeltaCos, high.mDeltaCos);
+            qs[pair] = makePair (low.mDeltaStepSin, high.mDeltaStepSin);
+            qc[pair] = makePair (low.mDeltaStepCos, high.mDeltaStepCos);
+            angle[pair] = makePair (low.mAngle, high.mAngle);
+            delta[pair] = makePair (low.mAngleDelta, high.mAngleDelta);
+        }
+
+        for (int i = done; i < done + numThisTime; ++i)
+        {
+            for (int pair = 0; pair < numPairs; ++pair)
+            {
+                storeLow (dest[pair * 2] + i, s[pair]);
+
+                if (pair < numPairs - 1 || lastPairIsFull)
+                    storeHigh (dest[pair * 2 + 1] + i, s[pair]);
+
+                rotatePair (s[pair], c[pair], ds[pair], dc[pair]);
+
+                if (isRamping)
+                {
+                    rotatePair (ds[pair], dc[pair], qs[pair], qc[pair]);
+                    angle[pair] = wrapPair (addPair (angle[pair], splatPair (angleDeltas[i])));
+                }
+                else
+                {
+                    angle[pair] = wrapPair (addPair (angle[pair], delta[pair]));
+                }
+            }
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            auto& oscillator = oscillators[lane];
+            const int pair = lane / 2;
+            const auto get = [lane] (DoublePair value) { return (lane & 1) == 0 ? getLow (value) : getHigh (value); };
+
+            oscillator.mSin = get (s[pair]);
+            oscillator.mCos = get (c[pair]);
+            oscillator.mAngle = get (angle[pair]);
+
+            if (isRamping)
+            {
+                oscillator.mDeltaSin = get (ds[pair]);
+                oscillator.mDeltaCos = get (dc[pair]);
+            }
+
+            oscillator.mPosition += numThisTime;
+
+            if ((oscillator.mPosition & (resyncInterval - 1)) == 0)
+                oscillator.reachGridPoint();
+        }
+
+        done += numThisTime;
+    }
+}
+
+void LfoOscillator::resync (double angle)
+{
+    mSin = std::sin (angle);
+    mCos = std::cos (angle);
+}
+
+double LfoOscillator::lookUpSine (double angle)
+{
+    static const auto& table = getSineTable();
+
+    const double position = angle * ((double) sineTableSize / twoPi);
+    const int index = (int) position;
+    const double fraction = position - (double) index;
+
+    const double a = table[index];
+    const double b = table[index + 1];
+
+    return a + fraction * (b - a);
+}
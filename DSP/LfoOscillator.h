@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    LfoOscillator.h
+    Sine LFO/carrier used by the modulation and pulsing stages. It replaces the
+    per-sample std::sin + std::fmod with one of a few selectable backends, and
+    keeps its phase tied to an absolute sample position.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "StateHash.h"
+
+#include <cmath>
+
+// accuracy figures are the worst absolute difference from std::sin of the exact
+// phase (as measured by "mfx_bench --suite oscillator")
+enum lfoBackend
+{
+    exactLfo = 1,   // std::sin per sample of the angle, accumulated between grid points
+    wavetableLfo,   // linearly interpolated 2048 point table, error < 1.2e-6
+    rotatorLfo      // recursive complex rotator resynced every 256 samples, error < 1e-13
+};
+
+//==============================================================================
+class LfoOscillator
+{
+public:
+    // same value as juce::MathConstants<double>::twoPi
+    static constexpr double twoPi = 2.0 * 3.141592653589793238;
+
+    // the grid points are every resyncInterval samples from sample 0. With a fixed delta the angle
+    // is put back there onto the one worked out in closed form from the anchor (the position and
+    // angle the delta was set at), and the rotator onto the exact sin/cos of it, which keeps its
+    // amplitude and phase from drifting. In between the angle is accumulated. So the phase at a
+    // sample only depends on its position, not on the block sizes or where rendering started
+    static constexpr int resyncInterval = 256;
+    static_assert ((resyncInterval & (resyncInterval - 1)) == 0, "the grid is found with a mask");
+
+    // the most oscillators renderLanes() runs side by side
+    static constexpr int maxLanes = 8;
+
+    LfoOscillator() = default;
+
+    void setBackend (lfoBackend backend);
+    lfoBackend getBackend() const   { return mBackend; }
+
+    // delta is in radians per sample and has to stay below twoPi. The phase carries on from where
+    // it is, which becomes the anchor
+    void setAngleDelta (double delta);
+    double getAngleDelta() const    { return mAngleDelta; }
+
+    // sets the angle at the current position, and anchors the phase there
+    void setAngle (double angle);
+    double getAngle() const         { return mAngle; }
+
+    // the position of the next sample, which every sample rendered moves on by one
+    long long getPosition() const   { return mPosition; }
+
+    // jumps to position (forwards or back) without rendering anything, ending up exactly where
+    // rendering every sample up to it at the current delta would have. Used to start mid-file, and
+    // to catch up after a stretch where the output wasn't needed. While ramping it goes on at the
+    // delta from before the ramp, and the ramp carries on from the next delta passed in
+    void setPosition (long long position);
+
+    // back to angle 0 at position 0, with the delta kept
+    void reset();
+
+    // everything that carries over from one sample to the next, for StateHash comparisons
+    void addStateTo (StateHash& hash) const;
+
+    // returns the sine of the current angle and then advances the phase, like the old getLfoSample + advancedLfoPhase pair
+    inline double getNextSample()
+    {
+        double sample;
+
+        switch (mBackend)
+        {
+            case wavetableLfo:
+                sample = lookUpSine (mAngle);
+                break;
+
+            case rotatorLfo:
+                sample = mSin;
+                rotate();
+                break;
+
+            case exactLfo:
+            default:
+                sample = std::sin (mAngle);
+                break;
+        }
+
+        mAngle = wrapAngle (mAngle + mAngleDelta);
+
+        if ((++mPosition & (resyncInterval - 1)) == 0)
+            reachGridPoint();
+
+        return sample;
+    }
+
+    // fills dest with the next numSamples values. This is the fast path: the backend is
+    // picked once and the state stays in registers for the whole run
+    void renderBlock (double* dest, int numSamples);
+
+    // same again, but advancing the phase by angleDeltas[i] after sample i instead of by the
+    // fixed delta. Used while a frequency is ramping, which has to be announced with
+    // setAngleDeltaRamp() first: the rotator expects the deltas to grow by that step every
+    // sample, so it can rotate its per-sample rotation instead of taking sin/cos of each delta
+    void renderBlock (double* dest, const double* angleDeltas, int numSamples);
+
+    // starts a linear ramp of the per-sample delta, lasting until the next setAngleDelta()
+    void setAngleDeltaRamp (double deltaStep);
+    bool isRamping() const          { return mRamping; }
+
+    // renders numLanes (up to maxLanes) oscillators at once, oscillator i into dest[i], the same as
+    // calling renderBlock() on each of them. The rotators are run as SIMD lanes, two to a register,
+    // so their dependency chains overlap instead of each oscillator waiting on its own. That needs
+    // the oscillators to be in step (at the same position, as they are when they're always set up
+    // together); otherwise, and for the other backends, it just calls renderBlock() on each.
+    // angleDeltas is the per-sample ramp shared by all of them, or nullptr for their fixed deltas
+    static void renderLanes (LfoOscillator* oscillators, int numLanes, double* const* dest,
+                             const double* angleDeltas, int numSamples);
+
+    // for a slow LFO: the sine at every interval-th position counted from 0 (interval being a power
+    // of two up to resyncInterval), with a cubic Hermite curve through them, whose slopes are the
+    // exact derivatives, for the numSamples positions from position on. The points are worked out
+    // in closed form on the grid and rotated on from there, the same way whichever block they're
+    // rendered in, so the values only depend on the position. It neither uses nor moves the
+    // backend's state, so oscillators in step can share one curve. For a fixed delta only, not
+    // while ramping. The curve is within (delta * interval)^4 / 384 of the sine
+    void renderInterpolated (double* dest, long long position, int numSamples, int interval);
+
+    // branch-free replacement for std::fmod (angle, twoPi), valid while angle < 2 * twoPi.
+    // for angle in [twoPi, 2 * twoPi) the subtraction is exact, so this gives the same result as fmod
+    static inline double wrapAngle (double angle)
+    {
+        return angle - twoPi * (double) (angle >= twoPi);
+    }
+
+    // interpolated table read used by the wavetable backend, angle must be in [0, twoPi)
+    static double lookUpSine (double angle);
+
+private:
+    lfoBackend mBackend = exactLfo;
+
+    double mAngle = 0.0;
+    double mAngleDelta = 0.0;
+    long long mPosition = 0;
+
+    // where the phase was when the delta was last set, the closed form is worked out from here
+    long long mAnchorPosition = 0;
+    double mAnchorAngle = 0.0;
+
+    // rotator state: sin/cos of the current angle and of the per-sample delta
+    double mSin = 0.0, mCos = 1.0;
+    double mDeltaSin = 0.0, mDeltaCos = 1.0;
+
+    // while ramping: sin/cos of the ramp step, and whether the delta's sin/cos have to be taken
+    // again from the next delta passed in (at the start of a ramp and after each grid point)
+    double mDeltaStepSin = 0.0, mDeltaStepCos = 1.0;
+    bool mDeltaResyncPending = false;
+    bool mRamping = false;
+
+    // renderInterpolated(): sin/cos at the last grid point it worked out, and of the angle between
+    // two of its points. Setting the delta or the angle throws them away
+    long long mCurveGridPoint = -1;
+    double mCurveSin = 0.0, mCurveCos = 1.0;
+    int mCurveInterval = 0;
+    double mCurveStepSin = 0.0, mCurveStepCos = 1.0;
+
+    int getSamplesUntilGridPoint() const    { return resyncInterval - (int) (mPosition & (resyncInterval - 1)); }
+
+    // the angle at position, going on from the anchor at the current delta
+    double getAngleAt (long long position) const;
+
+    // sin/cos of the angle at a grid point, for renderInterpolated()
+    void getCurveGridPoint (long long gridPoint, double& s, double& c);
+
+    inline void rotate()
+    {
+        const double nextSin = mSin * mDeltaCos + mCos * mDeltaSin;
+        const double nextCos = mCos * mDeltaCos - mSin * mDeltaSin;
+        mSin = nextSin;
+        mCos = nextCos;
+    }
+
+    void resync (double angle);
+    void reachGridPoint();
+
+    template <int numPairs, bool isRamping>
+    static void renderRotatorLanes (LfoOscillator* oscillators, int numLanes, double* const* dest,
+                                    const double* angleDeltas, int numSamples);
+};
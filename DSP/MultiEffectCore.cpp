@@ -0,0 +1,2139 @@
+/*
+  ==============================================================================
+
+    MultiEffectCore.cpp
+
+  ==============================================================================
+*/
+
+#include "MultiEffectCore.h"
+#include "VectorOps.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+
+namespace
+{
+    constexpr double twoPi = LfoOscillator::twoPi;
+}
+
+//==============================================================================
+MultiEffectCore::MultiEffectCore()
+{
+    mSampleRate = 44100.0;
+    mNumChannels = 2;
+
+    mModFreqSliderValue = MOD_FREQ_INIT;
+    mOverdriveSliderValue = OVERDRIVE_INIT;
+    mPulserFreqSliderValue = PULSER_FREQ_INIT;
+    mDistMixSliderValue = DIST_MIX_INIT;
+    mBypassed = false;
+    mModEnabled = true;
+    mDistEnabled = true;
+    mPulserEnabled = true;
+
+    mLevelAttackValue = LEVEL_ATTACK_INIT;
+    mLevelReleaseValue = LEVEL_RELEASE_INIT;
+    mLevelDetector = peakLevel;
+    mLevelLinked = false;
+
+    mModAngleDelta = 0.0;
+    mPulserAngleDelta = 0.0;
+    mLfoBackend = rotatorLfo;
+
+    mModType = rm;
+    mDistType = hard;
+
+    mTanhApprox = padeTanh;
+    mSpecialisedProcessing = true;
+    mChannelLanes = 4;
+    mPulserControlInterval = 1;
+
+    mQualityTier = fullQuality;
+    mActiveTanh = padeTanh;
+    mFadingFromTanh = padeTanh;
+    mActivePulserInterval = 1;
+    mLightPathAvailable = false;
+    mFullPathRunning = true;
+    mLightPathRunning = false;
+    mQualityWarmUp = 0;
+    mLightFadePending = false;
+
+    mModRamping = false;
+    mOverdriveRamping = false;
+    mPulserRamping = false;
+    mDistMixRamping = false;
+    mBypassRamping = false;
+    mModTypeRamping = false;
+    mDistTypeRamping = false;
+    mModDepthRamping = false;
+    mPulserDepthRamping = false;
+    mTanhFading = false;
+    mLightFading = false;
+    mPulserInterpolated = false;
+    mChainParked = false;
+    mBypassDryDelayed = false;
+
+    mIdleFastPaths = true;
+    mTailSamples = 0;
+    mSilentSamples = 0;
+    mIdle = false;
+    mIdleSamples = 0.0;
+    mSamplePosition = 0;
+
+    mOversamplingFactor = 1;
+    mOversamplingFilter = iirOversampling;
+    mOversamplersRunning = false;
+
+    setModType (rm);
+    setDistType (hard);
+    setModFreq (MOD_FREQ_INIT);
+    setOverdrive (OVERDRIVE_INIT);
+    setPulserFreq (PULSER_FREQ_INIT);
+    setDistMix (DIST_MIX_INIT);
+    setLevelAttack (LEVEL_ATTACK_INIT);
+    setLevelRelease (LEVEL_RELEASE_INIT);
+    setLevelDetector (peakLevel);
+    setLevelLink (false);
+    setBypassed (false);
+    setModEnabled (true);
+    setDistEnabled (true);
+    setPulserEnabled (true);
+    setStageOrder (StageOrder());
+
+    prepare (mSampleRate);
+}
+
+void MultiEffectCore::prepare (double sampleRate)
+{
+    prepare (sampleRate, mNumChannels);
+}
+
+void MultiEffectCore::prepare (double sampleRate, int numChannels)
+{
+    mSampleRate = sampleRate;
+
+    // a change in channel count starts every oscillator from scratch, so all the channels stay in phase
+    numChannels = std::min (std::max (numChannels, 1), maxChannels);
+
+    if (numChannels != (int) mModLfos.size())
+    {
+        mModLfos.assign ((size_t) numChannels, LfoOscillator());
+        mPulserLfos.assign ((size_t) numChannels, LfoOscillator());
+        mOversamplers.resize ((size_t) numChannels);
+        mLightOversamplers.resize ((size_t) numChannels);
+        mLightDelays.resize ((size_t) numChannels);
+        mDryDelays.resize ((size_t) numChannels);
+        mDryBlocks.assign ((size_t) (numChannels * subBlockSize), 0.0);
+        mBypassDryBlocks.assign ((size_t) (numChannels * subBlockSize), 0.0);
+        mLevelDelays.resize ((size_t) numChannels);
+        mBypassDelays.resize ((size_t) numChannels);
+        mInputFollowers.resize ((size_t) numChannels);
+        mOutputFollowers.resize ((size_t) numChannels);
+    }
+
+    mNumChannels = numChannels;
+
+    // every instance starts at full quality
+    mQualityTier = fullQuality;
+    mLastQualityTier.store (fullQuality, std::memory_order_relaxed);
+    setLfoBackend (mLfoBackend);
+
+    for (auto* ramp : { &mModAngleDeltaRamp, &mOverdriveRamp, &mPulserAngleDeltaRamp, &mDistMixRamp, &mModTypeRamp, &mDistTypeRamp,
+                        &mModDepthRamp, &mPulserDepthRamp, &mTanhFadeRamp, &mLightFadeRamp })
+        ramp->reset (mSampleRate, parameterRampSeconds);
+
+    mBypassRamp.reset (mSampleRate, bypassRampSeconds);
+
+    // set param values before playback, the angle deltas depend on the sample rate so everything
+    // is refreshed, and nothing ramps in from the old values. A snapshot's values are in the store
+    // already, so it only needs taking out of the way
+    takeSnapshot();
+    updateParameters (mParameters.takeChanges() | ParameterStore::allParameters);
+    finishRamps();
+    mChain = mNextChain.load (std::memory_order_acquire);
+
+    // the LFOs start from angle 0 at sample 0, the phase is worked out from there
+    mSamplePosition = 0;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        mModLfos[(size_t) channel].reset();
+        mModLfos[(size_t) channel].setAngleDelta (mModAngleDelta);
+        mPulserLfos[(size_t) channel].reset();
+        mPulserLfos[(size_t) channel].setAngleDelta (mPulserAngleDelta);
+    }
+
+    // the kernel hands the oversamplers one sub-block at a time
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        mOversamplers[channel].prepare (mSampleRate, mOversamplingFactor, mOversamplingFilter, subBlockSize);
+        mDryDelays[channel].setDelay (mOversamplers[channel].getLatencySamples());
+        mLevelDelays[channel].setDelay (mOversamplers[channel].getLatencySamples());
+        mBypassDelays[channel].setDelay (mOversamplers[channel].getLatencySamples());
+    }
+
+    // the lighter oversampling for minimumQuality, delayed up to the latency of the full one
+    mLightPathAvailable = getAdaptiveQuality() && mOversamplingFactor > 1;
+
+    if (mLightPathAvailable)
+    {
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            mLightOversamplers[channel].prepare (mSampleRate, mOversamplingFactor / 2, mOversamplingFilter, subBlockSize);
+            mLightDelays[channel].setDelay (mOversamplers[channel].getLatencySamples() - mLightOversamplers[channel].getLatencySamples());
+        }
+    }
+
+    mQualityGovernor.setLowestTier (mLightPathAvailable ? minimumQuality : lowQuality);
+    mQualityGovernor.prepare (mSampleRate);
+    applyQualityTier (false);
+
+    mOversamplersRunning = false;
+    mChainParked = false;
+    mBypassDryDelayed = false;
+    mTailSamples = measureTailSamples();
+
+    // the follower times depend on the sample rate, and every level starts from silence
+    updateLevelFollowers (false, false);
+    resetLevelFollowers();
+
+    // everything is empty, as if the input had been silent for ever
+    mSilentSamples = mTailSamples;
+    mIdle = false;
+    mIdleSamples = 0.0;
+}
+
+void MultiEffectCore::reset()
+{
+    mSamplePosition = 0;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        mModLfos[(size_t) channel].reset();
+        mPulserLfos[(size_t) channel].reset();
+        mOversamplers[(size_t) channel].reset();
+        mLightOversamplers[(size_t) channel].reset();
+        mDryDelays[(size_t) channel].reset();
+        mLevelDelays[(size_t) channel].reset();
+        mBypassDelays[(size_t) channel].reset();
+        mLightDelays[(size_t) channel].reset();
+    }
+
+    mOversamplersRunning = false;
+    mChainParked = false;
+    mBypassDryDelayed = false;
+
+    finishRamps();
+    resetLevelFollowers();
+
+    mSilentSamples = mTailSamples;
+    mIdle = false;
+    mIdleSamples = 0.0;
+}
+
+void MultiEffectCore::resetLevelFollowers()
+{
+    for (auto* followers : { &mInputFollowers, &mOutputFollowers })
+        for (auto& follower : *followers)
+            follower.reset();
+
+    mLinkedInputFollower.reset();
+    mLinkedOutputFollower.reset();
+}
+
+int MultiEffectCore::measureTailSamples() const
+{
+    if (mOversamplers[0].getFactor() == 1)
+        return 0;
+
+    // -140dB below a full scale impulse, and a second at the most
+    const double threshold = 1.0e-7;
+    const int maxTailSamples = (int) mSampleRate;
+
+    Oversampler oversampler;
+    oversampler.prepare (mSampleRate, mOversamplingFactor, mOversamplingFilter, subBlockSize);
+
+    double block[subBlockSize];
+    int tailSamples = 0;
+
+    // carries on until a whole sub-block has stayed below the threshold
+    for (int start = 0; start < tailSamples + subBlockSize && start < maxTailSamples; start += subBlockSize)
+    {
+        std::fill (block, block + subBlockSize, 0.0);
+
+        if (start == 0)
+            block[0] = 1.0;
+
+        oversampler.upsample (block, subBlockSize);
+        oversampler.downsample (block, subBlockSize);
+
+        for (int sample = 0; sample < subBlockSize; ++sample)
+            if (std::abs (block[sample]) > threshold)
+                tailSamples = start + sample + 1;
+    }
+
+    return std::min (tailSamples, maxTailSamples);
+}
+
+//======== GET/SET FUNCTIONS =====================================================
+modType MultiEffectCore::getModType() const
+{
+    return (modType) (int) mParameters.get (modTypeParam);
+}
+
+void MultiEffectCore::setModType (modType type)
+{
+    mParameters.set (modTypeParam, limitParameter (modTypeParam, type));
+}
+
+distType MultiEffectCore::getDistType() const
+{
+    return (distType) (int) mParameters.get (distTypeParam);
+}
+
+void MultiEffectCore::setDistType (distType type)
+{
+    mParameters.set (distTypeParam, limitParameter (distTypeParam, type));
+}
+
+double MultiEffectCore::getModFreq() const
+{
+    return mParameters.get (modFreqParam);
+}
+
+void MultiEffectCore::setModFreq (double freq)
+{
+    mParameters.set (modFreqParam, limitParameter (modFreqParam, freq));
+}
+
+double MultiEffectCore::getOverdrive() const
+{
+    return mParameters.get (overdriveParam);
+}
+
+void MultiEffectCore::setOverdrive (double value)
+{
+    mParameters.set (overdriveParam, limitParameter (overdriveParam, value));
+}
+
+double MultiEffectCore::getPulserFreq() const
+{
+    return mParameters.get (pulserFreqParam);
+}
+
+void MultiEffectCore::setPulserFreq (double freq)
+{
+    mParameters.set (pulserFreqParam, limitParameter (pulserFreqParam, freq));
+}
+
+double MultiEffectCore::getDistMix() const
+{
+    return mParameters.get (distMixParam);
+}
+
+void MultiEffectCore::setDistMix (double mix)
+{
+    mParameters.set (distMixParam, limitParameter (distMixParam, mix));
+}
+
+double MultiEffectCore::getLevelAttack() const
+{
+    return mParameters.get (levelAttackParam);
+}
+
+void MultiEffectCore::setLevelAttack (double milliseconds)
+{
+    mParameters.set (levelAttackParam, limitParameter (levelAttackParam, milliseconds));
+}
+
+double MultiEffectCore::getLevelRelease() const
+{
+    return mParameters.get (levelReleaseParam);
+}
+
+void MultiEffectCore::setLevelRelease (double milliseconds)
+{
+    mParameters.set (levelReleaseParam, limitParameter (levelReleaseParam, milliseconds));
+}
+
+levelDetector MultiEffectCore::getLevelDetector() const
+{
+    return (levelDetector) (int) mParameters.get (levelDetectorParam);
+}
+
+void MultiEffectCore::setLevelDetector (levelDetector detector)
+{
+    mParameters.set (levelDetectorParam, limitParameter (levelDetectorParam, detector));
+}
+
+bool MultiEffectCore::getLevelLink() const
+{
+    return mParameters.get (levelLinkParam) != 0.0;
+}
+
+void MultiEffectCore::setLevelLink (bool shouldBeLinked)
+{
+    mParameters.set (levelLinkParam, shouldBeLinked ? 1.0 : 0.0);
+}
+
+bool MultiEffectCore::getBypassed() const
+{
+    return mParameters.get (bypassParam) != 0.0;
+}
+
+void MultiEffectCore::setBypassed (bool shouldBeBypassed)
+{
+    mParameters.set (bypassParam, shouldBeBypassed ? 1.0 : 0.0);
+}
+
+bool MultiEffectCore::getModEnabled() const
+{
+    return mParameters.get (modEnabledParam) != 0.0;
+}
+
+void MultiEffectCore::setModEnabled (bool shouldBeEnabled)
+{
+    mParameters.set (modEnabledParam, shouldBeEnabled ? 1.0 : 0.0);
+}
+
+bool MultiEffectCore::getDistEnabled() const
+{
+    return mParameters.get (distEnabledParam) != 0.0;
+}
+
+void MultiEffectCore::setDistEnabled (bool shouldBeEnabled)
+{
+    mParameters.set (distEnabledParam, shouldBeEnabled ? 1.0 : 0.0);
+}
+
+bool MultiEffectCore::getPulserEnabled() const
+{
+    return mParameters.get (pulserEnabledParam) != 0.0;
+}
+
+void MultiEffectCore::setPulserEnabled (bool shouldBeEnabled)
+{
+    mParameters.set (pulserEnabledParam, shouldBeEnabled ? 1.0 : 0.0);
+}
+
+void MultiEffectCore::setParameters (const ParameterSnapshot& snapshot)
+{
+    ParameterSnapshot limited = snapshot;
+
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+        limited.values[parameter] = limitParameter ((parameterId) parameter, snapshot.values[parameter]);
+
+    mParameters.setSnapshot (limited);
+}
+
+ParameterSnapshot MultiEffectCore::getParameters() const
+{
+    ParameterSnapshot snapshot;
+
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+        snapshot.values[parameter] = mParameters.get ((parameterId) parameter);
+
+    snapshot.mask = ParameterStore::allParameters;
+    return snapshot;
+}
+
+StageOrder MultiEffectCore::getStageOrder() const
+{
+    return StageOrder::fromCode (mStageOrderCode.load (std::memory_order_relaxed));
+}
+
+void MultiEffectCore::setStageOrder (const StageOrder& order)
+{
+    const StageOrder validOrder = order.isValid() ? order : StageOrder();
+
+    mNextChain.store (&getCompiledChain (validOrder), std::memory_order_release);
+    mStageOrderCode.store (validOrder.getCode(), std::memory_order_relaxed);
+}
+
+void MultiEffectCore::setOversampling (int factor, oversamplingFilter filter)
+{
+    mOversamplingFactor = factor >= Oversampler::maxFactor ? Oversampler::maxFactor : (factor >= 4 ? 4 : (factor >= 2 ? 2 : 1));
+    mOversamplingFilter = (filter == firOversampling) ? firOversampling : iirOversampling;
+}
+
+int MultiEffectCore::getLatencySamples() const
+{
+    return mOversamplers[0].getLatencySamples();
+}
+
+double MultiEffectCore::limitParameter (parameterId parameter, double value)
+{
+    switch (parameter)
+    {
+        case modFreqParam:
+            // limit the modulation frequency to 0 - MOD_FREQ_LIMIT kHz
+            value = (value < 0.0) ? 0.0 : value;
+            return (value > MOD_FREQ_LIMIT) ? MOD_FREQ_LIMIT : value;
+
+        case overdriveParam:
+            // limit the overdrive gain factor to 1 - OVERDRIVE_LIMIT
+            value = (value <= 1.0) ? 1.0 : value;
+            return (value > OVERDRIVE_LIMIT) ? OVERDRIVE_LIMIT : value;
+
+        case pulserFreqParam:
+            // limit the pulser frequency to 0 - PULSER_FREQ_LIMIT Hz
+            value = (value < 0.0) ? 0.0 : value;
+            return (value > PULSER_FREQ_LIMIT) ? PULSER_FREQ_LIMIT : value;
+
+        case modTypeParam:
+            // if an unexpected value comes in for "type" argument, default to RM
+            return (value == am) ? am : rm;
+
+        case distTypeParam:
+            // if an unexpected value comes in for "type" argument, default to hard clipping
+            return (value == soft) ? soft : hard;
+
+        case distMixParam:
+            // limit the mix to 0 (dry) - 1 (wet)
+            value = (value < 0.0) ? 0.0 : value;
+            return (value > 1.0) ? 1.0 : value;
+
+        case levelAttackParam:
+            // limit the attack to 0.1 - LEVEL_ATTACK_LIMIT ms
+            value = (value < 0.1) ? 0.1 : value;
+            return (value > LEVEL_ATTACK_LIMIT) ? LEVEL_ATTACK_LIMIT : value;
+
+        case levelReleaseParam:
+            // limit the release to 0.1 - LEVEL_RELEASE_LIMIT ms
+            value = (value < 0.1) ? 0.1 : value;
+            return (value > LEVEL_RELEASE_LIMIT) ? LEVEL_RELEASE_LIMIT : value;
+
+        case levelDetectorParam:
+            // anything unexpected follows the peak level
+            return (value == rmsLevel) ? rmsLevel : peakLevel;
+
+        case levelLinkParam:
+        case bypassParam:
+        case modEnabledParam:
+        case distEnabledParam:
+        case pulserEnabledParam:
+            return (value != 0.0) ? 1.0 : 0.0;
+
+        case numParameters:
+        default:
+            return value;
+    }
+}
+
+void MultiEffectCore::updateParameters (uint32_t changes)
+{
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+        if (ParameterStore::hasChanged (changes, (parameterId) parameter))
+            setParameter ((parameterId) parameter, mParameters.get ((parameterId) parameter));
+}
+
+void MultiEffectCore::takeSnapshot()
+{
+    // every value in it starts its ramp on the same sample. Single changes made since are picked
+    // up after it, and read the store, which holds the snapshot's values unless they're newer
+    ParameterSnapshot snapshot;
+
+    if (! mParameters.takeSnapshot (snapshot))
+        return;
+
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+        if (ParameterStore::hasChanged (snapshot.mask, (parameterId) parameter))
+            setParameter ((parameterId) parameter, snapshot.values[parameter]);
+}
+
+void MultiEffectCore::setParameter (parameterId parameter, double value)
+{
+    switch (parameter)
+    {
+        case modTypeParam:
+            mModType = (modType) (int) value;
+            mModTypeRamp.setTargetValue (mModType == am ? 1.0 : 0.0);
+            break;
+
+        case distTypeParam:
+            mDistType = (distType) (int) value;
+            mDistTypeRamp.setTargetValue (mDistType == soft ? 1.0 : 0.0);
+            break;
+
+        // turned off, the overdrive goes down to 1 and the modulation and pulsing fade out, which
+        // is what taking them to their neutral settings does
+        case overdriveParam:
+            mOverdriveSliderValue = value;
+            mOverdriveRamp.setTargetValue (mDistEnabled ? mOverdriveSliderValue : 1.0);
+            break;
+
+        case distEnabledParam:
+            mDistEnabled = value != 0.0;
+            mOverdriveRamp.setTargetValue (mDistEnabled ? mOverdriveSliderValue : 1.0);
+            break;
+
+        case modEnabledParam:
+            mModEnabled = value != 0.0;
+            mModDepthRamp.setTargetValue (mModEnabled && mModFreqSliderValue > 0.0 ? 1.0 : 0.0);
+            break;
+
+        case pulserEnabledParam:
+            mPulserEnabled = value != 0.0;
+            mPulserDepthRamp.setTargetValue (mPulserEnabled && mPulserFreqSliderValue > 0.0 ? 1.0 : 0.0);
+            break;
+
+        case distMixParam:
+            mDistMixSliderValue = value;
+            mDistMixRamp.setTargetValue (mDistMixSliderValue);
+            break;
+
+        case levelAttackParam:
+            mLevelAttackValue = value;
+            updateLevelFollowers (false, false);
+            break;
+
+        case levelReleaseParam:
+            mLevelReleaseValue = value;
+            updateLevelFollowers (false, false);
+            break;
+
+        case levelDetectorParam:
+        {
+            const auto detector = (levelDetector) (int) value;
+            const bool detectorChanged = detector != mLevelDetector;
+
+            mLevelDetector = detector;
+            updateLevelFollowers (detectorChanged, false);
+            break;
+        }
+
+        case levelLinkParam:
+        {
+            const bool linked = value != 0.0;
+            const bool linkChanged = linked != mLevelLinked;
+
+            mLevelLinked = linked;
+            updateLevelFollowers (false, linkChanged);
+            break;
+        }
+
+        case bypassParam:
+            mBypassed = value != 0.0;
+            mBypassRamp.setTargetValue (mBypassed ? 1.0 : 0.0);
+            break;
+
+        case modFreqParam:
+        {
+            mModFreqSliderValue = value;
+
+            auto cyclesPerSample = mModFreqSliderValue / mSampleRate;
+
+            mModAngleDelta = cyclesPerSample * twoPi;
+            mModAngleDeltaRamp.setTargetValue (mModAngleDelta);
+            mModDepthRamp.setTargetValue (mModEnabled && mModFreqSliderValue > 0.0 ? 1.0 : 0.0);
+
+            if (mModAngleDeltaRamp.isRamping())
+                for (auto& lfo : mModLfos)
+                    lfo.setAngleDeltaRamp (mModAngleDeltaRamp.getStep());
+            break;
+        }
+
+        case pulserFreqParam:
+        {
+            mPulserFreqSliderValue = value;
+
+            auto cyclesPerSample = mPulserFreqSliderValue / mSampleRate;
+
+            mPulserAngleDelta = cyclesPerSample * twoPi;
+            mPulserAngleDeltaRamp.setTargetValue (mPulserAngleDelta);
+            mPulserDepthRamp.setTargetValue (mPulserEnabled && mPulserFreqSliderValue > 0.0 ? 1.0 : 0.0);
+
+            if (mPulserAngleDeltaRamp.isRamping())
+                for (auto& lfo : mPulserLfos)
+                    lfo.setAngleDeltaRamp (mPulserAngleDeltaRamp.getStep());
+            break;
+        }
+
+        case numParameters:
+        default:
+            break;
+    }
+}
+
+void MultiEffectCore::finishRamps()
+{
+    // an oversampling path that's still settling takes over straight away
+    if (mLightFadePending)
+    {
+        mLightFadeRamp.setCurrentAndTargetValue (mLightFadeRamp.getTargetValue() == 0.0 ? 1.0 : 0.0);
+        mLightFadePending = false;
+        mQualityWarmUp = 0;
+    }
+
+    for (auto* ramp : { &mModAngleDeltaRamp, &mOverdriveRamp, &mPulserAngleDeltaRamp, &mDistMixRamp, &mBypassRamp, &mModTypeRamp, &mDistTypeRamp,
+                        &mModDepthRamp, &mPulserDepthRamp, &mTanhFadeRamp, &mLightFadeRamp })
+        ramp->setCurrentAndTargetValue (ramp->getTargetValue());
+
+    mModRamping = false;
+    mOverdriveRamping = false;
+    mPulserRamping = false;
+    mDistMixRamping = false;
+    mBypassRamping = false;
+    mModTypeRamping = false;
+    mDistTypeRamping = false;
+    mModDepthRamping = false;
+    mPulserDepthRamping = false;
+    mTanhFading = false;
+    mLightFading = false;
+
+    // and the path that was faded out stops
+    mLightPathRunning = mLightFadeRamp.getTargetValue() == 1.0;
+    mFullPathRunning = ! mLightPathRunning;
+
+    updateLfoAngleDeltas();
+}
+
+int MultiEffectCore::fillRampBlocks (int numSamples)
+{
+    // a sub-block never runs past the end of a ramp, so the sample a ramp reaches its target
+    // doesn't depend on the host block size, and after it the kernel goes back to the fixed
+    // frequency LFOs and the single drive value
+    if (mLightFadePending && mQualityWarmUp <= 0)
+    {
+        // the path coming in has settled, so it's faded in from here
+        mLightFadeRamp.setTargetValue (mLightFadeRamp.getTargetValue() == 0.0 ? 1.0 : 0.0);
+        mLightFadePending = false;
+    }
+    else if (! mLightFadePending && ! mLightFadeRamp.isRamping())
+    {
+        // once the fade is over only the path that's heard runs
+        mLightPathRunning = mLightFadeRamp.getTargetValue() == 1.0;
+        mFullPathRunning = ! mLightPathRunning;
+    }
+
+    for (auto* ramp : { &mModAngleDeltaRamp, &mOverdriveRamp, &mPulserAngleDeltaRamp, &mDistMixRamp, &mBypassRamp, &mModTypeRamp, &mDistTypeRamp,
+                        &mModDepthRamp, &mPulserDepthRamp, &mTanhFadeRamp, &mLightFadeRamp })
+        if (ramp->isRamping())
+            numSamples = std::min (numSamples, ramp->getNumRemainingSamples());
+
+    mModRamping = mModAngleDeltaRamp.isRamping();
+    mOverdriveRamping = mOverdriveRamp.isRamping();
+    mPulserRamping = mPulserAngleDeltaRamp.isRamping();
+    mDistMixRamping = mDistMixRamp.isRamping();
+    mBypassRamping = mBypassRamp.isRamping();
+    mModTypeRamping = mModTypeRamp.isRamping();
+    mDistTypeRamping = mDistTypeRamp.isRamping();
+    mModDepthRamping = mModDepthRamp.isRamping();
+    mPulserDepthRamping = mPulserDepthRamp.isRamping();
+    mTanhFading = mTanhFadeRamp.isRamping();
+    mLightFading = mLightFadeRamp.isRamping();
+
+    if (mModRamping)
+        mModAngleDeltaRamp.fill (mModAngleDeltaBlock, numSamples);
+
+    if (mOverdriveRamping)
+        mOverdriveRamp.fill (mOverdriveBlock, numSamples);
+
+    if (mPulserRamping)
+        mPulserAngleDeltaRamp.fill (mPulserAngleDeltaBlock, numSamples);
+
+    if (mDistMixRamping)
+        mDistMixRamp.fill (mDistMixBlock, numSamples);
+
+    if (mBypassRamping)
+        mBypassRamp.fill (mBypassBlock, numSamples);
+
+    if (mModTypeRamping)
+        mModTypeRamp.fill (mModTypeBlock, numSamples);
+
+    if (mDistTypeRamping)
+        mDistTypeRamp.fill (mDistTypeBlock, numSamples);
+
+    if (mModDepthRamping)
+        mModDepthRamp.fill (mModDepthBlock, numSamples);
+
+    if (mPulserDepthRamping)
+        mPulserDepthRamp.fill (mPulserDepthBlock, numSamples);
+
+    if (mTanhFading)
+        mTanhFadeRamp.fill (mTanhFadeBlock, numSamples);
+
+    if (mLightFading)
+        mLightFadeRamp.fill (mLightFadeBlock, numSamples);
+
+    if (mQualityWarmUp > 0)
+        mQualityWarmUp -= numSamples;
+
+    return numSamples;
+}
+
+void MultiEffectCore::updateLfoAngleDeltas()
+{
+    // setAngleDelta() also resyncs the rotator and anchors the phase, so only call it when something
+    // actually changed, or a ramp has just ended (which may have come back to where it started).
+    // An LFO that wasn't needed for a while is brought up to the current sample first, where the
+    // new delta takes over
+    const auto update = [this] (std::vector<LfoOscillator>& lfos, const ParameterRamp& ramp)
+    {
+        if (ramp.isRamping() || (! lfos[0].isRamping() && lfos[0].getAngleDelta() == ramp.getTargetValue()))
+            return;
+
+        for (auto& lfo : lfos)
+        {
+            lfo.setPosition (mSamplePosition);
+            lfo.setAngleDelta (ramp.getTargetValue());
+        }
+    };
+
+    update (mModLfos, mModAngleDeltaRamp);
+    update (mPulserLfos, mPulserAngleDeltaRamp);
+}
+
+void MultiEffectCore::renderLfos (std::vector<LfoOscillator>& lfos, int firstChannel, int numLanes,
+                                  double (*blocks)[subBlockSize], const double* angleDeltas, int numSamples)
+{
+    double* dest[LfoOscillator::maxLanes];
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        lfos[(size_t) (firstChannel + lane)].setPosition (mSamplePosition);
+        dest[lane] = blocks[lane];
+    }
+
+    LfoOscillator::renderLanes (&lfos[(size_t) firstChannel], numLanes, dest, angleDeltas, numSamples);
+}
+
+uint64_t MultiEffectCore::getStateHash() const
+{
+    StateHash hash;
+    hash.add (mSamplePosition);
+
+    // an LFO that's behind is hashed where it'll be when it's next needed
+    for (const auto* lfos : { &mModLfos, &mPulserLfos })
+    {
+        for (auto lfo : *lfos)
+        {
+            lfo.setPosition (mSamplePosition);
+            lfo.addStateTo (hash);
+        }
+    }
+
+    for (const auto* delays : { &mDryDelays, &mLevelDelays, &mBypassDelays, &mLightDelays })
+        for (const auto& delay : *delays)
+            delay.addStateTo (hash);
+
+    for (const auto* oversamplers : { &mOversamplers, &mLightOversamplers })
+        for (const auto& oversampler : *oversamplers)
+            oversampler.addStateTo (hash);
+
+    for (const auto* followers : { &mInputFollowers, &mOutputFollowers })
+        for (const auto& follower : *followers)
+            hash.add (follower.getEnvelope());
+
+    hash.add (mLinkedInputFollower.getEnvelope());
+    hash.add (mLinkedOutputFollower.getEnvelope());
+
+    for (const auto* ramp : { &mModAngleDeltaRamp, &mOverdriveRamp, &mPulserAngleDeltaRamp, &mDistMixRamp, &mBypassRamp, &mModTypeRamp,
+                              &mDistTypeRamp, &mModDepthRamp, &mPulserDepthRamp, &mTanhFadeRamp, &mLightFadeRamp })
+    {
+        hash.add (ramp->getCurrentValue());
+        hash.add (ramp->getTargetValue());
+        hash.add (ramp->getNumRemainingSamples());
+    }
+
+    hash.add ((int) mQualityTier);
+    hash.add ((int) mActiveTanh);
+    hash.add ((int) mFadingFromTanh);
+    hash.add (mActivePulserInterval);
+    hash.add (mFullPathRunning);
+    hash.add (mLightPathRunning);
+    hash.add (mQualityWarmUp);
+    hash.add (mLightFadePending);
+    hash.add (mOversamplersRunning);
+    hash.add (mChainParked);
+    hash.add (mBypassDryDelayed);
+    hash.add (mSilentSamples);
+    hash.add (mIdle);
+    hash.add (mIdleSamples);
+
+    return hash.get();
+}
+
+lfoBackend MultiEffectCore::getLfoBackend() const
+{
+    return mLfoBackend;
+}
+
+void MultiEffectCore::setLfoBackend (lfoBackend backend)
+{
+    mLfoBackend = backend;
+
+    for (auto* lfos : { &mModLfos, &mPulserLfos })
+        for (auto& lfo : *lfos)
+            lfo.setBackend (mQualityTier >= reducedQuality ? rotatorLfo : backend);
+}
+
+bool MultiEffectCore::getAdaptiveQuality() const
+{
+    return mAdaptiveQuality.load (std::memory_order_relaxed);
+}
+
+void MultiEffectCore::setAdaptiveQuality (bool shouldAdapt)
+{
+    mAdaptiveQuality.store (shouldAdapt, std::memory_order_relaxed);
+}
+
+qualityTier MultiEffectCore::getQualityTier() const
+{
+    return (qualityTier) mLastQualityTier.load (std::memory_order_relaxed);
+}
+
+void MultiEffectCore::updateQualityTier (bool adaptive)
+{
+    const qualityTier tier = adaptive ? mQualityGovernor.getTier() : fullQuality;
+    const bool changing = mTanhFadeRamp.isRamping() || mLightFadeRamp.isRamping() || mLightFadePending;
+
+    // one change at a time, apart from turning it off
+    if (tier != mQualityTier && ! (adaptive && changing))
+    {
+        mQualityTier = tier;
+        applyQualityTier (adaptive);
+    }
+
+    mLastQualityTier.store (mQualityTier, std::memory_order_relaxed);
+}
+
+void MultiEffectCore::applyQualityTier (bool fade)
+{
+    // the rotator is the cheapest of the LFOs, and the pulser's curve needs it every few samples at most
+    const lfoBackend backend = mQualityTier >= reducedQuality ? rotatorLfo : mLfoBackend;
+
+    if (mModLfos[0].getBackend() != backend)
+        setLfoBackend (mLfoBackend);
+
+    mActivePulserInterval = mQualityTier >= reducedQuality ? std::max (mPulserControlInterval, PULSER_CONTROL_INTERVAL)
+                                                           : mPulserControlInterval;
+
+    const tanhApprox tanh = mQualityTier >= lowQuality ? polynomialTanh : mTanhApprox;
+
+    if (tanh != mActiveTanh)
+    {
+        mFadingFromTanh = mActiveTanh;
+        mActiveTanh = tanh;
+        mTanhFadeRamp.setCurrentAndTargetValue (0.0);
+    }
+
+    mTanhFadeRamp.setTargetValue (1.0);
+
+    if (! fade)
+        mTanhFadeRamp.setCurrentAndTargetValue (1.0);
+
+    const bool light = mLightPathAvailable && mQualityTier >= minimumQuality;
+
+    if (! fade)
+    {
+        if (! (light ? mLightPathRunning : mFullPathRunning))
+            startOversamplingPath (light);
+
+        mLightFadeRamp.setCurrentAndTargetValue (light ? 1.0 : 0.0);
+        mLightFadePending = false;
+        mQualityWarmUp = 0;
+        mLightPathRunning = light;
+        mFullPathRunning = ! light;
+    }
+    else if (light != (mLightFadeRamp.getTargetValue() == 1.0))
+    {
+        // the path coming in runs unheard until its filters and delay have filled, then it's faded in
+        startOversamplingPath (light);
+        mLightFadePending = true;
+        mQualityWarmUp = mTailSamples + getLatencySamples();
+    }
+}
+
+void MultiEffectCore::startOversamplingPath (bool light)
+{
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        if (light)
+        {
+            mLightOversamplers[(size_t) channel].reset();
+            mLightDelays[(size_t) channel].reset();
+        }
+        else
+        {
+            mOversamplers[(size_t) channel].reset();
+        }
+    }
+
+    (light ? mLightPathRunning : mFullPathRunning) = true;
+}
+
+//======== CUSTOM MEMBER FUNCTIONS =====================================================
+tanhApprox MultiEffectCore::getTanhApprox() const
+{
+    return mTanhApprox;
+}
+
+void MultiEffectCore::setTanhApprox (tanhApprox approx)
+{
+    mTanhApprox = approx;
+
+    if (mQualityTier < lowQuality)
+        mActiveTanh = approx;
+}
+
+void MultiEffectCore::setChannelLanes (int numLanes)
+{
+    mChannelLanes = std::min (std::max (numLanes, 1), LfoOscillator::maxLanes);
+}
+
+void MultiEffectCore::setPulserControlInterval (int numSamples)
+{
+    // rounded down to a power of two, so the control points fall on the LFO grid
+    int interval = 1;
+
+    while (interval * 2 <= std::min (numSamples, LfoOscillator::resyncInterval))
+        interval *= 2;
+
+    mPulserControlInterval = interval;
+    mActivePulserInterval = mQualityTier >= reducedQuality ? std::max (interval, PULSER_CONTROL_INTERVAL) : interval;
+}
+
+double MultiEffectCore::reRangeLfoSample (double sample)
+{
+    sample += 1.0;
+    sample *= 0.5;
+
+    return sample;
+}
+
+float MultiEffectCore::getMagnitude (const float* channelData, int numSamples)
+{
+    return VectorOps::findMagnitude (channelData, numSamples);
+}
+
+template <typename SampleType>
+void MultiEffectCore::doModulation (SampleType* channelData, int numSamples, int channel)
+{
+    if (mModFreqSliderValue <= 0.0 || ! mModEnabled)
+        return;
+
+    double lfoBlock[subBlockSize];
+
+    for (int start = 0; start < numSamples; start += subBlockSize)
+    {
+        const int numThisTime = std::min (subBlockSize, numSamples - start);
+        mModLfos[(size_t) channel].renderBlock (lfoBlock, numThisTime);
+
+        for (int sample = 0; sample < numThisTime; ++sample)
+        {
+            auto lfoSample = lfoBlock[sample];
+
+            if (mModType == am)
+                lfoSample = reRangeLfoSample (lfoSample);
+
+            channelData[start + sample] *= lfoSample;
+        }
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::doDistortion (SampleType* channelData, int numSamples, int channel)
+{
+    (void) channel;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        if (mOverdriveSliderValue > 1.0 && mDistEnabled)
+        {
+            // step 1: overdrive
+            channelData[sample] *= mOverdriveSliderValue;
+
+            // step 2: limit the signal
+            if (mDistType == soft)
+            {
+                // do soft clipping
+                channelData[sample] = std::tanh (channelData[sample]);
+            }
+            else
+            {
+                // do hard clipping
+                if (channelData[sample] > (SampleType) 1)
+                    channelData[sample] = (SampleType) 1;
+                else if (channelData[sample] < (SampleType) -1)
+                    channelData[sample] = (SampleType) -1;
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::doLevelCompensation (const SampleType* const* inputs, SampleType* const* channelData, int numChannels, int numSamples)
+{
+    // the gain is the ratio of the followed input and output levels, so that the output of the
+    // distortion is at the same level as the original signal
+    if (mLevelLinked)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            double inputLevel = 0.0;
+            double outputLevel = 0.0;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                inputLevel = std::max (inputLevel, EnvelopeFollower::getLevel (inputs[channel][sample], mLevelDetector));
+                outputLevel = std::max (outputLevel, EnvelopeFollower::getLevel (channelData[channel][sample], mLevelDetector));
+            }
+
+            const double gain = getCompensationGain (mLinkedInputFollower.process (inputLevel), mLinkedOutputFollower.process (outputLevel));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                channelData[channel][sample] *= gain;
+        }
+
+        return;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& inputFollower = mInputFollowers[(size_t) channel];
+        auto& outputFollower = mOutputFollowers[(size_t) channel];
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const double inputEnvelope = inputFollower.process (EnvelopeFollower::getLevel (inputs[channel][sample], mLevelDetector));
+            const double outputEnvelope = outputFollower.process (EnvelopeFollower::getLevel (channelData[channel][sample], mLevelDetector));
+
+            channelData[channel][sample] *= getCompensationGain (inputEnvelope, outputEnvelope);
+        }
+    }
+}
+
+double MultiEffectCore::getCompensationGain (double inputEnvelope, double outputEnvelope) const
+{
+    // both levels get a floor of -100dB, which keeps silence at unity gain rather than dividing by zero
+    const double floor = mLevelDetector == rmsLevel ? 1.0e-10 : 1.0e-5;
+    const double ratio = (inputEnvelope + floor) / (outputEnvelope + floor);
+    const double gain = mLevelDetector == rmsLevel ? std::sqrt (ratio) : ratio;
+
+    return std::min (gain, LEVEL_GAIN_LIMIT);
+}
+
+double MultiEffectCore::getMakeUpGain (int channel) const
+{
+    if (mLevelLinked)
+        return getCompensationGain (mLinkedInputFollower.getEnvelope(), mLinkedOutputFollower.getEnvelope());
+
+    return getCompensationGain (mInputFollowers[(size_t) channel].getEnvelope(), mOutputFollowers[(size_t) channel].getEnvelope());
+}
+
+void MultiEffectCore::followLinkedLevels (int numSamples)
+{
+    auto inputFollower = mLinkedInputFollower;
+    auto outputFollower = mLinkedOutputFollower;
+
+    for (int sample = 0; sample < numSamples; ++sample)
+        mLinkedGainBlock[sample] = getCompensationGain (inputFollower.process (mLinkedInputLevels[sample]),
+                                                        outputFollower.process (mLinkedOutputLevels[sample]));
+
+    mLinkedInputFollower = inputFollower;
+    mLinkedOutputFollower = outputFollower;
+}
+
+void MultiEffectCore::updateLevelFollowers (bool detectorChanged, bool linkChanged)
+{
+    // a mean square envelope is the square of a peak one, near enough to carry on from
+    const auto update = [this, detectorChanged] (EnvelopeFollower& follower)
+    {
+        follower.setTimes (mSampleRate, mLevelAttackValue * 0.001, mLevelReleaseValue * 0.001);
+
+        if (detectorChanged)
+        {
+            const double envelope = follower.getEnvelope();
+            follower.setEnvelope (mLevelDetector == rmsLevel ? envelope * envelope : std::sqrt (envelope));
+        }
+    };
+
+    for (auto* followers : { &mInputFollowers, &mOutputFollowers })
+        for (auto& follower : *followers)
+            update (follower);
+
+    update (mLinkedInputFollower);
+    update (mLinkedOutputFollower);
+
+    if (! linkChanged)
+        return;
+
+    // linking starts from the loudest channel, unlinking starts every channel from the shared level
+    for (auto pair : { std::make_pair (&mInputFollowers, &mLinkedInputFollower), std::make_pair (&mOutputFollowers, &mLinkedOutputFollower) })
+    {
+        if (mLevelLinked)
+        {
+            double loudest = 0.0;
+
+            for (const auto& follower : *pair.first)
+                loudest = std::max (loudest, follower.getEnvelope());
+
+            pair.second->setEnvelope (loudest);
+        }
+        else
+        {
+            for (auto& follower : *pair.first)
+                follower.setEnvelope (pair.second->getEnvelope());
+        }
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::doPulsing (SampleType* channelData, int numSamples, int channel)
+{
+    if (mPulserFreqSliderValue <= 0.0 || ! mPulserEnabled)
+        return;
+
+    double lfoBlock[subBlockSize];
+
+    for (int start = 0; start < numSamples; start += subBlockSize)
+    {
+        const int numThisTime = std::min (subBlockSize, numSamples - start);
+
+        // the reference chain never ramps, so the curve can always be used (and the LFO is
+        // brought up to the position at the start of the next call)
+        if (mPulserControlInterval > 1)
+            mPulserLfos[(size_t) channel].renderInterpolated (lfoBlock, mSamplePosition + start, numThisTime, mPulserControlInterval);
+        else
+            mPulserLfos[(size_t) channel].renderBlock (lfoBlock, numThisTime);
+
+        for (int sample = 0; sample < numThisTime; ++sample)
+            channelData[start + sample] *= reRangeLfoSample (lfoBlock[sample]);
+    }
+}
+
+//==============================================================================
+bool MultiEffectCore::isModulationOn() const
+{
+    // a stage that is fading in or out stays on until its fade is over, and the fade to dry always
+    // runs alongside a frequency ramp to 0
+    return mModDepthRamping || mModDepthRamp.getTargetValue() > 0.0;
+}
+
+bool MultiEffectCore::isDistortionOn() const
+{
+    return mOverdriveRamping || mOverdriveRamp.getTargetValue() > 1.0;
+}
+
+bool MultiEffectCore::isPulsingOn() const
+{
+    return mPulserDepthRamping || mPulserDepthRamp.getTargetValue() > 0.0;
+}
+
+int MultiEffectCore::getConfiguration() const
+{
+    int configuration = 0;
+
+    if (isModulationOn())
+        configuration |= (mModType == am) ? (modulationBit | amBit) : modulationBit;
+
+    if (isDistortionOn())
+        configuration |= (mDistType == soft) ? (distortionBit | softClipBit) : distortionBit;
+
+    if (isPulsingOn())
+        configuration |= pulsingBit;
+
+    return configuration;
+}
+
+template <typename SampleType>
+void MultiEffectCore::processInputStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) lane;
+
+    // the input level. With oversampling it's taken from the input delayed by the latency, so it
+    // lines up with the output it gets compared with
+    const SampleType* levelInput = channelData;
+    SampleType delayedInput[subBlockSize];
+
+    if (mOversamplers[(size_t) channel].getFactor() > 1)
+    {
+        std::copy (channelData, channelData + numSamples, delayedInput);
+        mLevelDelays[(size_t) channel].process (delayedInput, numSamples);
+        levelInput = delayedInput;
+    }
+
+    // the dry side of a bypass crossfade is the same input, lined up with the output
+    if (mBypassRamping)
+    {
+        double* dryBlock = &mBypassDryBlocks[(size_t) channel * subBlockSize];
+
+        if (mBypassDryDelayed)
+        {
+            std::copy (channelData, channelData + numSamples, dryBlock);
+            mBypassDelays[(size_t) channel].process (dryBlock, numSamples);
+        }
+        else
+        {
+            std::copy (levelInput, levelInput + numSamples, dryBlock);
+        }
+    }
+
+    if (mLevelLinked)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            mLinkedInputLevels[sample] = std::max (mLinkedInputLevels[sample], EnvelopeFollower::getLevel (levelInput[sample], mLevelDetector));
+    }
+    else
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            mInputLevelBlock[sample] = EnvelopeFollower::getLevel (levelInput[sample], mLevelDetector);
+    }
+
+    mCpuMeter.lap (distortionSection);
+}
+
+template <typename SampleType, int configuration>
+void MultiEffectCore::processModulationStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) channel;
+
+    // for a fixed configuration these are compile-time constants, so every test below folds away
+    // and each step only contains the loops it actually needs. The step is only in the list of a
+    // configuration with the modulation on
+    constexpr bool isSpecialised = configuration != runtimeConfiguration;
+
+    const bool modulationOn = isSpecialised || isModulationOn();
+    const bool amOn = isSpecialised ? (configuration & amBit) != 0 : mModType == am;
+    const double* lfoBlock = mModLfoBlocks[lane];
+
+    if (modulationOn && (mModTypeRamping || mModDepthRamping))
+    {
+        // crossfading between RM and AM, or between the stage and the dry signal. The signal is only
+        // scaled either way, so crossfading the scales is the same as crossfading the outputs
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const double lfoSample = lfoBlock[sample];
+            const double amSample = reRangeLfoSample (lfoSample);
+            double scale = mModTypeRamping ? lfoSample + (amSample - lfoSample) * mModTypeBlock[sample] : (amOn ? amSample : lfoSample);
+
+            if (mModDepthRamping)
+                scale = 1.0 + (scale - 1.0) * mModDepthBlock[sample];
+
+            channelData[sample] *= scale;
+        }
+    }
+    else if (modulationOn)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            auto lfoSample = lfoBlock[sample];
+
+            if (amOn)
+                lfoSample = reRangeLfoSample (lfoSample);
+
+            channelData[sample] *= lfoSample;
+        }
+    }
+
+    mCpuMeter.lap (modulationSection);
+}
+
+template <typename SampleType, int configuration>
+void MultiEffectCore::processDistortionStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) lane;
+
+    constexpr bool isSpecialised = configuration != runtimeConfiguration;
+
+    const bool distortionOn = isSpecialised ? (configuration & distortionBit) != 0 : isDistortionOn();
+    const bool softClipOn = isSpecialised ? (configuration & softClipBit) != 0 : mDistType == soft;
+
+    auto& oversampler = mOversamplers[(size_t) channel];
+    auto& dryDelay = mDryDelays[(size_t) channel];
+    const bool isOversampled = oversampler.getFactor() > 1;
+    const bool mixOn = distortionOn && (mDistMixSliderValue < 1.0 || mDistMixRamping);
+
+    // the dry side of the dist mix. With oversampling it goes through the delay every sub-block,
+    // whether or not it's used, so there's no stale audio in it when the mix or distortion comes on
+    if (distortionOn && (mixOn || isOversampled))
+    {
+        double* dryBlock = &mDryBlocks[(size_t) channel * subBlockSize];
+
+        std::copy (channelData, channelData + numSamples, dryBlock);
+        dryDelay.process (dryBlock, numSamples);
+    }
+
+    // overdrive -> clipping
+    if (distortionOn)
+    {
+        double drive = mOverdriveSliderValue;
+
+        if (mOverdriveRamping)
+        {
+            // the drive changes every sample, so apply it here (with the same sample *= double
+            // rounding as the waveshaper) and leave the waveshaper a drive of exactly 1
+            for (int sample = 0; sample < numSamples; ++sample)
+                channelData[sample] *= mOverdriveBlock[sample];
+
+            drive = 1.0;
+        }
+
+        if (isOversampled)
+        {
+            // only the clipping runs at the higher rate, the drive is linear so it's the same either side
+            if (mLightPathRunning)
+                clipBothPaths (channelData, numSamples, channel, drive, softClipOn);
+            else
+                clipOversampled (oversampler, channelData, numSamples, drive, softClipOn);
+        }
+        else if (mDistTypeRamping)
+        {
+            crossfadeClip (channelData, numSamples, 1, drive);
+        }
+        else if (softClipOn)
+        {
+            softClip (channelData, numSamples, 1, drive);
+        }
+        else
+        {
+            Waveshaper::hardClip (channelData, numSamples, drive);
+        }
+    }
+    else if (isOversampled)
+    {
+        // bypassed, but still delayed by the same amount so the latency the host was told about holds
+        dryDelay.process (channelData, numSamples);
+    }
+
+    if (mLevelLinked)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            mLinkedOutputLevels[sample] = std::max (mLinkedOutputLevels[sample], EnvelopeFollower::getLevel (channelData[sample], mLevelDetector));
+    }
+
+    mCpuMeter.lap (distortionSection);
+}
+
+template <typename SampleType>
+void MultiEffectCore::crossfadeClip (SampleType* data, int numSamples, int factor, double drive)
+{
+    // the filters either side of an oversampled clip are linear, so crossfading here is the same as
+    // crossfading the two stage outputs
+    SampleType hardClipped[subBlockSize * Oversampler::maxFactor];
+
+    std::copy (data, data + numSamples, hardClipped);
+    softClip (data, numSamples, factor, drive);
+    Waveshaper::hardClip (hardClipped, numSamples, drive);
+
+    for (int sample = 0; sample < numSamples; sample += factor)
+    {
+        const double softness = mDistTypeBlock[sample / factor];
+
+        for (int k = sample; k < sample + factor; ++k)
+            data[k] = (SampleType) (hardClipped[k] + (data[k] - hardClipped[k]) * softness);
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::softClip (SampleType* data, int numSamples, int factor, double drive)
+{
+    if (! mTanhFading)
+    {
+        Waveshaper::softClip (data, numSamples, drive, mActiveTanh);
+        return;
+    }
+
+    SampleType fadingOut[subBlockSize * Oversampler::maxFactor];
+
+    std::copy (data, data + numSamples, fadingOut);
+    Waveshaper::softClip (fadingOut, numSamples, drive, mFadingFromTanh);
+    Waveshaper::softClip (data, numSamples, drive, mActiveTanh);
+
+    for (int sample = 0; sample < numSamples; sample += factor)
+    {
+        const double amount = mTanhFadeBlock[sample / factor];
+
+        for (int k = sample; k < sample + factor; ++k)
+            data[k] = (SampleType) (fadingOut[k] + (data[k] - fadingOut[k]) * amount);
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::clipOversampled (Oversampler& oversampler, SampleType* channelData, int numSamples, double drive, bool softClipOn)
+{
+    const int factor = oversampler.getFactor();
+    SampleType* oversampled = oversampler.upsample (channelData, numSamples);
+
+    if (mDistTypeRamping)
+        crossfadeClip (oversampled, numSamples * factor, factor, drive);
+    else if (softClipOn)
+        softClip (oversampled, numSamples * factor, factor, drive);
+    else
+        Waveshaper::hardClip (oversampled, numSamples * factor, drive);
+
+    oversampler.downsample (channelData, numSamples);
+}
+
+template <typename SampleType>
+void MultiEffectCore::clipBothPaths (SampleType* channelData, int numSamples, int channel, double drive, bool softClipOn)
+{
+    SampleType light[subBlockSize];
+
+    std::copy (channelData, channelData + numSamples, light);
+    clipOversampled (mLightOversamplers[(size_t) channel], light, numSamples, drive, softClipOn);
+    mLightDelays[(size_t) channel].process (light, numSamples);
+
+    if (mFullPathRunning)
+        clipOversampled (mOversamplers[(size_t) channel], channelData, numSamples, drive, softClipOn);
+
+    // outside the fade one of them is running unheard, settling before it's faded in
+    if (mLightFading)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            channelData[sample] = (SampleType) (channelData[sample] + (light[sample] - channelData[sample]) * mLightFadeBlock[sample]);
+    }
+    else if (mLightFadeRamp.getTargetValue() == 1.0)
+    {
+        std::copy (light, light + numSamples, channelData);
+    }
+}
+
+template <typename SampleType, int configuration>
+void MultiEffectCore::processMakeUpStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) lane;
+
+    constexpr bool isSpecialised = configuration != runtimeConfiguration;
+
+    const bool distortionOn = isSpecialised ? (configuration & distortionBit) != 0 : isDistortionOn();
+    const bool mixOn = distortionOn && (mDistMixSliderValue < 1.0 || mDistMixRamping);
+
+    // levels -> make-up gain -> dist mix, while the sub-block is still in L1. Both followers are
+    // serial from one sample to the next, so they go in the same loop where they overlap
+    if (mLevelLinked)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            channelData[sample] *= mLinkedGainBlock[sample];
+    }
+    else
+    {
+        auto inputFollower = mInputFollowers[(size_t) channel];
+        auto outputFollower = mOutputFollowers[(size_t) channel];
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            const double inputEnvelope = inputFollower.process (mInputLevelBlock[sample]);
+            const double outputEnvelope = outputFollower.process (EnvelopeFollower::getLevel (channelData[sample], mLevelDetector));
+            channelData[sample] *= getCompensationGain (inputEnvelope, outputEnvelope);
+        }
+
+        mInputFollowers[(size_t) channel] = inputFollower;
+        mOutputFollowers[(size_t) channel] = outputFollower;
+    }
+
+    // the make-up gain only goes on the wet side, the dry one is already at the input level
+    if (mixOn)
+    {
+        const double* dryBlock = &mDryBlocks[(size_t) channel * subBlockSize];
+
+        if (mDistMixRamping)
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+                channelData[sample] = (SampleType) (channelData[sample] * mDistMixBlock[sample] + dryBlock[sample] * (1.0 - mDistMixBlock[sample]));
+        }
+        else
+        {
+            const double wet = mDistMixSliderValue;
+
+            for (int sample = 0; sample < numSamples; ++sample)
+                channelData[sample] = (SampleType) (channelData[sample] * wet + dryBlock[sample] * (1.0 - wet));
+        }
+    }
+
+    mCpuMeter.lap (distortionSection);
+}
+
+template <typename SampleType, int configuration>
+void MultiEffectCore::processPulsingStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) channel;
+
+    // like the modulation, only in the list of a configuration with the pulsing on
+    constexpr bool isSpecialised = configuration != runtimeConfiguration;
+
+    const bool pulsingOn = isSpecialised || isPulsingOn();
+    const double* lfoBlock = mPulserLfoBlocks[mPulserInterpolated ? 0 : lane];
+
+    if (pulsingOn && mPulserDepthRamping)
+    {
+        // fading in or out, between the pulsed and the steady signal
+        for (int sample = 0; sample < numSamples; ++sample)
+            channelData[sample] *= 1.0 + (reRangeLfoSample (lfoBlock[sample]) - 1.0) * mPulserDepthBlock[sample];
+    }
+    else if (pulsingOn)
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            channelData[sample] *= reRangeLfoSample (lfoBlock[sample]);
+    }
+
+    mCpuMeter.lap (pulsingSection);
+}
+
+template <typename SampleType>
+void MultiEffectCore::processOutputStep (SampleType* channelData, int numSamples, int channel, int lane)
+{
+    (void) lane;
+
+    // fading into or out of bypass
+    if (mBypassRamping)
+    {
+        const double* dryBlock = &mBypassDryBlocks[(size_t) channel * subBlockSize];
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            channelData[sample] = (SampleType) (channelData[sample] * (1.0 - mBypassBlock[sample]) + dryBlock[sample] * mBypassBlock[sample]);
+
+        mCpuMeter.lap (overheadSection);
+    }
+}
+
+//==============================================================================
+const MultiEffectCore::CompiledChain& MultiEffectCore::getCompiledChain (const StageOrder& order)
+{
+    // built by whichever thread makes the first core, which is never the audio thread as there's
+    // no core for it to run yet, and only read from then on
+    static const std::vector<CompiledChain> chains = []
+    {
+        std::vector<CompiledChain> compiled ((size_t) StageOrder::getNumOrders());
+
+        for (int index = 0; index < StageOrder::getNumOrders(); ++index)
+        {
+            auto& chain = compiled[(size_t) index];
+            chain.order = StageOrder::fromIndex (index);
+
+            for (int stage = 0; stage < numEffectStages; ++stage)
+                chain.inFront[stage] = chain.order.getPosition ((effectStage) stage) < chain.order.getPosition (distStage);
+
+            for (int configuration = 0; configuration <= numConfigurations; ++configuration)
+            {
+                compileSteps (chain.order, configuration, chain.floatSteps[configuration]);
+                compileSteps (chain.order, configuration, chain.doubleSteps[configuration]);
+            }
+        }
+
+        return compiled;
+    }();
+
+    return chains[(size_t) order.getIndex()];
+}
+
+template <typename SampleType>
+const MultiEffectCore::StepList<SampleType>& MultiEffectCore::CompiledChain::getSteps (int configuration) const
+{
+    if constexpr (std::is_same<SampleType, float>::value)
+        return floatSteps[configuration];
+    else
+        return doubleSteps[configuration];
+}
+
+template <typename SampleType>
+void MultiEffectCore::compileSteps (const StageOrder& order, int configuration, StepList<SampleType>& steps)
+{
+    // numConfigurations is the runtime flags, where every step is in and tests for itself
+    const bool isRuntime = configuration == numConfigurations;
+    bool inFront = true;
+
+    steps.numFront = 0;
+    steps.numBack = 0;
+
+    const auto add = [&steps, &inFront] (SubBlockFunction<SampleType> function)
+    {
+        if (inFront)
+            steps.front[steps.numFront++] = function;
+        else
+            steps.back[steps.numBack++] = function;
+    };
+
+    add (&MultiEffectCore::processInputStep<SampleType>);
+
+    for (auto stage : order.stages)
+    {
+        switch (stage)
+        {
+            // the stages that only scale the signal are left out altogether while they're off
+            case modStage:
+                if (isRuntime)
+                    add (&MultiEffectCore::processModulationStep<SampleType, runtimeConfiguration>);
+                else if ((configuration & modulationBit) != 0)
+                    add ((configuration & amBit) != 0 ? &MultiEffectCore::processModulationStep<SampleType, modulationBit | amBit>
+                                                      : &MultiEffectCore::processModulationStep<SampleType, modulationBit>);
+                break;
+
+            // the distortion is always in, as off it still delays the signal by the latency and
+            // measures the linked levels. Its make-up gain starts the back
+            case distStage:
+                if (isRuntime)
+                    add (&MultiEffectCore::processDistortionStep<SampleType, runtimeConfiguration>);
+                else if ((configuration & distortionBit) == 0)
+                    add (&MultiEffectCore::processDistortionStep<SampleType, 0>);
+                else
+                    add ((configuration & softClipBit) != 0 ? &MultiEffectCore::processDistortionStep<SampleType, distortionBit | softClipBit>
+                                                            : &MultiEffectCore::processDistortionStep<SampleType, distortionBit>);
+
+                inFront = false;
+
+                if (isRuntime)
+                    add (&MultiEffectCore::processMakeUpStep<SampleType, runtimeConfiguration>);
+                else
+                    add ((configuration & distortionBit) != 0 ? &MultiEffectCore::processMakeUpStep<SampleType, distortionBit>
+                                                              : &MultiEffectCore::processMakeUpStep<SampleType, 0>);
+                break;
+
+            case pulserStage:
+                if (isRuntime)
+                    add (&MultiEffectCore::processPulsingStep<SampleType, runtimeConfiguration>);
+                else if ((configuration & pulsingBit) != 0)
+                    add (&MultiEffectCore::processPulsingStep<SampleType, pulsingBit>);
+                break;
+
+            case numEffectStages:
+            default:
+                break;
+        }
+    }
+
+    add (&MultiEffectCore::processOutputStep<SampleType>);
+}
+
+void MultiEffectCore::process (float* const* channelData, int numChannels, int numSamples)
+{
+    processBlock (channelData, numChannels, numSamples, nullptr, 0);
+}
+
+void MultiEffectCore::process (float* const* channelData, int numChannels, int numSamples,
+                               const ParameterEvent* events, int numEvents)
+{
+    processBlock (channelData, numChannels, numSamples, events, numEvents);
+}
+
+void MultiEffectCore::process (double* const* channelData, int numChannels, int numSamples)
+{
+    processBlock (channelData, numChannels, numSamples, nullptr, 0);
+}
+
+void MultiEffectCore::process (double* const* channelData, int numChannels, int numSamples,
+                               const ParameterEvent* events, int numEvents)
+{
+    processBlock (channelData, numChannels, numSamples, events, numEvents);
+}
+
+template <typename SampleType>
+void MultiEffectCore::processBlock (SampleType* const* channelData, int numChannels, int numSamples,
+                                    const ParameterEvent* events, int numEvents)
+{
+    assert (numChannels <= mNumChannels);
+    numChannels = std::min (numChannels, mNumChannels);
+
+    // timed from the top, for the quality governor
+    const bool adaptive = mAdaptiveQuality.load (std::memory_order_relaxed);
+    const auto blockStart = adaptive ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+    mCpuMeter.startBlock();
+    const bool tapping = mSignalTap.startBlock (channelData, numChannels, numSamples);
+
+    // pick up whatever the editor/host changed since the last block, these start ramping from the first sample
+    takeSnapshot();
+    updateParameters (mParameters.takeChanges());
+    updateLfoAngleDeltas();
+    mChain = mNextChain.load (std::memory_order_acquire);
+    updateQualityTier (adaptive);
+
+    // the block is split at every event, so each one starts its ramp on its own sample
+    int startSample = 0;
+
+    for (int event = 0; event < numEvents; ++event)
+    {
+        const int eventSample = std::min (std::max (events[event].sampleOffset, startSample), numSamples);
+
+        processSubBlocks (channelData, numChannels, startSample, eventSample - startSample);
+
+        setParameter (events[event].parameter, limitParameter (events[event].parameter, events[event].value));
+        updateLfoAngleDeltas();
+
+        startSample = eventSample;
+    }
+
+    processSubBlocks (channelData, numChannels, startSample, numSamples - startSample);
+
+    if (tapping)
+    {
+        double makeUpGains[MeterReading::maxChannels];
+
+        for (int channel = 0; channel < std::min (numChannels, MeterReading::maxChannels); ++channel)
+            makeUpGains[channel] = getMakeUpGain (channel);
+
+        mSignalTap.endBlock (channelData, makeUpGains);
+    }
+
+    mCpuMeter.endBlock (numSamples, mSampleRate);
+
+    if (adaptive)
+        mQualityGovernor.update (std::chrono::duration<double> (std::chrono::steady_clock::now() - blockStart).count(), numSamples);
+}
+
+template <typename SampleType>
+void MultiEffectCore::processSubBlocks (SampleType* const* channelData, int numChannels, int startSample, int numSamples)
+{
+    const int endSample = startSample + numSamples;
+
+    // sub-blocks on the outside, so a large host block is handled exactly as if the host had
+    // delivered it in blocks of subBlockSize
+    for (int start = startSample; start < endSample;)
+    {
+        const int numThisTime = fillRampBlocks (std::min (subBlockSize, endSample - start));
+
+        // the chain isn't run at all once it's fully bypassed, nor while the input is silent or the
+        // settings leave the input as it is
+        if (mBypassed && ! mBypassRamping)
+        {
+            processBypassed (channelData, numChannels, start, numThisTime);
+        }
+        else
+        {
+            mChainParked = false;
+            mBypassDryDelayed = mBypassDryDelayed && mBypassRamping;
+
+            if (! skipSilence (channelData, numChannels, start, numThisTime))
+            {
+                if (isNeutral (numChannels))
+                    followNeutral (channelData, numChannels, start, numThisTime);
+                else
+                    processChain (channelData, numChannels, start, numThisTime);
+            }
+        }
+
+        mSamplePosition += numThisTime;
+        updateLfoAngleDeltas();
+        start += numThisTime;
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::processChain (SampleType* const* channelData, int numChannels, int start, int numSamples)
+{
+    // whatever came before the chain (parameters, ramps, the silence check) is overhead
+    mCpuMeter.lap (overheadSection);
+
+    const bool distortionOn = isDistortionOn();
+
+    if (distortionOn && ! mOversamplersRunning)
+    {
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            mOversamplers[(size_t) channel].reset();
+            mLightOversamplers[(size_t) channel].reset();
+            mLightDelays[(size_t) channel].reset();
+        }
+    }
+
+    mOversamplersRunning = distortionOn;
+
+    // the steps are picked per sub-block, as a ramp finishing can switch a stage off. Picking them
+    // is all that's left to do at this point, the order was compiled before it was set
+    const auto& chain = *mChain;
+    const auto& steps = chain.getSteps<SampleType> (mSpecialisedProcessing ? getConfiguration() : numConfigurations);
+
+    const bool modulationOn = isModulationOn();
+    const bool pulsingOn = isPulsingOn();
+
+    // at the control rate the pulser's curve is the same for every channel, so it's worked out once
+    // here. Its LFOs are left where they are, and brought up to the position when they're next rendered
+    mPulserInterpolated = pulsingOn && mActivePulserInterval > 1 && ! mPulserRamping;
+
+    if (mPulserInterpolated)
+        mPulserLfos[0].renderInterpolated (mPulserLfoBlocks[0], mSamplePosition, numSamples, mActivePulserInterval);
+
+    // renders the LFOs of a group for the stages in the front, the back or both. While a frequency
+    // is ramping the LFOs follow the per-sample angle deltas written out for this sub-block
+    const auto renderLanes = [&] (int firstChannel, int numLanes, bool front, bool back)
+    {
+        if (modulationOn && (chain.inFront[modStage] ? front : back))
+            renderLfos (mModLfos, firstChannel, numLanes, mModLfoBlocks, mModRamping ? mModAngleDeltaBlock : nullptr, numSamples);
+
+        mCpuMeter.lap (modulationSection);
+
+        if (pulsingOn && ! mPulserInterpolated && (chain.inFront[pulserStage] ? front : back))
+            renderLfos (mPulserLfos, firstChannel, numLanes, mPulserLfoBlocks, mPulserRamping ? mPulserAngleDeltaBlock : nullptr, numSamples);
+
+        mCpuMeter.lap (pulsingSection);
+    };
+
+    const auto runSteps = [this, numSamples] (const SubBlockFunction<SampleType>* functions, int numFunctions,
+                                              SampleType* data, int channel, int lane)
+    {
+        for (int step = 0; step < numFunctions; ++step)
+            (this->*functions[step]) (data, numSamples, channel, lane);
+    };
+
+    if (mLevelLinked)
+    {
+        std::fill (mLinkedInputLevels, mLinkedInputLevels + numSamples, 0.0);
+        std::fill (mLinkedOutputLevels, mLinkedOutputLevels + numSamples, 0.0);
+    }
+
+    // the channels go in groups of mChannelLanes, with the group's LFOs rendered together, and each
+    // channel goes through the front and then the back while its sub-block is in L1
+    for (int firstChannel = 0; firstChannel < numChannels; firstChannel += mChannelLanes)
+    {
+        const int numLanes = std::min (mChannelLanes, numChannels - firstChannel);
+        renderLanes (firstChannel, numLanes, true, ! mLevelLinked);
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const int channel = firstChannel + lane;
+            runSteps (steps.front, steps.numFront, channelData[channel] + start, channel, lane);
+
+            if (! mLevelLinked)
+                runSteps (steps.back, steps.numBack, channelData[channel] + start, channel, lane);
+        }
+    }
+
+    // linked, the gain needs the levels of every channel, so the backs go round a second time
+    if (mLevelLinked)
+    {
+        followLinkedLevels (numSamples);
+        mCpuMeter.lap (distortionSection);
+
+        for (int firstChannel = 0; firstChannel < numChannels; firstChannel += mChannelLanes)
+        {
+            const int numLanes = std::min (mChannelLanes, numChannels - firstChannel);
+            renderLanes (firstChannel, numLanes, false, true);
+
+            for (int lane = 0; lane < numLanes; ++lane)
+                runSteps (steps.back, steps.numBack, channelData[firstChannel + lane] + start, firstChannel + lane, lane);
+        }
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::processBypassed (SampleType* const* channelData, int numChannels, int start, int numSamples)
+{
+    if (! mChainParked)
+    {
+        // the bypass delays carry on from the level delays, which were the dry side of the crossfade
+        // in. Everything else empties, so when the bypass fades out the chain starts from silence
+        // rather than from whatever was in it when it was bypassed
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            if (! mBypassDryDelayed)
+                mBypassDelays[(size_t) channel] = mLevelDelays[(size_t) channel];
+
+            mLevelDelays[(size_t) channel].reset();
+            mDryDelays[(size_t) channel].reset();
+        }
+
+        mOversamplersRunning = false;
+        resetLevelFollowers();
+
+        mChainParked = true;
+        mBypassDryDelayed = true;
+        mSilentSamples = 0;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        mBypassDelays[(size_t) channel].process (channelData[channel] + start, numSamples);
+}
+
+template <typename SampleType>
+bool MultiEffectCore::skipSilence (SampleType* const* channelData, int numChannels, int start, int numSamples)
+{
+    if (! mIdleFastPaths)
+    {
+        wakeUp();
+        mSilentSamples = 0;
+        return false;
+    }
+
+    // the silence at the end of the sub-block, over all the channels. Only exact zeros count, so
+    // that the output of a skipped sub-block really is silent. A channel with sound in its last
+    // sample, which is most of them, stops the search straight away
+    int numSilent = numSamples;
+
+    for (int channel = 0; channel < numChannels && numSilent > 0; ++channel)
+    {
+        const SampleType* data = channelData[channel] + start;
+
+        if (data[numSamples - 1] != (SampleType) 0)
+        {
+            numSilent = 0;
+        }
+        else if (! VectorOps::isSilent (data + numSamples - numSilent, numSilent))
+        {
+            int sample = numSamples - 1;
+
+            while (data[sample - 1] == (SampleType) 0)
+                --sample;
+
+            numSilent = numSamples - sample;
+        }
+    }
+
+    // it can be skipped if it's silent and whatever came before it has died away
+    if (numSilent < numSamples || mSilentSamples < mTailSamples)
+    {
+        mSilentSamples = numSilent < numSamples ? numSilent : mSilentSamples + numSamples;
+        wakeUp();
+        return false;
+    }
+
+    if (! mIdle)
+    {
+        // all that's left in the filters and delays is below the tail threshold
+        for (int channel = 0; channel < mNumChannels; ++channel)
+        {
+            mDryDelays[(size_t) channel].reset();
+            mLevelDelays[(size_t) channel].reset();
+            mBypassDelays[(size_t) channel].reset();
+        }
+
+        mOversamplersRunning = false;
+        mIdle = true;
+    }
+
+    // the LFOs catch up from the position when the chain runs again. While a frequency is ramping
+    // there's nothing to work them out from, so they're rendered (into blocks nobody reads) as usual
+    for (int firstChannel = 0; firstChannel < numChannels; firstChannel += LfoOscillator::maxLanes)
+    {
+        const int numLanes = std::min (LfoOscillator::maxLanes, numChannels - firstChannel);
+
+        if (mModRamping && isModulationOn())
+            renderLfos (mModLfos, firstChannel, numLanes, mModLfoBlocks, mModAngleDeltaBlock, numSamples);
+
+        if (mPulserRamping && isPulsingOn())
+            renderLfos (mPulserLfos, firstChannel, numLanes, mPulserLfoBlocks, mPulserAngleDeltaBlock, numSamples);
+    }
+
+    mIdleSamples += numSamples;
+    return true;
+}
+
+void MultiEffectCore::wakeUp()
+{
+    if (! mIdle)
+        return;
+
+    // the followers have been releasing towards silence all along
+    for (auto* followers : { &mInputFollowers, &mOutputFollowers })
+        for (auto& follower : *followers)
+            follower.decay (mIdleSamples);
+
+    mLinkedInputFollower.decay (mIdleSamples);
+    mLinkedOutputFollower.decay (mIdleSamples);
+
+    mIdle = false;
+    mIdleSamples = 0.0;
+}
+
+bool MultiEffectCore::isNeutral (int numChannels) const
+{
+    // with the envelopes equal the make-up gain is exactly 1, and as long as the output is the input
+    // they both follow the same levels and stay equal
+    if (! mIdleFastPaths || getConfiguration() != 0 || mBypassRamping || mOversamplers[0].getFactor() > 1)
+        return false;
+
+    if (mLevelLinked)
+        return mLinkedInputFollower.getEnvelope() == mLinkedOutputFollower.getEnvelope();
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        if (mInputFollowers[(size_t) channel].getEnvelope() != mOutputFollowers[(size_t) channel].getEnvelope())
+            return false;
+
+    return true;
+}
+
+template <typename SampleType>
+void MultiEffectCore::followNeutral (SampleType* const* channelData, int numChannels, int start, int numSamples)
+{
+    // the same sums as the kernel, so the envelopes are where it would have left them
+    if (mLevelLinked)
+    {
+        std::fill (mLinkedInputLevels, mLinkedInputLevels + numSamples, 0.0);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int sample = 0; sample < numSamples; ++sample)
+                mLinkedInputLevels[sample] = std::max (mLinkedInputLevels[sample], EnvelopeFollower::getLevel (channelData[channel][start + sample], mLevelDetector));
+
+        auto follower = mLinkedInputFollower;
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            follower.process (mLinkedInputLevels[sample]);
+
+        mLinkedInputFollower = follower;
+        mLinkedOutputFollower.setEnvelope (follower.getEnvelope());
+        return;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const SampleType* data = channelData[channel] + start;
+        auto follower = mInputFollowers[(size_t) channel];
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            follower.process (EnvelopeFollower::getLevel (data[sample], mLevelDetector));
+
+        mInputFollowers[(size_t) channel] = follower;
+        mOutputFollowers[(size_t) channel].setEnvelope (follower.getEnvelope());
+    }
+}
+
+template <typename SampleType>
+void MultiEffectCore::processReference (SampleType* const* channelData, int numChannels, int numSamples)
+{
+    assert (numChannels <= mNumChannels);
+    numChannels = std::min (numChannels, mNumChannels);
+
+    updateParameters (mParameters.takeChanges());
+    finishRamps();
+    mChain = mNextChain.load (std::memory_order_acquire);
+
+    for (auto* lfos : { &mModLfos, &mPulserLfos })
+        for (auto& lfo : *lfos)
+            lfo.setPosition (mSamplePosition);
+
+    // keep a copy of the input so we can do automatic gain matching after the distortion DSP. This is
+    // only the verification path, so the copy is simply allocated here
+    std::vector<std::vector<SampleType>> inputs;
+    std::vector<const SampleType*> inputPointers;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        inputs.emplace_back (channelData[channel], channelData[channel] + numSamples);
+
+    for (const auto& input : inputs)
+        inputPointers.push_back (input.data());
+
+    // one stage after another in the order that was set, the make-up gain straight after the distortion
+    for (auto stage : mChain->order.stages)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (stage == modStage)
+                doModulation (channelData[channel], numSamples, channel);
+            else if (stage == distStage)
+                doDistortion (channelData[channel], numSamples, channel);
+            else if (stage == pulserStage)
+                doPulsing (channelData[channel], numSamples, channel);
+        }
+
+        if (stage == distStage)
+            doLevelCompensation (inputPointers.data(), channelData, numChannels, numSamples);
+    }
+
+    mSamplePosition += numSamples;
+}
+
+//==============================================================================
+template void MultiEffectCore::processReference<float> (float* const*, int, int);
+template void MultiEffectCore::processReference<double> (double* const*, int, int);
+template void MultiEffectCore::doModulation<float> (float*, int, int);
+template void MultiEffectCore::doModulation<double> (double*, int, int);
+template void MultiEffectCore::doDistortion<float> (float*, int, int);
+template void MultiEffectCore::doDistortion<double> (double*, int, int);
+template void MultiEffectCore::doPulsing<float> (float*, int, int);
+template void MultiEffectCore::doPulsing<double> (double*, int, int);
+template void MultiEffectCore::doLevelCompensation<float> (const float* const*, float* const*, int, int);
+template void MultiEffectCore::doLevelCompensation<double> (const double* const*, double* const*, int, int);
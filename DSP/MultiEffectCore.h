@@ -0,0 +1,705 @@
+/*
+  ==============================================================================
+
+    MultiEffectCore.h
+    The modulation, distortion and pulsing chain (in that order unless another
+    one is set) with no JUCE dependency, so it can be driven by the plugin as
+    well as by the offline render and benchmark tools.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CpuMeter.h"
+#include "DelayLine.h"
+#include "EnvelopeFollower.h"
+#include "LfoOscillator.h"
+#include "Oversampler.h"
+#include "ParameterRamp.h"
+#include "ParameterStore.h"
+#include "QualityGovernor.h"
+#include "SignalTap.h"
+#include "StageOrder.h"
+#include "Waveshaper.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#define MOD_FREQ_INIT 100.0
+#define MOD_FREQ_LIMIT 5000.0
+
+#define OVERDRIVE_INIT 1.0
+#define OVERDRIVE_LIMIT 50.0
+
+#define PULSER_FREQ_INIT 2.0
+#define PULSER_FREQ_LIMIT 10.0
+
+// how often the plugin works out the pulser LFO while playing live, in samples (see setPulserControlInterval())
+#define PULSER_CONTROL_INTERVAL 32
+
+// wet/dry balance of the distortion stage, 1 is fully distorted
+#define DIST_MIX_INIT 1.0
+
+// attack and release of the level followers behind the distortion make-up gain, in milliseconds
+#define LEVEL_ATTACK_INIT 10.0
+#define LEVEL_ATTACK_LIMIT 500.0
+
+#define LEVEL_RELEASE_INIT 100.0
+#define LEVEL_RELEASE_LIMIT 5000.0
+
+// the make-up gain never goes above this (+24dB), so a near silent output can't be blown up
+#define LEVEL_GAIN_LIMIT 16.0
+
+// declaring enums outside of class definition so that the Editor, the Processor and the tools can all use them
+enum modType
+{
+    rm = 1,
+    am
+};
+
+enum distType
+{
+    soft = 1,
+    hard
+};
+
+// a parameter change that lands sampleOffset samples into the block handed to process().
+// modTypeParam, distTypeParam and levelDetectorParam take the enum values, levelLinkParam, bypassParam and
+// the enabled parameters 0 or 1
+struct ParameterEvent
+{
+    int sampleOffset;
+    parameterId parameter;
+    double value;
+};
+
+//==============================================================================
+class MultiEffectCore
+{
+public:
+    // the per-channel state is allocated in prepare() for the number of channels asked for, which
+    // can be anything from mono up to this (e.g. 7.1.4 or third order ambisonics)
+    static constexpr int maxChannels = 64;
+
+    // the kernel works through each channel in sub-blocks of this many samples, so the audio (1kB)
+    // and both LFO buffers (2kB each) stay in L1 from one stage to the next
+    static constexpr int subBlockSize = 256;
+
+    // mod frequency, overdrive, pulser frequency and dist mix glide to a new value over this long.
+    // A change of mod or dist type crossfades between the two over the same time, and the modulation
+    // and pulsing fade in from and out to the dry signal as they're turned on and off
+    static constexpr double parameterRampSeconds = 0.05;
+
+    // switching the bypass on or off crossfades between the chain and its input over this long
+    static constexpr double bypassRampSeconds = 0.02;
+
+    MultiEffectCore();
+
+    //==============================================================================
+    // allocates the per-channel state for numChannels channels, the version without a channel
+    // count keeps the current one (stereo to begin with)
+    void prepare (double sampleRate, int numChannels);
+    void prepare (double sampleRate);
+    void reset();
+
+    int getNumChannels() const      { return mNumChannels; }
+
+    // the position of the next sample handed to process(), from 0 at prepare() and reset(), moved
+    // on by every sample processed. The LFO phases are worked out from it (see LfoOscillator), so
+    // a render that starts partway through a file (with the position set to match) has its LFOs
+    // exactly where they'd be in one that went through from the start, as long as no frequency
+    // has changed since the start. Setting it is a jump, to follow a host's timeline for example.
+    // Audio thread only
+    long long getSamplePosition() const                 { return mSamplePosition; }
+    void setSamplePosition (long long position)         { mSamplePosition = position; }
+
+    // a hash of everything that carries over from one sample to the next: the position, the LFOs,
+    // the filters and delays, the level followers, the ramps and the silence count. Two cores with
+    // the same settings and the same hash give the same output from then on for the same input,
+    // which is how a render split into sections checks its seams. Audio thread only
+    uint64_t getStateHash() const;
+
+    // runs the whole chain in place on each channel, every stage on a sub-block before the next one.
+    // numChannels must not be more than were prepared, any extra channels are left untouched.
+    // Everything, the distortion make-up gain included, is worked out per sample, so the output is
+    // bit-identical to processReference() and the same at any host block size
+    void process (float* const* channelData, int numChannels, int numSamples);
+
+    // same, with the events (sorted by sampleOffset, offsets within the block) applied at their
+    // sample positions. The ramps are computed per sample from the time of each event, so the
+    // LFOs and parameter ramps come out the same whatever size the host blocks are
+    void process (float* const* channelData, int numChannels, int numSamples,
+                  const ParameterEvent* events, int numEvents);
+
+    // the same chain in double precision, for hosts with a 64-bit mix bus. The kernels are the float
+    // ones compiled for double, so the signal is never rounded to float on the way through. All of
+    // the state (LFOs, filters, delays, level followers) is shared with the float path, so a host
+    // may even switch from one to the other between blocks
+    void process (double* const* channelData, int numChannels, int numSamples);
+    void process (double* const* channelData, int numChannels, int numSamples,
+                  const ParameterEvent* events, int numEvents);
+
+    // the original stage-by-stage chain (three sweeps per channel, plus one over all of them for
+    // the make-up gain), kept so the tools can verify and benchmark the fused kernel against it. Parameter
+    // changes jump straight to their new values at the start of the block, as they used to
+    // processReference() also leaves out the oversampling, the dist mix and the bypass. Works in float or double
+    template <typename SampleType>
+    void processReference (SampleType* const* channelData, int numChannels, int numSamples);
+
+    //==============================================================================
+    // the parameter setters are wait-free and may be called from any thread. The values are
+    // handed over through a ParameterStore and picked up at the start of the next process()
+    // (or prepare()), the getters return the latest value that was set. Events passed to
+    // process() don't go through the store and aren't reflected by the getters
+    modType getModType() const;
+    void setModType (modType type);
+
+    distType getDistType() const;
+    void setDistType (distType type);
+
+    double getModFreq() const;
+    void setModFreq (double freq);
+
+    double getOverdrive() const;
+    void setOverdrive (double value);
+
+    double getPulserFreq() const;
+    void setPulserFreq (double freq);
+
+    double getDistMix() const;
+    void setDistMix (double mix);
+
+    // the distortion make-up gain brings the level after the distortion back to the level of the
+    // input, both measured by envelope followers with these attack and release times (in ms).
+    // Each channel follows its own levels, unless they're linked, in which case the loudest channel
+    // sets one gain for all of them (which keeps the stereo image where it was)
+    double getLevelAttack() const;
+    void setLevelAttack (double milliseconds);
+
+    double getLevelRelease() const;
+    void setLevelRelease (double milliseconds);
+
+    levelDetector getLevelDetector() const;
+    void setLevelDetector (levelDetector detector);
+
+    bool getLevelLink() const;
+    void setLevelLink (bool shouldBeLinked);
+
+    // bypassing crossfades to the input, delayed by the latency so the timing doesn't move, over
+    // bypassRampSeconds. Once it's fully bypassed the chain isn't run at all, and it starts again
+    // from a clean state (empty filters, followers at silence) when it's switched back on
+    bool getBypassed() const;
+    void setBypassed (bool shouldBeBypassed);
+
+    // a stage that's turned off fades out over parameterRampSeconds the way it would going to its
+    // neutral setting: the modulation and pulsing fade to the dry signal and the overdrive goes down
+    // to 1. Its settings are kept for when it's turned back on
+    bool getModEnabled() const;
+    void setModEnabled (bool shouldBeEnabled);
+
+    bool getDistEnabled() const;
+    void setDistEnabled (bool shouldBeEnabled);
+
+    bool getPulserEnabled() const;
+    void setPulserEnabled (bool shouldBeEnabled);
+
+    // sets every parameter in the snapshot's mask at once (a program change, or a session being
+    // loaded). They're all picked up on the same sample and glide or crossfade from the old values
+    // like any other change. Wait-free, but only one thread at a time may set snapshots
+    void setParameters (const ParameterSnapshot& snapshot);
+
+    // the latest value set for each parameter, all of them in the mask
+    ParameterSnapshot getParameters() const;
+
+    // the order the stages run in. Every order is compiled once per process, the first time a core is
+    // made, into flat lists of sub-block kernels, one pair for every configuration of the stages, and
+    // all the instances share them. Setting one hands the audio thread a pointer to its lists, which
+    // it takes at the start of its next block, and all it does per sub-block is pick the lists for the
+    // configuration it's in. Wait-free, but only one thread at a time may set orders; the new order
+    // starts on the next block's first sample, without a crossfade. Wherever the distortion is, its
+    // make-up gain brings the level back to the level at the input of the chain. An order that isn't
+    // valid sets the default
+    StageOrder getStageOrder() const;
+    void setStageOrder (const StageOrder& order);
+
+    //==============================================================================
+    // runs the drive + clip of the distortion stage at factor (1, 2, 4 or 8) times the sample rate.
+    // Not wait-free: it only takes effect at the next prepare(), which is where the filters are
+    // designed, so set it before preparing (the plugin re-prepares with processing suspended)
+    void setOversampling (int factor, oversamplingFilter filter);
+    int getOversamplingFactor() const                   { return mOversamplingFactor; }
+    oversamplingFilter getOversamplingFilter() const    { return mOversamplingFilter; }
+
+    // the delay added by the oversampling, in samples, as of the last prepare(). The dry side of the
+    // dist mix and a bypassed distortion stage are delayed by the same amount, so it doesn't change
+    // with the parameters
+    int getLatencySamples() const;
+
+    // how long the output can carry on after the input goes silent, as of the last prepare(): the
+    // ring-out of the oversampling filters (down to -140dB), or 0 without oversampling. Everything
+    // else in the chain (the LFOs, the parameter ramps, the level followers) only scales the signal,
+    // so nothing is left once the filters have emptied
+    int getTailSamples() const      { return mTailSamples; }
+
+    // picks how the modulation and pulser LFOs are generated, see lfoBackend. Below full quality
+    // they're rotators whatever this is (see setAdaptiveQuality())
+    lfoBackend getLfoBackend() const;
+    void setLfoBackend (lfoBackend backend);
+
+    // picks the tanh used by the soft clip in process(), see tanhApprox (the default is padeTanh).
+    // processReference() always uses std::tanh, and lowQuality the polynomial
+    tanhApprox getTanhApprox() const;
+    void setTanhApprox (tanhApprox approx);
+
+    // process() normally runs sub-block kernels compiled for the current combination of stages
+    // and modes, picked once per sub-block. Turning this off runs the same kernels with the flags
+    // tested at runtime instead, which is only useful for benchmarking
+    void setSpecialisedProcessing (bool shouldBeSpecialised)  { mSpecialisedProcessing = shouldBeSpecialised; }
+
+    // with these on (the default) process() skips the work it doesn't need to do:
+    // - once the input has been digital silence for longer than the tail, the output is silence as
+    //   well, so those sub-blocks aren't run. The LFOs and level followers are moved on to where
+    //   they'd have got to when the input comes back
+    // - with every stage neutral (mod freq 0, overdrive 1, pulser 0), no oversampling and both
+    //   level envelopes equal, the output is the input, so only the input level is followed
+    // The neutral path is bit-identical, and so are the LFO phases coming back from silence, which
+    // are worked out from the position. The envelopes are worked out in one step rather than per
+    // sample, so they differ in the last few bits
+    bool getIdleFastPaths() const   { return mIdleFastPaths; }
+    void setIdleFastPaths (bool shouldSkipIdleWork)          { mIdleFastPaths = shouldSkipIdleWork; }
+
+    // how many channels process() runs side by side (1 to LfoOscillator::maxLanes, default 4). Their
+    // LFOs are rendered together as SIMD lanes into per-channel blocks, which then go through the
+    // kernel one channel at a time. The output is the same for every setting, 1 is the plain
+    // channel-by-channel loop
+    int getChannelLanes() const     { return mChannelLanes; }
+    void setChannelLanes (int numLanes);
+
+    // the pulser never goes above PULSER_FREQ_LIMIT, so it doesn't need working out every sample.
+    // Above 1 (a power of two up to LfoOscillator::resyncInterval, default 1) its LFO is taken every
+    // numSamples samples and a cubic curve through those gives the ones in between (see
+    // LfoOscillator::renderInterpolated()). process() works the curve out once per sub-block for
+    // all the channels, which leaves the stage a multiply-add per sample, and doPulsing() (so
+    // processReference() as well) uses the same curve. While the frequency is ramping the LFOs
+    // are rendered every sample as usual. The curve only depends on the position, so the output
+    // is still the same at any block size. The gain is within (2 pi f numSamples / sampleRate)^4 / 768
+    // of the one worked out every sample, under 1.5e-6 even at 10 Hz every 64 samples at 22.05 kHz.
+    // Set it between process() calls. Below full quality it's PULSER_CONTROL_INTERVAL at least
+    int getPulserControlInterval() const    { return mPulserControlInterval; }
+    void setPulserControlInterval (int numSamples);
+
+    // with adaptive quality on, process() times itself and hands the time to the governor, which
+    // gives up quality a tier at a time while the blocks take too long and wins it back once
+    // there's room again (see QualityGovernor and qualityTier). The settings above are left as they
+    // were set, the tier only changes what's run. The LFOs and the pulser change over at a block
+    // boundary, they're well under anything audible apart. The tanh and the oversampling crossfade
+    // over parameterRampSeconds, one tier at a time: the lighter oversampling goes through a delay
+    // that keeps the latency where it was, and the path coming in runs unheard for the filters'
+    // tail first, so its filters have settled by the time it's faded in. The lighter oversamplers
+    // are only made by a prepare() with adaptive quality on and oversampling, without them it
+    // stops at lowQuality. Turning it off goes straight back to full quality at the next block,
+    // without a fade, which is what a render (or a host rendering offline) should get. Off by
+    // default. Any thread
+    bool getAdaptiveQuality() const;
+    void setAdaptiveQuality (bool shouldAdapt);
+
+    // the tier the last block ran at. Any thread
+    qualityTier getQualityTier() const;
+
+    QualityGovernor& getQualityGovernor()       { return mQualityGovernor; }
+
+    double getSampleRate() const    { return mSampleRate; }
+
+    // times every process() call and the modulation, distortion and pulsing inside it, once it's
+    // enabled (see CpuMeter). The measurements are queued for one other thread to pick up
+    CpuMeter& getCpuMeter()         { return mCpuMeter; }
+
+    // once enabled, every process() call queues the input and output peaks and the make-up gain of
+    // each channel, and the output mixed down to mono, for the editor's meters, scope and spectrum
+    SignalTap& getSignalTap()       { return mSignalTap; }
+
+    // audio thread only: the make-up gain the channel's followers (or the linked ones) are on now
+    double getMakeUpGain (int channel) const;
+
+    //==============================================================================
+    // the individual stages are public so that the benchmark can time them on their own
+    template <typename SampleType>
+    void doModulation (SampleType* channelData, int numSamples, int channel);
+
+    template <typename SampleType>
+    void doDistortion (SampleType* channelData, int numSamples, int channel);
+
+    template <typename SampleType>
+    void doPulsing (SampleType* channelData, int numSamples, int channel);
+
+    // the make-up gain, inputs being what went into the chain for each channel
+    template <typename SampleType>
+    void doLevelCompensation (const SampleType* const* inputs, SampleType* const* channelData, int numChannels, int numSamples);
+
+    // largest absolute sample value, same as juce::AudioBuffer::getMagnitude()
+    static float getMagnitude (const float* channelData, int numSamples);
+
+private:
+    double mSampleRate;
+    int mNumChannels;
+
+    ParameterStore mParameters;
+
+    // audio thread copies of the parameters (the targets while they're ramping), only written by setParameter()
+    double mModFreqSliderValue;
+    double mOverdriveSliderValue;
+    double mPulserFreqSliderValue;
+
+    double mModAngleDelta;
+    double mPulserAngleDelta;
+    lfoBackend mLfoBackend;
+
+    double mDistMixSliderValue;
+    bool mBypassed;
+
+    bool mModEnabled;
+    bool mDistEnabled;
+    bool mPulserEnabled;
+
+    // the last order set, as its code, for getStageOrder()
+    std::atomic<int> mStageOrderCode { StageOrder().getCode() };
+
+    double mLevelAttackValue;
+    double mLevelReleaseValue;
+    levelDetector mLevelDetector;
+    bool mLevelLinked;
+
+    int mOversamplingFactor;
+    oversamplingFilter mOversamplingFilter;
+
+    // per-channel state, one contiguous array per kind of state, indexed by channel and sized in
+    // prepare() so nothing is allocated while processing. Every channel has its own oscillators
+    std::vector<LfoOscillator> mModLfos;
+    std::vector<LfoOscillator> mPulserLfos;
+    std::vector<Oversampler> mOversamplers;
+
+    // the dry signal, delayed to line up with the oversampled wet one
+    std::vector<DelayLine> mDryDelays;
+
+    // the sub-block of dry signal for each channel, subBlockSize samples apiece. Doubles, which hold
+    // a float exactly, so both precisions can use them
+    std::vector<double> mDryBlocks;
+
+    // the input level is delayed as well, so it's compared with the output it turned into
+    std::vector<DelayLine> mLevelDelays;
+
+    // the input and output level of each channel, and the shared ones used while they're linked
+    std::vector<EnvelopeFollower> mInputFollowers;
+    std::vector<EnvelopeFollower> mOutputFollowers;
+    EnvelopeFollower mLinkedInputFollower;
+    EnvelopeFollower mLinkedOutputFollower;
+
+    // the oversamplers are left alone while the distortion is off and reset when it comes back on,
+    // rather than carrying on from whatever was in their filters at the time
+    bool mOversamplersRunning;
+
+    // the input before the chain, delayed by the latency, for the dry side of the bypass crossfade.
+    // Going into bypass it comes from the level delays, which are running anyway. Once it's fully
+    // bypassed the chain is parked (emptied, so it starts again from silence) and the input goes
+    // through the bypass delays instead, until the crossfade back out is over
+    std::vector<double> mBypassDryBlocks;
+    std::vector<DelayLine> mBypassDelays;
+    bool mChainParked;
+    bool mBypassDryDelayed;
+
+    bool mIdleFastPaths;
+    int mTailSamples;
+
+    // how many samples the input has been silent for on every channel, counted up to the tail.
+    // While idle, the number of samples the level followers would have released for is kept, and
+    // only applied once the input comes back
+    int mSilentSamples;
+    bool mIdle;
+    double mIdleSamples;
+
+    long long mSamplePosition;
+
+    modType mModType;
+    distType mDistType;
+
+    tanhApprox mTanhApprox;
+    bool mSpecialisedProcessing;
+    int mChannelLanes;
+    int mPulserControlInterval;
+
+    CpuMeter mCpuMeter;
+    SignalTap mSignalTap;
+
+    // what the quality tier runs instead of the settings above. mFadingFromTanh is the tanh being
+    // faded out while mTanhFading
+    std::atomic<bool> mAdaptiveQuality { false };
+    std::atomic<int> mLastQualityTier { fullQuality };
+    QualityGovernor mQualityGovernor;
+    qualityTier mQualityTier;
+    tanhApprox mActiveTanh;
+    tanhApprox mFadingFromTanh;
+    int mActivePulserInterval;
+
+    // the oversamplers at half the factor for minimumQuality, and the delays that bring them up to
+    // the latency of the full ones. Either path only runs while it's heard or being faded in or out
+    std::vector<Oversampler> mLightOversamplers;
+    std::vector<DelayLine> mLightDelays;
+    bool mLightPathAvailable;
+    bool mFullPathRunning;
+    bool mLightPathRunning;
+
+    // samples left for the path coming in to settle before its fade starts
+    int mQualityWarmUp;
+    bool mLightFadePending;
+
+    ParameterRamp mModAngleDeltaRamp;
+    ParameterRamp mOverdriveRamp;
+    ParameterRamp mPulserAngleDeltaRamp;
+    ParameterRamp mDistMixRamp;
+    ParameterRamp mBypassRamp;
+
+    // 0 is RM / hard clipping and 1 is AM / soft clipping, the crossfade between the two while ramping
+    ParameterRamp mModTypeRamp;
+    ParameterRamp mDistTypeRamp;
+
+    // 1 while the modulation / pulsing is on and 0 while it's off (frequency 0), the amount of the
+    // stage that's mixed in while ramping. They only ramp along with the frequency, which keeps the
+    // stage running until both are over
+    ParameterRamp mModDepthRamp;
+    ParameterRamp mPulserDepthRamp;
+
+    // 0 for the tanh faded out / the full oversampling and 1 for the new tanh / the light oversampling
+    ParameterRamp mTanhFadeRamp;
+    ParameterRamp mLightFadeRamp;
+
+    // the ramps written out for the current sub-block, shared by all channels. Only valid while
+    // the matching flag is set, which is for the whole sub-block or not at all
+    double mModAngleDeltaBlock[subBlockSize];
+    double mOverdriveBlock[subBlockSize];
+    double mPulserAngleDeltaBlock[subBlockSize];
+    double mDistMixBlock[subBlockSize];
+    double mBypassBlock[subBlockSize];
+    double mModTypeBlock[subBlockSize];
+    double mDistTypeBlock[subBlockSize];
+    double mModDepthBlock[subBlockSize];
+    double mPulserDepthBlock[subBlockSize];
+    double mTanhFadeBlock[subBlockSize];
+    double mLightFadeBlock[subBlockSize];
+
+    bool mModRamping;
+    bool mOverdriveRamping;
+    bool mPulserRamping;
+    bool mDistMixRamping;
+    bool mBypassRamping;
+    bool mModTypeRamping;
+    bool mDistTypeRamping;
+    bool mModDepthRamping;
+    bool mPulserDepthRamping;
+    bool mTanhFading;
+    bool mLightFading;
+
+    // set for a sub-block where the pulser runs at the control rate, its curve being the first
+    // block of mPulserLfoBlocks for every channel
+    bool mPulserInterpolated;
+
+    // the LFO output of the channels in the current group, one block per lane, 32k in all so a
+    // group's blocks stay in L1 while its channels go through the kernel
+    double mModLfoBlocks[LfoOscillator::maxLanes][subBlockSize];
+    double mPulserLfoBlocks[LfoOscillator::maxLanes][subBlockSize];
+
+    // the input level of the channel going through the kernel, or with the levels linked, the
+    // loudest input and output level of each sample over all the channels and the gain they give
+    double mInputLevelBlock[subBlockSize];
+    double mLinkedInputLevels[subBlockSize];
+    double mLinkedOutputLevels[subBlockSize];
+    double mLinkedGainBlock[subBlockSize];
+
+    double reRangeLfoSample (double sample);
+
+    // the make-up gain for a pair of envelopes, the same sum in the kernel and the reference chain
+    double getCompensationGain (double inputEnvelope, double outputEnvelope) const;
+
+    // applies the attack/release times to every follower, and carries the envelopes over when the
+    // detector or the linking changes
+    void updateLevelFollowers (bool detectorChanged, bool linkChanged);
+
+    // turns the linked levels of the sub-block into mLinkedGainBlock
+    void followLinkedLevels (int numSamples);
+
+    void resetLevelFollowers();
+
+    // the soft and hard clip of the same signal, crossfaded by mDistTypeBlock. Each value of the
+    // block goes with factor samples, which are oversampled ones when the clipping is
+    template <typename SampleType>
+    void crossfadeClip (SampleType* data, int numSamples, int factor, double drive);
+
+    // the soft clip with the tanh of the quality tier, crossfaded from the last one by mTanhFadeBlock
+    // while it's changing. Each value of the block goes with factor samples, as above
+    template <typename SampleType>
+    void softClip (SampleType* data, int numSamples, int factor, double drive);
+
+    // drive + clip at the oversampler's rate, in place
+    template <typename SampleType>
+    void clipOversampled (Oversampler& oversampler, SampleType* channelData, int numSamples, double drive, bool softClipOn);
+
+    // the same through whichever of the full and light paths are running, mixed by the fade
+    template <typename SampleType>
+    void clipBothPaths (SampleType* channelData, int numSamples, int channel, double drive, bool softClipOn);
+
+    // audio thread: picks up the governor's tier at the start of a block (full quality while
+    // adaptive quality is off), as long as the last change is over
+    void updateQualityTier (bool adaptive);
+
+    // sets what's run for mQualityTier. With fade false everything switches over at once
+    void applyQualityTier (bool fade);
+
+    // starts the full or the light path from empty filters
+    void startOversamplingPath (bool light);
+
+    // sends an impulse through an oversampler set up like the ones in use and counts how long it rings
+    int measureTailSamples() const;
+
+    // copies the parameters flagged in "changes" from the store and recomputes what depends on them
+    void updateParameters (uint32_t changes);
+
+    // applies the latest snapshot, if one was set since the last block
+    void takeSnapshot();
+
+    // audio thread only: sets the new target and starts its ramp
+    void setParameter (parameterId parameter, double value);
+    static double limitParameter (parameterId parameter, double value);
+
+    // snaps every ramp to its target, for prepare() and the reference chain
+    void finishRamps();
+
+    // shortens numSamples so no ramp ends inside the sub-block, then writes out the running ramps
+    int fillRampBlocks (int numSamples);
+
+    // hands the target angle deltas to the LFOs once their ramps are over
+    void updateLfoAngleDeltas();
+
+    // brings a group of channels' LFOs up to the current position, then renders the sub-block of
+    // them into the blocks. angleDeltas is the ramp, or nullptr for their fixed deltas
+    void renderLfos (std::vector<LfoOscillator>& lfos, int firstChannel, int numLanes,
+                     double (*blocks)[subBlockSize], const double* angleDeltas, int numSamples);
+
+    // process() for either precision: splits the block at the events, then runs the sub-blocks
+    template <typename SampleType>
+    void processBlock (SampleType* const* channelData, int numChannels, int numSamples,
+                       const ParameterEvent* events, int numEvents);
+
+    template <typename SampleType>
+    void processSubBlocks (SampleType* const* channelData, int numChannels, int startSample, int numSamples);
+
+    // one sub-block through the compiled chain, all channels
+    template <typename SampleType>
+    void processChain (SampleType* const* channelData, int numChannels, int start, int numSamples);
+
+    // a fully bypassed sub-block: the input delayed by the latency. The first one parks the chain
+    template <typename SampleType>
+    void processBypassed (SampleType* const* channelData, int numChannels, int start, int numSamples);
+
+    // counts the silence at the input, and returns true if the sub-block can be skipped because
+    // the output would be silent too. Wakes the chain up when the input comes back
+    template <typename SampleType>
+    bool skipSilence (SampleType* const* channelData, int numChannels, int start, int numSamples);
+    void wakeUp();
+
+    // true when the chain passes the input through unchanged, see setIdleFastPaths()
+    bool isNeutral (int numChannels) const;
+
+    // the neutral path: follows the input level, which the output level is equal to
+    template <typename SampleType>
+    void followNeutral (SampleType* const* channelData, int numChannels, int start, int numSamples);
+
+    //==============================================================================
+    // a configuration is a bit mask of these, one kernel is compiled for each combination
+    enum configurationBits
+    {
+        modulationBit = 1,
+        amBit = 2,
+        distortionBit = 4,
+        softClipBit = 8,
+        pulsingBit = 16,
+        numConfigurations = 32
+    };
+
+    // passing runtimeConfiguration makes the kernel read the flags from the members instead
+    static constexpr int runtimeConfiguration = -1;
+
+    // a chain is run as steps, each one a stage (or part of one) on one channel's sub-block. They
+    // come in two halves: the front measures the input level and runs the stages up to and including
+    // the distortion, the back applies the make-up gain and the dist mix, runs the rest of the stages
+    // and the bypass crossfade. Each channel normally goes through both in turn; with the levels linked
+    // every channel goes through the front before the gain can be worked out, and then through the back.
+    // lane is the channel's place in its group, which picks its LFO blocks
+    template <typename SampleType>
+    using SubBlockFunction = void (MultiEffectCore::*) (SampleType*, int, int, int);
+
+    static constexpr int maxChainSteps = numEffectStages + 2;
+
+    template <typename SampleType>
+    struct StepList
+    {
+        SubBlockFunction<SampleType> front[maxChainSteps];
+        SubBlockFunction<SampleType> back[maxChainSteps];
+        int numFront;
+        int numBack;
+    };
+
+    // an order compiled for every configuration, and for the runtime flags after them, in both
+    // precisions. A stage that's off in a configuration isn't in its lists at all. They never change
+    // once they're built, so one copy of each order does for every instance
+    struct CompiledChain
+    {
+        StageOrder order;
+        StepList<float> floatSteps[numConfigurations + 1];
+        StepList<double> doubleSteps[numConfigurations + 1];
+
+        // whether the stage comes before the distortion, which is when its LFOs are rendered if
+        // the levels are linked
+        bool inFront[numEffectStages];
+
+        template <typename SampleType>
+        const StepList<SampleType>& getSteps (int configuration) const;
+    };
+
+    // the chain the last setStageOrder() picked, and the one the audio thread took at the start of
+    // its block
+    std::atomic<const CompiledChain*> mNextChain { nullptr };
+    const CompiledChain* mChain = nullptr;
+
+    // every order's chain, built the first time it's called
+    static const CompiledChain& getCompiledChain (const StageOrder& order);
+
+    template <typename SampleType>
+    static void compileSteps (const StageOrder& order, int configuration, StepList<SampleType>& steps);
+
+    int getConfiguration() const;
+
+    // a stage is on while it's away from its neutral setting, or ramping to or from it
+    bool isModulationOn() const;
+    bool isDistortionOn() const;
+    bool isPulsingOn() const;
+
+    // the steps. The specialised ones are only compiled for the configuration bits they look at
+    template <typename SampleType>
+    void processInputStep (SampleType* channelData, int numSamples, int channel, int lane);
+
+    template <typename SampleType, int configuration>
+    void processModulationStep (SampleType* channelData, int numSamples, int channel, int lane);
+
+    template <typename SampleType, int configuration>
+    void processDistortionStep (SampleType* channelData, int numSamples, int channel, int lane);
+
+    template <typename SampleType, int configuration>
+    void processMakeUpStep (SampleType* channelData, int numSamples, int channel, int lane);
+
+    template <typename SampleType, int configuration>
+    void processPulsingStep (SampleType* channelData, int numSamples, int channel, int lane);
+
+    template <typename SampleType>
+    void processOutputStep (SampleType* channelData, int numSamples, int channel, int lane);
+};
@@ -0,0 +1,510 @@
+/*
+  ==============================================================================
+
+    Oversampler.cpp
+
+  ==============================================================================
+*/
+
+#include "Oversampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr double pi = 3.141592653589793238;
+
+    constexpr double iirAttenuationDb = 90.0;
+    constexpr double firAttenuationDb = 120.0;
+
+    //==============================================================================
+    // polyphase allpass halfband design, after the elliptic filter method used by
+    // Laurent de Soras' HIIR library. transition is the width of the transition band
+    // either side of a quarter of the (high) sample rate, as a fraction of that rate
+    void computeTransitionParameters (double transition, double& k, double& q)
+    {
+        k = std::tan ((1.0 - transition * 2.0) * pi / 4.0);
+        k *= k;
+
+        const double kksqrt = std::pow (1.0 - k * k, 0.25);
+        const double e = 0.5 * (1.0 - kksqrt) / (1.0 + kksqrt);
+        const double e4 = e * e * e * e;
+
+        q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+    }
+
+    int computeOrder (double attenuationDb, double q)
+    {
+        const double attenuationPower = std::pow (10.0, -attenuationDb / 10.0);
+        const double a = attenuationPower / (1.0 - attenuationPower);
+
+        int order = (int) std::ceil (std::log (a * a / 16.0) / std::log (q));
+
+        if ((order & 1) == 0)
+            ++order;
+
+        return std::max (3, order);
+    }
+
+    double computeCoefficient (int index, double k, double q, int order)
+    {
+        const int c = index + 1;
+
+        double numerator = 0.0;
+        double sign = 1.0;
+
+        for (int i = 0; ; ++i, sign = -sign)
+        {
+            const double term = std::pow (q, (double) (i * (i + 1))) * std::sin ((i * 2 + 1) * c * pi / order) * sign;
+            numerator += term;
+
+            if (std::abs (term) <= 1.0e-100)
+                break;
+        }
+
+        double denominator = 0.0;
+        sign = -1.0;
+
+        for (int i = 1; ; ++i, sign = -sign)
+        {
+            const double term = std::pow (q, (double) (i * i)) * std::cos (i * 2 * c * pi / order) * sign;
+            denominator += term;
+
+            if (std::abs (term) <= 1.0e-100)
+                break;
+        }
+
+        const double ww = numerator * std::pow (q, 0.25) / (denominator + 0.5);
+        const double wwsq = ww * ww;
+        const double x = std::sqrt ((1.0 - wwsq * k) * (1.0 - wwsq / k)) / (1.0 + wwsq);
+
+        return (1.0 - x) / (1.0 + x);
+    }
+
+    // zeroth order modified Bessel function of the first kind, for the Kaiser window
+    double besselI0 (double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; term > 1.0e-12 * sum; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    inline double processAllpass (double coefficient, double input, double* state)
+    {
+        // state[0] is the previous input, state[1] the previous output
+        const double output = coefficient * (input - state[1]) + state[0];
+        state[0] = input;
+        state[1] = output;
+        return output;
+    }
+
+    std::vector<double> designIirHalfband (double attenuationDb, double transition)
+    {
+        double k, q;
+        computeTransitionParameters (transition, k, q);
+
+        const int order = computeOrder (attenuationDb, q);
+        std::vector<double> coefficients ((size_t) (order - 1) / 2);
+
+        for (int i = 0; i < (int) coefficients.size(); ++i)
+            coefficients[(size_t) i] = computeCoefficient (i, k, q, order);
+
+        return coefficients;
+    }
+
+    // Kaiser's estimate of the length, rounded up to 4k + 3 taps so the centre tap sits at an
+    // odd index and the outermost taps aren't zero. Only the even taps are returned, 2k + 2 of them
+    std::vector<double> designFirHalfband (double attenuationDb, double transition)
+    {
+        const double transitionWidth = 2.0 * pi * (2.0 * transition);
+        const int estimatedLength = (int) std::ceil ((attenuationDb - 8.0) / (2.285 * transitionWidth)) + 1;
+        const int quarter = std::max (0, (estimatedLength - 3 + 3) / 4);
+        const int numTaps = 4 * quarter + 3;
+        const int centre = (numTaps - 1) / 2;
+        const double beta = 0.1102 * (attenuationDb - 8.7);
+
+        std::vector<double> evenTaps ((size_t) (numTaps + 1) / 2);
+
+        for (int tap = 0; tap < numTaps; tap += 2)
+        {
+            const int offset = tap - centre;
+            const double sinc = std::sin (pi * offset / 2.0) / (pi * offset);
+            const double position = 2.0 * tap / (numTaps - 1) - 1.0;
+            const double window = besselI0 (beta * std::sqrt (1.0 - position * position)) / besselI0 (beta);
+
+            evenTaps[(size_t) tap / 2] = sinc * window;
+        }
+
+        return evenTaps;
+    }
+}
+
+//==============================================================================
+void Oversampler::IirHalfband::design (double attenuationDb, double transition)
+{
+    coefficients = &SharedTables::get (iirHalfbandTable, attenuationDb, transition, designIirHalfband);
+    const int numCoefficients = coefficients->size();
+
+    upState.assign ((size_t) numCoefficients * 2, 0.0);
+    downState.assign ((size_t) numCoefficients * 2, 0.0);
+}
+
+void Oversampler::IirHalfband::reset()
+{
+    std::fill (upState.begin(), upState.end(), 0.0);
+    std::fill (downState.begin(), downState.end(), 0.0);
+    previousOddSample = 0.0;
+}
+
+template <typename SampleType>
+void Oversampler::IirHalfband::upsample (const SampleType* input, SampleType* output, int numSamples)
+{
+    const int numCoefficients = coefficients->size();
+    const double* coefficient = coefficients->data();
+    double* state = upState.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double path0 = input[i];
+        double path1 = input[i];
+
+        // the two paths are independent, so step through them together
+        int c = 0;
+
+        for (; c + 1 < numCoefficients; c += 2)
+        {
+            path0 = processAllpass (coefficient[c], path0, state + c * 2);
+            path1 = processAllpass (coefficient[c + 1], path1, state + c * 2 + 2);
+        }
+
+        if (c < numCoefficients)
+            path0 = processAllpass (coefficient[c], path0, state + c * 2);
+
+        output[i * 2] = (SampleType) path0;
+        output[i * 2 + 1] = (SampleType) path1;
+    }
+}
+
+template <typename SampleType>
+void Oversampler::IirHalfband::downsample (const SampleType* input, SampleType* output, int numSamples)
+{
+    const int numCoefficients = coefficients->size();
+    const double* coefficient = coefficients->data();
+    double* state = downState.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double path0 = input[i * 2];
+        double path1 = previousOddSample;
+        previousOddSample = input[i * 2 + 1];
+
+        int c = 0;
+
+        for (; c + 1 < numCoefficients; c += 2)
+        {
+            path0 = processAllpass (coefficient[c], path0, state + c * 2);
+            path1 = processAllpass (coefficient[c + 1], path1, state + c * 2 + 2);
+        }
+
+        if (c < numCoefficients)
+            path0 = processAllpass (coefficient[c], path0, state + c * 2);
+
+        output[i] = (SampleType) (0.5 * (path0 + path1));
+    }
+}
+
+double Oversampler::IirHalfband::getDelay() const
+{
+    // a first order allpass delays DC by (1 - a) / (1 + a) samples, and in the passband both paths
+    // line up, so path 0 on its own gives the delay of each direction
+    double delay = 0.0;
+
+    for (int c = 0; c < coefficients->size(); c += 2)
+        delay += (1.0 - (*coefficients)[c]) / (1.0 + (*coefficients)[c]);
+
+    return delay * 2.0;
+}
+
+//==============================================================================
+void Oversampler::FirHalfband::design (double attenuationDb, double transition, int maxBlockSize)
+{
+    evenTaps = &SharedTables::get (firHalfbandTable, attenuationDb, transition, designFirHalfband);
+
+    // 4k + 3 taps, 2k + 2 of them even, with the centre one 2k + 1 high rate samples in
+    centreDelay = evenTaps->size() / 2 - 1;
+
+    const size_t numTapsKept = (size_t) evenTaps->size();
+    upHistory.assign (numTapsKept - 1 + (size_t) maxBlockSize, 0.0);
+    downEvenHistory.assign (numTapsKept - 1 + (size_t) maxBlockSize, 0.0);
+    downOddHistory.assign ((size_t) centreDelay + 1 + (size_t) maxBlockSize, 0.0);
+    accumulator.assign ((size_t) maxBlockSize, 0.0);
+}
+
+void Oversampler::FirHalfband::reset()
+{
+    std::fill (upHistory.begin(), upHistory.end(), 0.0);
+    std::fill (downEvenHistory.begin(), downEvenHistory.end(), 0.0);
+    std::fill (downOddHistory.begin(), downOddHistory.end(), 0.0);
+}
+
+template <typename SampleType>
+void Oversampler::FirHalfband::upsample (const SampleType* input, SampleType* output, int numSamples)
+{
+    const int numTaps = evenTaps->size();
+    const int historySize = numTaps - 1;
+    double* x = upHistory.data();
+    double* sum = accumulator.data();
+
+    std::copy (input, input + numSamples, x + historySize);
+    std::fill (sum, sum + numSamples, 0.0);
+
+    // taps on the outside so the inner loop runs across the outputs and vectorises
+    for (int tap = 0; tap < numTaps; ++tap)
+    {
+        const double gain = 2.0 * (*evenTaps)[tap];
+        const double* source = x + historySize - tap;
+
+        for (int i = 0; i < numSamples; ++i)
+            sum[i] += gain * source[i];
+    }
+
+    // the centre tap is 0.5, times the upsampling gain of 2
+    for (int i = 0; i < numSamples; ++i)
+    {
+        output[i * 2] = (SampleType) sum[i];
+        output[i * 2 + 1] = (SampleType) x[historySize + i - centreDelay];
+    }
+
+    std::memmove (x, x + numSamples, (size_t) historySize * sizeof (double));
+}
+
+template <typename SampleType>
+void Oversampler::FirHalfband::downsample (const SampleType* input, SampleType* output, int numSamples)
+{
+    const int numTaps = evenTaps->size();
+    const int evenHistorySize = numTaps - 1;
+    const int oddHistorySize = centreDelay + 1;
+    double* even = downEvenHistory.data();
+    double* odd = downOddHistory.data();
+    double* sum = accumulator.data();
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        even[evenHistorySize + i] = input[i * 2];
+        odd[oddHistorySize + i] = input[i * 2 + 1];
+    }
+
+    // the odd phase only sees the centre tap, centreDelay + 1 samples back
+    for (int i = 0; i < numSamples; ++i)
+        sum[i] = 0.5 * odd[i];
+
+    for (int tap = 0; tap < numTaps; ++tap)
+    {
+        const double gain = (*evenTaps)[tap];
+        const double* source = even + evenHistorySize - tap;
+
+        for (int i = 0; i < numSamples; ++i)
+            sum[i] += gain * source[i];
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+        output[i] = (SampleType) sum[i];
+
+    std::memmove (even, even + numSamples, (size_t) evenHistorySize * sizeof (double));
+    std::memmove (odd, odd + numSamples, (size_t) oddHistorySize * sizeof (double));
+}
+
+double Oversampler::FirHalfband::getDelay() const
+{
+    // (numTaps - 1) / 2 high rate samples each way
+    return 2.0 * centreDelay + 1.0;
+}
+
+//==============================================================================
+void Oversampler::prepare (double sampleRate, int factor, oversamplingFilter filter, int maxBlockSize)
+{
+    mNumStages = factor >= 8 ? 3 : (factor >= 4 ? 2 : (factor >= 2 ? 1 : 0));
+    mFactor = 1 << mNumStages;
+    mFilter = filter;
+
+    mIirStages.clear();
+    mFirStages.clear();
+    mBuffers.clear();
+    mDoubleBuffers.clear();
+
+    const double passbandEdge = std::min (20000.0, 0.45 * sampleRate);
+    double latency = 0.0;
+
+    for (int stage = 0; stage < mNumStages; ++stage)
+    {
+        // each stage only has to keep the audio band clear, so the later ones get away with far
+        // wider transition bands than the first
+        const double stageRate = sampleRate * (double) (2 << stage);
+        const double transition = std::min (0.24, std::max (0.005, 0.25 - passbandEdge / stageRate));
+
+        if (mFilter == firOversampling)
+        {
+            mFirStages.emplace_back();
+            mFirStages.back().design (firAttenuationDb, transition, maxBlockSize << stage);
+            latency += mFirStages.back().getDelay() / (double) (1 << stage);
+        }
+        else
+        {
+            mIirStages.emplace_back();
+            mIirStages.back().design (iirAttenuationDb, transition);
+            latency += mIirStages.back().getDelay() / (double) (1 << stage);
+        }
+
+        mBuffers.emplace_back ((size_t) maxBlockSize << (stage + 1), 0.0f);
+        mDoubleBuffers.emplace_back ((size_t) maxBlockSize << (stage + 1), 0.0);
+    }
+
+    if (mNumStages == 0)
+    {
+        mBuffers.emplace_back ((size_t) maxBlockSize, 0.0f);
+        mDoubleBuffers.emplace_back ((size_t) maxBlockSize, 0.0);
+    }
+
+    const int numPaddingSamples = (int) std::lround ((std::ceil (latency - 1.0e-9) - latency) * mFactor);
+    mPadding.assign ((size_t) numPaddingSamples, 0.0);
+    mPaddingPosition = 0;
+
+    mLatencySamples = (int) std::lround (latency + (double) numPaddingSamples / mFactor);
+}
+
+void Oversampler::reset()
+{
+    for (auto& stage : mIirStages)
+        stage.reset();
+
+    for (auto& stage : mFirStages)
+        stage.reset();
+
+    std::fill (mPadding.begin(), mPadding.end(), 0.0);
+    mPaddingPosition = 0;
+}
+
+void Oversampler::addStateTo (StateHash& hash) const
+{
+    for (const auto& stage : mIirStages)
+    {
+        for (auto* state : { &stage.upState, &stage.downState })
+            for (auto value : *state)
+                hash.add (value);
+
+        hash.add (stage.previousOddSample);
+    }
+
+    // only the start of each history buffer is kept from one block to the next, the rest is
+    // where the next block goes
+    for (const auto& stage : mFirStages)
+    {
+        const int numTaps = stage.evenTaps->size();
+
+        for (int i = 0; i < numTaps - 1; ++i)
+        {
+            hash.add (stage.upHistory[(size_t) i]);
+            hash.add (stage.downEvenHistory[(size_t) i]);
+        }
+
+        for (int i = 0; i <= stage.centreDelay; ++i)
+            hash.add (stage.downOddHistory[(size_t) i]);
+    }
+
+    const int numPaddingSamples = (int) mPadding.size();
+
+    for (int i = 0; i < numPaddingSamples; ++i)
+        hash.add (mPadding[(size_t) ((mPaddingPosition + i) % numPaddingSamples)]);
+}
+
+float* Oversampler::upsample (const float* input, int numSamples)
+{
+    return upsampleBuffers (input, numSamples, mBuffers);
+}
+
+double* Oversampler::upsample (const double* input, int numSamples)
+{
+    return upsampleBuffers (input, numSamples, mDoubleBuffers);
+}
+
+void Oversampler::downsample (float* output, int numSamples)
+{
+    downsampleBuffers (output, numSamples, mBuffers);
+}
+
+void Oversampler::downsample (double* output, int numSamples)
+{
+    downsampleBuffers (output, numSamples, mDoubleBuffers);
+}
+
+template <typename SampleType>
+SampleType* Oversampler::upsampleBuffers (const SampleType* input, int numSamples, std::vector<std::vector<SampleType>>& buffers)
+{
+    if (mNumStages == 0)
+    {
+        std::copy (input, input + numSamples, buffers[0].data());
+        return buffers[0].data();
+    }
+
+    const SampleType* source = input;
+
+    for (int stage = 0; stage < mNumStages; ++stage)
+    {
+        SampleType* destination = buffers[(size_t) stage].data();
+
+        if (mFilter == firOversampling)
+            mFirStages[(size_t) stage].upsample (source, destination, numSamples << stage);
+        else
+            mIirStages[(size_t) stage].upsample (source, destination, numSamples << stage);
+
+        source = destination;
+    }
+
+    return buffers[(size_t) mNumStages - 1].data();
+}
+
+template <typename SampleType>
+void Oversampler::downsampleBuffers (SampleType* output, int numSamples, std::vector<std::vector<SampleType>>& buffers)
+{
+    if (mNumStages == 0)
+    {
+        std::copy (buffers[0].data(), buffers[0].data() + numSamples, output);
+        return;
+    }
+
+    SampleType* top = buffers[(size_t) mNumStages - 1].data();
+    const int numTopSamples = numSamples * mFactor;
+    const int numPaddingSamples = (int) mPadding.size();
+
+    if (numPaddingSamples > 0)
+    {
+        for (int i = 0; i < numTopSamples; ++i)
+        {
+            const double delayed = mPadding[(size_t) mPaddingPosition];
+            mPadding[(size_t) mPaddingPosition] = top[i];
+            top[i] = (SampleType) delayed;
+
+            if (++mPaddingPosition == numPaddingSamples)
+                mPaddingPosition = 0;
+        }
+    }
+
+    for (int stage = mNumStages - 1; stage >= 0; --stage)
+    {
+        const SampleType* source = buffers[(size_t) stage].data();
+        SampleType* destination = stage > 0 ? buffers[(size_t) stage - 1].data() : output;
+
+        if (mFilter == firOversampling)
+            mFirStages[(size_t) stage].downsample (source, destination, numSamples << stage);
+        else
+            mIirStages[(size_t) stage].downsample (source, destination, numSamples << stage);
+    }
+}
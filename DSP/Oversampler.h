@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    Oversampler.h
+    2x/4x/8x up/down sampling built from cascaded halfband stages, used to run
+    the drive + clip of the distortion stage at a higher rate so its harmonics
+    don't fold back into the audio band.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SharedTables.h"
+#include "StateHash.h"
+
+#include <vector>
+
+// figures are the stopband attenuation of every halfband stage, with the passband up to 20kHz
+// (or 0.45 x the sample rate, whichever is lower)
+enum oversamplingFilter
+{
+    iirOversampling = 1,    // polyphase allpass IIR, 90dB, a few samples of latency but not linear phase
+    firOversampling         // Kaiser windowed linear-phase FIR, 120dB, tens of samples of latency
+};
+
+//==============================================================================
+/**
+    One instance handles one channel. The filters are designed in prepare(), so
+    changing the factor or filter type means calling prepare() again. The coefficients come
+    from SharedTables, so every channel of every instance running at the same rate reads the
+    same copy and only the filter state is per channel.
+*/
+class Oversampler
+{
+public:
+    static constexpr int maxFactor = 8;
+
+    Oversampler() = default;
+
+    // allocates everything. factor is 1, 2, 4 or 8, other values are rounded down to one of those
+    void prepare (double sampleRate, int factor, oversamplingFilter filter, int maxBlockSize);
+    void reset();
+
+    int getFactor() const                   { return mFactor; }
+    oversamplingFilter getFilter() const    { return mFilter; }
+
+    // the delay of upsample() + downsample() in samples at the base rate. The IIR filters' delay
+    // is measured at DC, and a few samples are added at the top rate so it comes out a whole number
+    int getLatencySamples() const           { return mLatencySamples; }
+
+    // upsamples numSamples (no more than maxBlockSize) into an internal buffer of numSamples * factor
+    // samples and returns it. It can be processed in place before calling downsample()
+    float* upsample (const float* input, int numSamples);
+    double* upsample (const double* input, int numSamples);
+
+    // filters the buffer returned by upsample() back down into numSamples of output. Use the same
+    // precision as the upsample() before it. The filter state is kept in double either way, so the
+    // two precisions can take turns from one block to the next
+    void downsample (float* output, int numSamples);
+    void downsample (double* output, int numSamples);
+
+    // the filter histories, for StateHash comparisons
+    void addStateTo (StateHash& hash) const;
+
+private:
+    // one 2x step of the polyphase IIR. Even coefficients make up the allpass chain of path 0,
+    // odd ones path 1, which runs one high rate sample later
+    struct IirHalfband
+    {
+        const SharedTable* coefficients = nullptr;
+        std::vector<double> upState, downState;     // (previous input, previous output) per section
+        double previousOddSample = 0.0;
+
+        void design (double attenuationDb, double transition);
+        void reset();
+
+        template <typename SampleType>
+        void upsample (const SampleType* input, SampleType* output, int numSamples);
+
+        template <typename SampleType>
+        void downsample (const SampleType* input, SampleType* output, int numSamples);
+
+        // up + down delay at DC, in samples at the lower of the two rates
+        double getDelay() const;
+    };
+
+    // one 2x step of the FIR. Halfband taps are zero at every other position apart from the centre
+    // one (0.5), so only the even taps are kept and the odd phase is a plain delay
+    struct FirHalfband
+    {
+        const SharedTable* evenTaps = nullptr;
+        int centreDelay = 0;                        // the odd phase delay, in low rate samples
+
+        std::vector<double> upHistory, downEvenHistory, downOddHistory;
+        std::vector<double> accumulator;
+
+        void design (double attenuationDb, double transition, int maxBlockSize);
+        void reset();
+
+        template <typename SampleType>
+        void upsample (const SampleType* input, SampleType* output, int numSamples);
+
+        template <typename SampleType>
+        void downsample (const SampleType* input, SampleType* output, int numSamples);
+
+        double getDelay() const;
+    };
+
+    int mFactor = 1;
+    int mNumStages = 0;
+    oversamplingFilter mFilter = iirOversampling;
+    int mLatencySamples = 0;
+
+    std::vector<IirHalfband> mIirStages;
+    std::vector<FirHalfband> mFirStages;
+
+    // mBuffers[i] holds the signal at 2^(i + 1) times the base rate, one set for each precision
+    std::vector<std::vector<float>> mBuffers;
+    std::vector<std::vector<double>> mDoubleBuffers;
+
+    // whole-sample padding at the top rate that rounds the latency up to whole base rate samples
+    std::vector<double> mPadding;
+    int mPaddingPosition = 0;
+
+    template <typename SampleType>
+    SampleType* upsampleBuffers (const SampleType* input, int numSamples, std::vector<std::vector<SampleType>>& buffers);
+
+    template <typename SampleType>
+    void downsampleBuffers (SampleType* output, int numSamples, std::vector<std::vector<SampleType>>& buffers);
+};
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    ParameterRamp.h
+    Linear parameter ramp that is written out a block at a time, so the kernels
+    read a buffer of per-sample values instead of stepping a smoother per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+
+//==============================================================================
+/**
+    Every value is computed from the start of the ramp (start + step * k) rather than by
+    repeated addition, so the values don't depend on how the ramp is split into blocks
+    and the fill loop has no carried dependency for the compiler to trip over.
+*/
+class ParameterRamp
+{
+public:
+    ParameterRamp() = default;
+
+    void reset (double sampleRate, double rampLengthInSeconds)
+    {
+        mRampLength = (int) std::floor (rampLengthInSeconds * sampleRate);
+        setCurrentAndTargetValue (mTarget);
+    }
+
+    void setCurrentAndTargetValue (double newValue)
+    {
+        mStart = mTarget = newValue;
+        mStep = 0.0;
+        mPosition = 0;
+        mSamplesRemaining = 0;
+    }
+
+    // starts a new ramp from wherever the current one has got to
+    void setTargetValue (double newValue)
+    {
+        if (newValue == mTarget)
+            return;
+
+        if (mRampLength <= 0)
+        {
+            setCurrentAndTargetValue (newValue);
+            return;
+        }
+
+        mStart = getCurrentValue();
+        mTarget = newValue;
+        mStep = (mTarget - mStart) / (double) mRampLength;
+        mPosition = 0;
+        mSamplesRemaining = mRampLength;
+    }
+
+    // writes the next numSamples values and moves the ramp on. Past the end of the ramp the
+    // target is written, and the last sample of the ramp always lands exactly on the target
+    void fill (double* dest, int numSamples)
+    {
+        const int numRampSamples = numSamples < mSamplesRemaining ? numSamples : mSamplesRemaining;
+        const double start = mStart;
+        const double step = mStep;
+        const double firstStep = (double) (mPosition + 1);
+
+        int sample = 0;
+
+        for (; sample < numRampSamples; ++sample)
+            dest[sample] = start + step * (firstStep + (double) sample);
+
+        mPosition += numRampSamples;
+        mSamplesRemaining -= numRampSamples;
+
+        if (numRampSamples > 0 && mSamplesRemaining == 0)
+            dest[numRampSamples - 1] = mTarget;
+
+        for (; sample < numSamples; ++sample)
+            dest[sample] = mTarget;
+    }
+
+    bool isRamping() const                  { return mSamplesRemaining > 0; }
+    int getNumRemainingSamples() const      { return mSamplesRemaining; }
+    double getTargetValue() const           { return mTarget; }
+
+    // how much the value changes per sample while ramping
+    double getStep() const                  { return mStep; }
+
+    double getCurrentValue() const
+    {
+        return isRamping() ? mStart + mStep * (double) mPosition : mTarget;
+    }
+
+private:
+    double mStart = 0.0;
+    double mTarget = 0.0;
+    double mStep = 0.0;
+    int mPosition = 0;
+    int mSamplesRemaining = 0;
+    int mRampLength = 0;
+};
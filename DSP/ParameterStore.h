@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    ParameterStore.h
+    Wait-free hand-over of parameter values from the editor/host threads to the
+    audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "TripleBuffer.h"
+
+#include <atomic>
+#include <cstdint>
+
+enum parameterId
+{
+    modFreqParam = 0,
+    overdriveParam,
+    pulserFreqParam,
+    modTypeParam,
+    distTypeParam,
+    distMixParam,
+    levelAttackParam,
+    levelReleaseParam,
+    levelDetectorParam,
+    levelLinkParam,
+    bypassParam,
+    modEnabledParam,
+    distEnabledParam,
+    pulserEnabledParam,
+    numParameters
+};
+
+// a whole set of parameter values handed over in one go, mask has a bit for each one it sets
+struct ParameterSnapshot
+{
+    double values[numParameters];
+    uint32_t mask;
+};
+
+//==============================================================================
+/**
+    Each parameter is a lock-free atomic plus one bit in a shared "changed" mask.
+    Any thread may call set(). The audio thread calls takeChanges() once per block
+    and only re-reads the parameters whose bits are set, so a burst of slider moves
+    between two blocks collapses into a single update of the latest value.
+
+    A snapshot (a program change, or a session being loaded) goes through a triple
+    buffer instead, so the audio thread picks up all of its values together or none of
+    them, never half of one snapshot and half of the next.
+*/
+class ParameterStore
+{
+public:
+    ParameterStore()
+    {
+        for (auto& value : mValues)
+            value.store (0.0, std::memory_order_relaxed);
+    }
+
+    void set (parameterId id, double value)
+    {
+        mValues[id].store (value, std::memory_order_relaxed);
+        mChanged.fetch_or (1u << id, std::memory_order_release);
+    }
+
+    double get (parameterId id) const
+    {
+        return mValues[id].load (std::memory_order_relaxed);
+    }
+
+    // returns a bit mask of the parameters set since the previous call
+    uint32_t takeChanges()
+    {
+        return mChanged.exchange (0, std::memory_order_acquire);
+    }
+
+    // only one thread at a time may set snapshots. The values are stored as well, so the getters
+    // return them straight away
+    void setSnapshot (const ParameterSnapshot& snapshot)
+    {
+        for (int id = 0; id < numParameters; ++id)
+            if (hasChanged (snapshot.mask, (parameterId) id))
+                mValues[id].store (snapshot.values[id], std::memory_order_relaxed);
+
+        mSnapshots.getWriteSlot() = snapshot;
+        mSnapshots.publish();
+    }
+
+    // audio thread: returns true and the latest snapshot if one was set since the previous call
+    bool takeSnapshot (ParameterSnapshot& snapshot)
+    {
+        if (! mSnapshots.takeLatest())
+            return false;
+
+        snapshot = mSnapshots.getReadSlot();
+        return true;
+    }
+
+    static bool hasChanged (uint32_t changes, parameterId id)     { return (changes & (1u << id)) != 0; }
+    static constexpr uint32_t allParameters = (1u << numParameters) - 1;
+
+private:
+    std::atomic<double> mValues[numParameters];
+    std::atomic<uint32_t> mChanged { 0 };
+
+    TripleBuffer<ParameterSnapshot> mSnapshots;
+
+    static_assert (std::atomic<double>::is_always_lock_free, "parameter values must be lock-free");
+};
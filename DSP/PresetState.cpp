@@ -0,0 +1,353 @@
+/*
+  ==============================================================================
+
+    PresetState.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetState.h"
+#include "MultiEffectCore.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+static_assert ((int) levelLinkField == (int) levelLinkParam, "the parameter fields must line up with parameterId");
+
+namespace
+{
+    const char* const fieldNames[numPresetFields] =
+    {
+        "modFreq", "overdrive", "pulserFreq", "modType", "distType", "distMix",
+        "levelAttack", "levelRelease", "levelDetector", "levelLink",
+        "osRealtime", "osOffline", "program",
+        "modOn", "distOn", "pulserOn", "stageOrder"
+    };
+
+    // the field each core parameter is kept in, numPresetFields for the bypass
+    const presetField parameterFields[numParameters] =
+    {
+        modFreqField, overdriveField, pulserFreqField, modTypeField, distTypeField, distMixField,
+        levelAttackField, levelReleaseField, levelDetectorField, levelLinkField,
+        numPresetFields, modEnabledField, distEnabledField, pulserEnabledField
+    };
+
+    const char magic[4] = { 'M', 'F', 'X', 'S' };
+    const char* const xmlTag = "MultiEffectState";
+
+    struct BuiltInProgram
+    {
+        const char* name;
+        double modFreq;
+        double overdrive;
+        double pulserFreq;
+        modType mod;
+        distType dist;
+        double distMix;
+        double levelAttack;
+        double levelRelease;
+        levelDetector detector;
+        bool levelLinked;
+    };
+
+    // the first one is the defaults
+    const BuiltInProgram programs[] =
+    {
+        { "Init",           MOD_FREQ_INIT, OVERDRIVE_INIT, PULSER_FREQ_INIT, rm, hard, DIST_MIX_INIT, LEVEL_ATTACK_INIT, LEVEL_RELEASE_INIT, peakLevel, false },
+        { "Ring Bell",      440.0,  1.0,  0.0, rm, hard, 1.0,  10.0, 100.0, peakLevel, false },
+        { "Slow Tremolo",   0.0,    1.0,  4.0, rm, hard, 1.0,  10.0, 100.0, peakLevel, false },
+        { "Warm Drive",     0.0,    6.0,  0.0, rm, soft, 0.75, 20.0, 250.0, rmsLevel,  true },
+        { "Fuzz Wall",      0.0,   40.0,  0.0, rm, hard, 1.0,   5.0, 100.0, peakLevel, true },
+        { "Broken Radio",   1250.0, 12.0, 0.0, am, hard, 0.75, 10.0, 100.0, peakLevel, false },
+        { "Helicopter",     30.0,   8.0,  8.0, am, soft, 1.0,  10.0, 100.0, peakLevel, true },
+        { "Shimmer Pulse",  2500.0, 2.0,  3.0, am, soft, 0.5,  20.0, 500.0, rmsLevel,  false }
+    };
+
+    constexpr int numPrograms = (int) (sizeof (programs) / sizeof (programs[0]));
+
+    void writeFloat (uint8_t* dest, float value)
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+
+        for (int byte = 0; byte < 4; ++byte)
+            dest[byte] = (uint8_t) (bits >> (8 * byte));
+    }
+
+    uint32_t readUint32 (const uint8_t* source)
+    {
+        return (uint32_t) source[0] | ((uint32_t) source[1] << 8) | ((uint32_t) source[2] << 16) | ((uint32_t) source[3] << 24);
+    }
+
+    float readFloat (const uint8_t* source)
+    {
+        const uint32_t bits = readUint32 (source);
+        float value;
+        std::memcpy (&value, &bits, sizeof (value));
+        return value;
+    }
+}
+
+//==============================================================================
+PresetState::PresetState()
+{
+    for (int field = 0; field < numPresetFields; ++field)
+        mValues[field] = getDefault ((presetField) field);
+
+    mFields = allFields;
+}
+
+double PresetState::getDefault (presetField field)
+{
+    switch (field)
+    {
+        case modFreqField:                  return MOD_FREQ_INIT;
+        case overdriveField:                return OVERDRIVE_INIT;
+        case pulserFreqField:               return PULSER_FREQ_INIT;
+        case modTypeField:                  return rm;
+        case distTypeField:                 return hard;
+        case distMixField:                  return DIST_MIX_INIT;
+        case levelAttackField:              return LEVEL_ATTACK_INIT;
+        case levelReleaseField:             return LEVEL_RELEASE_INIT;
+        case levelDetectorField:            return peakLevel;
+        case levelLinkField:                return 0.0;
+
+        // the plugin's defaults: none while playing live, 4x for offline bounces
+        case realtimeOversamplingField:     return 1.0;
+        case offlineOversamplingField:      return 4.0;
+
+        case programField:                  return -1.0;
+
+        case modEnabledField:
+        case distEnabledField:
+        case pulserEnabledField:            return 1.0;
+
+        case stageOrderField:               return StageOrder().getCode();
+
+        case numPresetFields:
+        default:                            return 0.0;
+    }
+}
+
+void PresetState::set (presetField field, double value)
+{
+    if (field < 0 || field >= numPresetFields || ! std::isfinite (value))
+        return;
+
+    if (field == realtimeOversamplingField || field == offlineOversamplingField)
+        value = value >= Oversampler::maxFactor ? Oversampler::maxFactor : (value >= 4.0 ? 4.0 : (value >= 2.0 ? 2.0 : 1.0));
+    else if (field == programField)
+        value = (value >= 0.0 && value < numPrograms) ? std::floor (value) : -1.0;
+    else if (field == modEnabledField || field == distEnabledField || field == pulserEnabledField)
+        value = value != 0.0 ? 1.0 : 0.0;
+    else if (field == stageOrderField)
+        value = StageOrder::fromCode ((int) value).getCode();
+
+    mValues[field] = value;
+    mFields |= 1u << field;
+}
+
+ParameterSnapshot PresetState::getParameters() const
+{
+    ParameterSnapshot snapshot {};
+
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+    {
+        const auto field = parameterFields[parameter];
+
+        if (field != numPresetFields && contains (field))
+        {
+            snapshot.values[parameter] = mValues[field];
+            snapshot.mask |= 1u << parameter;
+        }
+    }
+
+    return snapshot;
+}
+
+void PresetState::setParameters (const ParameterSnapshot& snapshot)
+{
+    for (int parameter = 0; parameter < numParameters; ++parameter)
+        if (parameterFields[parameter] != numPresetFields && ParameterStore::hasChanged (snapshot.mask, (parameterId) parameter))
+            set (parameterFields[parameter], snapshot.values[parameter]);
+}
+
+//==============================================================================
+uint32_t PresetState::getChecksum (const uint8_t* data, size_t numBytes)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t byte = 0; byte < numBytes; ++byte)
+        hash = (hash ^ data[byte]) * 16777619u;
+
+    return hash;
+}
+
+int PresetState::writeBinary (uint8_t* dest) const
+{
+    std::memcpy (dest, magic, sizeof (magic));
+    dest[4] = (uint8_t) formatVersion;
+
+    int size = 6;
+    int numFields = 0;
+
+    for (int field = 0; field < numPresetFields; ++field)
+    {
+        if (contains ((presetField) field))
+        {
+            dest[size] = (uint8_t) field;
+            writeFloat (dest + size + 1, (float) mValues[field]);
+            size += 5;
+            ++numFields;
+        }
+    }
+
+    dest[5] = (uint8_t) numFields;
+
+    const uint32_t checksum = getChecksum (dest, (size_t) size);
+
+    for (int byte = 0; byte < 4; ++byte)
+        dest[size + byte] = (uint8_t) (checksum >> (8 * byte));
+
+    return size + 4;
+}
+
+bool PresetState::readBinary (const void* data, size_t numBytes)
+{
+    const auto* bytes = static_cast<const uint8_t*> (data);
+
+    if (bytes == nullptr || numBytes < 10 || std::memcmp (bytes, magic, sizeof (magic)) != 0
+         || bytes[4] < 1 || bytes[4] > formatVersion)
+        return false;
+
+    const size_t size = 6 + (size_t) bytes[5] * 5;
+
+    if (numBytes < size + 4 || readUint32 (bytes + size) != getChecksum (bytes, size))
+        return false;
+
+    PresetState state;
+
+    for (size_t entry = 6; entry < size; entry += 5)
+        if (bytes[entry] < numPresetFields)
+            state.set ((presetField) bytes[entry], readFloat (bytes + entry + 1));
+
+    *this = state;
+    return true;
+}
+
+//==============================================================================
+std::string PresetState::toXml() const
+{
+    // kept to float precision like the binary, and always with a '.' whatever the locale
+    std::ostringstream stream;
+    stream.imbue (std::locale::classic());
+    stream.precision (9);
+
+    stream << '<' << xmlTag << " version=\"" << formatVersion << '"';
+
+    for (int field = 0; field < numPresetFields; ++field)
+        if (contains ((presetField) field))
+            stream << ' ' << fieldNames[field] << "=\"" << (float) mValues[field] << '"';
+
+    stream << "/>";
+    return stream.str();
+}
+
+bool PresetState::readXml (const std::string& text)
+{
+    const std::string openTag = std::string ("<") + xmlTag;
+    size_t position = text.find (openTag);
+
+    // the tag has to end there, not carry on into a longer name
+    while (position != std::string::npos && position + openTag.size() < text.size()
+            && std::isalnum ((unsigned char) text[position + openTag.size()]))
+        position = text.find (openTag, position + 1);
+
+    if (position == std::string::npos)
+        return false;
+
+    PresetState state;
+    position += openTag.size();
+
+    // name="value" pairs up to the end of the tag
+    for (;;)
+    {
+        while (position < text.size() && std::isspace ((unsigned char) text[position]))
+            ++position;
+
+        if (position >= text.size() || text[position] == '/' || text[position] == '>')
+            break;
+
+        const size_t equals = text.find ('=', position);
+
+        if (equals == std::string::npos || equals + 1 >= text.size() || (text[equals + 1] != '"' && text[equals + 1] != '\''))
+            return false;
+
+        const size_t closingQuote = text.find (text[equals + 1], equals + 2);
+
+        if (closingQuote == std::string::npos)
+            return false;
+
+        const std::string name = text.substr (position, equals - position);
+
+        std::istringstream valueStream (text.substr (equals + 2, closingQuote - equals - 2));
+        valueStream.imbue (std::locale::classic());
+        double value = 0.0;
+
+        if (valueStream >> value)
+        {
+            if (name == "version" && value > formatVersion)
+                return false;
+
+            for (int field = 0; field < numPresetFields; ++field)
+                if (name == fieldNames[field])
+                    state.set ((presetField) field, value);
+        }
+
+        position = closingQuote + 1;
+    }
+
+    *this = state;
+    return true;
+}
+
+const char* PresetState::getFieldName (presetField field)
+{
+    return (field >= 0 && field < numPresetFields) ? fieldNames[field] : "";
+}
+
+//==============================================================================
+int PresetState::getNumPrograms()
+{
+    return numPrograms;
+}
+
+const char* PresetState::getProgramName (int index)
+{
+    return (index >= 0 && index < numPrograms) ? programs[index].name : "";
+}
+
+PresetState PresetState::getProgram (int index)
+{
+    const auto& program = programs[(index >= 0 && index < numPrograms) ? index : 0];
+    PresetState state;
+
+    state.set (modFreqField, program.modFreq);
+    state.set (overdriveField, program.overdrive);
+    state.set (pulserFreqField, program.pulserFreq);
+    state.set (modTypeField, program.mod);
+    state.set (distTypeField, program.dist);
+    state.set (distMixField, program.distMix);
+    state.set (levelAttackField, program.levelAttack);
+    state.set (levelReleaseField, program.levelRelease);
+    state.set (levelDetectorField, program.detector);
+    state.set (levelLinkField, program.levelLinked ? 1.0 : 0.0);
+    state.set (programField, (index >= 0 && index < numPrograms) ? index : 0);
+
+    state.remove (realtimeOversamplingField);
+    state.remove (offlineOversamplingField);
+    return state;
+}
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    PresetState.h
+    The plugin's settings, written to and read back from a compact versioned
+    binary format (or XML), and the built-in programs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ParameterStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// what a state holds. Everything up to levelLinkField is the core parameter with the same number
+// in parameterId, the enabled fields are the core's enabled parameters and the stage order is a
+// StageOrder code (the bypass belongs to the host and isn't saved). The numbers are written to
+// the binary format, so they mustn't change, and new fields go on the end
+enum presetField
+{
+    modFreqField = 0,
+    overdriveField,
+    pulserFreqField,
+    modTypeField,
+    distTypeField,
+    distMixField,
+    levelAttackField,
+    levelReleaseField,
+    levelDetectorField,
+    levelLinkField,
+    realtimeOversamplingField,
+    offlineOversamplingField,
+    programField,
+    modEnabledField,
+    distEnabledField,
+    pulserEnabledField,
+    stageOrderField,
+    numPresetFields
+};
+
+//==============================================================================
+/**
+    One value per field, in the units the core uses: the types are their enum values, the
+    level link and the enabled fields are 0 or 1, the oversampling settings are factors (1, 2,
+    4 or 8), the program is an index into the built-in bank (-1 when none was loaded) and the
+    stage order is StageOrder::getCode().
+
+    The binary format is "MFXS", a version byte and a field count byte, then for each field
+    its number as a byte and its value as a little-endian 32-bit float, and a 32-bit FNV-1a
+    checksum of everything before it: 95 bytes with every field in. A reader skips fields
+    it doesn't know and keeps the defaults for those that are missing, so fields can be
+    added without changing the version; it only goes up when the layout changes, and a
+    reader refuses anything newer than it knows.
+*/
+class PresetState
+{
+public:
+    static constexpr int formatVersion = 1;
+    static constexpr int maxBinarySize = 6 + numPresetFields * 5 + 4;
+
+    // every field at its default, no program
+    PresetState();
+
+    double get (presetField field) const         { return mValues[field]; }
+    bool contains (presetField field) const     { return (mFields & (1u << field)) != 0; }
+
+    // non-finite values are ignored, the oversampling is rounded to a factor the core has and a
+    // program out of range is none. The parameters are limited when they're set on the core
+    void set (presetField field, double value);
+    void remove (presetField field)             { mFields &= ~(1u << field); }
+
+    // the core parameters this state contains, and setting them from the core's. The stage order
+    // isn't a parameter, it's set on the core on its own
+    ParameterSnapshot getParameters() const;
+    void setParameters (const ParameterSnapshot& snapshot);
+
+    // dest needs room for maxBinarySize bytes, returns how many were written. Doesn't allocate
+    int writeBinary (uint8_t* dest) const;
+
+    // returns false, and leaves the state as it was, if the data isn't this format, is damaged or is
+    // from a newer version. Otherwise every field not in the data is back to its default
+    bool readBinary (const void* data, size_t numBytes);
+
+    // the fallback: one element with an attribute per field, e.g.
+    // <MultiEffectState version="1" modFreq="100" ... />. Reading takes the attributes of the first
+    // MultiEffectState element and ignores anything else
+    std::string toXml() const;
+    bool readXml (const std::string& text);
+
+    // the attribute names, which are also the plugin's parameter IDs
+    static const char* getFieldName (presetField field);
+
+    // the built-in programs set the core parameters, the stage order and the program, and leave the
+    // oversampling alone
+    static int getNumPrograms();
+    static const char* getProgramName (int index);
+    static PresetState getProgram (int index);
+
+private:
+    double mValues[numPresetFields];
+    uint32_t mFields;
+
+    static constexpr uint32_t allFields = (1u << numPresetFields) - 1;
+
+    static double getDefault (presetField field);
+    static uint32_t getChecksum (const uint8_t* data, size_t numBytes);
+};
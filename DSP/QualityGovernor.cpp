@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.cpp
+
+  ==============================================================================
+*/
+
+#include "QualityGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+QualityGovernor::QualityGovernor()
+{
+    mSampleRate = 44100.0;
+    mLowestTier = minimumQuality;
+    reset();
+}
+
+void QualityGovernor::prepare (double sampleRate)
+{
+    mSampleRate = sampleRate;
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    mTier = fullQuality;
+    mAverageLoad = 0.0;
+    mSinceChange = 0.0;
+    mUnderStepUp = 0.0;
+    mLastStepWasUp = false;
+
+    for (auto& hold : mHoldUp)
+        hold = holdUpSeconds;
+
+    mNumStepsDown.store (0, std::memory_order_relaxed);
+    mNumStepsUp.store (0, std::memory_order_relaxed);
+}
+
+double QualityGovernor::getShare() const
+{
+    return mShare.load (std::memory_order_relaxed);
+}
+
+void QualityGovernor::setShare (double share)
+{
+    mShare.store (std::min (std::max (share, 1.0e-6), 1.0), std::memory_order_relaxed);
+}
+
+const char* QualityGovernor::getTierName (qualityTier tier)
+{
+    switch (tier)
+    {
+        case fullQuality:       return "full";
+        case reducedQuality:    return "reduced";
+        case lowQuality:        return "low";
+        case minimumQuality:    return "minimum";
+        default:                return "";
+    }
+}
+
+void QualityGovernor::setLowestTier (qualityTier tier)
+{
+    mLowestTier = std::min (std::max (tier, fullQuality), minimumQuality);
+}
+
+qualityTier QualityGovernor::update (double seconds, int numSamples)
+{
+    if (numSamples <= 0)
+        return mTier;
+
+    const double blockSeconds = numSamples / mSampleRate;
+    const double load = seconds / blockSeconds / getShare();
+
+    // averaged over audio time rather than blocks, so it reacts the same at any block size
+    mAverageLoad += (load - mAverageLoad) * (1.0 - std::exp (-blockSeconds / averageSeconds));
+    mSinceChange += blockSeconds;
+    mUnderStepUp = mAverageLoad < stepUpLoad ? mUnderStepUp + blockSeconds : 0.0;
+
+    if (mSinceChange < holdDownSeconds)
+        return mTier;
+
+    if (mTier < mLowestTier && (mAverageLoad > stepDownLoad || (load > overrunLoad && mAverageLoad > stepUpLoad)))
+    {
+        // the tier it stepped up to didn't fit after all, so it waits longer before the next try
+        if (mLastStepWasUp)
+            mHoldUp[mTier] = mSinceChange < mHoldUp[mTier] ? std::min (mHoldUp[mTier] * 2.0, maxHoldUpSeconds) : holdUpSeconds;
+
+        mTier = (qualityTier) (mTier + 1);
+        mLastStepWasUp = false;
+        mSinceChange = 0.0;
+        mUnderStepUp = 0.0;
+        mNumStepsDown.fetch_add (1, std::memory_order_relaxed);
+    }
+    else if (mTier > fullQuality && mUnderStepUp >= mHoldUp[mTier - 1])
+    {
+        mTier = (qualityTier) (mTier - 1);
+        mLastStepWasUp = true;
+        mSinceChange = 0.0;
+        mUnderStepUp = 0.0;
+        mNumStepsUp.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    return mTier;
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+    Picks how much of the DSP quality to give up from how long each block
+    takes against the time it lasts.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+// each one cheaper than the one before, and keeps what the ones before it gave up
+enum qualityTier
+{
+    fullQuality = 0,    // the settings as they are
+    reducedQuality,     // the rotator LFOs, and the pulser at PULSER_CONTROL_INTERVAL
+    lowQuality,         // the polynomial tanh in the soft clip
+    minimumQuality,     // half the oversampling factor
+    numQualityTiers
+};
+
+//==============================================================================
+/**
+    The load of a block is the time process() took over the time the block lasts, divided
+    by this instance's share of the callback. With the share at 1 / the number of instances
+    that's about how much of the deadline all of them together are taking.
+
+    The load is averaged over averageSeconds of audio. The tier steps down once the average
+    goes over stepDownLoad, or as soon as a single block goes over overrunLoad while the
+    average is above stepUpLoad, so a lone spike with plenty of headroom doesn't count. It
+    steps back up once the average has stayed under stepUpLoad for holdUpSeconds. Every
+    change is held for at least holdDownSeconds. A step up that's followed by a step down
+    within its hold time doubles the hold before the next try at that tier (up to
+    maxHoldUpSeconds), so a tier that doesn't fit isn't tried over and over.
+*/
+class QualityGovernor
+{
+public:
+    static constexpr double stepDownLoad = 0.7;
+    static constexpr double overrunLoad = 0.9;
+    static constexpr double stepUpLoad = 0.35;
+
+    static constexpr double averageSeconds = 0.1;
+    static constexpr double holdDownSeconds = 0.1;
+    static constexpr double holdUpSeconds = 2.0;
+    static constexpr double maxHoldUpSeconds = 30.0;
+
+    QualityGovernor();
+
+    // back to full quality, with the average and the holds forgotten
+    void prepare (double sampleRate);
+    void reset();
+
+    // this instance's share of the callback, 0 to 1. Any thread
+    double getShare() const;
+    void setShare (double share);
+
+    // the cheapest tier it will go to, for when the ones past it wouldn't save anything
+    qualityTier getLowestTier() const       { return mLowestTier; }
+    void setLowestTier (qualityTier tier);
+
+    // audio thread: how long the block of numSamples took. Returns the tier for the next one
+    qualityTier update (double seconds, int numSamples);
+
+    qualityTier getTier() const             { return mTier; }
+    double getAverageLoad() const           { return mAverageLoad; }
+
+    // "full", "reduced", "low" or "minimum"
+    static const char* getTierName (qualityTier tier);
+
+    // how often it has stepped each way since prepare(). Any thread
+    long long getNumStepsDown() const       { return mNumStepsDown.load (std::memory_order_relaxed); }
+    long long getNumStepsUp() const         { return mNumStepsUp.load (std::memory_order_relaxed); }
+
+private:
+    double mSampleRate;
+    std::atomic<double> mShare { 1.0 };
+
+    qualityTier mTier;
+    qualityTier mLowestTier;
+    double mAverageLoad;
+
+    // in seconds of audio
+    double mSinceChange;
+    double mUnderStepUp;
+    double mHoldUp[numQualityTiers];
+    bool mLastStepWasUp;
+
+    std::atomic<long long> mNumStepsDown { 0 };
+    std::atomic<long long> mNumStepsUp { 0 };
+};
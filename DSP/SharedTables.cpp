@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    SharedTables.cpp
+
+  ==============================================================================
+*/
+
+#include "SharedTables.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+
+namespace
+{
+    struct AlignedDelete
+    {
+        void operator() (double* data) const
+        {
+            ::operator delete (data, std::align_val_t (SharedTables::cacheLineSize));
+        }
+    };
+
+    struct Store
+    {
+        std::mutex lock;
+
+        // never shrinks, and the tables don't move when it grows, so references to them stay valid
+        std::vector<std::unique_ptr<SharedTable>> tables;
+        std::vector<std::unique_ptr<double[], AlignedDelete>> storage;
+        size_t numBytes = 0;
+    };
+
+    Store& getStore()
+    {
+        static Store store;
+        return store;
+    }
+}
+
+//==============================================================================
+const SharedTable& SharedTables::get (sharedTableType type, double parameter1, double parameter2, Designer design)
+{
+    auto& store = getStore();
+    const std::lock_guard<std::mutex> guard (store.lock);
+
+    for (const auto& table : store.tables)
+        if (table->mType == type && table->mParameter1 == parameter1 && table->mParameter2 == parameter2)
+            return *table;
+
+    const auto values = design (parameter1, parameter2);
+
+    // whole cache lines, the padding zeroed
+    const size_t numBytes = (values.size() * sizeof (double) + cacheLineSize - 1) / cacheLineSize * cacheLineSize;
+    auto* data = static_cast<double*> (::operator new (std::max (numBytes, cacheLineSize), std::align_val_t (cacheLineSize)));
+    std::memset (data, 0, std::max (numBytes, cacheLineSize));
+    std::copy (values.begin(), values.end(), data);
+
+    store.storage.emplace_back (data);
+    store.numBytes += std::max (numBytes, cacheLineSize);
+
+    auto table = std::make_unique<SharedTable>();
+    table->mType = type;
+    table->mParameter1 = parameter1;
+    table->mParameter2 = parameter2;
+    table->mData = data;
+    table->mSize = (int) values.size();
+
+    store.tables.push_back (std::move (table));
+    return *store.tables.back();
+}
+
+int SharedTables::getNumTables()
+{
+    auto& store = getStore();
+    const std::lock_guard<std::mutex> guard (store.lock);
+    return (int) store.tables.size();
+}
+
+size_t SharedTables::getNumBytes()
+{
+    auto& store = getStore();
+    const std::lock_guard<std::mutex> guard (store.lock);
+    return store.numBytes;
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    SharedTables.h
+    Read-only tables built once per process and shared by every instance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// the kinds of table, each one designed from two numbers
+enum sharedTableType
+{
+    sineTable = 1,      // one cycle plus guard points, for the wavetable LFO (size, unused)
+    iirHalfbandTable,   // allpass coefficients of a halfband stage (attenuation dB, transition)
+    firHalfbandTable    // even taps of a halfband stage (attenuation dB, transition)
+};
+
+//==============================================================================
+/**
+    A table is designed by the first caller to ask for it and stays as it is until the process
+    ends, so every instance, and every channel of every instance, reads the same copy, which
+    also stays in cache between them. Nothing is ever written to one once it's been handed out,
+    so the audio thread reads it without any synchronisation. Each one starts on a cache line of
+    its own and is padded out to the end of its last one, so no instance's state shares a line
+    with it.
+
+    Getting a table takes a lock (and designs it the first time), so it belongs in prepare(),
+    never on the audio thread.
+*/
+class SharedTable
+{
+public:
+    const double* data() const              { return mData; }
+    int size() const                        { return mSize; }
+    double operator[] (int index) const     { return mData[index]; }
+
+private:
+    friend class SharedTables;
+
+    sharedTableType mType;
+    double mParameter1, mParameter2;
+    const double* mData;
+    int mSize;
+};
+
+class SharedTables
+{
+public:
+    static constexpr size_t cacheLineSize = 64;
+
+    using Designer = std::vector<double> (*) (double parameter1, double parameter2);
+
+    // the table of this type for these parameters, calling design() to build it the first time it's asked for.
+    // The reference stays valid for the life of the process
+    static const SharedTable& get (sharedTableType type, double parameter1, double parameter2, Designer design);
+
+    // how many tables have been designed so far, and the memory they take up with their padding
+    static int getNumTables();
+    static size_t getNumBytes();
+};
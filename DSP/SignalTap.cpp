@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+    SignalTap.cpp
+
+  ==============================================================================
+*/
+
+#include "SignalTap.h"
+
+#include <cmath>
+
+namespace
+{
+    float toDecibels (double gain)
+    {
+        return gain > 0.0 ? std::max (SignalAnalyser::floorDb, (float) (20.0 * std::log10 (gain))) : SignalAnalyser::floorDb;
+    }
+}
+
+//==============================================================================
+SignalAnalyser::SignalAnalyser()
+{
+    mSampleRate = 44100.0;
+    mNumChannels = 0;
+    mHistoryPosition = 0;
+    mSamplesSinceSpectrum = 0;
+
+    prepare (mSampleRate);
+}
+
+void SignalAnalyser::prepare (double sampleRate)
+{
+    mSampleRate = sampleRate;
+
+    for (auto* levels : { &mInputLevels, &mOutputLevels, &mInputHolds, &mOutputHolds, &mMakeUpGains })
+        levels->resize ((size_t) MeterReading::maxChannels);
+
+    mInputHoldAges.resize ((size_t) MeterReading::maxChannels);
+    mOutputHoldAges.resize ((size_t) MeterReading::maxChannels);
+    mHistory.resize ((size_t) historySize);
+    mReal.resize ((size_t) fftSize);
+    mImag.resize ((size_t) fftSize);
+    mSpectrum.resize ((size_t) numBins);
+
+    const double twoPi = 6.283185307179586476925286766559;
+
+    mWindow.resize ((size_t) fftSize);
+
+    for (int i = 0; i < fftSize; ++i)
+        mWindow[(size_t) i] = (float) (0.5 - 0.5 * std::cos (twoPi * i / fftSize));
+
+    mTwiddleReal.resize ((size_t) fftSize / 2);
+    mTwiddleImag.resize ((size_t) fftSize / 2);
+
+    for (int i = 0; i < fftSize / 2; ++i)
+    {
+        mTwiddleReal[(size_t) i] = std::cos (twoPi * i / fftSize);
+        mTwiddleImag[(size_t) i] = -std::sin (twoPi * i / fftSize);
+    }
+
+    reset();
+}
+
+void SignalAnalyser::reset()
+{
+    mNumChannels = 0;
+
+    for (auto* levels : { &mInputLevels, &mOutputLevels, &mInputHolds, &mOutputHolds })
+        std::fill (levels->begin(), levels->end(), floorDb);
+
+    std::fill (mMakeUpGains.begin(), mMakeUpGains.end(), 0.0f);
+    std::fill (mInputHoldAges.begin(), mInputHoldAges.end(), 0.0);
+    std::fill (mOutputHoldAges.begin(), mOutputHoldAges.end(), 0.0);
+    std::fill (mHistory.begin(), mHistory.end(), 0.0f);
+    std::fill (mSpectrum.begin(), mSpectrum.end(), floorDb);
+
+    mHistoryPosition = 0;
+    mSamplesSinceSpectrum = 0;
+}
+
+int SignalAnalyser::takeFrom (SignalTap& tap)
+{
+    MeterReading reading;
+
+    while (tap.popReading (reading))
+        addReading (reading);
+
+    float chunk[512];
+    int numTaken = 0;
+
+    for (int numThisTime; (numThisTime = tap.popScope (chunk, 512)) > 0;)
+    {
+        // in at most two runs, either side of the end of the history
+        const int numToEnd = std::min (numThisTime, historySize - mHistoryPosition);
+        std::copy (chunk, chunk + numToEnd, mHistory.begin() + mHistoryPosition);
+        std::copy (chunk + numToEnd, chunk + numThisTime, mHistory.begin());
+        mHistoryPosition = (mHistoryPosition + numThisTime) % historySize;
+
+        numTaken += numThisTime;
+    }
+
+    mSamplesSinceSpectrum += numTaken;
+    return numTaken;
+}
+
+void SignalAnalyser::addReading (const MeterReading& reading)
+{
+    const double seconds = reading.numSamples / mSampleRate;
+    const float fall = (float) (meterFallDbPerSecond * seconds);
+
+    // a level jumps up to a new peak straight away and falls back at a fixed rate. The held peak
+    // stays where it is until it's been there for peakHoldSeconds
+    const auto follow = [&] (float& level, float& hold, double& holdAge, float peak)
+    {
+        const float peakDb = toDecibels (peak);
+        level = std::max (peakDb, level - fall);
+
+        if (peakDb >= hold)
+        {
+            hold = peakDb;
+            holdAge = 0.0;
+        }
+        else if ((holdAge += seconds) > peakHoldSeconds)
+        {
+            hold = level;
+        }
+    };
+
+    mNumChannels = reading.numChannels;
+
+    for (int channel = 0; channel < reading.numChannels; ++channel)
+    {
+        const auto index = (size_t) channel;
+        follow (mInputLevels[index], mInputHolds[index], mInputHoldAges[index], reading.inputPeaks[channel]);
+        follow (mOutputLevels[index], mOutputHolds[index], mOutputHoldAges[index], reading.outputPeaks[channel]);
+        mMakeUpGains[index] = toDecibels (reading.makeUpGains[channel]);
+    }
+}
+
+void SignalAnalyser::getScope (float* samples, int numSamples) const
+{
+    numSamples = std::min (numSamples, fftSize);
+
+    // look back up to fftSize samples for the sample where it goes from below zero to zero or above
+    int start = mHistoryPosition - numSamples + historySize;
+
+    for (int offset = 0; offset < fftSize; ++offset)
+    {
+        const int candidate = start - offset;
+
+        if (mHistory[(size_t) ((candidate - 1) % historySize)] < 0.0f && mHistory[(size_t) (candidate % historySize)] >= 0.0f)
+        {
+            start = candidate;
+            break;
+        }
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+        samples[i] = mHistory[(size_t) ((start + i) % historySize)];
+}
+
+const std::vector<float>& SignalAnalyser::updateSpectrum()
+{
+    const int oldest = mHistoryPosition - fftSize + historySize;
+
+    for (int i = 0; i < fftSize; ++i)
+    {
+        mReal[(size_t) i] = mHistory[(size_t) ((oldest + i) % historySize)] * mWindow[(size_t) i];
+        mImag[(size_t) i] = 0.0;
+    }
+
+    fft();
+
+    // the Hann window sums to fftSize / 2, and a real sine splits its energy between two bins. The
+    // magnitudes are squared, which saves a square root per bin
+    const double scale = 4.0 / fftSize;
+    const double floorPower = std::pow (10.0, floorDb / 10.0);
+    const float fall = (float) (spectrumFallDbPerSecond * mSamplesSinceSpectrum / mSampleRate);
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        const double power = std::max (floorPower, (mReal[(size_t) bin] * mReal[(size_t) bin] + mImag[(size_t) bin] * mImag[(size_t) bin]) * scale * scale);
+        auto& shown = mSpectrum[(size_t) bin];
+        shown = std::max ((float) (10.0 * std::log10 (power)), std::max (floorDb, shown - fall));
+    }
+
+    mSamplesSinceSpectrum = 0;
+    return mSpectrum;
+}
+
+void SignalAnalyser::fft()
+{
+    // in-place radix-2, with the twiddle factors worked out in prepare()
+    for (int i = 1, j = 0; i < fftSize; ++i)
+    {
+        int bit = fftSize >> 1;
+
+        for (; (j & bit) != 0; bit >>= 1)
+            j ^= bit;
+
+        j ^= bit;
+
+        if (i < j)
+        {
+            std::swap (mReal[(size_t) i], mReal[(size_t) j]);
+            std::swap (mImag[(size_t) i], mImag[(size_t) j]);
+        }
+    }
+
+    double* real = mReal.data();
+    double* imag = mImag.data();
+
+    for (int length = 2; length <= fftSize; length <<= 1)
+    {
+        const int half = length / 2;
+        const int twiddleStep = fftSize / length;
+
+        for (int start = 0; start < fftSize; start += length)
+        {
+            for (int k = 0; k < half; ++k)
+            {
+                const double twiddleReal = mTwiddleReal[(size_t) (k * twiddleStep)];
+                const double twiddleImag = mTwiddleImag[(size_t) (k * twiddleStep)];
+                const int even = start + k;
+                const int odd = even + half;
+
+                const double oddReal = real[odd] * twiddleReal - imag[odd] * twiddleImag;
+                const double oddImag = real[odd] * twiddleImag + imag[odd] * twiddleReal;
+
+                real[odd] = real[even] - oddReal;
+                imag[odd] = imag[even] - oddImag;
+                real[even] += oddReal;
+                imag[even] += oddImag;
+            }
+        }
+    }
+}
@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    SignalTap.h
+    Hands the levels, the make-up gain and the output waveform from the audio
+    thread to the editor's meters, scope and spectrum without ever blocking.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SpscQueue.h"
+#include "VectorOps.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// the peaks and make-up gains of one process() call, for its first maxChannels channels
+struct MeterReading
+{
+    static constexpr int maxChannels = 16;
+
+    int numChannels;
+    int numSamples;
+    float inputPeaks[maxChannels];
+    float outputPeaks[maxChannels];
+    float makeUpGains[maxChannels];
+};
+
+//==============================================================================
+/**
+    The audio thread calls startBlock() before processing and endBlock() after it. They
+    queue a MeterReading and the output mixed down to mono, for one other thread to read.
+    Nothing is measured until setEnabled (true), and when a queue is full what doesn't fit
+    is left out rather than waited for.
+*/
+class SignalTap
+{
+public:
+    static constexpr int readingQueueSize = 256;
+
+    // a third of a second at 48kHz, several frames' worth at any sensible frame rate
+    static constexpr int scopeQueueSize = 16384;
+
+    // may be called from any thread, takes effect at the next block
+    bool isEnabled() const                      { return mEnabled.load (std::memory_order_relaxed); }
+    void setEnabled (bool shouldBeEnabled)      { mEnabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+
+    // audio thread only: returns true if the block is being tapped, after measuring its input
+    template <typename SampleType>
+    bool startBlock (const SampleType* const* channelData, int numChannels, int numSamples)
+    {
+        mTapping = mEnabled.load (std::memory_order_relaxed);
+
+        if (mTapping)
+        {
+            mReading.numChannels = std::min (numChannels, MeterReading::maxChannels);
+            mReading.numSamples = numSamples;
+
+            for (int channel = 0; channel < mReading.numChannels; ++channel)
+                mReading.inputPeaks[channel] = (float) VectorOps::findMagnitude (channelData[channel], numSamples);
+        }
+
+        return mTapping;
+    }
+
+    // the same channels after processing, and the make-up gain each of them ended the block on
+    template <typename SampleType>
+    void endBlock (const SampleType* const* channelData, const double* makeUpGains)
+    {
+        if (! mTapping)
+            return;
+
+        const int numChannels = mReading.numChannels;
+        const int numSamples = mReading.numSamples;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            mReading.outputPeaks[channel] = (float) VectorOps::findMagnitude (channelData[channel], numSamples);
+            mReading.makeUpGains[channel] = (float) makeUpGains[channel];
+        }
+
+        mReadings.push (mReading);
+
+        if (numChannels == 0)
+            return;
+
+        // the scope and spectrum show the average of the channels, a chunk at a time from the stack
+        constexpr int chunkSize = 256;
+        float mix[chunkSize];
+        const float scale = 1.0f / (float) numChannels;
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int numThisTime = std::min (chunkSize, numSamples - start);
+
+            for (int sample = 0; sample < numThisTime; ++sample)
+                mix[sample] = (float) channelData[0][start + sample];
+
+            for (int channel = 1; channel < numChannels; ++channel)
+                for (int sample = 0; sample < numThisTime; ++sample)
+                    mix[sample] += (float) channelData[channel][start + sample];
+
+            for (int sample = 0; sample < numThisTime; ++sample)
+                mix[sample] *= scale;
+
+            if (mScope.push (mix, numThisTime) < numThisTime)
+                break;
+        }
+    }
+
+    // the reading thread only
+    bool popReading (MeterReading& reading)         { return mReadings.pop (reading); }
+    int popScope (float* samples, int maxSamples)   { return mScope.pop (samples, maxSamples); }
+
+private:
+    std::atomic<bool> mEnabled { false };
+    bool mTapping = false;
+    MeterReading mReading {};
+
+    SpscQueue<MeterReading> mReadings { readingQueueSize };
+    SpscQueue<float> mScope { scopeQueueSize };
+};
+
+//==============================================================================
+/**
+    The reading side: falling peak meters with a peak hold, the latest make-up gains, a
+    history of the waveform for a scope, and its spectrum. Allocates in prepare(), and
+    is meant to be polled a few dozen times a second from the message thread.
+*/
+class SignalAnalyser
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2 + 1;
+
+    // enough for a spectrum or a scope plus as much again to look for a trigger in
+    static constexpr int historySize = 2 * fftSize;
+
+    // the meters fall at this rate once the signal drops, and the held peaks stay up this long
+    static constexpr double meterFallDbPerSecond = 24.0;
+    static constexpr double peakHoldSeconds = 1.5;
+
+    // the spectrum falls at this rate, so it doesn't flicker at the frame rate
+    static constexpr double spectrumFallDbPerSecond = 60.0;
+
+    // anything below this is shown as this
+    static constexpr float floorDb = -120.0f;
+
+    SignalAnalyser();
+
+    void prepare (double sampleRate);
+    void reset();
+
+    // takes everything waiting in the tap, returns how many samples of waveform there were
+    int takeFrom (SignalTap& tap);
+
+    int getNumChannels() const  { return mNumChannels; }
+
+    // in dB
+    float getInputLevel (int channel) const         { return mInputLevels[(size_t) channel]; }
+    float getOutputLevel (int channel) const        { return mOutputLevels[(size_t) channel]; }
+    float getInputPeakHold (int channel) const      { return mInputHolds[(size_t) channel]; }
+    float getOutputPeakHold (int channel) const     { return mOutputHolds[(size_t) channel]; }
+    float getMakeUpGain (int channel) const         { return mMakeUpGains[(size_t) channel]; }
+
+    // the latest numSamples (at most fftSize) of the waveform. It starts on a rising zero crossing
+    // when there's one close enough, so a steady waveform stands still on the screen
+    void getScope (float* samples, int numSamples) const;
+
+    // the magnitude of each bin in dB, with a full scale sine at 0dB. Worked out on the latest
+    // fftSize samples through a Hann window
+    const std::vector<float>& updateSpectrum();
+
+private:
+    double mSampleRate;
+    int mNumChannels;
+
+    std::vector<float> mInputLevels, mOutputLevels;
+    std::vector<float> mInputHolds, mOutputHolds;
+    std::vector<double> mInputHoldAges, mOutputHoldAges;
+    std::vector<float> mMakeUpGains;
+
+    std::vector<float> mHistory;
+    int mHistoryPosition;
+    long long mSamplesSinceSpectrum;
+
+    // the FFT works on separate real and imaginary arrays, which the compiler does a lot better
+    // with than an array of std::complex
+    std::vector<float> mWindow;
+    std::vector<double> mReal, mImag;
+    std::vector<double> mTwiddleReal, mTwiddleImag;
+    std::vector<float> mSpectrum;
+
+    void addReading (const MeterReading& reading);
+    void fft();
+};
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    SpscQueue.h
+    Wait-free single producer / single consumer ring, for handing things from
+    the audio thread to the UI (or any other one thread) without locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+//==============================================================================
+/**
+    The items are copied in and out of a power of two sized ring. The read and write
+    counts run freely and the difference between them is the number of items waiting,
+    so a full ring doesn't need a spare slot. push() may only be called from one thread
+    and pop() from one other thread (which can be the same one).
+*/
+template <typename Type>
+class SpscQueue
+{
+public:
+    // allocates, the capacity is rounded up to a power of two
+    explicit SpscQueue (int capacity)
+    {
+        size_t size = 1;
+
+        while (size < (size_t) capacity)
+            size *= 2;
+
+        mItems.resize (size);
+        mMask = size - 1;
+    }
+
+    int getCapacity() const     { return (int) mItems.size(); }
+
+    int getNumReady() const
+    {
+        return (int) (mWriteCount.load (std::memory_order_acquire) - mReadCount.load (std::memory_order_acquire));
+    }
+
+    // producer side, returns false (and drops the item) when the ring is full
+    bool push (const Type& item)
+    {
+        const size_t write = mWriteCount.load (std::memory_order_relaxed);
+
+        if (write - mReadCount.load (std::memory_order_acquire) == mItems.size())
+            return false;
+
+        mItems[write & mMask] = item;
+        mWriteCount.store (write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false when there's nothing waiting
+    bool pop (Type& item)
+    {
+        const size_t read = mReadCount.load (std::memory_order_relaxed);
+
+        if (read == mWriteCount.load (std::memory_order_acquire))
+            return false;
+
+        item = mItems[read & mMask];
+        mReadCount.store (read + 1, std::memory_order_release);
+        return true;
+    }
+
+    // the same for a run of items, with one hand-over for all of them. Returns how many went in
+    // (as many as there was room for) or came out
+    int push (const Type* items, int numItems)
+    {
+        const size_t write = mWriteCount.load (std::memory_order_relaxed);
+        const size_t space = mItems.size() - (write - mReadCount.load (std::memory_order_acquire));
+        const size_t numToWrite = std::min (space, (size_t) numItems);
+        const size_t first = write & mMask;
+        const size_t numToEnd = std::min (numToWrite, mItems.size() - first);
+
+        // a run that goes past the end of the ring carries on at the start
+        std::copy (items, items + numToEnd, mItems.begin() + (std::ptrdiff_t) first);
+        std::copy (items + numToEnd, items + numToWrite, mItems.begin());
+
+        mWriteCount.store (write + numToWrite, std::memory_order_release);
+        return (int) numToWrite;
+    }
+
+    int pop (Type* items, int maxItems)
+    {
+        const size_t read = mReadCount.load (std::memory_order_relaxed);
+        const size_t numToRead = std::min (mWriteCount.load (std::memory_order_acquire) - read, (size_t) maxItems);
+        const size_t first = read & mMask;
+        const size_t numToEnd = std::min (numToRead, mItems.size() - first);
+
+        std::copy (mItems.begin() + (std::ptrdiff_t) first, mItems.begin() + (std::ptrdiff_t) (first + numToEnd), items);
+        std::copy (mItems.begin(), mItems.begin() + (std::ptrdiff_t) (numToRead - numToEnd), items + numToEnd);
+
+        mReadCount.store (read + numToRead, std::memory_order_release);
+        return (int) numToRead;
+    }
+
+private:
+    std::vector<Type> mItems;
+    size_t mMask;
+
+    // on separate cache lines, so the two threads don't keep taking the line off each other
+    alignas (64) std::atomic<size_t> mWriteCount { 0 };
+    alignas (64) std::atomic<size_t> mReadCount { 0 };
+};
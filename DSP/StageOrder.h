@@ -0,0 +1,187 @@
+/*
+  ==============================================================================
+
+    StageOrder.h
+    The order the effect stages run in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// a new stage goes on the end, so the stages already in saved orders keep their numbers
+enum effectStage
+{
+    modStage = 0,
+    distStage,
+    pulserStage,
+    numEffectStages
+};
+
+//==============================================================================
+/**
+    Every stage, once each, in the order they process the signal. A stage that's turned
+    off still has its place, it just leaves the signal alone.
+
+    The orders are numbered 0 to getNumOrders() - 1 in lexicographic order of the stage
+    numbers, which is how the plugin lists them, and 0 is the original modulation ->
+    distortion -> pulsing. The code is what gets saved: four bits per stage, the first in
+    the lowest bits, holding the stage number + 1. Reading a code from before a stage
+    existed puts that stage on the end.
+*/
+struct StageOrder
+{
+    effectStage stages[numEffectStages];
+
+    StageOrder()
+    {
+        for (int position = 0; position < numEffectStages; ++position)
+            stages[position] = (effectStage) position;
+    }
+
+    bool operator== (const StageOrder& other) const
+    {
+        for (int position = 0; position < numEffectStages; ++position)
+            if (stages[position] != other.stages[position])
+                return false;
+
+        return true;
+    }
+
+    bool operator!= (const StageOrder& other) const     { return ! operator== (other); }
+
+    // true if every stage is in it exactly once
+    bool isValid() const
+    {
+        int found = 0;
+
+        for (auto stage : stages)
+        {
+            if (stage < 0 || stage >= numEffectStages || (found & (1 << stage)) != 0)
+                return false;
+
+            found |= 1 << stage;
+        }
+
+        return true;
+    }
+
+    int getPosition (effectStage stage) const
+    {
+        for (int position = 0; position < numEffectStages; ++position)
+            if (stages[position] == stage)
+                return position;
+
+        return -1;
+    }
+
+    static constexpr int getNumOrders()
+    {
+        int numOrders = 1;
+
+        for (int stage = 2; stage <= numEffectStages; ++stage)
+            numOrders *= stage;
+
+        return numOrders;
+    }
+
+    // the rank of the order among all of them, and back. An index out of range gives the default
+    int getIndex() const
+    {
+        int index = 0;
+
+        for (int position = 0; position < numEffectStages; ++position)
+        {
+            int numSmallerLeft = 0;
+
+            for (int later = position + 1; later < numEffectStages; ++later)
+                numSmallerLeft += stages[later] < stages[position] ? 1 : 0;
+
+            index = index * (numEffectStages - position) + numSmallerLeft;
+        }
+
+        return index;
+    }
+
+    static StageOrder fromIndex (int index)
+    {
+        StageOrder order;
+
+        if (index <= 0 || index >= getNumOrders())
+            return order;
+
+        // the digits of the index in the factorial number system pick from the stages left over
+        int digits[numEffectStages];
+
+        for (int position = numEffectStages - 1; position >= 0; --position)
+        {
+            digits[position] = index % (numEffectStages - position);
+            index /= numEffectStages - position;
+        }
+
+        int used = 0;
+
+        for (int position = 0; position < numEffectStages; ++position)
+        {
+            int stage = -1;
+
+            for (int skip = digits[position]; skip >= 0; --skip)
+                do ++stage; while ((used & (1 << stage)) != 0);
+
+            order.stages[position] = (effectStage) stage;
+            used |= 1 << stage;
+        }
+
+        return order;
+    }
+
+    int getCode() const
+    {
+        int code = 0;
+
+        for (int position = numEffectStages - 1; position >= 0; --position)
+            code = (code << 4) | (stages[position] + 1);
+
+        return code;
+    }
+
+    // anything that isn't a valid order, or has stages this build doesn't know, gives the default
+    static StageOrder fromCode (int code)
+    {
+        StageOrder order;
+        int used = 0;
+        int position = 0;
+
+        for (; position < numEffectStages && (code & 15) != 0; ++position, code >>= 4)
+        {
+            const int stage = (code & 15) - 1;
+
+            if (stage >= numEffectStages || (used & (1 << stage)) != 0)
+                return StageOrder();
+
+            order.stages[position] = (effectStage) stage;
+            used |= 1 << stage;
+        }
+
+        if (code != 0)
+            return StageOrder();
+
+        for (int stage = 0; stage < numEffectStages; ++stage)
+            if ((used & (1 << stage)) == 0)
+                order.stages[position++] = (effectStage) stage;
+
+        return order;
+    }
+
+    static const char* getStageName (effectStage stage)
+    {
+        switch (stage)
+        {
+            case modStage:      return "Mod";
+            case distStage:     return "Dist";
+            case pulserStage:   return "Pulse";
+            case numEffectStages:
+            default:            return "";
+        }
+    }
+};
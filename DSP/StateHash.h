@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    StateHash.h
+    FNV-1a over the bits of a run of values, for checking that two runs of the
+    processing have ended up in exactly the same state.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+//==============================================================================
+class StateHash
+{
+public:
+    StateHash() = default;
+
+    // doubles go in as their bits, so 0.0 and -0.0 (or two NaNs) only match if they're the same
+    void add (double value)
+    {
+        uint64_t bits;
+        std::memcpy (&bits, &value, sizeof (bits));
+        addBits (bits);
+    }
+
+    void add (long long value)      { addBits ((uint64_t) value); }
+    void add (int value)            { addBits ((uint64_t) (long long) value); }
+    void add (bool value)           { addBits (value ? 1 : 0); }
+
+    uint64_t get() const            { return mHash; }
+
+private:
+    uint64_t mHash = 14695981039346656037ull;
+
+    void addBits (uint64_t bits)
+    {
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            mHash = (mHash ^ (bits & 0xff)) * 1099511628211ull;
+            bits >>= 8;
+        }
+    }
+};
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    Wait-free hand-over of a whole value from one writer thread to the audio
+    thread, used for parameter snapshots.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+
+//==============================================================================
+/**
+    Three copies of the value: the writer fills in its slot and publishes it, which swaps it
+    with the middle one, and the reader swaps its slot with the middle one when something
+    new has been published. Neither side ever waits, and the reader always sees a value
+    that was published whole, never one that's still being written.
+
+    Only one thread at a time may write, and only one may read.
+*/
+template <typename Type>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    // writer: fill this in, then publish() it. It may still hold anything written before
+    Type& getWriteSlot()                { return mSlots[mWriteSlot]; }
+
+    // writer: the slot just written becomes the middle one, flagged as new, and the old middle
+    // one is written next time
+    void publish()
+    {
+        mWriteSlot = mMiddleSlot.exchange (mWriteSlot | newValueBit, std::memory_order_acq_rel) & slotMask;
+    }
+
+    // reader: swaps in the latest value and returns true if one was published since the previous call
+    bool takeLatest()
+    {
+        if ((mMiddleSlot.load (std::memory_order_relaxed) & newValueBit) == 0)
+            return false;
+
+        mReadSlot = mMiddleSlot.exchange (mReadSlot, std::memory_order_acq_rel) & slotMask;
+        return true;
+    }
+
+    // reader: the value taken last (value-initialised before anything was taken)
+    const Type& getReadSlot() const     { return mSlots[mReadSlot]; }
+
+private:
+    static constexpr int slotMask = 3;
+    static constexpr int newValueBit = 4;
+
+    Type mSlots[3] {};
+    int mWriteSlot = 0;
+    std::atomic<int> mMiddleSlot { 1 };
+    int mReadSlot = 2;
+
+    TripleBuffer (const TripleBuffer&) = delete;
+    TripleBuffer& operator= (const TripleBuffer&) = delete;
+};
@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    VectorOps.cpp
+
+  ==============================================================================
+*/
+
+#include "VectorOps.h"
+
+#include <cmath>
+
+#if defined (__x86_64__) || defined (_M_X64)
+ #define MFX_SSE2 1
+ #include <emmintrin.h>
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #define MFX_NEON 1
+ #include <arm_neon.h>
+#endif
+
+//==============================================================================
+float VectorOps::findMagnitude (const float* data, int numSamples)
+{
+    int sample = 0;
+    float peak = 0.0f;
+
+   #if MFX_SSE2
+    // two accumulators so consecutive max operations don't wait on each other
+    const __m128 absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+    __m128 peakA = _mm_setzero_ps();
+    __m128 peakB = _mm_setzero_ps();
+
+    for (; sample + 8 <= numSamples; sample += 8)
+    {
+        peakA = _mm_max_ps (peakA, _mm_and_ps (_mm_loadu_ps (data + sample), absMask));
+        peakB = _mm_max_ps (peakB, _mm_and_ps (_mm_loadu_ps (data + sample + 4), absMask));
+    }
+
+    __m128 v = _mm_max_ps (peakA, peakB);
+    v = _mm_max_ps (v, _mm_movehl_ps (v, v));
+    v = _mm_max_ss (v, _mm_shuffle_ps (v, v, 1));
+    peak = _mm_cvtss_f32 (v);
+   #elif MFX_NEON
+    float32x4_t peakA = vdupq_n_f32 (0.0f);
+    float32x4_t peakB = vdupq_n_f32 (0.0f);
+
+    for (; sample + 8 <= numSamples; sample += 8)
+    {
+        peakA = vmaxq_f32 (peakA, vabsq_f32 (vld1q_f32 (data + sample)));
+        peakB = vmaxq_f32 (peakB, vabsq_f32 (vld1q_f32 (data + sample + 4)));
+    }
+
+    peak = vmaxvq_f32 (vmaxq_f32 (peakA, peakB));
+   #endif
+
+    for (; sample < numSamples; ++sample)
+    {
+        const float magnitude = std::abs (data[sample]);
+        peak = magnitude > peak ? magnitude : peak;
+    }
+
+    return peak;
+}
+
+double VectorOps::findMagnitude (const double* data, int numSamples)
+{
+    int sample = 0;
+    double peak = 0.0;
+
+   #if MFX_SSE2
+    const __m128d absMask = _mm_castsi128_pd (_mm_set1_epi64x (0x7fffffffffffffffLL));
+    __m128d peakA = _mm_setzero_pd();
+    __m128d peakB = _mm_setzero_pd();
+
+    for (; sample + 4 <= numSamples; sample += 4)
+    {
+        peakA = _mm_max_pd (peakA, _mm_and_pd (_mm_loadu_pd (data + sample), absMask));
+        peakB = _mm_max_pd (peakB, _mm_and_pd (_mm_loadu_pd (data + sample + 2), absMask));
+    }
+
+    __m128d v = _mm_max_pd (peakA, peakB);
+    v = _mm_max_sd (v, _mm_unpackhi_pd (v, v));
+    peak = _mm_cvtsd_f64 (v);
+   #elif MFX_NEON
+    float64x2_t peakA = vdupq_n_f64 (0.0);
+    float64x2_t peakB = vdupq_n_f64 (0.0);
+
+    for (; sample + 4 <= numSamples; sample += 4)
+    {
+        peakA = vmaxq_f64 (peakA, vabsq_f64 (vld1q_f64 (data + sample)));
+        peakB = vmaxq_f64 (peakB, vabsq_f64 (vld1q_f64 (data + sample + 2)));
+    }
+
+    peak = vmaxvq_f64 (vmaxq_f64 (peakA, peakB));
+   #endif
+
+    for (; sample < numSamples; ++sample)
+    {
+        const double magnitude = std::abs (data[sample]);
+        peak = magnitude > peak ? magnitude : peak;
+    }
+
+    return peak;
+}
+
+bool VectorOps::isSilent (const float* data, int numSamples)
+{
+    int sample = 0;
+
+    // the bits of all the samples are ORed together, leaving the sign out, so it's a plain integer
+    // test whatever the denormal mode is
+   #if MFX_SSE2
+    __m128i bits = _mm_setzero_si128();
+
+    for (; sample + 8 <= numSamples; sample += 8)
+        bits = _mm_or_si128 (bits, _mm_or_si128 (_mm_loadu_si128 ((const __m128i*) (data + sample)),
+                                                 _mm_loadu_si128 ((const __m128i*) (data + sample + 4))));
+
+    bits = _mm_and_si128 (bits, _mm_set1_epi32 (0x7fffffff));
+
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (bits, _mm_setzero_si128())) != 0xffff)
+        return false;
+   #elif MFX_NEON
+    uint32x4_t bits = vdupq_n_u32 (0);
+
+    for (; sample + 8 <= numSamples; sample += 8)
+        bits = vorrq_u32 (bits, vorrq_u32 (vreinterpretq_u32_f32 (vld1q_f32 (data + sample)),
+                                           vreinterpretq_u32_f32 (vld1q_f32 (data + sample + 4))));
+
+    if (vmaxvq_u32 (vandq_u32 (bits, vdupq_n_u32 (0x7fffffff))) != 0)
+        return false;
+   #endif
+
+    for (; sample < numSamples; ++sample)
+        if (data[sample] != 0.0f)
+            return false;
+
+    return true;
+}
+
+bool VectorOps::isSilent (const double* data, int numSamples)
+{
+    int sample = 0;
+
+   #if MFX_SSE2
+    __m128i bits = _mm_setzero_si128();
+
+    for (; sample + 4 <= numSamples; sample += 4)
+        bits = _mm_or_si128 (bits, _mm_or_si128 (_mm_loadu_si128 ((const __m128i*) (data + sample)),
+                                                 _mm_loadu_si128 ((const __m128i*) (data + sample + 2))));
+
+    bits = _mm_and_si128 (bits, _mm_set1_epi64x (0x7fffffffffffffffLL));
+
+    // a 64-bit lane is zero when both of its 32-bit halves are
+    if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (bits, _mm_setzero_si128())) != 0xffff)
+        return false;
+   #elif MFX_NEON
+    uint64x2_t bits = vdupq_n_u64 (0);
+
+    for (; sample + 4 <= numSamples; sample += 4)
+        bits = vorrq_u64 (bits, vorrq_u64 (vreinterpretq_u64_f64 (vld1q_f64 (data + sample)),
+                                           vreinterpretq_u64_f64 (vld1q_f64 (data + sample + 2))));
+
+    bits = vandq_u64 (bits, vdupq_n_u64 (0x7fffffffffffffffULL));
+
+    if ((vgetq_lane_u64 (bits, 0) | vgetq_lane_u64 (bits, 1)) != 0)
+        return false;
+   #endif
+
+    for (; sample < numSamples; ++sample)
+        if (data[sample] != 0.0)
+            return false;
+
+    return true;
+}
@@ -0,0 +1,24 @@
+/*
+  ==============================================================================
+
+    VectorOps.h
+    Small SIMD helpers for the loops the compiler won't vectorise on its own
+    (mostly because of strict IEEE semantics on min/max reductions).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+class VectorOps
+{
+public:
+    // largest absolute sample value, same result as the scalar loop for any non-NaN input
+    static float findMagnitude (const float* data, int numSamples);
+    static double findMagnitude (const double* data, int numSamples);
+
+    // true if every sample is exactly zero (either sign), without stopping at the first one that isn't
+    static bool isSilent (const float* data, int numSamples);
+    static bool isSilent (const double* data, int numSamples);
+};
@@ -0,0 +1,748 @@
+/*
+  ==============================================================================
+
+    Waveshaper.cpp
+
+  ==============================================================================
+*/
+
+#include "Waveshaper.h"
+
+#include <cmath>
+
+#if defined (__x86_64__) || defined (_M_X64)
+ #define MFX_X86 1
+ #include <immintrin.h>
+ #if defined (_MSC_VER) && ! defined (__clang__)
+  #include <intrin.h>
+  #define MFX_AVX2_TARGET
+ #else
+  #define MFX_AVX2_TARGET __attribute__ ((target ("avx2")))
+ #endif
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #define MFX_NEON 1
+ #include <arm_neon.h>
+#endif
+
+namespace
+{
+    template <typename SampleType>
+    struct ShapeConstants
+    {
+        // the Pade approximant reaches 1 at |x| = 4.9718, so clamping just below that keeps it within +/-1
+        static constexpr SampleType padeLimit = (SampleType) 4.97;
+
+        static constexpr SampleType padeN0 = 135135, padeN1 = 17325, padeN2 = 378;
+        static constexpr SampleType padeD0 = 135135, padeD1 = 62370, padeD2 = 3150, padeD3 = 28;
+
+        // least-squares fit with p(2.5) = 1 and p'(2.5) = 0, so the clamp joins without a kink
+        static constexpr SampleType polyLimit = (SampleType) 2.5;
+
+        static constexpr SampleType polyC1 = (SampleType) 0.9467016064670405;
+        static constexpr SampleType polyC3 = (SampleType) -0.19531687762183716;
+        static constexpr SampleType polyC5 = (SampleType) 0.01865651310414651;
+        static constexpr SampleType polyC7 = (SampleType) 0.0008922928876739694;
+        static constexpr SampleType polyC9 = (SampleType) -0.0001786420315691997;
+    };
+
+    // the float kernels use these directly
+    constexpr float padeLimit = ShapeConstants<float>::padeLimit;
+    constexpr float padeN0 = ShapeConstants<float>::padeN0, padeN1 = ShapeConstants<float>::padeN1, padeN2 = ShapeConstants<float>::padeN2;
+    constexpr float padeD0 = ShapeConstants<float>::padeD0, padeD1 = ShapeConstants<float>::padeD1, padeD2 = ShapeConstants<float>::padeD2, padeD3 = ShapeConstants<float>::padeD3;
+    constexpr float polyLimit = ShapeConstants<float>::polyLimit;
+    constexpr float polyC1 = ShapeConstants<float>::polyC1, polyC3 = ShapeConstants<float>::polyC3, polyC5 = ShapeConstants<float>::polyC5;
+    constexpr float polyC7 = ShapeConstants<float>::polyC7, polyC9 = ShapeConstants<float>::polyC9;
+
+    static_assert (padeLimit == 4.97f && polyC1 == 0.9467016064670405f && polyC9 == -0.0001786420315691997f,
+                   "the float constants have to round the same as the float literals they replaced");
+
+    // max (min (x, limit), -limit) the way _mm_min/_mm_max compare, so a NaN comes out as +limit
+    // here just as it does in the vector kernels (the NEON ones use vminnm/vmaxnm to do the same)
+    template <typename SampleType>
+    inline SampleType clampSample (SampleType x, SampleType limit)
+    {
+        x = x < limit ? x : limit;
+        return x > -limit ? x : -limit;
+    }
+
+    template <typename SampleType>
+    SampleType padeTanhValue (SampleType x)
+    {
+        using C = ShapeConstants<SampleType>;
+
+        x = clampSample (x, C::padeLimit);
+        const SampleType x2 = x * x;
+        const SampleType num = x * (C::padeN0 + x2 * (C::padeN1 + x2 * (C::padeN2 + x2)));
+        const SampleType den = C::padeD0 + x2 * (C::padeD1 + x2 * (C::padeD2 + x2 * C::padeD3));
+        return num / den;
+    }
+
+    template <typename SampleType>
+    SampleType polynomialTanhValue (SampleType x)
+    {
+        using C = ShapeConstants<SampleType>;
+
+        x = clampSample (x, C::polyLimit);
+        const SampleType x2 = x * x;
+        return x * (C::polyC1 + x2 * (C::polyC3 + x2 * (C::polyC5 + x2 * (C::polyC7 + x2 * C::polyC9))));
+    }
+
+    //==============================================================================
+    // scalar kernels, these define the results all of the vector versions have to reproduce
+    template <typename SampleType, typename ShapeFn>
+    SampleType processScalar (SampleType* data, int numSamples, double drive, ShapeFn shape)
+    {
+        SampleType peak = 0;
+
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            SampleType x = data[sample];
+            x *= drive;
+            x = shape (x);
+            data[sample] = x;
+
+            const SampleType magnitude = std::abs (x);
+            peak = magnitude > peak ? magnitude : peak;
+        }
+
+        return peak;
+    }
+
+    template <typename SampleType>
+    SampleType hardClipScalar (SampleType* data, int numSamples, double drive)
+    {
+        return processScalar (data, numSamples, drive, [] (SampleType x) { return clampSample (x, (SampleType) 1); });
+    }
+
+    template <typename SampleType>
+    SampleType softClipScalar (SampleType* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processScalar (data, numSamples, drive, padeTanhValue<SampleType>);
+            case polynomialTanh:    return processScalar (data, numSamples, drive, polynomialTanhValue<SampleType>);
+            case exactTanh:
+            default:                return processScalar (data, numSamples, drive, [] (SampleType x) { return std::tanh (x); });
+        }
+    }
+
+   #if MFX_X86
+    //==============================================================================
+    inline __m128 driveSse2 (__m128 x, __m128d drive)
+    {
+        const __m128 low = _mm_cvtpd_ps (_mm_mul_pd (_mm_cvtps_pd (x), drive));
+        const __m128 high = _mm_cvtpd_ps (_mm_mul_pd (_mm_cvtps_pd (_mm_movehl_ps (x, x)), drive));
+        return _mm_movelh_ps (low, high);
+    }
+
+    inline __m128 clampSse2 (__m128 x, float limit)
+    {
+        return _mm_max_ps (_mm_min_ps (x, _mm_set1_ps (limit)), _mm_set1_ps (-limit));
+    }
+
+    inline __m128 padeSse2 (__m128 x)
+    {
+        x = clampSse2 (x, padeLimit);
+        const __m128 x2 = _mm_mul_ps (x, x);
+        const __m128 num = _mm_mul_ps (x, _mm_add_ps (_mm_set1_ps (padeN0), _mm_mul_ps (x2, _mm_add_ps (_mm_set1_ps (padeN1), _mm_mul_ps (x2, _mm_add_ps (_mm_set1_ps (padeN2), x2))))));
+        const __m128 den = _mm_add_ps (_mm_set1_ps (padeD0), _mm_mul_ps (x2, _mm_add_ps (_mm_set1_ps (padeD1), _mm_mul_ps (x2, _mm_add_ps (_mm_set1_ps (padeD2), _mm_mul_ps (x2, _mm_set1_ps (padeD3)))))));
+        return _mm_div_ps (num, den);
+    }
+
+    inline __m128 polynomialSse2 (__m128 x)
+    {
+        x = clampSse2 (x, polyLimit);
+        const __m128 x2 = _mm_mul_ps (x, x);
+        __m128 y = _mm_add_ps (_mm_set1_ps (polyC7), _mm_mul_ps (x2, _mm_set1_ps (polyC9)));
+        y = _mm_add_ps (_mm_set1_ps (polyC5), _mm_mul_ps (x2, y));
+        y = _mm_add_ps (_mm_set1_ps (polyC3), _mm_mul_ps (x2, y));
+        y = _mm_add_ps (_mm_set1_ps (polyC1), _mm_mul_ps (x2, y));
+        return _mm_mul_ps (x, y);
+    }
+
+    inline float horizontalMaxSse2 (__m128 v)
+    {
+        v = _mm_max_ps (v, _mm_movehl_ps (v, v));
+        v = _mm_max_ss (v, _mm_shuffle_ps (v, v, 1));
+        return _mm_cvtss_f32 (v);
+    }
+
+    template <typename ShapeVec, typename ShapeScalar>
+    float processSse2 (float* data, int numSamples, double drive, ShapeVec shape, ShapeScalar shapeScalar)
+    {
+        const __m128d driveVec = _mm_set1_pd (drive);
+        const __m128 absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+        __m128 peak = _mm_setzero_ps();
+        int sample = 0;
+
+        for (; sample + 4 <= numSamples; sample += 4)
+        {
+            const __m128 y = shape (driveSse2 (_mm_loadu_ps (data + sample), driveVec));
+            _mm_storeu_ps (data + sample, y);
+            peak = _mm_max_ps (peak, _mm_and_ps (y, absMask));
+        }
+
+        const float tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const float vectorPeak = horizontalMaxSse2 (peak);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    float hardClipSse2 (float* data, int numSamples, double drive)
+    {
+        return processSse2 (data, numSamples, drive, [] (__m128 x) { return clampSse2 (x, 1.0f); },
+                            [] (float x) { return clampSample (x, 1.0f); });
+    }
+
+    float softClipSse2 (float* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processSse2 (data, numSamples, drive, [] (__m128 x) { return padeSse2 (x); }, padeTanhValue<float>);
+            case polynomialTanh:    return processSse2 (data, numSamples, drive, [] (__m128 x) { return polynomialSse2 (x); }, polynomialTanhValue<float>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+
+    //==============================================================================
+    // double precision, two samples per register and the drive applied without any conversion
+    inline __m128d clampSse2 (__m128d x, double limit)
+    {
+        return _mm_max_pd (_mm_min_pd (x, _mm_set1_pd (limit)), _mm_set1_pd (-limit));
+    }
+
+    inline __m128d padeSse2 (__m128d x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampSse2 (x, C::padeLimit);
+        const __m128d x2 = _mm_mul_pd (x, x);
+        const __m128d num = _mm_mul_pd (x, _mm_add_pd (_mm_set1_pd (C::padeN0), _mm_mul_pd (x2, _mm_add_pd (_mm_set1_pd (C::padeN1), _mm_mul_pd (x2, _mm_add_pd (_mm_set1_pd (C::padeN2), x2))))));
+        const __m128d den = _mm_add_pd (_mm_set1_pd (C::padeD0), _mm_mul_pd (x2, _mm_add_pd (_mm_set1_pd (C::padeD1), _mm_mul_pd (x2, _mm_add_pd (_mm_set1_pd (C::padeD2), _mm_mul_pd (x2, _mm_set1_pd (C::padeD3)))))));
+        return _mm_div_pd (num, den);
+    }
+
+    inline __m128d polynomialSse2 (__m128d x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampSse2 (x, C::polyLimit);
+        const __m128d x2 = _mm_mul_pd (x, x);
+        __m128d y = _mm_add_pd (_mm_set1_pd (C::polyC7), _mm_mul_pd (x2, _mm_set1_pd (C::polyC9)));
+        y = _mm_add_pd (_mm_set1_pd (C::polyC5), _mm_mul_pd (x2, y));
+        y = _mm_add_pd (_mm_set1_pd (C::polyC3), _mm_mul_pd (x2, y));
+        y = _mm_add_pd (_mm_set1_pd (C::polyC1), _mm_mul_pd (x2, y));
+        return _mm_mul_pd (x, y);
+    }
+
+    inline double horizontalMaxSse2 (__m128d v)
+    {
+        return _mm_cvtsd_f64 (_mm_max_sd (v, _mm_unpackhi_pd (v, v)));
+    }
+
+    template <typename ShapeVec, typename ShapeScalar>
+    double processSse2 (double* data, int numSamples, double drive, ShapeVec shape, ShapeScalar shapeScalar)
+    {
+        const __m128d driveVec = _mm_set1_pd (drive);
+        const __m128d absMask = _mm_castsi128_pd (_mm_set1_epi64x (0x7fffffffffffffffLL));
+        __m128d peak = _mm_setzero_pd();
+        int sample = 0;
+
+        for (; sample + 2 <= numSamples; sample += 2)
+        {
+            const __m128d y = shape (_mm_mul_pd (_mm_loadu_pd (data + sample), driveVec));
+            _mm_storeu_pd (data + sample, y);
+            peak = _mm_max_pd (peak, _mm_and_pd (y, absMask));
+        }
+
+        const double tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const double vectorPeak = horizontalMaxSse2 (peak);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    double hardClipSse2 (double* data, int numSamples, double drive)
+    {
+        return processSse2 (data, numSamples, drive, [] (__m128d x) { return clampSse2 (x, 1.0); },
+                            [] (double x) { return clampSample (x, 1.0); });
+    }
+
+    double softClipSse2 (double* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processSse2 (data, numSamples, drive, [] (__m128d x) { return padeSse2 (x); }, padeTanhValue<double>);
+            case polynomialTanh:    return processSse2 (data, numSamples, drive, [] (__m128d x) { return polynomialSse2 (x); }, polynomialTanhValue<double>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+
+    //==============================================================================
+    MFX_AVX2_TARGET inline __m256 driveAvx2 (__m256 x, __m256d drive)
+    {
+        const __m128 low = _mm256_cvtpd_ps (_mm256_mul_pd (_mm256_cvtps_pd (_mm256_castps256_ps128 (x)), drive));
+        const __m128 high = _mm256_cvtpd_ps (_mm256_mul_pd (_mm256_cvtps_pd (_mm256_extractf128_ps (x, 1)), drive));
+        return _mm256_insertf128_ps (_mm256_castps128_ps256 (low), high, 1);
+    }
+
+    MFX_AVX2_TARGET inline __m256 clampAvx2 (__m256 x, float limit)
+    {
+        return _mm256_max_ps (_mm256_min_ps (x, _mm256_set1_ps (limit)), _mm256_set1_ps (-limit));
+    }
+
+    MFX_AVX2_TARGET inline __m256 padeAvx2 (__m256 x)
+    {
+        x = clampAvx2 (x, padeLimit);
+        const __m256 x2 = _mm256_mul_ps (x, x);
+        const __m256 num = _mm256_mul_ps (x, _mm256_add_ps (_mm256_set1_ps (padeN0), _mm256_mul_ps (x2, _mm256_add_ps (_mm256_set1_ps (padeN1), _mm256_mul_ps (x2, _mm256_add_ps (_mm256_set1_ps (padeN2), x2))))));
+        const __m256 den = _mm256_add_ps (_mm256_set1_ps (padeD0), _mm256_mul_ps (x2, _mm256_add_ps (_mm256_set1_ps (padeD1), _mm256_mul_ps (x2, _mm256_add_ps (_mm256_set1_ps (padeD2), _mm256_mul_ps (x2, _mm256_set1_ps (padeD3)))))));
+        return _mm256_div_ps (num, den);
+    }
+
+    MFX_AVX2_TARGET inline __m256 polynomialAvx2 (__m256 x)
+    {
+        x = clampAvx2 (x, polyLimit);
+        const __m256 x2 = _mm256_mul_ps (x, x);
+        __m256 y = _mm256_add_ps (_mm256_set1_ps (polyC7), _mm256_mul_ps (x2, _mm256_set1_ps (polyC9)));
+        y = _mm256_add_ps (_mm256_set1_ps (polyC5), _mm256_mul_ps (x2, y));
+        y = _mm256_add_ps (_mm256_set1_ps (polyC3), _mm256_mul_ps (x2, y));
+        y = _mm256_add_ps (_mm256_set1_ps (polyC1), _mm256_mul_ps (x2, y));
+        return _mm256_mul_ps (x, y);
+    }
+
+    // the shape is picked with a template parameter rather than a lambda, so that it can carry the AVX2 target attribute
+    template <tanhApprox shapeType>
+    MFX_AVX2_TARGET inline __m256 shapeAvx2 (__m256 x)
+    {
+        if (shapeType == padeTanh)
+            return padeAvx2 (x);
+
+        if (shapeType == polynomialTanh)
+            return polynomialAvx2 (x);
+
+        return clampAvx2 (x, 1.0f);
+    }
+
+    template <tanhApprox shapeType, typename ShapeScalar>
+    MFX_AVX2_TARGET float processAvx2 (float* data, int numSamples, double drive, ShapeScalar shapeScalar)
+    {
+        const __m256d driveVec = _mm256_set1_pd (drive);
+        const __m256 absMask = _mm256_castsi256_ps (_mm256_set1_epi32 (0x7fffffff));
+        __m256 peak = _mm256_setzero_ps();
+        int sample = 0;
+
+        for (; sample + 8 <= numSamples; sample += 8)
+        {
+            const __m256 y = shapeAvx2<shapeType> (driveAvx2 (_mm256_loadu_ps (data + sample), driveVec));
+            _mm256_storeu_ps (data + sample, y);
+            peak = _mm256_max_ps (peak, _mm256_and_ps (y, absMask));
+        }
+
+        const __m128 peak4 = _mm_max_ps (_mm256_castps256_ps128 (peak), _mm256_extractf128_ps (peak, 1));
+        _mm256_zeroupper();
+
+        const float tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const float vectorPeak = horizontalMaxSse2 (peak4);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    float hardClipAvx2 (float* data, int numSamples, double drive)
+    {
+        // exactTanh stands for "no shaping beyond the hard clamp" here
+        return processAvx2<exactTanh> (data, numSamples, drive, [] (float x) { return clampSample (x, 1.0f); });
+    }
+
+    float softClipAvx2 (float* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processAvx2<padeTanh> (data, numSamples, drive, padeTanhValue<float>);
+            case polynomialTanh:    return processAvx2<polynomialTanh> (data, numSamples, drive, polynomialTanhValue<float>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+
+    //==============================================================================
+    MFX_AVX2_TARGET inline __m256d clampAvx2 (__m256d x, double limit)
+    {
+        return _mm256_max_pd (_mm256_min_pd (x, _mm256_set1_pd (limit)), _mm256_set1_pd (-limit));
+    }
+
+    MFX_AVX2_TARGET inline __m256d padeAvx2 (__m256d x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampAvx2 (x, C::padeLimit);
+        const __m256d x2 = _mm256_mul_pd (x, x);
+        const __m256d num = _mm256_mul_pd (x, _mm256_add_pd (_mm256_set1_pd (C::padeN0), _mm256_mul_pd (x2, _mm256_add_pd (_mm256_set1_pd (C::padeN1), _mm256_mul_pd (x2, _mm256_add_pd (_mm256_set1_pd (C::padeN2), x2))))));
+        const __m256d den = _mm256_add_pd (_mm256_set1_pd (C::padeD0), _mm256_mul_pd (x2, _mm256_add_pd (_mm256_set1_pd (C::padeD1), _mm256_mul_pd (x2, _mm256_add_pd (_mm256_set1_pd (C::padeD2), _mm256_mul_pd (x2, _mm256_set1_pd (C::padeD3)))))));
+        return _mm256_div_pd (num, den);
+    }
+
+    MFX_AVX2_TARGET inline __m256d polynomialAvx2 (__m256d x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampAvx2 (x, C::polyLimit);
+        const __m256d x2 = _mm256_mul_pd (x, x);
+        __m256d y = _mm256_add_pd (_mm256_set1_pd (C::polyC7), _mm256_mul_pd (x2, _mm256_set1_pd (C::polyC9)));
+        y = _mm256_add_pd (_mm256_set1_pd (C::polyC5), _mm256_mul_pd (x2, y));
+        y = _mm256_add_pd (_mm256_set1_pd (C::polyC3), _mm256_mul_pd (x2, y));
+        y = _mm256_add_pd (_mm256_set1_pd (C::polyC1), _mm256_mul_pd (x2, y));
+        return _mm256_mul_pd (x, y);
+    }
+
+    template <tanhApprox shapeType>
+    MFX_AVX2_TARGET inline __m256d shapeAvx2 (__m256d x)
+    {
+        if (shapeType == padeTanh)
+            return padeAvx2 (x);
+
+        if (shapeType == polynomialTanh)
+            return polynomialAvx2 (x);
+
+        return clampAvx2 (x, 1.0);
+    }
+
+    template <tanhApprox shapeType, typename ShapeScalar>
+    MFX_AVX2_TARGET double processAvx2 (double* data, int numSamples, double drive, ShapeScalar shapeScalar)
+    {
+        const __m256d driveVec = _mm256_set1_pd (drive);
+        const __m256d absMask = _mm256_castsi256_pd (_mm256_set1_epi64x (0x7fffffffffffffffLL));
+        __m256d peak = _mm256_setzero_pd();
+        int sample = 0;
+
+        for (; sample + 4 <= numSamples; sample += 4)
+        {
+            const __m256d y = shapeAvx2<shapeType> (_mm256_mul_pd (_mm256_loadu_pd (data + sample), driveVec));
+            _mm256_storeu_pd (data + sample, y);
+            peak = _mm256_max_pd (peak, _mm256_and_pd (y, absMask));
+        }
+
+        const __m128d peak2 = _mm_max_pd (_mm256_castpd256_pd128 (peak), _mm256_extractf128_pd (peak, 1));
+        _mm256_zeroupper();
+
+        const double tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const double vectorPeak = horizontalMaxSse2 (peak2);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    double hardClipAvx2 (double* data, int numSamples, double drive)
+    {
+        return processAvx2<exactTanh> (data, numSamples, drive, [] (double x) { return clampSample (x, 1.0); });
+    }
+
+    double softClipAvx2 (double* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processAvx2<padeTanh> (data, numSamples, drive, padeTanhValue<double>);
+            case polynomialTanh:    return processAvx2<polynomialTanh> (data, numSamples, drive, polynomialTanhValue<double>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+
+    bool cpuHasAvx2()
+    {
+       #if defined (_MSC_VER) && ! defined (__clang__)
+        int info[4];
+        __cpuid (info, 1);
+
+        // the OS has to save the YMM registers as well as the CPU supporting AVX
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv (0) & 6) == 6;
+
+        __cpuidex (info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5)) != 0;
+       #else
+        return __builtin_cpu_supports ("avx2");
+       #endif
+    }
+   #endif
+
+   #if MFX_NEON
+    //==============================================================================
+    inline float32x4_t driveNeon (float32x4_t x, float64x2_t drive)
+    {
+        const float64x2_t low = vmulq_f64 (vcvt_f64_f32 (vget_low_f32 (x)), drive);
+        const float64x2_t high = vmulq_f64 (vcvt_high_f64_f32 (x), drive);
+        return vcvt_high_f32_f64 (vcvt_f32_f64 (low), high);
+    }
+
+    inline float32x4_t clampNeon (float32x4_t x, float limit)
+    {
+        return vmaxnmq_f32 (vminnmq_f32 (x, vdupq_n_f32 (limit)), vdupq_n_f32 (-limit));
+    }
+
+    inline float32x4_t padeNeon (float32x4_t x)
+    {
+        x = clampNeon (x, padeLimit);
+        const float32x4_t x2 = vmulq_f32 (x, x);
+        const float32x4_t num = vmulq_f32 (x, vaddq_f32 (vdupq_n_f32 (padeN0), vmulq_f32 (x2, vaddq_f32 (vdupq_n_f32 (padeN1), vmulq_f32 (x2, vaddq_f32 (vdupq_n_f32 (padeN2), x2))))));
+        const float32x4_t den = vaddq_f32 (vdupq_n_f32 (padeD0), vmulq_f32 (x2, vaddq_f32 (vdupq_n_f32 (padeD1), vmulq_f32 (x2, vaddq_f32 (vdupq_n_f32 (padeD2), vmulq_f32 (x2, vdupq_n_f32 (padeD3)))))));
+        return vdivq_f32 (num, den);
+    }
+
+    inline float32x4_t polynomialNeon (float32x4_t x)
+    {
+        x = clampNeon (x, polyLimit);
+        const float32x4_t x2 = vmulq_f32 (x, x);
+        float32x4_t y = vaddq_f32 (vdupq_n_f32 (polyC7), vmulq_f32 (x2, vdupq_n_f32 (polyC9)));
+        y = vaddq_f32 (vdupq_n_f32 (polyC5), vmulq_f32 (x2, y));
+        y = vaddq_f32 (vdupq_n_f32 (polyC3), vmulq_f32 (x2, y));
+        y = vaddq_f32 (vdupq_n_f32 (polyC1), vmulq_f32 (x2, y));
+        return vmulq_f32 (x, y);
+    }
+
+    template <typename ShapeVec, typename ShapeScalar>
+    float processNeon (float* data, int numSamples, double drive, ShapeVec shape, ShapeScalar shapeScalar)
+    {
+        const float64x2_t driveVec = vdupq_n_f64 (drive);
+        float32x4_t peak = vdupq_n_f32 (0.0f);
+        int sample = 0;
+
+        for (; sample + 4 <= numSamples; sample += 4)
+        {
+            const float32x4_t y = shape (driveNeon (vld1q_f32 (data + sample), driveVec));
+            vst1q_f32 (data + sample, y);
+            peak = vmaxq_f32 (peak, vabsq_f32 (y));
+        }
+
+        const float tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const float vectorPeak = vmaxvq_f32 (peak);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    float hardClipNeon (float* data, int numSamples, double drive)
+    {
+        return processNeon (data, numSamples, drive, [] (float32x4_t x) { return clampNeon (x, 1.0f); },
+                            [] (float x) { return clampSample (x, 1.0f); });
+    }
+
+    float softClipNeon (float* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processNeon (data, numSamples, drive, [] (float32x4_t x) { return padeNeon (x); }, padeTanhValue<float>);
+            case polynomialTanh:    return processNeon (data, numSamples, drive, [] (float32x4_t x) { return polynomialNeon (x); }, polynomialTanhValue<float>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+
+    //==============================================================================
+    inline float64x2_t clampNeon (float64x2_t x, double limit)
+    {
+        return vmaxnmq_f64 (vminnmq_f64 (x, vdupq_n_f64 (limit)), vdupq_n_f64 (-limit));
+    }
+
+    inline float64x2_t padeNeon (float64x2_t x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampNeon (x, C::padeLimit);
+        const float64x2_t x2 = vmulq_f64 (x, x);
+        const float64x2_t num = vmulq_f64 (x, vaddq_f64 (vdupq_n_f64 (C::padeN0), vmulq_f64 (x2, vaddq_f64 (vdupq_n_f64 (C::padeN1), vmulq_f64 (x2, vaddq_f64 (vdupq_n_f64 (C::padeN2), x2))))));
+        const float64x2_t den = vaddq_f64 (vdupq_n_f64 (C::padeD0), vmulq_f64 (x2, vaddq_f64 (vdupq_n_f64 (C::padeD1), vmulq_f64 (x2, vaddq_f64 (vdupq_n_f64 (C::padeD2), vmulq_f64 (x2, vdupq_n_f64 (C::padeD3)))))));
+        return vdivq_f64 (num, den);
+    }
+
+    inline float64x2_t polynomialNeon (float64x2_t x)
+    {
+        using C = ShapeConstants<double>;
+
+        x = clampNeon (x, C::polyLimit);
+        const float64x2_t x2 = vmulq_f64 (x, x);
+        float64x2_t y = vaddq_f64 (vdupq_n_f64 (C::polyC7), vmulq_f64 (x2, vdupq_n_f64 (C::polyC9)));
+        y = vaddq_f64 (vdupq_n_f64 (C::polyC5), vmulq_f64 (x2, y));
+        y = vaddq_f64 (vdupq_n_f64 (C::polyC3), vmulq_f64 (x2, y));
+        y = vaddq_f64 (vdupq_n_f64 (C::polyC1), vmulq_f64 (x2, y));
+        return vmulq_f64 (x, y);
+    }
+
+    template <typename ShapeVec, typename ShapeScalar>
+    double processNeon (double* data, int numSamples, double drive, ShapeVec shape, ShapeScalar shapeScalar)
+    {
+        const float64x2_t driveVec = vdupq_n_f64 (drive);
+        float64x2_t peak = vdupq_n_f64 (0.0);
+        int sample = 0;
+
+        for (; sample + 2 <= numSamples; sample += 2)
+        {
+            const float64x2_t y = shape (vmulq_f64 (vld1q_f64 (data + sample), driveVec));
+            vst1q_f64 (data + sample, y);
+            peak = vmaxq_f64 (peak, vabsq_f64 (y));
+        }
+
+        const double tailPeak = processScalar (data + sample, numSamples - sample, drive, shapeScalar);
+        const double vectorPeak = vmaxvq_f64 (peak);
+        return tailPeak > vectorPeak ? tailPeak : vectorPeak;
+    }
+
+    double hardClipNeon (double* data, int numSamples, double drive)
+    {
+        return processNeon (data, numSamples, drive, [] (float64x2_t x) { return clampNeon (x, 1.0); },
+                            [] (double x) { return clampSample (x, 1.0); });
+    }
+
+    double softClipNeon (double* data, int numSamples, double drive, tanhApprox approx)
+    {
+        switch (approx)
+        {
+            case padeTanh:          return processNeon (data, numSamples, drive, [] (float64x2_t x) { return padeNeon (x); }, padeTanhValue<double>);
+            case polynomialTanh:    return processNeon (data, numSamples, drive, [] (float64x2_t x) { return polynomialNeon (x); }, polynomialTanhValue<double>);
+            case exactTanh:
+            default:                return softClipScalar (data, numSamples, drive, approx);
+        }
+    }
+   #endif
+
+    //==============================================================================
+    instructionSet findBestInstructionSet()
+    {
+       #if MFX_X86
+        return cpuHasAvx2() ? avx2Instructions : sse2Instructions;
+       #elif MFX_NEON
+        return neonInstructions;
+       #else
+        return scalarInstructions;
+       #endif
+    }
+
+    instructionSet activeInstructionSet = findBestInstructionSet();
+}
+
+//==============================================================================
+float Waveshaper::padeTanhSample (float x)
+{
+    return padeTanhValue (x);
+}
+
+float Waveshaper::polynomialTanhSample (float x)
+{
+    return polynomialTanhValue (x);
+}
+
+double Waveshaper::padeTanhSample (double x)
+{
+    return padeTanhValue (x);
+}
+
+double Waveshaper::polynomialTanhSample (double x)
+{
+    return polynomialTanhValue (x);
+}
+
+float Waveshaper::hardClip (float* data, int numSamples, double drive)
+{
+    switch (activeInstructionSet)
+    {
+       #if MFX_X86
+        case avx2Instructions:  return hardClipAvx2 (data, numSamples, drive);
+        case sse2Instructions:  return hardClipSse2 (data, numSamples, drive);
+       #endif
+       #if MFX_NEON
+        case neonInstructions:  return hardClipNeon (data, numSamples, drive);
+       #endif
+        default:                return hardClipScalar (data, numSamples, drive);
+    }
+}
+
+float Waveshaper::softClip (float* data, int numSamples, double drive, tanhApprox approx)
+{
+    switch (activeInstructionSet)
+    {
+       #if MFX_X86
+        case avx2Instructions:  return softClipAvx2 (data, numSamples, drive, approx);
+        case sse2Instructions:  return softClipSse2 (data, numSamples, drive, approx);
+       #endif
+       #if MFX_NEON
+        case neonInstructions:  return softClipNeon (data, numSamples, drive, approx);
+       #endif
+        default:                return softClipScalar (data, numSamples, drive, approx);
+    }
+}
+
+double Waveshaper::hardClip (double* data, int numSamples, double drive)
+{
+    switch (activeInstructionSet)
+    {
+       #if MFX_X86
+        case avx2Instructions:  return hardClipAvx2 (data, numSamples, drive);
+        case sse2Instructions:  return hardClipSse2 (data, numSamples, drive);
+       #endif
+       #if MFX_NEON
+        case neonInstructions:  return hardClipNeon (data, numSamples, drive);
+       #endif
+        default:                return hardClipScalar (data, numSamples, drive);
+    }
+}
+
+double Waveshaper::softClip (double* data, int numSamples, double drive, tanhApprox approx)
+{
+    switch (activeInstructionSet)
+    {
+       #if MFX_X86
+        case avx2Instructions:  return softClipAvx2 (data, numSamples, drive, approx);
+        case sse2Instructions:  return softClipSse2 (data, numSamples, drive, approx);
+       #endif
+       #if MFX_NEON
+        case neonInstructions:  return softClipNeon (data, numSamples, drive, approx);
+       #endif
+        default:                return softClipScalar (data, numSamples, drive, approx);
+    }
+}
+
+instructionSet Waveshaper::getInstructionSet()
+{
+    return activeInstructionSet;
+}
+
+bool Waveshaper::isSupported (instructionSet set)
+{
+    switch (set)
+    {
+        case scalarInstructions:    return true;
+       #if MFX_X86
+        case sse2Instructions:      return true;
+        case avx2Instructions:      return cpuHasAvx2();
+       #endif
+       #if MFX_NEON
+        case neonInstructions:      return true;
+       #endif
+        default:                    return false;
+    }
+}
+
+bool Waveshaper::setInstructionSet (instructionSet set)
+{
+    if (! isSupported (set))
+        return false;
+
+    activeInstructionSet = set;
+    return true;
+}
+
+const char* Waveshaper::getName (instructionSet set)
+{
+    switch (set)
+    {
+        case scalarInstructions:    return "scalar";
+        case sse2Instructions:      return "sse2";
+        case avx2Instructions:      return "avx2";
+        case neonInstructions:      return "neon";
+        default:                    return "?";
+    }
+}
+
+const char* Waveshaper::getName (tanhApprox approx)
+{
+    switch (approx)
+    {
+        case exactTanh:         return "exact";
+        case padeTanh:          return "pade";
+        case polynomialTanh:    return "polynomial";
+        default:                return "?";
+    }
+}
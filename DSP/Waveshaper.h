@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    Waveshaper.h
+    Vectorised overdrive + clipping kernels for the distortion stage, with a
+    runtime-dispatched SSE2/AVX2 build on x86 and NEON on 64-bit ARM.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// approximations used for the soft clip. Error figures are the worst absolute
+// difference from std::tanh over any input (as measured by "mfx_bench --suite waveshaper")
+enum tanhApprox
+{
+    exactTanh = 1,  // std::tanh per sample, bit-identical to the original code (scalar only)
+    padeTanh,       // [7/6] Pade approximant clamped at |x| = 4.97, error < 1e-4
+    polynomialTanh  // 9th order odd polynomial clamped at |x| = 2.5, error < 1.4e-2, monotonic
+};
+
+enum instructionSet
+{
+    scalarInstructions = 1,
+    sse2Instructions,
+    avx2Instructions,
+    neonInstructions
+};
+
+//==============================================================================
+class Waveshaper
+{
+public:
+    // multiply by drive (in double precision, like the original float *= double) then hard clip
+    // to +/-1. Works in place and returns the peak magnitude of the result
+    static float hardClip (float* data, int numSamples, double drive);
+
+    // multiply by drive then soft clip with the chosen tanh, returns the peak magnitude of the result
+    static float softClip (float* data, int numSamples, double drive, tanhApprox approx);
+
+    // the same for the double precision path, evaluated in double throughout (the approximations
+    // keep the error figures above, they just aren't rounded to float)
+    static double hardClip (double* data, int numSamples, double drive);
+    static double softClip (double* data, int numSamples, double drive, tanhApprox approx);
+
+    // all instruction sets produce bit-identical results, NaN input included (the clamps all turn
+    // it into the top of their range), so switching is only useful for benchmarking
+    static instructionSet getInstructionSet();
+    static bool isSupported (instructionSet set);
+    static bool setInstructionSet (instructionSet set);
+
+    static const char* getName (instructionSet set);
+    static const char* getName (tanhApprox approx);
+
+    // the scalar versions of the approximations, also used for the tails of the vector loops
+    static float padeTanhSample (float x);
+    static float polynomialTanhSample (float x);
+    static double padeTanhSample (double x);
+    static double polynomialTanhSample (double x);
+};
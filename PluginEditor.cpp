@@ -13,43 +13,95 @@
 FinalMultiEffectEditor::FinalMultiEffectEditor (FinalMultiEffect& p)
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
-    setSize (400, 300);
+    setSize (880, 520);
+
+    auto& valueTreeState = audioProcessor.getValueTreeState();
 
     // SLIDERS
     mModFreqSlider.setSliderStyle (juce::Slider::LinearHorizontal);
     mModFreqSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
-    mModFreqSlider.setRange (0.0, MOD_FREQ_LIMIT);
-    mModFreqSlider.setValue (audioProcessor.getModFreq());
     addAndMakeVisible (&mModFreqSlider);
-    mModFreqSlider.addListener (this);
-    
+    mModFreqAttachment = std::make_unique<SliderAttachment> (valueTreeState, MOD_FREQ_ID, mModFreqSlider);
+
     mOverdriveSlider.setSliderStyle (juce::Slider::LinearHorizontal);
     mOverdriveSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
-    mOverdriveSlider.setRange (0.0, OVERDRIVE_LIMIT);
-    mOverdriveSlider.setValue (audioProcessor.getOverdrive());
     addAndMakeVisible (&mOverdriveSlider);
-    mOverdriveSlider.addListener (this);
+    mOverdriveAttachment = std::make_unique<SliderAttachment> (valueTreeState, OVERDRIVE_ID, mOverdriveSlider);
 
     mPulserFreqSlider.setSliderStyle (juce::Slider::LinearHorizontal);
     mPulserFreqSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
-    mPulserFreqSlider.setRange (0.0, PULSER_FREQ_LIMIT);
-    mPulserFreqSlider.setValue (audioProcessor.getPulserFreq());
     addAndMakeVisible (&mPulserFreqSlider);
-    mPulserFreqSlider.addListener (this);
-    
+    mPulserFreqAttachment = std::make_unique<SliderAttachment> (valueTreeState, PULSER_FREQ_ID, mPulserFreqSlider);
+
+    mDistMixSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+    mDistMixSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
+    addAndMakeVisible (&mDistMixSlider);
+    mDistMixAttachment = std::make_unique<SliderAttachment> (valueTreeState, DIST_MIX_ID, mDistMixSlider);
+
+    mLevelAttackSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+    mLevelAttackSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
+    addAndMakeVisible (&mLevelAttackSlider);
+    mLevelAttackAttachment = std::make_unique<SliderAttachment> (valueTreeState, LEVEL_ATTACK_ID, mLevelAttackSlider);
+
+    mLevelReleaseSlider.setSliderStyle (juce::Slider::LinearHorizontal);
+    mLevelReleaseSlider.setTextBoxStyle (juce::Slider::NoTextBox, true, 0, 0);
+    addAndMakeVisible (&mLevelReleaseSlider);
+    mLevelReleaseAttachment = std::make_unique<SliderAttachment> (valueTreeState, LEVEL_RELEASE_ID, mLevelReleaseSlider);
+
     // COMBO-BOXES
+    // the items have to be in place before the attachment is made, item ID == choice index + 1
     mModTypeComboBox.addItem ("RM", rm);
     mModTypeComboBox.addItem ("AM", am);
-    mModTypeComboBox.setSelectedId (audioProcessor.getModType());
-    addAndMakeVisible(&mModTypeComboBox);
-    mModTypeComboBox.addListener(this);
+    addAndMakeVisible (&mModTypeComboBox);
+    mModTypeAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, MOD_TYPE_ID, mModTypeComboBox);
 
     mDistTypeComboBox.addItem ("Soft", soft);
     mDistTypeComboBox.addItem ("Hard", hard);
-    mDistTypeComboBox.setSelectedId (audioProcessor.getDistType());
     addAndMakeVisible (&mDistTypeComboBox);
-    mDistTypeComboBox.addListener (this);
-    
+    mDistTypeAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, DIST_TYPE_ID, mDistTypeComboBox);
+
+    for (auto* comboBox : { &mOsRealtimeComboBox, &mOsOfflineComboBox })
+    {
+        comboBox->addItemList ({ "1x", "2x", "4x", "8x" }, 1);
+        addAndMakeVisible (comboBox);
+    }
+
+    mOsRealtimeAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, OS_REALTIME_ID, mOsRealtimeComboBox);
+    mOsOfflineAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, OS_OFFLINE_ID, mOsOfflineComboBox);
+
+    mLevelDetectorComboBox.addItem ("Peak", peakLevel);
+    mLevelDetectorComboBox.addItem ("RMS", rmsLevel);
+    addAndMakeVisible (&mLevelDetectorComboBox);
+    mLevelDetectorAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, LEVEL_DETECTOR_ID, mLevelDetectorComboBox);
+
+    mLevelLinkComboBox.addItemList ({ "Per Channel", "Linked" }, 1);
+    addAndMakeVisible (&mLevelLinkComboBox);
+    mLevelLinkAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, LEVEL_LINK_ID, mLevelLinkComboBox);
+
+    mStageOrderComboBox.addItemList (FinalMultiEffect::getStageOrderNames(), 1);
+    addAndMakeVisible (&mStageOrderComboBox);
+    mStageOrderAttachment = std::make_unique<ComboBoxAttachment> (valueTreeState, STAGE_ORDER_ID, mStageOrderComboBox);
+
+    // STAGE SWITCHES
+    for (auto* button : { &mModOnButton, &mDistOnButton, &mPulserOnButton })
+        addAndMakeVisible (button);
+
+    mModOnAttachment = std::make_unique<ButtonAttachment> (valueTreeState, MOD_ON_ID, mModOnButton);
+    mDistOnAttachment = std::make_unique<ButtonAttachment> (valueTreeState, DIST_ON_ID, mDistOnButton);
+    mPulserOnAttachment = std::make_unique<ButtonAttachment> (valueTreeState, PULSER_ON_ID, mPulserOnButton);
+
+    // PROGRAMS
+    for (int program = 0; program < audioProcessor.getNumPrograms(); ++program)
+        mProgramComboBox.addItem (audioProcessor.getProgramName (program), program + 1);
+
+    mProgramComboBox.setSelectedId (audioProcessor.getCurrentProgram() + 1, juce::NotificationType::dontSendNotification);
+    mProgramComboBox.onChange = [this]
+    {
+        audioProcessor.setCurrentProgram (mProgramComboBox.getSelectedId() - 1);
+        audioProcessor.updateHostDisplay();
+    };
+    addAndMakeVisible (&mProgramComboBox);
+
     // LABELS
     mModFreqLabel.setText ("Mod Frequency", juce::NotificationType::dontSendNotification);
     mModFreqLabel.attachToComponent (&mModFreqSlider, true);
@@ -62,6 +114,10 @@ FinalMultiEffectEditor::FinalMultiEffectEditor (FinalMultiEffect& p)
     mPulserFreqLabel.setText ("Pulser Freq", juce::NotificationType::dontSendNotification);
     mPulserFreqLabel.attachToComponent (&mPulserFreqSlider, true);
     addAndMakeVisible (&mPulserFreqLabel);
+
+    mDistMixLabel.setText ("Dist Mix", juce::NotificationType::dontSendNotification);
+    mDistMixLabel.attachToComponent (&mDistMixSlider, true);
+    addAndMakeVisible (&mDistMixLabel);
     
     mModTypeLabel.setText ("Mod Type", juce::NotificationType::dontSendNotification);
     mModTypeLabel.attachToComponent (&mModTypeComboBox, true);
@@ -70,70 +126,136 @@ FinalMultiEffectEditor::FinalMultiEffectEditor (FinalMultiEffect& p)
     mDistTypeLabel.setText ("Dist Type", juce::NotificationType::dontSendNotification);
     mDistTypeLabel.attachToComponent (&mDistTypeComboBox, true);
     addAndMakeVisible (&mDistTypeLabel);
+
+    mOsRealtimeLabel.setText ("OS Live", juce::NotificationType::dontSendNotification);
+    mOsRealtimeLabel.attachToComponent (&mOsRealtimeComboBox, true);
+    addAndMakeVisible (&mOsRealtimeLabel);
+
+    mOsOfflineLabel.setText ("OS Render", juce::NotificationType::dontSendNotification);
+    mOsOfflineLabel.attachToComponent (&mOsOfflineComboBox, true);
+    addAndMakeVisible (&mOsOfflineLabel);
+
+    mLevelDetectorLabel.setText ("Level", juce::NotificationType::dontSendNotification);
+    mLevelDetectorLabel.attachToComponent (&mLevelDetectorComboBox, true);
+    addAndMakeVisible (&mLevelDetectorLabel);
+
+    mLevelLinkLabel.setText ("Level Link", juce::NotificationType::dontSendNotification);
+    mLevelLinkLabel.attachToComponent (&mLevelLinkComboBox, true);
+    addAndMakeVisible (&mLevelLinkLabel);
+
+    mLevelAttackLabel.setText ("Attack", juce::NotificationType::dontSendNotification);
+    mLevelAttackLabel.attachToComponent (&mLevelAttackSlider, true);
+    addAndMakeVisible (&mLevelAttackLabel);
+
+    mLevelReleaseLabel.setText ("Release", juce::NotificationType::dontSendNotification);
+    mLevelReleaseLabel.attachToComponent (&mLevelReleaseSlider, true);
+    addAndMakeVisible (&mLevelReleaseLabel);
+
+    // CPU
+    mCpuLabel.setFont (juce::Font (juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    mCpuLabel.setJustificationType (juce::Justification::topLeft);
+    addAndMakeVisible (&mCpuLabel);
+
+    mCopyCpuTextButton.onClick = [this] { juce::SystemClipboard::copyTextToClipboard (audioProcessor.updateCpuStats().toText()); };
+    mCopyCpuJsonButton.onClick = [this] { juce::SystemClipboard::copyTextToClipboard (audioProcessor.updateCpuStats().toJson()); };
+    mResetCpuButton.onClick = [this] { audioProcessor.resetCpuStats(); };
+
+    for (auto* button : { &mCopyCpuTextButton, &mCopyCpuJsonButton, &mResetCpuButton })
+        addAndMakeVisible (button);
+
+    // DISPLAYS
+    for (auto* display : std::initializer_list<juce::Component*> { &mInputMeter, &mOutputMeter, &mScope, &mSpectrum })
+        addAndMakeVisible (display);
+
+    mMakeUpGainLabel.setJustificationType (juce::Justification::centredLeft);
+    addAndMakeVisible (&mMakeUpGainLabel);
+
+    // the audio thread is only timed and tapped while there's somebody to look at the figures
+    audioProcessor.setCpuMetering (true);
+    audioProcessor.getSignalTap().setEnabled (true);
+    startTimerHz (DISPLAY_FRAME_RATE);
 }
 
 FinalMultiEffectEditor::~FinalMultiEffectEditor()
 {
-    mModFreqSlider.removeListener (this);
-    mOverdriveSlider.removeListener (this);
-    mPulserFreqSlider.removeListener (this);
-    mModTypeComboBox.removeListener (this);
-    mModFreqSlider.removeListener (this);
+    stopTimer();
+    audioProcessor.setCpuMetering (false);
+    audioProcessor.getSignalTap().setEnabled (false);
 }
 
-void FinalMultiEffectEditor::sliderValueChanged (juce::Slider* slider)
+void FinalMultiEffectEditor::timerCallback()
 {
-    if (slider == &mModFreqSlider)
+    // a hidden editor (another tab, a minimised window) leaves the tap's queues to fill up and drop
+    // rather than spend message thread time on displays nobody sees
+    if (! isShowing())
+        return;
+
+    // the host can change program too
+    mProgramComboBox.setSelectedId (audioProcessor.getCurrentProgram() + 1, juce::NotificationType::dontSendNotification);
+
+    const double sampleRate = audioProcessor.getSampleRate() > 0.0 ? audioProcessor.getSampleRate() : 44100.0;
+
+    if (sampleRate != mAnalyserSampleRate)
     {
-        audioProcessor.setModFreq(mModFreqSlider.getValue());
-        //= mModFreqSlider.getValue();
+        mSignalAnalyser.prepare (sampleRate);
+        mAnalyserSampleRate = sampleRate;
     }
-    else if (slider == &mOverdriveSlider)
+
+    // nothing is redrawn while no audio is coming through
+    if (mSignalAnalyser.takeFrom (audioProcessor.getSignalTap()) > 0)
     {
-        audioProcessor.setOverdrive (mOverdriveSlider.getValue());
+        mInputMeter.update (mSignalAnalyser);
+        mOutputMeter.update (mSignalAnalyser);
+        mScope.update (mSignalAnalyser);
+        mSpectrum.update (mSignalAnalyser, sampleRate);
+        updateMakeUpGainText();
     }
-    else if (slider == &mPulserFreqSlider)
+
+    if (++mFrameCount % (DISPLAY_FRAME_RATE / 4) != 0)
+        return;
+
+    if (! CpuMeter::isCompiledIn)
     {
-        audioProcessor.setPulserFreq (mPulserFreqSlider.getValue());
+        mCpuLabel.setText ("CPU timing was left out of this build (MFX_INSTRUMENTATION=0)", juce::NotificationType::dontSendNotification);
+        return;
     }
+
+    juce::String text (audioProcessor.updateCpuStats().toText());
+    const auto tier = audioProcessor.getQualityTier();
+
+    // on the first line, there's no room for another one
+    if (tier != fullQuality)
+        text = text.replaceFirstOccurrenceOf ("\n", juce::String (", quality down to ") + QualityGovernor::getTierName (tier) + "\n");
+
+    mCpuLabel.setText (text, juce::NotificationType::dontSendNotification);
 }
 
-void FinalMultiEffectEditor::comboBoxChanged (juce::ComboBox* comboBox)
+void FinalMultiEffectEditor::updateMakeUpGainText()
 {
-    if (comboBox == &mModTypeComboBox)
+    // one figure per channel for mono and stereo, the range of them for anything bigger
+    const int numChannels = mSignalAnalyser.getNumChannels();
+    juce::String text ("Make-up gain");
+
+    if (numChannels <= 2)
     {
-        switch (comboBox->getSelectedId())
-        {
-            case rm:
-                audioProcessor.setModType (rm);
-                break;
-            case am:
-                audioProcessor.setModType (am);
-                break;
-
-            // in case the ComboBox is set to something unknown, default to RM
-            default:
-                audioProcessor.setModType (rm);
-                break;
-        }
+        for (int channel = 0; channel < numChannels; ++channel)
+            text << (channel == 0 ? " " : " / ") << juce::String (mSignalAnalyser.getMakeUpGain (channel), 1) << " dB";
     }
-    else if (comboBox == &mDistTypeComboBox)
+    else
     {
-        switch (comboBox->getSelectedId())
+        float lowest = mSignalAnalyser.getMakeUpGain (0);
+        float highest = lowest;
+
+        for (int channel = 1; channel < numChannels; ++channel)
         {
-            case soft:
-                audioProcessor.setDistType (soft);
-                break;
-            case hard:
-                audioProcessor.setDistType (hard);
-                break;
-                
-            // in case the ComboBox is set to something unknown, default to hard clipping
-            default:
-                audioProcessor.setDistType (hard);
-                break;
+            lowest = juce::jmin (lowest, mSignalAnalyser.getMakeUpGain (channel));
+            highest = juce::jmax (highest, mSignalAnalyser.getMakeUpGain (channel));
         }
+
+        text << " " << juce::String (lowest, 1) << " to " << juce::String (highest, 1) << " dB";
     }
+
+    mMakeUpGainLabel.setText (text, juce::NotificationType::dontSendNotification);
 }
 
 //==============================================================================
@@ -154,14 +276,60 @@ void FinalMultiEffectEditor::resized()
     int sliderHeight = 50;
     int comboWidth = 100;
     int comboHeight = 40;
-    // make the horizontal and vertical starting points 100 pixels back than the halfway point of the window
-    float xMargin = getWidth() / 2.0f - 100;
-    float yMargin = getHeight() / 2.0f - 100;
+    // make the horizontal starting point 100 pixels back than the halfway point of the window, and the vertical one 150
+    // the displays take a column on the right and the CPU figures a strip along the bottom, the
+    // controls are centred in the rest
+    int displayWidth = 320;
+    int cpuHeight = 120;
+    float xMargin = (getWidth() - displayWidth) / 2.0f - 100;
+    float yMargin = (getHeight() - cpuHeight) / 2.0f - 150;
 
     mModFreqSlider.setBounds (xMargin, yMargin, sliderWidth, sliderHeight);
     mOverdriveSlider.setBounds (xMargin, yMargin + spacing, sliderWidth, sliderHeight);
     mPulserFreqSlider.setBounds (xMargin, yMargin + spacing * 2, sliderWidth, sliderHeight);
+    mDistMixSlider.setBounds (xMargin, yMargin + spacing * 3, sliderWidth, sliderHeight);
+
+    // each stage's switch sits right of the slider that drives it
+    mModOnButton.setBounds (xMargin + sliderWidth + 10, yMargin + 13, 60, 24);
+    mDistOnButton.setBounds (xMargin + sliderWidth + 10, yMargin + spacing + 13, 60, 24);
+    mPulserOnButton.setBounds (xMargin + sliderWidth + 10, yMargin + spacing * 2 + 13, 60, 24);
     
     mDistTypeComboBox.setBounds (xMargin, yMargin + spacing * 6, comboWidth, comboHeight);
     mModTypeComboBox.setBounds (xMargin, yMargin + spacing * 4, comboWidth, comboHeight);
+    mOsRealtimeComboBox.setBounds (xMargin, yMargin + spacing * 8, comboWidth, comboHeight);
+    mOsOfflineComboBox.setBounds (xMargin, yMargin + spacing * 10, comboWidth, comboHeight);
+
+    // the make-up gain's level controls go in a second column, right of the combo boxes
+    float xRightColumn = xMargin + 200;
+
+    mLevelDetectorComboBox.setBounds (xRightColumn, yMargin + spacing * 4, comboWidth, comboHeight);
+    mLevelLinkComboBox.setBounds (xRightColumn, yMargin + spacing * 6, comboWidth, comboHeight);
+    mLevelAttackSlider.setBounds (xRightColumn, yMargin + spacing * 8, comboWidth, sliderHeight);
+    mLevelReleaseSlider.setBounds (xRightColumn, yMargin + spacing * 10, comboWidth, sliderHeight);
+
+    auto bounds = getLocalBounds();
+    mProgramComboBox.setBounds (10, 10, 160, 24);
+    mStageOrderComboBox.setBounds (180, 10, 160, 24);
+
+    auto displayArea = bounds.removeFromRight (displayWidth).reduced (10);
+    auto meterRow = displayArea.removeFromTop (120);
+
+    mInputMeter.setBounds (meterRow.removeFromLeft (60));
+    meterRow.removeFromLeft (10);
+    mOutputMeter.setBounds (meterRow.removeFromLeft (60));
+    meterRow.removeFromLeft (10);
+    mMakeUpGainLabel.setBounds (meterRow);
+
+    displayArea.removeFromTop (10);
+    mScope.setBounds (displayArea.removeFromTop ((displayArea.getHeight() - 10) / 2));
+    displayArea.removeFromTop (10);
+    mSpectrum.setBounds (displayArea);
+
+    auto cpuArea = bounds.removeFromBottom (cpuHeight).reduced (10, 5);
+    auto buttonColumn = cpuArea.removeFromRight (120);
+
+    for (auto* button : { &mCopyCpuTextButton, &mCopyCpuJsonButton, &mResetCpuButton })
+        button->setBounds (buttonColumn.removeFromTop (30).reduced (0, 2));
+
+    mCpuLabel.setBounds (cpuArea);
 }
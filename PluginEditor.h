@@ -10,11 +10,16 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SignalDisplays.h"
+
+// the meters, scope and spectrum are redrawn at most this many times a second, the CPU figures 4 times
+#define DISPLAY_FRAME_RATE 30
 
 //==============================================================================
 /**
 */
-class FinalMultiEffectEditor  : public juce::AudioProcessorEditor, public juce::Slider::Listener, public juce::ComboBox::Listener
+class FinalMultiEffectEditor  : public juce::AudioProcessorEditor,
+                                private juce::Timer
 {
 public:
     FinalMultiEffectEditor (FinalMultiEffect&);
@@ -25,23 +30,87 @@ public:
     void resized() override;
 
 private:
+    // picks up the signal for the displays every frame and the CPU figures every few
+    void timerCallback() override;
+    void updateMakeUpGainText();
+
     FinalMultiEffect& audioProcessor;
 
     juce::Slider mModFreqSlider;
     juce::Slider mOverdriveSlider;
     juce::Slider mPulserFreqSlider;
+    juce::Slider mDistMixSlider;
+    juce::Slider mLevelAttackSlider;
+    juce::Slider mLevelReleaseSlider;
     
     juce::ComboBox mModTypeComboBox;
     juce::ComboBox mDistTypeComboBox;
+    juce::ComboBox mOsRealtimeComboBox;
+    juce::ComboBox mOsOfflineComboBox;
+    juce::ComboBox mLevelDetectorComboBox;
+    juce::ComboBox mLevelLinkComboBox;
+
+    // the built-in programs, kept showing whichever one the host or the editor loaded last
+    juce::ComboBox mProgramComboBox;
+
+    // which of the stages are on, and the order they run in
+    juce::ToggleButton mModOnButton { "On" };
+    juce::ToggleButton mDistOnButton { "On" };
+    juce::ToggleButton mPulserOnButton { "On" };
+    juce::ComboBox mStageOrderComboBox;
 
     juce::Label mModFreqLabel;
     juce::Label mOverdriveLabel;
     juce::Label mPulserFreqLabel;
+    juce::Label mDistMixLabel;
     juce::Label mModTypeLabel;
     juce::Label mDistTypeLabel;
+    juce::Label mOsRealtimeLabel;
+    juce::Label mOsOfflineLabel;
+    juce::Label mLevelAttackLabel;
+    juce::Label mLevelReleaseLabel;
+    juce::Label mLevelDetectorLabel;
+    juce::Label mLevelLinkLabel;
+
+    // what the signal is doing, read from the processor's SignalTap
+    SignalAnalyser mSignalAnalyser;
+    double mAnalyserSampleRate = 0.0;
+    int mFrameCount = 0;
+
+    LevelMeterDisplay mInputMeter { false };
+    LevelMeterDisplay mOutputMeter { true };
+    OscilloscopeDisplay mScope;
+    SpectrumDisplay mSpectrum;
+    juce::Label mMakeUpGainLabel;
+
+    // the CPU load of the audio thread, and the buttons that put a snapshot of it on the clipboard
+    juce::Label mCpuLabel;
+    juce::TextButton mCopyCpuTextButton { "Copy CPU Text" };
+    juce::TextButton mCopyCpuJsonButton { "Copy CPU JSON" };
+    juce::TextButton mResetCpuButton { "Reset CPU" };
+
+    // the attachments keep the controls and the parameters in sync in both directions (including
+    // host automation). They're declared after the controls so they get destroyed first
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+    using ButtonAttachment = juce::AudioProcessorValueTreeState::ButtonAttachment;
 
-    void sliderValueChanged (juce::Slider* slider) override;
-    void comboBoxChanged (juce::ComboBox* comboBox) override;
+    std::unique_ptr<SliderAttachment> mModFreqAttachment;
+    std::unique_ptr<SliderAttachment> mOverdriveAttachment;
+    std::unique_ptr<SliderAttachment> mPulserFreqAttachment;
+    std::unique_ptr<SliderAttachment> mDistMixAttachment;
+    std::unique_ptr<SliderAttachment> mLevelAttackAttachment;
+    std::unique_ptr<SliderAttachment> mLevelReleaseAttachment;
+    std::unique_ptr<ComboBoxAttachment> mModTypeAttachment;
+    std::unique_ptr<ComboBoxAttachment> mDistTypeAttachment;
+    std::unique_ptr<ComboBoxAttachment> mOsRealtimeAttachment;
+    std::unique_ptr<ComboBoxAttachment> mOsOfflineAttachment;
+    std::unique_ptr<ComboBoxAttachment> mLevelDetectorAttachment;
+    std::unique_ptr<ComboBoxAttachment> mLevelLinkAttachment;
+    std::unique_ptr<ButtonAttachment> mModOnAttachment;
+    std::unique_ptr<ButtonAttachment> mDistOnAttachment;
+    std::unique_ptr<ButtonAttachment> mPulserOnAttachment;
+    std::unique_ptr<ComboBoxAttachment> mStageOrderAttachment;
 
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -9,6 +9,13 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // the instances in this process, which share the callback's time out between them as far as
+    // the quality governors are concerned
+    std::atomic<int> numInstances { 0 };
+}
+
 //==============================================================================
 FinalMultiEffect::FinalMultiEffect()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -19,254 +26,174 @@ FinalMultiEffect::FinalMultiEffect()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       )
+                       ),
+#else
+     :
 #endif
+       mValueTreeState (*this, nullptr, "PARAMETERS", createParameterLayout())
 {
     DBG ("Processor constructor called");
 
-    mModFreqSliderValue = MOD_FREQ_INIT;
-    mOverdriveSliderValue = OVERDRIVE_INIT;
-    mPulserFreqSliderValue = PULSER_FREQ_INIT;
-
-    mModAngleDelta = 0.0;
-    mModCurrentAngle[0] = 0.0;
-    mModCurrentAngle[1] = 0.0;
+    ++numInstances;
 
-    mPulserAngleDelta = 0.0;
-    mPulserCurrentAngle[0] = 0.0;
-    mPulserCurrentAngle[1] = 0.0;
+    for (auto* id : { MOD_FREQ_ID, OVERDRIVE_ID, PULSER_FREQ_ID, MOD_TYPE_ID, DIST_TYPE_ID, DIST_MIX_ID, OS_REALTIME_ID, OS_OFFLINE_ID,
+                      LEVEL_ATTACK_ID, LEVEL_RELEASE_ID, LEVEL_DETECTOR_ID, LEVEL_LINK_ID,
+                      MOD_ON_ID, DIST_ON_ID, PULSER_ON_ID, STAGE_ORDER_ID })
+    {
+        mValueTreeState.addParameterListener (id, this);
 
-    mAmFlag = false;
-    mSoftClipFlag = false;
+        // the listener only hears about changes, so push the initial values across once
+        parameterChanged (id, mValueTreeState.getRawParameterValue (id)->load());
+    }
 }
 
 FinalMultiEffect::~FinalMultiEffect()
 {
+    cancelPendingUpdate();
+    --numInstances;
+
+    for (auto* id : { MOD_FREQ_ID, OVERDRIVE_ID, PULSER_FREQ_ID, MOD_TYPE_ID, DIST_TYPE_ID, DIST_MIX_ID, OS_REALTIME_ID, OS_OFFLINE_ID,
+                      LEVEL_ATTACK_ID, LEVEL_RELEASE_ID, LEVEL_DETECTOR_ID, LEVEL_LINK_ID,
+                      MOD_ON_ID, DIST_ON_ID, PULSER_ON_ID, STAGE_ORDER_ID })
+        mValueTreeState.removeParameterListener (id, this);
 }
 
 
-//======== GET/SET FUNCTIONS =====================================================
-modType FinalMultiEffect::getModType()
+//======== PARAMETERS =====================================================
+juce::AudioProcessorValueTreeState::ParameterLayout FinalMultiEffect::createParameterLayout()
 {
-    if (mAmFlag)
-        return am;
-    else
-        return rm;
-}
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
 
-void FinalMultiEffect::setModType (modType type)
-{
-    switch (type)
-    {
-        case rm:
-            mAmFlag = false;
-            break;
-        
-        case am:
-            mAmFlag = true;
-            break;
-        
-        // if an unexpected value comes in for "type" argument, default to RM
-        default:
-            mAmFlag = false;
-            break;
-    }
-    
-    if (mAmFlag)
-        DBG ("mAmFlag: ON");
-    else
-        DBG ("mAmFlag: OFF");
+    layout.add (std::make_unique<juce::AudioParameterFloat> (MOD_FREQ_ID, "Mod Frequency", juce::NormalisableRange<float> (0.0f, MOD_FREQ_LIMIT), MOD_FREQ_INIT));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (OVERDRIVE_ID, "Overdrive", juce::NormalisableRange<float> (1.0f, OVERDRIVE_LIMIT), OVERDRIVE_INIT));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (PULSER_FREQ_ID, "Pulser Freq", juce::NormalisableRange<float> (0.0f, PULSER_FREQ_LIMIT), PULSER_FREQ_INIT));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (DIST_MIX_ID, "Dist Mix", juce::NormalisableRange<float> (0.0f, 1.0f), DIST_MIX_INIT));
 
-}
+    // the level follower times are in ms, skewed so the short times get most of the travel
+    layout.add (std::make_unique<juce::AudioParameterFloat> (LEVEL_ATTACK_ID, "Level Attack", juce::NormalisableRange<float> (0.1f, LEVEL_ATTACK_LIMIT, 0.0f, 0.3f), LEVEL_ATTACK_INIT));
+    layout.add (std::make_unique<juce::AudioParameterFloat> (LEVEL_RELEASE_ID, "Level Release", juce::NormalisableRange<float> (0.1f, LEVEL_RELEASE_LIMIT, 0.0f, 0.3f), LEVEL_RELEASE_INIT));
 
-distType FinalMultiEffect::getDistType()
-{
-    if (mSoftClipFlag)
-        return soft;
-    else
-        return hard;
-}
+    // choice index + 1 == enum value, which is also what the editor uses as the combo box item ID
+    layout.add (std::make_unique<juce::AudioParameterChoice> (MOD_TYPE_ID, "Mod Type", juce::StringArray { "RM", "AM" }, rm - 1));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (DIST_TYPE_ID, "Dist Type", juce::StringArray { "Soft", "Hard" }, hard - 1));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (LEVEL_DETECTOR_ID, "Level Detector", juce::StringArray { "Peak", "RMS" }, peakLevel - 1));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (LEVEL_LINK_ID, "Level Link", juce::StringArray { "Per Channel", "Linked" }, 0));
 
-void FinalMultiEffect::setDistType (distType type)
-{
-    switch (type)
-    {
-        case soft:
-            mSoftClipFlag = true;
-            break;
-        
-        case hard:
-            mSoftClipFlag = false;
-            break;
-        
-        // if an unexpected value comes in for "type" argument, default to hard clipping
-        default:
-            mSoftClipFlag = false;
-            break;
-    }
-    
-    if (mSoftClipFlag)
-        DBG ("mSoftClipFlag: ON");
-    else
-        DBG ("mSoftClipFlag: OFF");
-}
+    // choice index i is 2^i times oversampling. Live playback defaults to none, offline bounces
+    // can afford the 4x linear-phase filters
+    const juce::StringArray factors { "1x", "2x", "4x", "8x" };
+    layout.add (std::make_unique<juce::AudioParameterChoice> (OS_REALTIME_ID, "Oversampling Live", factors, 0));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (OS_OFFLINE_ID, "Oversampling Render", factors, 2));
 
-double FinalMultiEffect::getModFreq()
-{
-    return mModFreqSliderValue;
-}
+    // switching a stage off fades it out, changing the order cuts straight over to the new one
+    layout.add (std::make_unique<juce::AudioParameterBool> (MOD_ON_ID, "Mod On", true));
+    layout.add (std::make_unique<juce::AudioParameterBool> (DIST_ON_ID, "Dist On", true));
+    layout.add (std::make_unique<juce::AudioParameterBool> (PULSER_ON_ID, "Pulser On", true));
+    layout.add (std::make_unique<juce::AudioParameterChoice> (STAGE_ORDER_ID, "Stage Order", getStageOrderNames(), 0));
 
-void FinalMultiEffect::setModFreq (double freq)
-{
-    // limit the modulation frequency to 0 - MOD_FREQ_LIMIT kHz
-    freq = (freq < 0.0) ? 0.0 : freq;
-    freq = (freq > MOD_FREQ_LIMIT) ? MOD_FREQ_LIMIT : freq;
-    
-    mModFreqSliderValue = freq;
-    
-    auto cyclesPerSample = mModFreqSliderValue / mSampleRate;
-    
-    mModAngleDelta = cyclesPerSample * juce::MathConstants<double>::twoPi;
-    
-    DBG ("mModFreqSliderValue: " + juce::String (mModFreqSliderValue) + ", mModAngleDelta: " + juce::String (mModAngleDelta));
+    return layout;
 }
 
-double FinalMultiEffect::getOverdrive()
+juce::StringArray FinalMultiEffect::getStageOrderNames()
 {
-    return mOverdriveSliderValue;
-}
+    juce::StringArray names;
 
-void FinalMultiEffect::setOverdrive (double value)
-{
-    // limit the overdrive gain factor to 1 - OVERDRIVE_LIMIT
-    value = (value <= 1.0) ? 1.0 : value;
-    value = (value > OVERDRIVE_LIMIT) ? OVERDRIVE_LIMIT : value;
-    
-    mOverdriveSliderValue = value;
-    DBG ("mOverdriveSliderValue: " + juce::String (mOverdriveSliderValue));
-}
+    for (int index = 0; index < StageOrder::getNumOrders(); ++index)
+    {
+        juce::StringArray stageNames;
 
-double FinalMultiEffect::getPulserFreq()
-{
-    return mPulserFreqSliderValue;
-}
+        for (auto stage : StageOrder::fromIndex (index).stages)
+            stageNames.add (StageOrder::getStageName (stage));
 
-void FinalMultiEffect::setPulserFreq (double freq)
-{
-    // limit the pulser frequency to 0 - PULSER_FREQ_LIMIT Hz
-    freq = (freq < 0.0) ? 0.0 : freq;
-    freq = (freq > PULSER_FREQ_LIMIT) ? PULSER_FREQ_LIMIT : freq;
-    
-    mPulserFreqSliderValue = freq;
-    
-    auto cyclesPerSample = mPulserFreqSliderValue / mSampleRate;
-    
-    mPulserAngleDelta = cyclesPerSample * juce::MathConstants<double>::twoPi;
-    
-    DBG ("mPulserFreqSliderValue: " + juce::String (mPulserFreqSliderValue) + ", mPulserAngleDelta: " + juce::String (mPulserAngleDelta));
-}
+        names.add (stageNames.joinIntoString (" > "));
+    }
 
-//======== CUSTOM MEMBER FUNCTIONS =====================================================
-double FinalMultiEffect::getLfoSample (double angle)
-{
-    double sample = std::sin (angle);
-    return sample;
-    
+    return names;
 }
 
-void FinalMultiEffect::advancedLfoPhase (double* angle, double delta)
+void FinalMultiEffect::parameterChanged (const juce::String& parameterID, float newValue)
 {
-    *angle += delta;
-    *angle = std::fmod(*angle, juce::MathConstants<double>::twoPi);
+    // no allocation or locking in here, it can be called from the audio thread during automation
+    if (parameterID == MOD_FREQ_ID)
+        mCore.setModFreq (newValue);
+    else if (parameterID == OVERDRIVE_ID)
+        mCore.setOverdrive (newValue);
+    else if (parameterID == PULSER_FREQ_ID)
+        mCore.setPulserFreq (newValue);
+    else if (parameterID == MOD_TYPE_ID)
+        mCore.setModType ((modType) (juce::roundToInt (newValue) + 1));
+    else if (parameterID == DIST_TYPE_ID)
+        mCore.setDistType ((distType) (juce::roundToInt (newValue) + 1));
+    else if (parameterID == DIST_MIX_ID)
+        mCore.setDistMix (newValue);
+    else if (parameterID == LEVEL_ATTACK_ID)
+        mCore.setLevelAttack (newValue);
+    else if (parameterID == LEVEL_RELEASE_ID)
+        mCore.setLevelRelease (newValue);
+    else if (parameterID == LEVEL_DETECTOR_ID)
+        mCore.setLevelDetector ((levelDetector) (juce::roundToInt (newValue) + 1));
+    else if (parameterID == LEVEL_LINK_ID)
+        mCore.setLevelLink (juce::roundToInt (newValue) != 0);
+    else if (parameterID == MOD_ON_ID)
+        mCore.setModEnabled (newValue >= 0.5f);
+    else if (parameterID == DIST_ON_ID)
+        mCore.setDistEnabled (newValue >= 0.5f);
+    else if (parameterID == PULSER_ON_ID)
+        mCore.setPulserEnabled (newValue >= 0.5f);
+    else if (parameterID == OS_REALTIME_ID || parameterID == OS_OFFLINE_ID || parameterID == STAGE_ORDER_ID)
+        triggerAsyncUpdate();
 }
 
-double FinalMultiEffect::reRangeLfoSample (double sample)
+int FinalMultiEffect::getWantedPulserControlInterval() const
 {
-    sample += 1.0;
-    sample *= 0.5;
-
-    return sample;
+    // the control rate is inaudible, but a bounce may as well work the pulser out every sample
+    return isNonRealtime() ? 1 : PULSER_CONTROL_INTERVAL;
 }
 
-void FinalMultiEffect::doModulation (juce::AudioBuffer<float>& buffer, int channel)
-{    
-    auto* channelData = buffer.getWritePointer (channel);
-    
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-        if (mModFreqSliderValue > 0.0)
-        {
-            auto lfoSample = getLfoSample (mModCurrentAngle[channel]);
-
-            advancedLfoPhase (&mModCurrentAngle[channel], mModAngleDelta);
-
-            if (mAmFlag)
-                lfoSample = reRangeLfoSample (lfoSample);
+int FinalMultiEffect::getWantedOversamplingFactor() const
+{
+    auto* choice = mValueTreeState.getRawParameterValue (isNonRealtime() ? OS_OFFLINE_ID : OS_REALTIME_ID);
 
-            channelData[sample] *= lfoSample;
-        }
-    }
+    return 1 << juce::jlimit (0, 3, juce::roundToInt (choice->load()));
 }
 
-void FinalMultiEffect::doDistortion (juce::AudioBuffer<float>& buffer, int channel, float inputPeak)
+void FinalMultiEffect::prepareCore (double sampleRate)
 {
-    auto* channelData = buffer.getWritePointer (channel);
-    float postDistPeak = buffer.getMagnitude(channel, 0, buffer.getNumSamples());
+    // the IIR filters keep the latency down to a few samples while playing live, offline there's
+    // no reason not to use the linear-phase ones
+    mCore.setOversampling (getWantedOversamplingFactor(), isNonRealtime() ? firOversampling : iirOversampling);
 
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-        if (mOverdriveSliderValue > 1.0)
-        {
-            // step 1: overdrive
-            channelData[sample] *= mOverdriveSliderValue;
-            
-            // step 2: limit the signal
-            if (mSoftClipFlag)
-            {
-                // do soft clipping
-                channelData[sample] = std::tanh (channelData[sample]);
-            }
-            else
-            {
-                // do hard clipping
-                if (channelData[sample] > 1.0)
-                    channelData[sample] = 1.0;
-                else if (channelData[sample] < -1.0)
-                    channelData[sample] = -1.0;
-            }
-        }
-    }
-    
-    postDistPeak = buffer.getMagnitude (channel, 0, buffer.getNumSamples());
+    mCore.setPulserControlInterval (getWantedPulserControlInterval());
 
-    // protect against division by zero when there's silence input
-    if (postDistPeak == 0.0)
-        postDistPeak = 1.0;
-    
-    // set the SmoothedValue target to be the ratio of the pre/post peak samples so that the output of the distortion is at the same level as the original signal
-    mDistGainFactor.setTargetValue (inputPeak / postDistPeak);
-    
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        channelData[sample] *= mDistGainFactor.getNextValue();
+    // live, the quality steps down rather than letting the callback overrun. A bounce has all the
+    // time it needs, so it always gets full quality (and prepare() leaves out the lighter oversamplers)
+    mCore.setAdaptiveQuality (! isNonRealtime());
+    mCore.prepare (sampleRate, juce::jmax (getTotalNumInputChannels(), getTotalNumOutputChannels()));
+
+    setLatencySamples (mCore.getLatencySamples());
 }
 
-void FinalMultiEffect::doPulsing (juce::AudioBuffer<float>& buffer, int channel)
+void FinalMultiEffect::handleAsyncUpdate()
 {
-    auto* channelData = buffer.getWritePointer (channel);
+    // setting the order is cheap now the orders are compiled up front, but only one thread may set it
+    const auto order = StageOrder::fromIndex (juce::roundToInt (mValueTreeState.getRawParameterValue (STAGE_ORDER_ID)->load()));
 
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-        if (mPulserFreqSliderValue > 0.0)
-        {
-            auto lfoSample = getLfoSample (mPulserCurrentAngle[channel]);
+    if (order != mCore.getStageOrder())
+        mCore.setStageOrder (order);
 
-            advancedLfoPhase (&mPulserCurrentAngle[channel], mPulserAngleDelta);
+    const auto filter = isNonRealtime() ? firOversampling : iirOversampling;
 
-            lfoSample = reRangeLfoSample (lfoSample);
+    // nothing to do until the host has prepared us, or if the setting that changed isn't the one in use
+    if (getSampleRate() <= 0.0
+         || (mCore.getOversamplingFactor() == getWantedOversamplingFactor() && mCore.getOversamplingFilter() == filter
+              && mCore.getPulserControlInterval() == getWantedPulserControlInterval()))
+        return;
 
-            channelData[sample] *= lfoSample;
-        }
-    }
+    // suspendProcessing() holds the callback lock, so processBlock() isn't running while the
+    // filters are reallocated
+    suspendProcessing (true);
+    prepareCore (getSampleRate());
+    suspendProcessing (false);
 }
 
 //==============================================================================
@@ -304,31 +231,37 @@ bool FinalMultiEffect::isMidiEffect() const
 
 double FinalMultiEffect::getTailLengthSeconds() const
 {
-    return 0.0;
+    // only the oversampling filters ring on once the input stops, the ramps and level followers
+    // just scale whatever is coming through
+    return mCore.getTailSamples() / mCore.getSampleRate();
 }
 
 int FinalMultiEffect::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return PresetState::getNumPrograms();
 }
 
 int FinalMultiEffect::getCurrentProgram()
 {
-    return 0;
+    // hosts don't cope with -1, and before a program has been loaded the settings are Init's
+    return juce::jmax (0, mCurrentProgram.load());
 }
 
 void FinalMultiEffect::setCurrentProgram (int index)
 {
+    if (index >= 0 && index < PresetState::getNumPrograms())
+        setState (PresetState::getProgram (index));
 }
 
 const juce::String FinalMultiEffect::getProgramName (int index)
 {
-    return {};
+    return PresetState::getProgramName (index);
 }
 
 void FinalMultiEffect::changeProgramName (int index, const juce::String& newName)
 {
+    // the programs are built in, so they keep their names
+    juce::ignoreUnused (index, newName);
 }
 
 //==============================================================================
@@ -336,16 +269,17 @@ void FinalMultiEffect::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
     DBG ("prepareToPlay() called");
 
-    mSampleRate = sampleRate;
-    
-    // set param values before playback
-    setModFreq(mModFreqSliderValue);
-    setOverdrive(mOverdriveSliderValue);
-    setPulserFreq(mPulserFreqSliderValue);
+    juce::ignoreUnused (samplesPerBlock);
 
-    // 100ms smoothing on automatic gain adjustment for distortion DSP
-    mDistGainFactor.reset (mSampleRate, 0.1);
-    mDistGainFactor.setCurrentAndTargetValue (1.0);
+    prepareCore (sampleRate);
+}
+
+void FinalMultiEffect::setNonRealtime (bool isNonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime (isNonRealtime);
+
+    // most wrappers call prepareToPlay() straight after this, which picks the new factor up anyway
+    triggerAsyncUpdate();
 }
 
 void FinalMultiEffect::releaseResources()
@@ -361,10 +295,11 @@ bool FinalMultiEffect::isBusesLayoutSupported (const BusesLayout& layouts) const
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // any layout works (surround, immersive, ambisonic...) as long as the core has room for it,
+    // every channel is processed on its own
+    const int numOutputChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numOutputChannels == 0 || numOutputChannels > MultiEffectCore::maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -379,6 +314,44 @@ bool FinalMultiEffect::isBusesLayoutSupported (const BusesLayout& layouts) const
 #endif
 
 void FinalMultiEffect::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+
+    mCore.setBypassed (false);
+    processSamples (buffer);
+}
+
+void FinalMultiEffect::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+
+    mCore.setBypassed (false);
+    processSamples (buffer);
+}
+
+void FinalMultiEffect::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+
+    mCore.setBypassed (true);
+    processSamples (buffer);
+}
+
+void FinalMultiEffect::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    juce::ignoreUnused (midiMessages);
+
+    mCore.setBypassed (true);
+    processSamples (buffer);
+}
+
+bool FinalMultiEffect::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void FinalMultiEffect::processSamples (juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -392,17 +365,30 @@ void FinalMultiEffect::processBlock (juce::AudioBuffer<float>& buffer, juce::Mid
     // this code if your algorithm always overwrites all the output channels.
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
-    
 
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    // while the host plays, the LFOs follow its timeline, so a loop or a jump lands them in the same
+    // phase every time and a bounce matches playback. Stopped, they just carry on
+    if (auto* playHead = getPlayHead())
     {
-        // get the peak amplitude of the input signal before processing so we can do automatic gain matching after the distortion DSP
-        double inputPeak = buffer.getMagnitude (channel, 0, buffer.getNumSamples());
-                
-        doModulation (buffer, channel);
-        doDistortion (buffer, channel, inputPeak);
-        doPulsing (buffer, channel);
+        const auto position = playHead->getPosition();
+
+        if (position.hasValue() && position->getIsPlaying())
+            if (const auto timeInSamples = position->getTimeInSamples())
+                if (*timeInSamples != mCore.getSamplePosition())
+                    mCore.setSamplePosition (*timeInSamples);
     }
+
+    // a host may go offline without telling us in time to re-prepare, full quality starts at this block
+    mCore.setAdaptiveQuality (! isNonRealtime());
+    mCore.getQualityGovernor().setShare (1.0 / juce::jmax (1, numInstances.load()));
+
+    mCore.process (buffer.getArrayOfWritePointers(), totalNumInputChannels, buffer.getNumSamples());
+}
+
+const CpuStats& FinalMultiEffect::updateCpuStats()
+{
+    mCpuStats.addFrom (mCore.getCpuMeter());
+    return mCpuStats;
 }
 
 //==============================================================================
@@ -419,15 +405,116 @@ juce::AudioProcessorEditor* FinalMultiEffect::createEditor()
 //==============================================================================
 void FinalMultiEffect::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    uint8_t data[PresetState::maxBinarySize];
+    destData.replaceWith (data, (size_t) getState().writeBinary (data));
 }
 
 void FinalMultiEffect::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    PresetState state;
+
+    if (sizeInBytes <= 0 || ! state.readBinary (data, (size_t) sizeInBytes))
+    {
+        const auto xml = juce::getXmlFromBinary (data, sizeInBytes);
+        const auto text = xml != nullptr ? xml->toString() : juce::String::fromUTF8 (static_cast<const char*> (data), sizeInBytes);
+
+        if (! state.readXml (text.toStdString()))
+            return;
+    }
+
+    setState (state);
+}
+
+PresetState FinalMultiEffect::getState() const
+{
+    PresetState state;
+
+    for (int field = 0; field < numPresetFields; ++field)
+        if (field != programField)
+            state.set ((presetField) field, fromParameterValue ((presetField) field,
+                                                                mValueTreeState.getRawParameterValue (PresetState::getFieldName ((presetField) field))->load()));
+
+    state.set (programField, mCurrentProgram.load());
+    return state;
+}
+
+void FinalMultiEffect::setState (const PresetState& state)
+{
+    // works out where each parameter will end up once it's been through its normalised range, so
+    // the core gets exactly what the parameters will hold, and nothing ramps a second time when the
+    // listener passes the same values on
+    PresetState rounded = state;
+    float normalisedValues[numPresetFields] = {};
+
+    for (int field = 0; field < numPresetFields; ++field)
+    {
+        if (field == programField || ! state.contains ((presetField) field))
+            continue;
+
+        auto* parameter = mValueTreeState.getParameter (PresetState::getFieldName ((presetField) field));
+
+        normalisedValues[field] = parameter->convertTo0to1 (toParameterValue ((presetField) field, state.get ((presetField) field)));
+        rounded.set ((presetField) field, fromParameterValue ((presetField) field, parameter->convertFrom0to1 (normalisedValues[field])));
+    }
+
+    // every one of the core's parameters changes on the same sample. The stage order isn't one of
+    // them, it follows once its parameter's listener has got to handleAsyncUpdate()
+    mCore.setParameters (rounded.getParameters());
+
+    for (int field = 0; field < numPresetFields; ++field)
+        if (field != programField && state.contains ((presetField) field))
+            mValueTreeState.getParameter (PresetState::getFieldName ((presetField) field))->setValueNotifyingHost (normalisedValues[field]);
+
+    if (state.contains (programField))
+        mCurrentProgram = (int) state.get (programField);
+}
+
+float FinalMultiEffect::toParameterValue (presetField field, double value)
+{
+    switch (field)
+    {
+        case modTypeField:
+        case distTypeField:
+        case levelDetectorField:
+            return (float) value - 1.0f;
+
+        case realtimeOversamplingField:
+        case offlineOversamplingField:
+            return (float) std::log2 (value);
+
+        case stageOrderField:
+            return (float) StageOrder::fromCode ((int) value).getIndex();
+
+        default:
+            return (float) value;
+    }
+}
+
+double FinalMultiEffect::fromParameterValue (presetField field, float value)
+{
+    switch (field)
+    {
+        case modTypeField:
+        case distTypeField:
+        case levelDetectorField:
+            return juce::roundToInt (value) + 1;
+
+        case levelLinkField:
+        case modEnabledField:
+        case distEnabledField:
+        case pulserEnabledField:
+            return juce::roundToInt (value) != 0 ? 1.0 : 0.0;
+
+        case realtimeOversamplingField:
+        case offlineOversamplingField:
+            return 1 << juce::jlimit (0, 3, juce::roundToInt (value));
+
+        case stageOrderField:
+            return StageOrder::fromIndex (juce::roundToInt (value)).getCode();
+
+        default:
+            return value;
+    }
 }
 
 //==============================================================================
@@ -9,34 +9,34 @@
 #pragma once
 
 #include <JuceHeader.h>
-
-#define MOD_FREQ_INIT 100.0
-#define MOD_FREQ_LIMIT 5000.0
-
-#define OVERDRIVE_INIT 1.0
-#define OVERDRIVE_LIMIT 50.0
-
-#define PULSER_FREQ_INIT 2.0
-#define PULSER_FREQ_LIMIT 10.0
-
-// declaring enums outside of class definition so that both the Editor and Processor can use them
-enum modType
-{
-    rm = 1,
-    am
-};
-
-enum distType
-{
-    soft = 1,
-    hard
-};
-
+#include "DSP/MultiEffectCore.h"
+#include "DSP/PresetState.h"
+
+// parameter IDs shared by the processor and the editor attachments, and the names the saved state
+// uses for them (see PresetState::getFieldName())
+#define MOD_FREQ_ID "modFreq"
+#define OVERDRIVE_ID "overdrive"
+#define PULSER_FREQ_ID "pulserFreq"
+#define MOD_TYPE_ID "modType"
+#define DIST_TYPE_ID "distType"
+#define DIST_MIX_ID "distMix"
+#define OS_REALTIME_ID "osRealtime"
+#define OS_OFFLINE_ID "osOffline"
+#define LEVEL_ATTACK_ID "levelAttack"
+#define LEVEL_RELEASE_ID "levelRelease"
+#define LEVEL_DETECTOR_ID "levelDetector"
+#define LEVEL_LINK_ID "levelLink"
+#define MOD_ON_ID "modOn"
+#define DIST_ON_ID "distOn"
+#define PULSER_ON_ID "pulserOn"
+#define STAGE_ORDER_ID "stageOrder"
 
 //==============================================================================
 /**
 */
-class FinalMultiEffect  : public juce::AudioProcessor
+class FinalMultiEffect  : public juce::AudioProcessor,
+                          private juce::AudioProcessorValueTreeState::Listener,
+                          private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -47,12 +47,25 @@ public:
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    // hosts switch this around offline bounces, the oversampling has its own setting for those
+    void setNonRealtime (bool isNonRealtime) noexcept override;
+
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
 
+    // hosts with a 64-bit mix bus can hand us doubles, which go through the core's double kernels
+    // rather than being converted to float and back by the wrapper
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
+
+    // hosts call these instead while the plugin is bypassed. The core crossfades to the input
+    // (delayed by the latency, which stays the same) and then stops running the chain
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -66,6 +79,8 @@ public:
     double getTailLengthSeconds() const override;
 
     //==============================================================================
+    // the built-in programs from PresetState. Changing program sets the whole snapshot on the core
+    // at once, and it glides and crossfades over to the new settings
     int getNumPrograms() override;
     int getCurrentProgram() override;
     void setCurrentProgram (int index) override;
@@ -73,51 +88,71 @@ public:
     void changeProgramName (int index, const juce::String& newName) override;
 
     //==============================================================================
+    // the state is PresetState's binary format. Loading falls back to its XML, as plain text or
+    // the way copyXmlToBinary() wraps it, and leaves everything as it was if neither can be read
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
-    
-    modType getModType();
-    void setModType (modType type);
-    
-    distType getDistType();
-    void setDistType (distType type);
-
-    double getModFreq();
-    void setModFreq (double freq);
-
-    double getOverdrive();
-    void setOverdrive (double value);
-    
-    double getPulserFreq();
-    void setPulserFreq (double freq);
-    
+
+    //==============================================================================
+    // the editor connects its controls to these through slider/combo box attachments
+    juce::AudioProcessorValueTreeState& getValueTreeState()     { return mValueTreeState; }
+
+    // the editor shows the CPU figures, and turns the timing on while it's open. updateCpuStats()
+    // adds whatever the audio thread has measured since the last call, message thread only
+    void setCpuMetering (bool shouldMeasure)                    { mCore.getCpuMeter().setEnabled (shouldMeasure); }
+    const CpuStats& updateCpuStats();
+    void resetCpuStats()                                        { mCpuStats.reset(); }
+
+    // the quality tier the last block ran at, see MultiEffectCore::setAdaptiveQuality()
+    qualityTier getQualityTier() const                          { return mCore.getQualityTier(); }
+
+    // the levels, make-up gain and waveform for the editor's meters, scope and spectrum. Only the
+    // editor's timer may read from it
+    SignalTap& getSignalTap()                                   { return mCore.getSignalTap(); }
+
+    // the stage order parameter's choices, "Mod > Dist > Pulse" and so on, in StageOrder::getIndex() order
+    static juce::StringArray getStageOrderNames();
+
 private:
 
-    double mSampleRate;
+    juce::AudioProcessorValueTreeState mValueTreeState;
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    // called on whichever thread changed the parameter (message thread for the editor, any thread
+    // for host automation). It only forwards the value to the core's wait-free parameter store
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+
+    // the oversampling factor is picked from the realtime or the offline setting, and changing it
+    // redesigns the filters and changes the latency, so it's done here with processing suspended
+    // rather than on the audio thread. The stage order is set here as well, so only the
+    // message thread ever sets it
+    void handleAsyncUpdate() override;
+    void prepareCore (double sampleRate);
+    int getWantedOversamplingFactor() const;
+    int getWantedPulserControlInterval() const;
+
+    // the parameters as a state, and setting them from one: the core gets the whole lot in one
+    // snapshot first, then the parameters are updated for the host and the editor
+    PresetState getState() const;
+    void setState (const PresetState& state);
 
-    double mModFreqSliderValue;
-    double mOverdriveSliderValue;
-    double mPulserFreqSliderValue;
+    // the choice parameters hold an index, where the state has the enum value or the oversampling factor
+    static float toParameterValue (presetField field, double value);
+    static double fromParameterValue (presetField field, float value);
 
-    double mModAngleDelta;
-    // use an array so we have a dedicated angle value for both the L and R channels
-    double mModCurrentAngle[2];
-    
-    double mPulserAngleDelta;
-    double mPulserCurrentAngle[2];
+    // both processBlock() overloads end up here
+    template <typename SampleType>
+    void processSamples (juce::AudioBuffer<SampleType>& buffer);
 
-    bool mAmFlag;
-    bool mSoftClipFlag;
-    
-    juce::SmoothedValue<double> mDistGainFactor;
+    // all of the DSP lives in the JUCE-free core so that it can also be rendered and profiled headless
+    MultiEffectCore mCore;
 
-    double getLfoSample (double angle);
-    void advancedLfoPhase (double* angle, double delta);
-    double reRangeLfoSample (double sample);
+    // collected on the message thread from the core's CpuMeter, kept while the editor is closed
+    CpuStats mCpuStats;
 
-    void doModulation (juce::AudioBuffer<float>& buffer, int channel);
-    void doDistortion (juce::AudioBuffer<float>& buffer, int channel, float peakSample);
-    void doPulsing (juce::AudioBuffer<float>& buffer, int channel);
+    // the last program loaded (by the host, the editor or the saved state), -1 for none
+    std::atomic<int> mCurrentProgram { -1 };
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FinalMultiEffect)
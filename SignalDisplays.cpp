@@ -0,0 +1,297 @@
+/*
+  ==============================================================================
+
+    SignalDisplays.cpp
+
+  ==============================================================================
+*/
+
+#include "SignalDisplays.h"
+
+namespace
+{
+    const juce::Colour backgroundColour (0xff1b1e22);
+    const juce::Colour gridColour (0xff3a3f46);
+    const juce::Colour textColour (0xff8c939c);
+    const juce::Colour signalColour (0xff5fd3a6);
+    const juce::Colour hotColour (0xffe8694a);
+
+    // a cached image has to be redrawn at the display's scale, or it comes out blurred on a high-DPI screen
+    juce::Image makeBackgroundImage (juce::Component& component)
+    {
+        const float scale = juce::Component::getApproximateScaleFactorForComponent (&component);
+        return juce::Image (juce::Image::RGB, juce::jmax (1, juce::roundToInt (component.getWidth() * scale)),
+                            juce::jmax (1, juce::roundToInt (component.getHeight() * scale)), true);
+    }
+
+    void drawCachedBackground (juce::Graphics& g, const juce::Component& component, const juce::Image& background)
+    {
+        g.drawImage (background, component.getLocalBounds().toFloat());
+    }
+}
+
+//==============================================================================
+LevelMeterDisplay::LevelMeterDisplay (bool showsOutput)
+    : mShowsOutput (showsOutput)
+{
+    setOpaque (true);
+
+    std::fill (std::begin (mLevels), std::end (mLevels), minDb);
+    std::fill (std::begin (mHolds), std::end (mHolds), minDb);
+}
+
+bool LevelMeterDisplay::update (const SignalAnalyser& analyser)
+{
+    const int numChannels = juce::jmax (1, analyser.getNumChannels());
+    bool changed = numChannels != mNumChannels;
+    mNumChannels = numChannels;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        const float level = juce::jmax (minDb, mShowsOutput ? analyser.getOutputLevel (channel) : analyser.getInputLevel (channel));
+        const float hold = juce::jmax (minDb, mShowsOutput ? analyser.getOutputPeakHold (channel) : analyser.getInputPeakHold (channel));
+
+        // nobody can see a change of less than a tenth of a dB, so it isn't worth a repaint
+        changed = changed || std::abs (level - mLevels[channel]) > 0.1f || std::abs (hold - mHolds[channel]) > 0.1f;
+        mLevels[channel] = level;
+        mHolds[channel] = hold;
+    }
+
+    if (changed)
+        repaint();
+
+    return changed;
+}
+
+float LevelMeterDisplay::dbToY (float db) const
+{
+    const float top = 14.0f;
+    const float bottom = (float) getHeight() - 2.0f;
+    return juce::jmap (juce::jlimit (minDb, 0.0f, db), minDb, 0.0f, bottom, top);
+}
+
+void LevelMeterDisplay::drawBackground()
+{
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+
+    mBackground = makeBackgroundImage (*this);
+    juce::Graphics g (mBackground);
+    g.addTransform (juce::AffineTransform::scale ((float) mBackground.getWidth() / (float) getWidth()));
+
+    g.fillAll (backgroundColour);
+    g.setColour (textColour);
+    g.setFont (11.0f);
+    g.drawText (mShowsOutput ? "Out" : "In", 0, 0, getWidth(), 12, juce::Justification::centred);
+
+    g.setColour (gridColour);
+
+    for (float db = 0.0f; db >= minDb; db -= 12.0f)
+        g.drawHorizontalLine (juce::roundToInt (dbToY (db)), 0.0f, (float) getWidth());
+}
+
+void LevelMeterDisplay::resized()
+{
+    drawBackground();
+}
+
+void LevelMeterDisplay::paint (juce::Graphics& g)
+{
+    drawCachedBackground (g, *this, mBackground);
+
+    const float barWidth = (float) getWidth() / (float) juce::jmax (1, mNumChannels);
+    const float bottom = (float) getHeight() - 2.0f;
+
+    for (int channel = 0; channel < mNumChannels; ++channel)
+    {
+        const float x = channel * barWidth + 1.0f;
+        const float y = dbToY (mLevels[channel]);
+
+        g.setColour (mLevels[channel] >= 0.0f ? hotColour : signalColour);
+        g.fillRect (x, y, barWidth - 2.0f, bottom - y);
+
+        g.setColour (mHolds[channel] >= 0.0f ? hotColour : juce::Colours::white);
+        g.fillRect (x, dbToY (mHolds[channel]), barWidth - 2.0f, 1.5f);
+    }
+}
+
+//==============================================================================
+OscilloscopeDisplay::OscilloscopeDisplay()
+    : mSamples ((size_t) numScopeSamples)
+{
+    setOpaque (true);
+}
+
+void OscilloscopeDisplay::update (const SignalAnalyser& analyser)
+{
+    analyser.getScope (mSamples.data(), numScopeSamples);
+    buildPath();
+    repaint();
+}
+
+void OscilloscopeDisplay::buildPath()
+{
+    // one vertical stroke per pixel from the lowest to the highest sample under it, so the path
+    // stays a few hundred points long whatever the number of samples
+    mPath.clear();
+
+    const int width = getWidth();
+    const float halfHeight = getHeight() * 0.5f;
+
+    for (int x = 0; x < width; ++x)
+    {
+        const int first = x * numScopeSamples / width;
+        const int last = juce::jmax (first + 1, (x + 1) * numScopeSamples / width);
+        const auto range = std::minmax_element (mSamples.begin() + first, mSamples.begin() + last);
+
+        const float top = halfHeight - juce::jlimit (-1.0f, 1.0f, *range.second) * halfHeight;
+        const float bottom = halfHeight - juce::jlimit (-1.0f, 1.0f, *range.first) * halfHeight;
+
+        if (x == 0)
+            mPath.startNewSubPath ((float) x, top);
+        else
+            mPath.lineTo ((float) x, top);
+
+        if (bottom > top + 1.0f)
+            mPath.lineTo ((float) x, bottom);
+    }
+}
+
+void OscilloscopeDisplay::drawBackground()
+{
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+
+    mBackground = makeBackgroundImage (*this);
+    juce::Graphics g (mBackground);
+    g.addTransform (juce::AffineTransform::scale ((float) mBackground.getWidth() / (float) getWidth()));
+
+    g.fillAll (backgroundColour);
+    g.setColour (gridColour);
+
+    for (int line = 1; line < 4; ++line)
+        g.drawHorizontalLine (getHeight() * line / 4, 0.0f, (float) getWidth());
+
+    for (int line = 1; line < 8; ++line)
+        g.drawVerticalLine (getWidth() * line / 8, 0.0f, (float) getHeight());
+
+    g.setColour (textColour);
+    g.setFont (11.0f);
+    g.drawText ("Scope", 4, 2, 60, 12, juce::Justification::centredLeft);
+}
+
+void OscilloscopeDisplay::resized()
+{
+    drawBackground();
+    buildPath();
+}
+
+void OscilloscopeDisplay::paint (juce::Graphics& g)
+{
+    drawCachedBackground (g, *this, mBackground);
+
+    g.setColour (signalColour);
+    g.strokePath (mPath, juce::PathStrokeType (1.0f));
+}
+
+//==============================================================================
+SpectrumDisplay::SpectrumDisplay()
+{
+    setOpaque (true);
+}
+
+float SpectrumDisplay::frequencyToX (double frequency) const
+{
+    const double maxFrequency = mSampleRate * 0.5;
+    return (float) (getWidth() * std::log (frequency / minFrequency) / std::log (maxFrequency / minFrequency));
+}
+
+void SpectrumDisplay::update (SignalAnalyser& analyser, double sampleRate)
+{
+    if (sampleRate != mSampleRate)
+    {
+        mSampleRate = sampleRate;
+        drawBackground();
+    }
+
+    const auto& spectrum = analyser.updateSpectrum();
+    const double binWidth = mSampleRate / SignalAnalyser::fftSize;
+    const float height = (float) getHeight();
+
+    // the loudest bin under each pixel, the low bins being stretched over several pixels
+    mPath.clear();
+
+    const auto getBin = [&] (int x)
+    {
+        const double frequency = minFrequency * std::pow (mSampleRate * 0.5 / minFrequency, (double) x / getWidth());
+        return juce::jlimit (1, SignalAnalyser::numBins - 1, juce::roundToInt (frequency / binWidth));
+    };
+
+    for (int x = 0; x < getWidth(); ++x)
+    {
+        const int firstBin = getBin (x);
+        const int lastBin = juce::jmax (firstBin, getBin (x + 1) - 1);
+        float loudest = SignalAnalyser::floorDb;
+
+        for (int i = firstBin; i <= lastBin; ++i)
+            loudest = juce::jmax (loudest, spectrum[(size_t) i]);
+
+        const float y = juce::jmap (juce::jlimit (minDb, 0.0f, loudest), minDb, 0.0f, height, 0.0f);
+
+        if (x == 0)
+            mPath.startNewSubPath ((float) x, y);
+        else
+            mPath.lineTo ((float) x, y);
+    }
+
+    repaint();
+}
+
+void SpectrumDisplay::drawBackground()
+{
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+
+    mBackground = makeBackgroundImage (*this);
+    juce::Graphics g (mBackground);
+    g.addTransform (juce::AffineTransform::scale ((float) mBackground.getWidth() / (float) getWidth()));
+
+    g.fillAll (backgroundColour);
+    g.setFont (10.0f);
+
+    for (double frequency : { 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0, 5000.0, 10000.0, 20000.0 })
+    {
+        if (frequency >= mSampleRate * 0.5)
+            break;
+
+        const float x = frequencyToX (frequency);
+        g.setColour (gridColour);
+        g.drawVerticalLine (juce::roundToInt (x), 0.0f, (float) getHeight());
+
+        g.setColour (textColour);
+        g.drawText (frequency >= 1000.0 ? juce::String ((int) (frequency / 1000.0)) + "k" : juce::String ((int) frequency),
+                    juce::roundToInt (x) + 2, getHeight() - 12, 30, 12, juce::Justification::centredLeft);
+    }
+
+    g.setColour (gridColour);
+
+    for (float db = -20.0f; db > minDb; db -= 20.0f)
+        g.drawHorizontalLine (juce::roundToInt (juce::jmap (db, minDb, 0.0f, (float) getHeight(), 0.0f)), 0.0f, (float) getWidth());
+
+    g.setColour (textColour);
+    g.setFont (11.0f);
+    g.drawText ("Spectrum", 4, 2, 80, 12, juce::Justification::centredLeft);
+}
+
+void SpectrumDisplay::resized()
+{
+    drawBackground();
+}
+
+void SpectrumDisplay::paint (juce::Graphics& g)
+{
+    drawCachedBackground (g, *this, mBackground);
+
+    g.setColour (signalColour);
+    g.strokePath (mPath, juce::PathStrokeType (1.0f));
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    SignalDisplays.h
+    The editor's meters, oscilloscope and spectrum. Each one draws its scale and
+    grid once into a cached image when it's resized, so a repaint only has to
+    draw that image and the signal on top of it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSP/SignalTap.h"
+
+//==============================================================================
+// one bar per channel for either the input or the output peaks, with the held peak as a line
+class LevelMeterDisplay  : public juce::Component
+{
+public:
+    LevelMeterDisplay (bool showsOutput);
+
+    // takes the levels, and returns true (after asking for a repaint) if any of them moved
+    bool update (const SignalAnalyser& analyser);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    bool mShowsOutput;
+    int mNumChannels = 0;
+    float mLevels[MeterReading::maxChannels] {};
+    float mHolds[MeterReading::maxChannels] {};
+
+    juce::Image mBackground;
+
+    static constexpr float minDb = -60.0f;
+    float dbToY (float db) const;
+    void drawBackground();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LevelMeterDisplay)
+};
+
+//==============================================================================
+// the output waveform (all channels mixed), triggered on a rising zero crossing
+class OscilloscopeDisplay  : public juce::Component
+{
+public:
+    OscilloscopeDisplay();
+
+    void update (const SignalAnalyser& analyser);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    // about 20ms at 48kHz
+    static constexpr int numScopeSamples = 1024;
+
+    std::vector<float> mSamples;
+    juce::Path mPath;
+    juce::Image mBackground;
+
+    void drawBackground();
+    void buildPath();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OscilloscopeDisplay)
+};
+
+//==============================================================================
+// the spectrum of the output on a log frequency axis, 20Hz to half the sample rate
+class SpectrumDisplay  : public juce::Component
+{
+public:
+    SpectrumDisplay();
+
+    void update (SignalAnalyser& analyser, double sampleRate);
+
+    void paint (juce::Graphics&) override;
+    void resized() override;
+
+private:
+    static constexpr float minDb = -100.0f;
+    static constexpr double minFrequency = 20.0;
+
+    double mSampleRate = 44100.0;
+    juce::Path mPath;
+    juce::Image mBackground;
+
+    float frequencyToX (double frequency) const;
+    void drawBackground();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumDisplay)
+};
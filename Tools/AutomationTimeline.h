@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    AutomationTimeline.h
+    Parameter changes at absolute sample positions, handed to
+    MultiEffectCore::process() a block at a time as sample-accurate events.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DSP/MultiEffectCore.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//==============================================================================
+class AutomationTimeline
+{
+public:
+    struct Point
+    {
+        long long samplePosition;
+        parameterId parameter;
+        double value;
+    };
+
+    // points at the same position are applied in the order they were added
+    void add (long long samplePosition, parameterId parameter, double value)
+    {
+        const auto insertPosition = std::upper_bound (mPoints.begin(), mPoints.end(), samplePosition,
+                                                      [] (long long position, const Point& point) { return position < point.samplePosition; });
+
+        mPoints.insert (insertPosition, { samplePosition, parameter, value });
+        mBlockEvents.reserve (mPoints.size());
+    }
+
+    bool isEmpty() const                        { return mPoints.empty(); }
+    const std::vector<Point>& getPoints() const { return mPoints; }
+
+    // start handing out events from the beginning again
+    void rewind()                               { mNextPoint = 0; }
+
+    // processes the next block, which starts at blockStart samples into the timeline, in float or double
+    template <typename SampleType>
+    void process (MultiEffectCore& core, SampleType* const* channelData, int numChannels, long long blockStart, int numSamples)
+    {
+        mBlockEvents.clear();
+
+        while (mNextPoint < mPoints.size() && mPoints[mNextPoint].samplePosition < blockStart + numSamples)
+        {
+            const auto& point = mPoints[mNextPoint++];
+            mBlockEvents.push_back ({ (int) std::max (0LL, point.samplePosition - blockStart), point.parameter, point.value });
+        }
+
+        core.process (channelData, numChannels, numSamples, mBlockEvents.data(), (int) mBlockEvents.size());
+    }
+
+    // the names used on the command line, returns false for an unknown name
+    static bool getParameterId (const std::string& name, parameterId& parameter)
+    {
+        const struct { const char* name; parameterId parameter; } names[] =
+        {
+            { "mod-freq", modFreqParam }, { "overdrive", overdriveParam }, { "pulser-freq", pulserFreqParam }, { "dist-mix", distMixParam },
+            { "mod-type", modTypeParam }, { "dist-type", distTypeParam }, { "level-attack", levelAttackParam },
+            { "level-release", levelReleaseParam }, { "level-detector", levelDetectorParam }, { "level-link", levelLinkParam },
+            { "bypass", bypassParam }, { "mod-on", modEnabledParam }, { "dist-on", distEnabledParam }, { "pulser-on", pulserEnabledParam }
+        };
+
+        for (const auto& entry : names)
+        {
+            if (name == entry.name)
+            {
+                parameter = entry.parameter;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    std::vector<Point> mPoints;
+    std::vector<ParameterEvent> mBlockEvents;
+    size_t mNextPoint = 0;
+};
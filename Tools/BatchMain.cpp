@@ -0,0 +1,365 @@
+/*
+  ==============================================================================
+
+    BatchMain.cpp
+    mfx_batch: renders a list of files through MultiEffectCore on every core,
+    splitting long files into sections that render side by side if asked to.
+
+  ==============================================================================
+*/
+
+#include "RenderJob.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    void printUsage()
+    {
+        std::printf ("usage: mfx_batch <jobs.txt> [--threads n] [--chunk frames] [--split seconds] [--pre-roll seconds] [options]\n"
+                     "  Each line of the job list is <input.wav> <output.wav> [options], the same as mfx_render's\n"
+                     "  command line. Paths with spaces go in double quotes, lines starting with # are left out.\n"
+                     "  The options given here apply to every job, before the job's own.\n"
+                     "  --threads <n>           threads to render on (default: one per hardware thread)\n"
+                     "  --chunk <frames>        frames read, processed and written at a time (default %d)\n"
+                     "  --split <seconds>       cuts files at least twice this long into sections of about this long,\n"
+                     "                          rendered as separate tasks and joined bit-exactly. Not for jobs with\n"
+                     "                          --automate or --cpu-report (default: off)\n"
+                     "  --pre-roll <seconds>    how long each section runs before its output is kept (default %g)\n"
+                     "options:\n", RENDER_CHUNK_FRAMES, RENDER_PRE_ROLL_SECONDS);
+        printRenderOptions();
+    }
+
+    // splits a line on spaces and tabs, keeping what's in double quotes together
+    std::vector<std::string> splitLine (const std::string& line)
+    {
+        std::vector<std::string> words;
+        std::string word;
+        bool inWord = false, inQuotes = false;
+
+        for (char c : line)
+        {
+            if (c == '"')
+            {
+                inQuotes = ! inQuotes;
+                inWord = true;
+            }
+            else if (! inQuotes && (c == ' ' || c == '\t' || c == '\r'))
+            {
+                if (inWord)
+                    words.push_back (word);
+
+                word.clear();
+                inWord = false;
+            }
+            else
+            {
+                word += c;
+                inWord = true;
+            }
+        }
+
+        if (inWord)
+            words.push_back (word);
+
+        return words;
+    }
+
+    bool readJobList (const std::string& path, const std::vector<std::string>& sharedOptions, std::vector<RenderJob>& jobs, std::string& error)
+    {
+        std::ifstream file (path);
+
+        if (! file)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+
+        std::string line;
+        std::set<std::string> outputPaths;
+
+        for (int lineNumber = 1; std::getline (file, line); ++lineNumber)
+        {
+            const auto words = splitLine (line);
+
+            if (words.empty() || words[0][0] == '#')
+                continue;
+
+            const auto where = path + ":" + std::to_string (lineNumber) + ": ";
+
+            if (words.size() < 2)
+            {
+                error = where + "needs an input and an output file";
+                return false;
+            }
+
+            RenderJob job { words[0], words[1], sharedOptions };
+            job.options.insert (job.options.end(), words.begin() + 2, words.end());
+
+            if (! checkRenderOptions (job.options, error))
+            {
+                error = where + error;
+                return false;
+            }
+
+            // two jobs writing the same file would each spoil the other's
+            if (! outputPaths.insert (job.outputPath).second)
+            {
+                error = where + job.outputPath + " is written by an earlier job too";
+                return false;
+            }
+
+            jobs.push_back (job);
+        }
+
+        return true;
+    }
+
+    // a whole job, or one section of a split one
+    struct BatchTask
+    {
+        int job;
+        int section;
+        double size;
+    };
+
+    struct ThreadStats
+    {
+        int numTasks = 0;
+        double audioSeconds = 0.0;
+        double busySeconds = 0.0;
+    };
+
+    // the sections of a split job that's still going
+    struct SplitJob
+    {
+        std::vector<RenderSection> sections;
+        int numLeft = 0;
+        bool failed = false;
+        std::string error;
+        std::chrono::steady_clock::time_point startTime;
+        bool started = false;
+    };
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return 1;
+    }
+
+    int numThreads = (int) std::max (1u, std::thread::hardware_concurrency());
+    int chunkFrames = RENDER_CHUNK_FRAMES;
+    double splitSeconds = 0.0;
+    double preRollSeconds = RENDER_PRE_ROLL_SECONDS;
+    std::vector<std::string> sharedOptions;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+
+        if (i + 1 < argc && option == "--threads")
+            numThreads = std::max (1, std::atoi (argv[++i]));
+        else if (i + 1 < argc && option == "--chunk")
+            chunkFrames = std::max (1, std::atoi (argv[++i]));
+        else if (i + 1 < argc && option == "--split")
+            splitSeconds = std::max (0.0, std::atof (argv[++i]));
+        else if (i + 1 < argc && option == "--pre-roll")
+            preRollSeconds = std::max (0.0, std::atof (argv[++i]));
+        else
+            sharedOptions.push_back (option);
+    }
+
+    std::string error;
+    std::vector<RenderJob> jobs;
+
+    if (! checkRenderOptions (sharedOptions, error))
+    {
+        std::fprintf (stderr, "%s\n", error.c_str());
+        printUsage();
+        return 1;
+    }
+
+    if (! readJobList (argv[1], sharedOptions, jobs, error))
+    {
+        std::fprintf (stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    // longest first (going by file size), so no thread is left with a long file once the rest are done
+    std::vector<uintmax_t> sizes;
+
+    for (const auto& job : jobs)
+    {
+        std::error_code sizeError;
+        const auto size = std::filesystem::file_size (job.inputPath, sizeError);
+        sizes.push_back (sizeError ? 0 : size);
+    }
+
+    // a split job has a task for each section, the size of its share of the file
+    std::vector<SplitJob> splitJobs (jobs.size());
+    std::vector<BatchTask> tasks;
+
+    for (int job = 0; job < (int) jobs.size(); ++job)
+    {
+        auto& splitJob = splitJobs[(size_t) job];
+        std::string splitError;
+
+        // one that fails to split goes as a whole, and reports the error when it renders
+        if (splitSeconds > 0.0 && canSplitRenderJob (jobs[(size_t) job])
+             && splitRenderJob (jobs[(size_t) job], splitSeconds, preRollSeconds, chunkFrames, splitJob.sections, splitError)
+             && splitJob.sections.size() > 1)
+        {
+            const auto& sections = splitJob.sections;
+            splitJob.numLeft = (int) sections.size();
+
+            for (int section = 0; section < (int) sections.size(); ++section)
+                tasks.push_back ({ job, section, (double) sizes[(size_t) job] * (double) (sections[(size_t) section].end - sections[(size_t) section].start)
+                                                  / (double) sections.back().end });
+        }
+        else
+        {
+            splitJob.sections.clear();
+            tasks.push_back ({ job, -1, (double) sizes[(size_t) job] });
+        }
+    }
+
+    std::stable_sort (tasks.begin(), tasks.end(), [] (const BatchTask& a, const BatchTask& b) { return a.size > b.size; });
+
+    WorkStealingPool pool (std::min (numThreads, std::max (1, (int) tasks.size())));
+    std::vector<ThreadStats> threadStats ((size_t) pool.getNumThreads());
+    std::mutex printLock;
+    int numDone = 0, numFailed = 0;
+
+    std::printf ("%d jobs (%d tasks) on %d threads\n", (int) jobs.size(), (int) tasks.size(), pool.getNumThreads());
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    pool.run ((int) tasks.size(), [&] (int taskIndex, int thread)
+    {
+        const auto& task = tasks[(size_t) taskIndex];
+        const auto& job = jobs[(size_t) task.job];
+        auto& splitJob = splitJobs[(size_t) task.job];
+        RenderResult result;
+        std::string jobError;
+        bool rendered = false;
+
+        // each thread only touches its own stats
+        auto& stats = threadStats[(size_t) thread];
+        stats.numTasks += 1;
+
+        if (task.section < 0)
+        {
+            rendered = runRenderJob (job, chunkFrames, result, jobError);
+            stats.audioSeconds += result.getAudioSeconds();
+            stats.busySeconds += result.seconds;
+        }
+        else
+        {
+            auto& section = splitJob.sections[(size_t) task.section];
+            bool isLast = false;
+
+            {
+                const std::lock_guard<std::mutex> guard (printLock);
+
+                if (! splitJob.started)
+                    splitJob.startTime = std::chrono::steady_clock::now();
+
+                splitJob.started = true;
+            }
+
+            const bool sectionRendered = runRenderSection (job, section, chunkFrames, jobError);
+            stats.audioSeconds += section.getAudioSeconds();
+            stats.busySeconds += section.seconds;
+
+            {
+                const std::lock_guard<std::mutex> guard (printLock);
+
+                if (! sectionRendered && ! splitJob.failed)
+                {
+                    splitJob.failed = true;
+                    splitJob.error = jobError;
+                }
+
+                isLast = --splitJob.numLeft == 0;
+            }
+
+            // the last section to finish joins them all
+            if (! isLast)
+                return;
+
+            if (splitJob.failed)
+            {
+                jobError = splitJob.error;
+
+                for (const auto& part : splitJob.sections)
+                    std::remove (part.partPath.c_str());
+            }
+            else
+            {
+                rendered = joinRenderSections (job, splitJob.sections, chunkFrames, result, jobError);
+                stats.busySeconds += result.seconds;
+            }
+
+            result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - splitJob.startTime).count();
+        }
+
+        const std::lock_guard<std::mutex> guard (printLock);
+        ++numDone;
+
+        if (rendered)
+        {
+            std::printf ("[%d/%d] %s: %.1f s in %.2f s, %.1fx realtime (thread %d", numDone, (int) jobs.size(), job.outputPath.c_str(),
+                         result.getAudioSeconds(), result.seconds, result.getRealtimeMultiple(), thread);
+
+            if (result.numSections > 1)
+                std::printf (", %d sections, %d rendered again", result.numSections, result.numRerendered);
+
+            std::printf (")\n");
+        }
+        else
+        {
+            ++numFailed;
+            std::printf ("[%d/%d] %s: FAILED, %s\n", numDone, (int) jobs.size(), job.inputPath.c_str(), jobError.c_str());
+        }
+
+        std::fflush (stdout);
+    });
+
+    const double wallSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    double totalAudioSeconds = 0.0;
+
+    std::printf ("\n%-8s %6s %12s %10s %10s\n", "thread", "tasks", "audio s", "busy s", "realtime");
+
+    for (size_t thread = 0; thread < threadStats.size(); ++thread)
+    {
+        const auto& stats = threadStats[thread];
+        totalAudioSeconds += stats.audioSeconds;
+
+        std::printf ("%-8d %6d %12.1f %10.2f %9.1fx\n", (int) thread, stats.numTasks, stats.audioSeconds, stats.busySeconds,
+                     stats.busySeconds > 0.0 ? stats.audioSeconds / stats.busySeconds : 0.0);
+    }
+
+    const double overall = wallSeconds > 0.0 ? totalAudioSeconds / wallSeconds : 0.0;
+
+    std::printf ("%-8s %6d %12.1f %10.2f %9.1fx overall, %.1fx per thread\n", "all", (int) tasks.size(), totalAudioSeconds, wallSeconds,
+                 overall, overall / pool.getNumThreads());
+
+    if (numFailed > 0)
+        std::fprintf (stderr, "%d of %d jobs failed\n", numFailed, (int) jobs.size());
+
+    return numFailed > 0 ? 1 : 0;
+}
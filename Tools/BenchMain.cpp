@@ -0,0 +1,4356 @@
+/*
+  ==============================================================================
+
+    BenchMain.cpp
+    mfx_bench: per-stage and whole-chain timings of MultiEffectCore.
+
+  ==============================================================================
+*/
+
+#include "DSP/MultiEffectCore.h"
+#include "DSP/PresetState.h"
+#include "DSP/Waveshaper.h"
+#include "AutomationTimeline.h"
+#include "RealtimeGuard.h"
+#include "RenderJob.h"
+#include "WavFile.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <complex>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+    const double sampleRates[] = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+    enum stageType
+    {
+        modulationStage = 1,
+        distortionStage,
+        pulsingStage,
+        chainStage,
+        referenceStage
+    };
+
+    const char* getStageName (stageType stage)
+    {
+        switch (stage)
+        {
+            case modulationStage:   return "modulation";
+            case distortionStage:   return "distortion";
+            case pulsingStage:      return "pulsing";
+            case chainStage:        return "chain";
+            case referenceStage:    return "chain-ref";
+            default:                return "?";
+        }
+    }
+
+    struct BenchOptions
+    {
+        std::string suite = "all";
+        double minSeconds = 0.01;
+        bool csv = false;
+        int onlyBlockSize = 0;
+        double onlySampleRate = 0.0;
+        std::string goldenPath;
+        std::string baselinePath;
+        bool record = false;
+        double tolerance = 1.0e-6;
+        double maxRegressionPercent = 10.0;
+    };
+
+    // one row per check in the verify suites, remembering whether any of them failed
+    struct VerifyReport
+    {
+        void check (const char* name, bool passed, const std::string& detail)
+        {
+            std::printf ("%-30s %-52s %6s\n", name, detail.c_str(), passed ? "ok" : "FAIL");
+            allPassed = allPassed && passed;
+        }
+
+        bool allPassed = true;
+    };
+
+    // the same noise in either precision, so float and double runs see the same material
+    template <typename SampleType>
+    struct BasicTestBuffer
+    {
+        BasicTestBuffer (int numChannels, int numSamples)
+            : source ((size_t) numChannels, std::vector<SampleType> ((size_t) numSamples)),
+              work ((size_t) numChannels, std::vector<SampleType> ((size_t) numSamples)),
+              pointers ((size_t) numChannels),
+              sourcePointers ((size_t) numChannels)
+        {
+            // white noise at -6dBFS
+            std::mt19937 rng (1234);
+            std::uniform_real_distribution<float> dist (-0.5f, 0.5f);
+
+            for (auto& channel : source)
+                for (auto& sample : channel)
+                    sample = dist (rng);
+
+            for (size_t i = 0; i < work.size(); ++i)
+            {
+                pointers[i] = work[i].data();
+                sourcePointers[i] = source[i].data();
+            }
+        }
+
+        void refill()
+        {
+            for (size_t i = 0; i < work.size(); ++i)
+                std::memcpy (work[i].data(), source[i].data(), source[i].size() * sizeof (SampleType));
+        }
+
+        int getNumChannels() const  { return (int) work.size(); }
+        int getNumSamples() const   { return (int) work[0].size(); }
+
+        std::vector<std::vector<SampleType>> source, work;
+        std::vector<SampleType*> pointers;
+        std::vector<const SampleType*> sourcePointers;
+    };
+
+    using TestBuffer = BasicTestBuffer<float>;
+
+    float checksum = 0.0f;
+
+    // calls fn() repeatedly for at least minSeconds and returns the mean time of one call in nanoseconds
+    template <typename Fn>
+    double timeCall (Fn&& fn, double minSeconds)
+    {
+        for (int i = 0; i < 4; ++i)
+            fn();
+
+        long long iterations = 0;
+        const auto start = Clock::now();
+        auto elapsed = Clock::duration::zero();
+
+        do
+        {
+            for (int i = 0; i < 16; ++i)
+                fn();
+
+            iterations += 16;
+            elapsed = Clock::now() - start;
+        }
+        while (std::chrono::duration<double> (elapsed).count() < minSeconds);
+
+        return std::chrono::duration<double, std::nano> (elapsed).count() / (double) iterations;
+    }
+
+    template <typename SampleType>
+    void runStage (MultiEffectCore& core, BasicTestBuffer<SampleType>& buffer, stageType stage)
+    {
+        buffer.refill();
+
+        const int numSamples = buffer.getNumSamples();
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* data = buffer.pointers[(size_t) channel];
+
+            switch (stage)
+            {
+                case modulationStage:
+                    core.doModulation (data, numSamples, channel);
+                    break;
+
+                case distortionStage:
+                    core.doDistortion (data, numSamples, channel);
+                    break;
+
+                case pulsingStage:
+                    core.doPulsing (data, numSamples, channel);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        // the make-up gain goes over all the channels at once, the input being the buffer's source
+        if (stage == distortionStage)
+            core.doLevelCompensation (buffer.sourcePointers.data(), buffer.pointers.data(), buffer.getNumChannels(), numSamples);
+
+        if (stage == chainStage)
+            core.process (buffer.pointers.data(), buffer.getNumChannels(), numSamples);
+        else if (stage == referenceStage)
+            core.processReference (buffer.pointers.data(), buffer.getNumChannels(), numSamples);
+
+        checksum += (float) buffer.work[0][0];
+    }
+
+    void runStageSuite (const BenchOptions& options)
+    {
+        const stageType stages[] = { modulationStage, distortionStage, pulsingStage, chainStage, referenceStage };
+        const modType modTypes[] = { rm, am };
+        const distType distTypes[] = { soft, hard };
+
+        if (options.csv)
+            std::printf ("sample_rate,block_size,mod_type,dist_type,stage,ns_per_sample,samples_per_sec\n");
+        else
+            std::printf ("%9s %6s %4s %5s %-11s %12s %14s\n", "rate", "block", "mod", "dist", "stage", "ns/sample", "samples/sec");
+
+        for (auto sampleRate : sampleRates)
+        {
+            if (options.onlySampleRate > 0.0 && sampleRate != options.onlySampleRate)
+                continue;
+
+            for (auto blockSize : blockSizes)
+            {
+                if (options.onlyBlockSize > 0 && blockSize != options.onlyBlockSize)
+                    continue;
+
+                TestBuffer buffer (2, blockSize);
+                const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+                const double samplesPerCall = (double) blockSize * buffer.getNumChannels();
+
+                for (auto mod : modTypes)
+                {
+                    for (auto dist : distTypes)
+                    {
+                        MultiEffectCore core;
+                        core.setModType (mod);
+                        core.setDistType (dist);
+                        core.setOverdrive (8.0);
+                        core.prepare (sampleRate);
+
+                        for (auto stage : stages)
+                        {
+                            // the input copy is timed separately and taken out again
+                            const double ns = std::max (0.0, timeCall ([&] { runStage (core, buffer, stage); }, options.minSeconds) - copyNs);
+                            const double nsPerSample = ns / samplesPerCall;
+                            const double samplesPerSec = nsPerSample > 0.0 ? 1.0e9 / nsPerSample : 0.0;
+
+                            if (options.csv)
+                                std::printf ("%g,%d,%s,%s,%s,%.4f,%.0f\n", sampleRate, blockSize, mod == am ? "am" : "rm",
+                                             dist == soft ? "soft" : "hard", getStageName (stage), nsPerSample, samplesPerSec);
+                            else
+                                std::printf ("%9g %6d %4s %5s %-11s %12.3f %14.0f\n", sampleRate, blockSize, mod == am ? "am" : "rm",
+                                             dist == soft ? "soft" : "hard", getStageName (stage), nsPerSample, samplesPerSec);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    const int channelLaneSettings[] = { 1, 2, 4, 8 };
+
+    // cost per channel from mono up to MultiEffectCore::maxChannels, at every setChannelLanes()
+    // setting. Every channel carries its own state, so the cost per channel-sample should stay flat
+    // apart from the LFOs, which get cheaper as more channels share the SIMD lanes
+    void runChannelSuite (const BenchOptions& options)
+    {
+        const struct { int numChannels; const char* layout; } layouts[] =
+        {
+            { 1, "mono" }, { 2, "stereo" }, { 6, "5.1" }, { 8, "7.1" }, { 12, "7.1.4" }, { 16, "ambisonic 3rd" },
+            { 24, "" }, { 32, "" }, { 36, "ambisonic 5th" }, { 48, "" }, { 64, "ambisonic 7th" }
+        };
+
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const double blockNs = 1.0e9 * blockSize / sampleRate;
+        const int defaultLanes = MultiEffectCore().getChannelLanes();
+        std::vector<std::vector<double>> nsPerBlock;
+
+        if (options.csv)
+            std::printf ("channels,layout,lanes,ns_per_channel_sample,us_per_block,realtime_load_percent,vs_1_lane\n");
+        else
+            std::printf ("\nchannel scaling, rm/hard/pulse with overdrive 8, block %d at %g Hz, ns/ch-sample per lane setting\n"
+                         "%8s %-14s %9s %9s %9s %9s %12s %10s %11s %11s\n", blockSize, sampleRate, "channels", "layout",
+                         "1 lane", "2 lanes", "4 lanes", "8 lanes", "us/block", "rt load", "vs 1 lane", "vs stereo");
+
+        for (const auto& layout : layouts)
+        {
+            TestBuffer buffer (layout.numChannels, blockSize);
+            const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+
+            MultiEffectCore core;
+            core.setOverdrive (8.0);
+            core.prepare (sampleRate, layout.numChannels);
+            nsPerBlock.emplace_back();
+
+            for (auto lanes : channelLaneSettings)
+            {
+                core.setChannelLanes (lanes);
+                nsPerBlock.back().push_back (std::max (1.0e-3, timeCall ([&] { runStage (core, buffer, chainStage); }, options.minSeconds) - copyNs));
+            }
+        }
+
+        const auto getSetting = [] (int lanes) { return (size_t) (std::find (std::begin (channelLaneSettings), std::end (channelLaneSettings), lanes)
+                                                                   - std::begin (channelLaneSettings)); };
+
+        // layouts[1] is stereo, the totals are at the default setting
+        const size_t defaultSetting = getSetting (defaultLanes);
+        const double stereoNs = nsPerBlock[1][defaultSetting] / (2.0 * blockSize);
+
+        for (size_t i = 0; i < nsPerBlock.size(); ++i)
+        {
+            const auto& layout = layouts[i];
+            const double samplesPerBlock = (double) blockSize * layout.numChannels;
+            const double ns = nsPerBlock[i][defaultSetting];
+
+            if (options.csv)
+            {
+                for (size_t setting = 0; setting < nsPerBlock[i].size(); ++setting)
+                    std::printf ("%d,%s,%d,%.3f,%.3f,%.3f,%.3f\n", layout.numChannels, layout.layout, channelLaneSettings[setting],
+                                 nsPerBlock[i][setting] / samplesPerBlock, nsPerBlock[i][setting] / 1000.0,
+                                 100.0 * nsPerBlock[i][setting] / blockNs, nsPerBlock[i][0] / nsPerBlock[i][setting]);
+            }
+            else
+            {
+                std::printf ("%8d %-14s", layout.numChannels, layout.layout);
+
+                for (auto settingNs : nsPerBlock[i])
+                    std::printf (" %9.3f", settingNs / samplesPerBlock);
+
+                std::printf (" %12.2f %9.2f%% %10.2fx %10.2fx\n", ns / 1000.0, 100.0 * ns / blockNs,
+                             nsPerBlock[i][0] / ns, ns / samplesPerBlock / stereoNs);
+            }
+        }
+    }
+
+    //==============================================================================
+    // the per-sample std::sin + std::fmod pair the LFOs used before LfoOscillator existed
+    struct LegacyLfo
+    {
+        double angle = 0.0;
+        double delta = 0.0;
+
+        double getNextSample()
+        {
+            double sample = std::sin (angle);
+            angle += delta;
+            angle = std::fmod (angle, LfoOscillator::twoPi);
+            return sample;
+        }
+    };
+
+    const char* getBackendName (lfoBackend backend)
+    {
+        switch (backend)
+        {
+            case exactLfo:      return "exact";
+            case wavetableLfo:  return "wavetable";
+            case rotatorLfo:    return "rotator";
+            default:            return "?";
+        }
+    }
+
+    // the frequency jumping between random values up to MOD_FREQ_LIMIT, each move ramped the way the
+    // core does it. While a ramp runs exactLfo is std::sin of the accumulated angle, so it's the reference here
+    void runOscillatorRampCheck (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int blockSize = 512;
+        const int numBlocks = (int) (sampleRate * 10.0) / blockSize;
+
+        std::printf ("\nramped frequency at %g Hz, a new target every 1024 samples, over 10 seconds\n", sampleRate);
+        std::printf ("%-10s %12s %12s\n", "backend", "ns/sample", "max error");
+
+        std::vector<double> deltas ((size_t) blockSize), output ((size_t) blockSize), expected ((size_t) blockSize);
+
+        const auto makeDeltas = [&] (ParameterRamp& ramp, std::mt19937& random, int block)
+        {
+            if (block % 2 == 0)
+                ramp.setTargetValue (std::uniform_real_distribution<double> (0.0, MOD_FREQ_LIMIT) (random) / sampleRate * LfoOscillator::twoPi);
+
+            ramp.fill (deltas.data(), blockSize);
+            return ramp.getStep();
+        };
+
+        for (auto backend : { exactLfo, wavetableLfo, rotatorLfo })
+        {
+            LfoOscillator lfo, reference;
+            lfo.setBackend (backend);
+            reference.setBackend (exactLfo);
+
+            ParameterRamp ramp;
+            ramp.reset (sampleRate, MultiEffectCore::parameterRampSeconds);
+            std::mt19937 random (3);
+            double maxError = 0.0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                const bool newTarget = block % 2 == 0;
+                const double step = makeDeltas (ramp, random, block);
+
+                if (newTarget)
+                {
+                    lfo.setAngleDeltaRamp (step);
+                    reference.setAngleDeltaRamp (step);
+                }
+
+                lfo.renderBlock (output.data(), deltas.data(), blockSize);
+                reference.renderBlock (expected.data(), deltas.data(), blockSize);
+
+                for (int i = 0; i < blockSize; ++i)
+                    maxError = std::max (maxError, std::abs (output[(size_t) i] - expected[(size_t) i]));
+            }
+
+            int block = 0;
+
+            const double ns = timeCall ([&]
+            {
+                const double step = makeDeltas (ramp, random, block);
+
+                if (block++ % 2 == 0)
+                    lfo.setAngleDeltaRamp (step);
+
+                lfo.renderBlock (output.data(), deltas.data(), blockSize);
+                checksum += (float) output[0];
+            }, options.minSeconds) / blockSize;
+
+            std::printf ("%-10s %12.3f %12.3g\n", getBackendName (backend), ns, maxError);
+        }
+    }
+
+    void runOscillatorSuite (const BenchOptions& options)
+    {
+        const lfoBackend backends[] = { exactLfo, wavetableLfo, rotatorLfo };
+        const double frequency = MOD_FREQ_LIMIT;
+        const int blockSize = 512;
+        std::vector<double> output ((size_t) blockSize);
+
+        std::printf ("\noscillator backends at %g Hz (MOD_FREQ_LIMIT), max error vs std::sin of the exact phase over 60 seconds\n", frequency);
+        std::printf ("%9s %-10s %12s %9s %12s\n", "rate", "backend", "ns/sample", "speedup", "max error");
+
+        for (auto sampleRate : sampleRates)
+        {
+            if (options.onlySampleRate > 0.0 && sampleRate != options.onlySampleRate)
+                continue;
+
+            const double delta = frequency / sampleRate * LfoOscillator::twoPi;
+
+            LegacyLfo legacy;
+            legacy.delta = delta;
+
+            const double legacyNs = timeCall ([&]
+            {
+                for (auto& sample : output)
+                    sample = legacy.getNextSample();
+
+                checksum += (float) output[0];
+            }, options.minSeconds) / blockSize;
+
+            std::printf ("%9g %-10s %12.3f %9s %12s\n", sampleRate, "legacy", legacyNs, "1.00x", "-");
+
+            for (auto backend : backends)
+            {
+                LfoOscillator lfo;
+                lfo.setBackend (backend);
+                lfo.setAngleDelta (delta);
+
+                const double ns = timeCall ([&]
+                {
+                    lfo.renderBlock (output.data(), blockSize);
+
+                    checksum += (float) output[0];
+                }, options.minSeconds) / blockSize;
+
+                LfoOscillator checked;
+                checked.setBackend (backend);
+                checked.setAngleDelta (delta);
+
+                // the phase at sample n is worked out from n, where the legacy one drifts further off
+                // with every fmod. In long double, so the reference's own rounding stays out of it
+                double maxError = 0.0;
+                const auto numBlocks = (long long) (sampleRate * 60.0) / blockSize;
+
+                for (long long block = 0; block < numBlocks; ++block)
+                {
+                    checked.renderBlock (output.data(), blockSize);
+
+                    for (int i = 0; i < blockSize; ++i)
+                    {
+                        const auto n = block * blockSize + i;
+                        const auto expected = (double) std::sin (std::fmod ((long double) delta * (long double) n, (long double) LfoOscillator::twoPi));
+                        maxError = std::max (maxError, std::abs (output[(size_t) i] - expected));
+                    }
+                }
+
+                std::printf ("%9g %-10s %12.3f %8.2fx %12.3g\n", sampleRate, getBackendName (backend), ns, legacyNs / ns, maxError);
+            }
+        }
+
+        runOscillatorRampCheck (options);
+    }
+
+    //==============================================================================
+    const instructionSet allInstructionSets[] = { scalarInstructions, sse2Instructions, avx2Instructions, neonInstructions };
+    const tanhApprox allTanhApproxes[] = { exactTanh, padeTanh, polynomialTanh };
+
+    // every clip kernel on every instruction set, in float or double
+    template <typename SampleType>
+    void runWaveshaperKernels (const BenchOptions& options, int blockSize, double drive)
+    {
+        const char* typeName = sizeof (SampleType) == sizeof (double) ? "double" : "float";
+
+        BasicTestBuffer<SampleType> buffer (1, blockSize);
+        std::vector<SampleType> scalarResult ((size_t) blockSize);
+
+        // a few non-finite samples in the noise, so 'matches scalar' covers those too
+        for (auto index : { 1, 5, blockSize - 1 })
+            if (index < blockSize)
+                buffer.source[0][(size_t) index] = index == 5 ? std::numeric_limits<SampleType>::infinity()
+                                                              : std::numeric_limits<SampleType>::quiet_NaN();
+        const double copyNs = timeCall ([&] { buffer.refill(); checksum += (float) buffer.work[0][0]; }, options.minSeconds);
+
+        for (int shape = 0; shape < 4; ++shape)
+        {
+            const bool isHard = (shape == 0);
+            const tanhApprox approx = isHard ? exactTanh : allTanhApproxes[shape - 1];
+            double scalarNs = 0.0;
+
+            auto runKernel = [&]
+            {
+                buffer.refill();
+
+                if (isHard)
+                    checksum += (float) Waveshaper::hardClip (buffer.pointers[0], blockSize, drive);
+                else
+                    checksum += (float) Waveshaper::softClip (buffer.pointers[0], blockSize, drive, approx);
+            };
+
+            for (auto set : allInstructionSets)
+            {
+                if (! Waveshaper::setInstructionSet (set))
+                    continue;
+
+                const double ns = std::max (1.0e-3, timeCall (runKernel, options.minSeconds) - copyNs) / blockSize;
+
+                runKernel();
+                bool matches = true;
+
+                if (set == scalarInstructions)
+                {
+                    scalarNs = ns;
+                    scalarResult = buffer.work[0];
+                }
+                else
+                {
+                    matches = std::memcmp (scalarResult.data(), buffer.work[0].data(), scalarResult.size() * sizeof (SampleType)) == 0;
+                }
+
+                const std::string shapeName = isHard ? std::string ("hard") : std::string ("soft/") + Waveshaper::getName (approx);
+
+                std::printf ("%-7s %-6s %-16s %12.3f %8.2fx %16s\n", Waveshaper::getName (set), typeName, shapeName.c_str(), ns, scalarNs / ns, matches ? "yes" : "NO");
+            }
+        }
+    }
+
+    void runWaveshaperSuite (const BenchOptions& options)
+    {
+        const tanhApprox* approxes = allTanhApproxes;
+        const instructionSet originalSet = Waveshaper::getInstructionSet();
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double drive = 8.0;
+
+        std::printf ("\ntanh approximations, max error vs std::tanh over [-60, 60]\n");
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const auto approx = approxes[i];
+            double maxError = 0.0;
+
+            for (int i = -600000; i <= 600000; ++i)
+            {
+                const float x = (float) i * 1.0e-4f;
+                float y = x;
+                Waveshaper::softClip (&y, 1, 1.0, approx);
+                maxError = std::max (maxError, std::abs ((double) y - std::tanh ((double) x)));
+            }
+
+            std::printf ("  %-10s %10.3g\n", Waveshaper::getName (approx), maxError);
+        }
+
+        std::printf ("\nwaveshaper kernels, block %d, drive %g (default instruction set: %s)\n", blockSize, drive, Waveshaper::getName (originalSet));
+        std::printf ("%-7s %-6s %-16s %12s %9s %16s\n", "isa", "type", "shape", "ns/sample", "speedup", "matches scalar");
+
+        runWaveshaperKernels<float> (options, blockSize, drive);
+        runWaveshaperKernels<double> (options, blockSize, drive);
+
+        Waveshaper::setInstructionSet (originalSet);
+    }
+
+    //==============================================================================
+    // in-place radix-2 FFT, size must be a power of two
+    void fft (std::vector<std::complex<double>>& data)
+    {
+        const size_t size = data.size();
+
+        for (size_t i = 1, j = 0; i < size; ++i)
+        {
+            size_t bit = size >> 1;
+
+            for (; (j & bit) != 0; bit >>= 1)
+                j ^= bit;
+
+            j ^= bit;
+
+            if (i < j)
+                std::swap (data[i], data[j]);
+        }
+
+        for (size_t length = 2; length <= size; length <<= 1)
+        {
+            const double angle = -2.0 * 3.141592653589793238 / (double) length;
+            const std::complex<double> step (std::cos (angle), std::sin (angle));
+
+            for (size_t start = 0; start < size; start += length)
+            {
+                std::complex<double> twiddle (1.0, 0.0);
+
+                for (size_t k = 0; k < length / 2; ++k)
+                {
+                    const auto even = data[start + k];
+                    const auto odd = data[start + k + length / 2] * twiddle;
+                    data[start + k] = even + odd;
+                    data[start + k + length / 2] = even - odd;
+                    twiddle *= step;
+                }
+            }
+        }
+    }
+
+    struct OversamplingTier
+    {
+        int factor;
+        oversamplingFilter filter;
+
+        std::string getName() const
+        {
+            if (factor == 1)
+                return "1x";
+
+            return std::to_string (factor) + "x " + (filter == firOversampling ? "fir" : "iir");
+        }
+    };
+
+    const OversamplingTier oversamplingTiers[] = { { 1, iirOversampling }, { 2, iirOversampling }, { 4, iirOversampling }, { 8, iirOversampling },
+                                                   { 2, firOversampling }, { 4, firOversampling }, { 8, firOversampling } };
+
+    // sweeps a sine through the oversampled clipper and measures everything that isn't a harmonic of it.
+    // Each test frequency sits on an odd FFT bin, so with no window the harmonics land exactly on
+    // multiples of that bin and any aliases (folded back from above the oversampled Nyquist, or let
+    // through by the filters) land on bins in between
+    void runAliasingSuite (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 44100.0;
+        const int fftSize = 16384;
+        const int numWarmUpSamples = 4096;
+        const int blockSize = MultiEffectCore::subBlockSize;
+        const double drive = 8.0;
+        const double passbandEdge = std::min (20000.0, 0.45 * sampleRate);
+
+        std::vector<int> bins;
+
+        for (double frequency = 100.0; frequency < std::min (18000.0, 0.4 * sampleRate); frequency *= 1.5)
+            bins.push_back ((int) (frequency * fftSize / sampleRate) | 1);
+
+        std::printf ("\naliasing, sine at 0.5 (-6dBFS) with drive %g swept over %d frequencies %g - %g Hz at %g Hz.\n"
+                     "worst alias below %g Hz relative to the fundamental\n", drive, (int) bins.size(),
+                     bins.front() * sampleRate / fftSize, bins.back() * sampleRate / fftSize, sampleRate, passbandEdge);
+        std::printf ("%-8s %-5s %8s %12s %10s %12s\n", "tier", "clip", "latency", "worst alias", "at Hz", "ns/sample");
+
+        std::vector<float> input ((size_t) (numWarmUpSamples + fftSize));
+        std::vector<float> output (input.size());
+        std::vector<std::complex<double>> spectrum ((size_t) fftSize);
+
+        for (const auto& tier : oversamplingTiers)
+        {
+            for (auto shape : { hard, soft })
+            {
+                Oversampler oversampler;
+                oversampler.prepare (sampleRate, tier.factor, tier.filter, blockSize);
+
+                const auto process = [&]
+                {
+                    for (int start = 0; start < (int) input.size(); start += blockSize)
+                    {
+                        const int numThisTime = std::min (blockSize, (int) input.size() - start);
+                        float* oversampled = oversampler.upsample (input.data() + start, numThisTime);
+
+                        if (shape == soft)
+                            Waveshaper::softClip (oversampled, numThisTime * tier.factor, drive, padeTanh);
+                        else
+                            Waveshaper::hardClip (oversampled, numThisTime * tier.factor, drive);
+
+                        oversampler.downsample (output.data() + start, numThisTime);
+                    }
+                };
+
+                double worstAliasDb = -999.0, worstFrequency = 0.0;
+
+                for (auto bin : bins)
+                {
+                    for (size_t i = 0; i < input.size(); ++i)
+                        input[i] = (float) (0.5 * std::sin (2.0 * 3.141592653589793238 * bin * (double) i / fftSize));
+
+                    oversampler.reset();
+                    process();
+
+                    for (int i = 0; i < fftSize; ++i)
+                        spectrum[(size_t) i] = output[(size_t) (numWarmUpSamples + i)];
+
+                    fft (spectrum);
+
+                    const double fundamentalPower = std::norm (spectrum[(size_t) bin]);
+                    double aliasPower = 0.0;
+
+                    for (int i = 1; i < fftSize / 2 && i * sampleRate / fftSize <= passbandEdge; ++i)
+                        if (i % bin != 0)
+                            aliasPower = std::max (aliasPower, std::norm (spectrum[(size_t) i]));
+
+                    const double aliasDb = 10.0 * std::log10 (std::max (aliasPower, 1.0e-30) / fundamentalPower);
+
+                    if (aliasDb > worstAliasDb)
+                    {
+                        worstAliasDb = aliasDb;
+                        worstFrequency = bin * sampleRate / fftSize;
+                    }
+                }
+
+                checksum += output.back();
+
+                const double ns = timeCall (process, options.minSeconds) / (double) input.size();
+
+                std::printf ("%-8s %-5s %8d %8.1f dBc %10.0f %12.3f\n", tier.getName().c_str(), shape == soft ? "soft" : "hard",
+                             oversampler.getLatencySamples(), worstAliasDb, worstFrequency, ns);
+            }
+        }
+    }
+
+    //==============================================================================
+    enum stimulusType
+    {
+        noiseStimulus = 1,
+        sineStimulus,
+        burstStimulus,
+        sweepStimulus,
+        silenceStimulus,
+        impulseStimulus
+    };
+
+    const char* getStimulusName (stimulusType stimulus)
+    {
+        switch (stimulus)
+        {
+            case noiseStimulus: return "noise";
+            case sineStimulus:  return "sine";
+            case burstStimulus: return "burst";
+            case sweepStimulus: return "sweep";
+            case silenceStimulus: return "silence";
+            case impulseStimulus: return "impulse";
+            default:            return "?";
+        }
+    }
+
+    double getSweepPhase (int sample, int numSamples, double sampleRate)
+    {
+        const double startFrequency = 20.0;
+        const double endFrequency = std::min (20000.0, sampleRate * 0.45);
+        const double seconds = (double) numSamples / sampleRate;
+        const double rate = std::log (endFrequency / startFrequency) / seconds;
+
+        return LfoOscillator::twoPi * startFrequency * (std::exp (rate * (double) sample / sampleRate) - 1.0) / rate;
+    }
+
+    std::vector<std::vector<float>> makeStimulus (stimulusType stimulus, int numChannels, int numSamples, double sampleRate)
+    {
+        std::vector<std::vector<float>> channels ((size_t) numChannels, std::vector<float> ((size_t) numSamples));
+        std::mt19937 rng (99);
+        std::uniform_real_distribution<float> dist (-0.5f, 0.5f);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double t = (double) i / sampleRate;
+                const double sine = 0.5 * std::sin (LfoOscillator::twoPi * (220.0 + 110.0 * channel) * t);
+
+                switch (stimulus)
+                {
+                    case noiseStimulus: channels[(size_t) channel][(size_t) i] = dist (rng); break;
+                    case sineStimulus:  channels[(size_t) channel][(size_t) i] = (float) sine; break;
+                    // level jumps between -32dB and -6dB every 50ms, the worst case for block based gain matching
+                    case burstStimulus: channels[(size_t) channel][(size_t) i] = (float) (sine * ((i / (int) (sampleRate * 0.05)) % 2 == 0 ? 0.05 : 1.0)); break;
+                    // 20 Hz to 20 kHz (or Nyquist) exponentially over the whole stimulus
+                    case sweepStimulus: channels[(size_t) channel][(size_t) i] = (float) (0.5 * std::sin (getSweepPhase (i, numSamples, sampleRate))); break;
+                    case silenceStimulus: channels[(size_t) channel][(size_t) i] = 0.0f; break;
+                    // a full scale click every 25ms, the other channel a sample later
+                    case impulseStimulus: channels[(size_t) channel][(size_t) i] = (i - channel) % (int) (sampleRate * 0.025) == 0 ? 1.0f : 0.0f; break;
+                    default: break;
+                }
+            }
+        }
+
+        return channels;
+    }
+
+    // renders a stimulus in host blocks of blockSize through either the fused or the reference chain.
+    // the reference chain can additionally split each host block into chunks of at most referenceChunk samples
+    template <typename SampleType>
+    std::vector<std::vector<SampleType>> renderThroughCore (MultiEffectCore& core, std::vector<std::vector<SampleType>> audio, int blockSize,
+                                                            bool useReference, int referenceChunk = 0)
+    {
+        const int numSamples = (int) audio[0].size();
+        std::vector<SampleType*> pointers (audio.size());
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            const int numThisTime = std::min (blockSize, numSamples - start);
+
+            if (useReference)
+            {
+                const int chunk = referenceChunk > 0 ? referenceChunk : numThisTime;
+
+                for (int offset = 0; offset < numThisTime; offset += chunk)
+                {
+                    for (size_t channel = 0; channel < audio.size(); ++channel)
+                        pointers[channel] = audio[channel].data() + start + offset;
+
+                    core.processReference (pointers.data(), (int) pointers.size(), std::min (chunk, numThisTime - offset));
+                }
+            }
+            else
+            {
+                for (size_t channel = 0; channel < audio.size(); ++channel)
+                    pointers[channel] = audio[channel].data() + start;
+
+                core.process (pointers.data(), (int) pointers.size(), numThisTime);
+            }
+        }
+
+        return audio;
+    }
+
+    struct Difference
+    {
+        double maxDiff = 0.0;
+        double relativeErrorDb = -999.0;
+    };
+
+    template <typename OutputType, typename ExpectedType>
+    Difference compareRenders (const std::vector<std::vector<OutputType>>& output, const std::vector<std::vector<ExpectedType>>& expected)
+    {
+        Difference result;
+        double errorEnergy = 0.0, signalEnergy = 0.0;
+
+        for (size_t channel = 0; channel < output.size(); ++channel)
+        {
+            for (size_t i = 0; i < output[channel].size(); ++i)
+            {
+                const double diff = (double) output[channel][i] - (double) expected[channel][i];
+                result.maxDiff = std::max (result.maxDiff, std::abs (diff));
+                errorEnergy += diff * diff;
+                signalEnergy += (double) expected[channel][i] * expected[channel][i];
+            }
+        }
+
+        if (errorEnergy > 0.0 && signalEnergy > 0.0)
+            result.relativeErrorDb = 10.0 * std::log10 (errorEnergy / signalEnergy);
+
+        return result;
+    }
+
+    // checks the fused kernel against the reference chain, with per-channel peak levels and with
+    // linked RMS levels behind the make-up gain. Everything is worked out per sample, so the tolerance
+    // is zero both against the reference chain fed with host blocks split at MultiEffectCore::subBlockSize
+    // and against the reference chain fed with the whole host blocks
+    bool runVerifySuite (const BenchOptions& options)
+    {
+        const int verifyBlockSizes[] = { 16, 64, 256, 300, 512, 2048, 8192 };
+        const stimulusType stimuli[] = { noiseStimulus, sineStimulus, burstStimulus };
+        const modType modTypes[] = { rm, am };
+        const distType distTypes[] = { soft, hard };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        bool allPassed = true;
+
+        std::printf ("\nfused kernel vs reference chain, 2 seconds at %g Hz, overdrive 8, exact tanh\n", sampleRate);
+        std::printf ("%6s %4s %5s %-6s %-8s %14s %20s %6s\n", "block", "mod", "dist", "input", "level", "max diff", "vs unsplit ref", "result");
+
+        for (auto blockSize : verifyBlockSizes)
+        {
+            if (options.onlyBlockSize > 0 && blockSize != options.onlyBlockSize)
+                continue;
+
+            for (auto mod : modTypes)
+            {
+                for (auto dist : distTypes)
+                {
+                    for (auto stimulus : stimuli)
+                    {
+                        for (auto linked : { false, true })
+                        {
+                            const auto input = makeStimulus (stimulus, 2, (int) (sampleRate * 2.0), sampleRate);
+
+                            MultiEffectCore fused, reference, unsplitReference;
+
+                            for (auto* core : { &fused, &reference, &unsplitReference })
+                            {
+                                core->setModType (mod);
+                                core->setDistType (dist);
+                                core->setOverdrive (8.0);
+                                core->setTanhApprox (exactTanh);
+                                core->setLevelDetector (linked ? rmsLevel : peakLevel);
+                                core->setLevelLink (linked);
+                                core->prepare (sampleRate);
+                            }
+
+                            const auto fusedOut = renderThroughCore (fused, input, blockSize, false);
+                            const auto referenceOut = renderThroughCore (reference, input, blockSize, true, MultiEffectCore::subBlockSize);
+                            const auto unsplitOut = renderThroughCore (unsplitReference, input, blockSize, true);
+
+                            const auto exact = compareRenders (fusedOut, referenceOut);
+                            const auto unsplit = compareRenders (fusedOut, unsplitOut);
+                            const bool passed = exact.maxDiff == 0.0 && unsplit.maxDiff == 0.0;
+                            allPassed = allPassed && passed;
+
+                            std::printf ("%6d %4s %5s %-6s %-8s %14.3g %9.3g / %5.1f dB %6s\n", blockSize, mod == am ? "am" : "rm", dist == soft ? "soft" : "hard",
+                                         getStimulusName (stimulus), linked ? "rms/link" : "peak", exact.maxDiff, unsplit.maxDiff,
+                                         unsplit.relativeErrorDb, passed ? "ok" : "FAIL");
+                        }
+                    }
+                }
+            }
+        }
+
+        return allPassed;
+    }
+
+    //==============================================================================
+    // every distinct combination of stages and modes, with "off" meaning the stage's neutral setting
+    struct ChainConfiguration
+    {
+        bool modulationOn;
+        modType mod;
+        bool distortionOn;
+        distType dist;
+        bool pulsingOn;
+
+        void applyTo (MultiEffectCore& core) const
+        {
+            core.setModType (mod);
+            core.setDistType (dist);
+            core.setModFreq (modulationOn ? MOD_FREQ_INIT : 0.0);
+            core.setOverdrive (distortionOn ? 8.0 : 1.0);
+            core.setPulserFreq (pulsingOn ? PULSER_FREQ_INIT : 0.0);
+        }
+
+        std::string getName() const
+        {
+            return std::string (modulationOn ? (mod == am ? "am" : "rm") : "-") + "/"
+                 + (distortionOn ? (dist == soft ? "soft" : "hard") : "-") + "/"
+                 + (pulsingOn ? "pulse" : "-");
+        }
+    };
+
+    std::vector<ChainConfiguration> getAllConfigurations()
+    {
+        std::vector<ChainConfiguration> configurations;
+
+        for (int modulation = 0; modulation < 3; ++modulation)
+            for (int distortion = 0; distortion < 3; ++distortion)
+                for (int pulsing = 0; pulsing < 2; ++pulsing)
+                    configurations.push_back ({ modulation > 0, modulation == 2 ? am : rm,
+                                                distortion > 0, distortion == 2 ? soft : hard,
+                                                pulsing > 0 });
+
+        return configurations;
+    }
+
+    // null test of the specialised kernels against both the runtime-flag kernel and the reference chain
+    bool runConfigurationVerify (const BenchOptions& options)
+    {
+        const int verifyBlockSizes[] = { 64, 512 };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        bool allPassed = true;
+
+        std::printf ("\nspecialised kernels, every configuration, noise input at %g Hz, exact tanh\n", sampleRate);
+        std::printf ("%6s %-16s %16s %16s %6s\n", "block", "configuration", "vs runtime flags", "vs reference", "result");
+
+        for (auto blockSize : verifyBlockSizes)
+        {
+            for (const auto& configuration : getAllConfigurations())
+            {
+                const auto input = makeStimulus (noiseStimulus, 2, (int) sampleRate, sampleRate);
+
+                MultiEffectCore specialised, generic, reference;
+
+                for (auto* core : { &specialised, &generic, &reference })
+                {
+                    configuration.applyTo (*core);
+                    core->setTanhApprox (exactTanh);
+                    core->prepare (sampleRate);
+                }
+
+                generic.setSpecialisedProcessing (false);
+
+                const auto specialisedOut = renderThroughCore (specialised, input, blockSize, false);
+                const auto genericOut = renderThroughCore (generic, input, blockSize, false);
+                const auto referenceOut = renderThroughCore (reference, input, blockSize, true, MultiEffectCore::subBlockSize);
+
+                const double genericDiff = compareRenders (specialisedOut, genericOut).maxDiff;
+                const double referenceDiff = compareRenders (specialisedOut, referenceOut).maxDiff;
+                const bool passed = genericDiff == 0.0 && referenceDiff == 0.0;
+                allPassed = allPassed && passed;
+
+                std::printf ("%6d %-16s %16.3g %16.3g %6s\n", blockSize, configuration.getName().c_str(), genericDiff, referenceDiff, passed ? "ok" : "FAIL");
+            }
+        }
+
+        return allPassed;
+    }
+
+    // an "editor" thread hammers every setter while the audio thread keeps processing. Nothing is
+    // locked, so this is mainly a target for -fsanitize=thread, but it also checks that the output
+    // stays finite and that the last values set are the ones the audio thread ends up using
+    bool runParameterVerify (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 64;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        std::printf ("\nparameter hand-over, setters on a second thread, block %d at %g Hz\n", blockSize, sampleRate);
+
+        MultiEffectCore core;
+        core.prepare (sampleRate);
+
+        TestBuffer buffer (2, blockSize);
+        std::atomic<bool> running { true };
+        long numSets = 0;
+
+        std::thread editorThread ([&]
+        {
+            std::mt19937 random (99);
+            std::uniform_real_distribution<double> unit (0.0, 1.0);
+
+            while (running.load())
+            {
+                core.setModFreq (unit (random) * MOD_FREQ_LIMIT);
+                core.setOverdrive (1.0 + unit (random) * (OVERDRIVE_LIMIT - 1.0));
+                core.setPulserFreq (unit (random) * PULSER_FREQ_LIMIT);
+                core.setModType (unit (random) < 0.5 ? rm : am);
+                core.setDistType (unit (random) < 0.5 ? soft : hard);
+                ++numSets;
+            }
+        });
+
+        bool finite = true;
+        const auto endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds (200);
+        long numBlocks = 0;
+
+        while (std::chrono::steady_clock::now() < endTime)
+        {
+            buffer.refill();
+            runStage (core, buffer, chainStage);
+            ++numBlocks;
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                for (int sample = 0; sample < blockSize; ++sample)
+                    finite = finite && std::isfinite (buffer.work[(size_t) channel][(size_t) sample]);
+        }
+
+        running.store (false);
+        editorThread.join();
+
+        // with every stage neutral the chain is a straight copy, which only holds once the final values went through
+        core.setModFreq (0.0);
+        core.setOverdrive (1.0);
+        core.setPulserFreq (0.0);
+
+        // the make-up gain only comes back to exactly 1 once the output level follower has caught up
+        // with the input one, which takes a few dozen release times
+        for (int block = 0; block < (int) (sampleRate * LEVEL_RELEASE_INIT * 0.04) / blockSize + 1; ++block)
+        {
+            buffer.refill();
+            runStage (core, buffer, chainStage);
+        }
+
+        buffer.refill();
+        runStage (core, buffer, chainStage);
+
+        bool settled = true;
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            settled = settled && buffer.work[(size_t) channel] == buffer.source[(size_t) channel];
+
+        const bool passed = finite && settled;
+
+        std::printf ("%ld parameter sets over %ld blocks, output finite: %s, final values applied: %s  %s\n",
+                     numSets, numBlocks, finite ? "yes" : "no", settled ? "yes" : "no", passed ? "ok" : "FAIL");
+
+        return passed;
+    }
+
+    //==============================================================================
+    std::vector<std::vector<float>> renderWithTimeline (MultiEffectCore& core, std::vector<std::vector<float>> audio, int blockSize,
+                                                        AutomationTimeline& timeline)
+    {
+        const int numSamples = (int) audio[0].size();
+        std::vector<float*> pointers (audio.size());
+
+        timeline.rewind();
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            for (size_t channel = 0; channel < audio.size(); ++channel)
+                pointers[channel] = audio[channel].data() + start;
+
+            timeline.process (core, pointers.data(), (int) pointers.size(), start, std::min (blockSize, numSamples - start));
+        }
+
+        return audio;
+    }
+
+    // random automation of the given parameters over numSamples, including moves to and from the neutral values
+    AutomationTimeline makeTimeline (std::initializer_list<parameterId> parameters, int numPoints, int numSamples, unsigned int seed)
+    {
+        const std::vector<parameterId> choices (parameters);
+        std::mt19937 random (seed);
+        std::uniform_real_distribution<double> unit (0.0, 1.0);
+        AutomationTimeline timeline;
+
+        for (int point = 0; point < numPoints; ++point)
+        {
+            const auto parameter = choices[(size_t) (unit (random) * (double) choices.size()) % choices.size()];
+            const auto position = (long long) (unit (random) * numSamples);
+            const bool neutral = unit (random) < 0.2;
+            double value = 0.0;
+
+            switch (parameter)
+            {
+                case modFreqParam:      value = neutral ? 0.0 : unit (random) * 2000.0; break;
+                case overdriveParam:    value = neutral ? 1.0 : 1.0 + unit (random) * 20.0; break;
+                case pulserFreqParam:   value = neutral ? 0.0 : unit (random) * PULSER_FREQ_LIMIT; break;
+                case modTypeParam:      value = unit (random) < 0.5 ? rm : am; break;
+                case distTypeParam:     value = unit (random) < 0.5 ? soft : hard; break;
+                case distMixParam:      value = neutral ? 1.0 : unit (random); break;
+                case levelAttackParam:  value = 0.1 + unit (random) * 50.0; break;
+                case levelReleaseParam: value = 1.0 + unit (random) * 500.0; break;
+                case levelDetectorParam: value = unit (random) < 0.5 ? peakLevel : rmsLevel; break;
+                case levelLinkParam:    value = unit (random) < 0.5 ? 0.0 : 1.0; break;
+                case numParameters:
+                default:                break;
+            }
+
+            timeline.add (position, parameter, value);
+        }
+
+        return timeline;
+    }
+
+    // the parameter ramps, LFOs and level followers all run per sample, and the ramps are computed
+    // from the event times, so automation has to come out the same at any block size, both for the
+    // pulser on its own and for the full chain
+    bool runAutomationVerify (const BenchOptions& options)
+    {
+        const int blockSizes[] = { 32, 64, 100, 333, 1024, 4096 };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const auto input = makeStimulus (noiseStimulus, 2, (int) (sampleRate * 2.0), sampleRate);
+        bool allPassed = true;
+
+        std::printf ("\nsample-accurate automation at %g Hz, output compared with 32-sample blocks\n", sampleRate);
+        std::printf ("%6s %-10s %14s %24s %6s\n", "block", "lfo", "pulser only", "full chain", "result");
+
+        for (auto backend : { exactLfo, wavetableLfo, rotatorLfo })
+        {
+            auto pulserTimeline = makeTimeline ({ pulserFreqParam, modTypeParam, distTypeParam }, 40, (int) input[0].size(), 11);
+            auto chainTimeline = makeTimeline ({ modFreqParam, overdriveParam, pulserFreqParam, modTypeParam, distTypeParam,
+                                                 levelAttackParam, levelReleaseParam, levelDetectorParam, levelLinkParam }, 90, (int) input[0].size(), 12);
+
+            const auto render = [&] (int blockSize, bool pulserOnly)
+            {
+                MultiEffectCore core;
+                core.setLfoBackend (backend);
+
+                if (pulserOnly)
+                {
+                    core.setModFreq (0.0);
+                    core.setOverdrive (1.0);
+                }
+                else
+                {
+                    core.setOverdrive (8.0);
+                }
+
+                core.prepare (sampleRate);
+                return renderWithTimeline (core, input, blockSize, pulserOnly ? pulserTimeline : chainTimeline);
+            };
+
+            const auto expectedPulser = render (32, true);
+            const auto expectedChain = render (32, false);
+
+            for (auto blockSize : blockSizes)
+            {
+                const auto pulser = compareRenders (render (blockSize, true), expectedPulser);
+                const auto chain = compareRenders (render (blockSize, false), expectedChain);
+                const bool passed = pulser.maxDiff == 0.0 && chain.maxDiff == 0.0;
+                allPassed = allPassed && passed;
+
+                std::printf ("%6d %-10s %14.3g %13.3g / %6.1f dB %6s\n", blockSize, getBackendName (backend), pulser.maxDiff,
+                             chain.maxDiff, chain.relativeErrorDb, passed ? "ok" : "FAIL");
+            }
+        }
+
+        return allPassed;
+    }
+
+    // the oversampled distortion reports a latency, and everything else has to be delayed to match it:
+    // with the distortion off or the mix fully dry the output is the input delayed by exactly that many
+    // samples. Driven below the clipping point the wet side comes out as the input delayed through the
+    // filters, which for the linear-phase FIR should match closely; the IIR's phase is only flat near DC
+    bool runOversamplingVerify (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 44100.0;
+        const int numSamples = (int) sampleRate;
+        const int settleSamples = numSamples / 2;
+        bool allPassed = true;
+
+        std::vector<std::vector<float>> input (2, std::vector<float> ((size_t) numSamples));
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            input[0][(size_t) i] = (float) (0.3 * std::sin (2.0 * 3.141592653589793238 * 1000.0 * i / sampleRate));
+            input[1][(size_t) i] = (float) (0.3 * std::sin (2.0 * 3.141592653589793238 * 250.0 * i / sampleRate));
+        }
+
+        std::printf ("\noversampled distortion latency at %g Hz, output compared with the input delayed by the reported latency\n", sampleRate);
+        std::printf ("%-8s %8s %14s %14s %24s %6s\n", "tier", "latency", "bypassed", "fully dry", "wet, not clipping", "result");
+
+        for (const auto& tier : oversamplingTiers)
+        {
+            const auto render = [&] (double overdrive, double mix)
+            {
+                MultiEffectCore core;
+                core.setModFreq (0.0);
+                core.setPulserFreq (0.0);
+                core.setOverdrive (overdrive);
+                core.setDistMix (mix);
+                core.setOversampling (tier.factor, tier.filter);
+                core.prepare (sampleRate);
+
+                return std::make_pair (renderThroughCore (core, input, 100, false), core.getLatencySamples());
+            };
+
+            const auto bypassed = render (1.0, 1.0);
+            const auto dry = render (8.0, 0.0);
+            const auto wet = render (1.5, 1.0);
+            const int latency = bypassed.second;
+
+            // the comparisons start once the level followers have settled
+            const auto compareDelayed = [&] (const std::vector<std::vector<float>>& output)
+            {
+                std::vector<std::vector<float>> trimmed (2), expected (2);
+
+                for (size_t channel = 0; channel < 2; ++channel)
+                {
+                    trimmed[channel].assign (output[channel].begin() + settleSamples, output[channel].end());
+                    expected[channel].assign (input[channel].begin() + settleSamples - latency, input[channel].end() - latency);
+                }
+
+                return compareRenders (trimmed, expected);
+            };
+
+            const auto bypassedDiff = compareDelayed (bypassed.first);
+            const auto dryDiff = compareDelayed (dry.first);
+            const auto wetDiff = compareDelayed (wet.first);
+
+            const double wetLimitDb = (tier.filter == firOversampling || tier.factor == 1) ? -80.0 : -30.0;
+            const bool passed = bypassedDiff.maxDiff == 0.0 && dryDiff.maxDiff == 0.0 && wetDiff.relativeErrorDb < wetLimitDb
+                                 && dry.second == latency && wet.second == latency;
+            allPassed = allPassed && passed;
+
+            std::printf ("%-8s %8d %14.3g %14.3g %13.3g / %6.1f dB %6s\n", tier.getName().c_str(), latency, bypassedDiff.maxDiff,
+                         dryDiff.maxDiff, wetDiff.maxDiff, wetDiff.relativeErrorDb, passed ? "ok" : "FAIL");
+        }
+
+        return allPassed;
+    }
+
+    // the channel lanes only change how the LFOs are computed, not what comes out, so every
+    // setChannelLanes() setting has to match the channel-by-channel loop bit for bit, with the
+    // frequencies ramping, the levels linked and unlinked, and with channel counts that leave a
+    // part-filled group at the end
+    bool runLaneVerify (const BenchOptions& options)
+    {
+        const int channelCounts[] = { 1, 2, 3, 6, 13 };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) sampleRate;
+        bool allPassed = true;
+
+        std::printf ("\nchannel lanes at %g Hz, automated full chain compared with 1 lane\n", sampleRate);
+        std::printf ("%8s %-10s %10s %10s %10s %6s\n", "channels", "lfo", "2 lanes", "4 lanes", "8 lanes", "result");
+
+        for (auto numChannels : channelCounts)
+        {
+            const auto input = makeStimulus (noiseStimulus, numChannels, numSamples, sampleRate);
+            auto timeline = makeTimeline ({ modFreqParam, overdriveParam, pulserFreqParam, modTypeParam, levelLinkParam }, 40, numSamples, 13);
+
+            for (auto backend : { exactLfo, wavetableLfo, rotatorLfo })
+            {
+                const auto render = [&] (int lanes)
+                {
+                    MultiEffectCore core;
+                    core.setLfoBackend (backend);
+                    core.setOverdrive (8.0);
+                    core.setChannelLanes (lanes);
+                    core.prepare (sampleRate, numChannels);
+
+                    return renderWithTimeline (core, input, 333, timeline);
+                };
+
+                const auto expected = render (1);
+                bool passed = true;
+
+                std::printf ("%8d %-10s", numChannels, getBackendName (backend));
+
+                for (auto lanes : { 2, 4, 8 })
+                {
+                    const auto difference = compareRenders (render (lanes), expected);
+                    passed = passed && difference.maxDiff == 0.0;
+
+                    std::printf (" %10.3g", difference.maxDiff);
+                }
+
+                allPassed = allPassed && passed;
+                std::printf (" %6s\n", passed ? "ok" : "FAIL");
+            }
+        }
+
+        return allPassed;
+    }
+
+    //==============================================================================
+    template <typename SampleType>
+    std::vector<std::vector<SampleType>> convertChannels (const std::vector<std::vector<float>>& audio)
+    {
+        std::vector<std::vector<SampleType>> converted;
+
+        for (const auto& channel : audio)
+            converted.emplace_back (channel.begin(), channel.end());
+
+        return converted;
+    }
+
+    // renders in double, but every other block goes through the float path, like a host that
+    // switches precision while playing
+    std::vector<std::vector<double>> renderAlternating (MultiEffectCore& core, std::vector<std::vector<double>> audio, int blockSize)
+    {
+        const int numSamples = (int) audio[0].size();
+        std::vector<std::vector<float>> floatBlock (audio.size(), std::vector<float> ((size_t) blockSize));
+        std::vector<double*> pointers (audio.size());
+        std::vector<float*> floatPointers (audio.size());
+
+        for (int start = 0, block = 0; start < numSamples; start += blockSize, ++block)
+        {
+            const int numThisTime = std::min (blockSize, numSamples - start);
+
+            for (size_t channel = 0; channel < audio.size(); ++channel)
+            {
+                pointers[channel] = audio[channel].data() + start;
+                floatPointers[channel] = floatBlock[channel].data();
+            }
+
+            if (block % 2 == 0)
+            {
+                core.process (pointers.data(), (int) pointers.size(), numThisTime);
+                continue;
+            }
+
+            for (size_t channel = 0; channel < audio.size(); ++channel)
+                std::copy (pointers[channel], pointers[channel] + numThisTime, floatPointers[channel]);
+
+            core.process (floatPointers.data(), (int) floatPointers.size(), numThisTime);
+
+            for (size_t channel = 0; channel < audio.size(); ++channel)
+                std::copy (floatPointers[channel], floatPointers[channel] + numThisTime, pointers[channel]);
+        }
+
+        return audio;
+    }
+
+    // the double path runs the float kernels compiled for double. Without oversampling it has to match
+    // the double reference chain exactly; with or without, it should only differ from the float path
+    // by float rounding, and switching precision between blocks has to carry on from the same state
+    bool runPrecisionVerify (const BenchOptions& options)
+    {
+        const int verifyBlockSizes[] = { 64, 300, 2048 };
+        const modType modTypes[] = { rm, am };
+        const distType distTypes[] = { soft, hard };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const double maxRoundingDb = -100.0;
+        bool allPassed = true;
+
+        std::printf ("\ndouble precision at %g Hz, burst input, overdrive 8, exact tanh\n", sampleRate);
+        std::printf ("%6s %4s %5s %-10s %14s %16s %16s %6s\n", "block", "mod", "dist", "oversample", "vs double ref", "vs float", "alternating", "result");
+
+        const auto input = makeStimulus (burstStimulus, 2, (int) sampleRate, sampleRate);
+        const auto doubleInput = convertChannels<double> (input);
+
+        for (auto blockSize : verifyBlockSizes)
+        {
+            for (auto mod : modTypes)
+            {
+                for (auto dist : distTypes)
+                {
+                    // oversampled, the dry delays and the mix go through their double versions as well
+                    for (auto oversampled : { false, true })
+                    {
+                        MultiEffectCore doubleCore, floatCore, reference, alternating;
+
+                        for (auto* core : { &doubleCore, &floatCore, &reference, &alternating })
+                        {
+                            core->setModType (mod);
+                            core->setDistType (dist);
+                            core->setOverdrive (8.0);
+                            core->setTanhApprox (exactTanh);
+                            core->setDistMix (oversampled ? 0.7 : 1.0);
+                            core->setOversampling (oversampled ? 4 : 1, firOversampling);
+                            core->prepare (sampleRate);
+                        }
+
+                        const auto doubleOut = renderThroughCore (doubleCore, doubleInput, blockSize, false);
+                        const auto floatOut = renderThroughCore (floatCore, input, blockSize, false);
+                        const auto alternatingOut = renderAlternating (alternating, doubleInput, blockSize);
+
+                        const auto vsFloat = compareRenders (doubleOut, floatOut);
+                        const auto vsAlternating = compareRenders (alternatingOut, doubleOut);
+                        bool passed = vsFloat.relativeErrorDb < maxRoundingDb && vsAlternating.relativeErrorDb < maxRoundingDb;
+
+                        char referenceText[32] = "-";
+
+                        if (! oversampled)
+                        {
+                            const auto referenceOut = renderThroughCore (reference, doubleInput, blockSize, true);
+                            const double referenceDiff = compareRenders (doubleOut, referenceOut).maxDiff;
+
+                            std::snprintf (referenceText, sizeof (referenceText), "%.3g", referenceDiff);
+                            passed = passed && referenceDiff == 0.0;
+                        }
+
+                        allPassed = allPassed && passed;
+
+                        std::printf ("%6d %4s %5s %-10s %14s %13.1f dB %13.1f dB %6s\n", blockSize, mod == am ? "am" : "rm", dist == soft ? "soft" : "hard",
+                                     oversampled ? "4x fir" : "off", referenceText, vsFloat.relativeErrorDb, vsAlternating.relativeErrorDb,
+                                     passed ? "ok" : "FAIL");
+                    }
+                }
+            }
+        }
+
+        return allPassed;
+    }
+
+    // cost of the chain on the same material in float, in double, and "mixed": double buffers converted
+    // to float for the float chain and back, which is what a host does for a plugin without double support
+    void runPrecisionSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const modType modTypes[] = { rm, am };
+        const distType distTypes[] = { soft, hard };
+
+        if (options.csv)
+            std::printf ("mod_type,dist_type,oversampling,float_ns_per_sample,double_ns_per_sample,mixed_ns_per_sample\n");
+        else
+            std::printf ("\nprecision, stereo block %d at %g Hz with overdrive 8, ns/sample\n%4s %5s %10s %9s %9s %9s %15s %14s\n",
+                         blockSize, sampleRate, "mod", "dist", "oversample", "float", "double", "mixed", "double/float", "mixed/double");
+
+        TestBuffer floatBuffer (2, blockSize);
+        BasicTestBuffer<double> doubleBuffer (2, blockSize);
+        std::vector<std::vector<float>> converted (2, std::vector<float> ((size_t) blockSize));
+        std::vector<float*> convertedPointers { converted[0].data(), converted[1].data() };
+
+        const double floatCopyNs = timeCall ([&] { floatBuffer.refill(); checksum += floatBuffer.work[0][0]; }, options.minSeconds);
+        const double doubleCopyNs = timeCall ([&] { doubleBuffer.refill(); checksum += (float) doubleBuffer.work[0][0]; }, options.minSeconds);
+        const double samplesPerCall = 2.0 * blockSize;
+
+        for (auto mod : modTypes)
+        {
+            for (auto dist : distTypes)
+            {
+                for (auto factor : { 1, 4 })
+                {
+                    MultiEffectCore core;
+                    core.setModType (mod);
+                    core.setDistType (dist);
+                    core.setOverdrive (8.0);
+                    core.setOversampling (factor, iirOversampling);
+                    core.prepare (sampleRate);
+
+                    const auto runMixed = [&]
+                    {
+                        doubleBuffer.refill();
+
+                        for (size_t channel = 0; channel < 2; ++channel)
+                            std::copy (doubleBuffer.work[channel].begin(), doubleBuffer.work[channel].end(), converted[channel].begin());
+
+                        core.process (convertedPointers.data(), 2, blockSize);
+
+                        for (size_t channel = 0; channel < 2; ++channel)
+                            std::copy (converted[channel].begin(), converted[channel].end(), doubleBuffer.work[channel].begin());
+
+                        checksum += (float) doubleBuffer.work[0][0];
+                    };
+
+                    const double floatNs = std::max (1.0e-3, timeCall ([&] { runStage (core, floatBuffer, chainStage); }, options.minSeconds) - floatCopyNs) / samplesPerCall;
+                    const double doubleNs = std::max (1.0e-3, timeCall ([&] { runStage (core, doubleBuffer, chainStage); }, options.minSeconds) - doubleCopyNs) / samplesPerCall;
+                    const double mixedNs = std::max (1.0e-3, timeCall (runMixed, options.minSeconds) - doubleCopyNs) / samplesPerCall;
+
+                    const std::string oversampling = factor > 1 ? std::to_string (factor) + "x iir" : std::string ("off");
+
+                    if (options.csv)
+                        std::printf ("%s,%s,%d,%.4f,%.4f,%.4f\n", mod == am ? "am" : "rm", dist == soft ? "soft" : "hard", factor, floatNs, doubleNs, mixedNs);
+                    else
+                        std::printf ("%4s %5s %10s %9.3f %9.3f %9.3f %14.2fx %13.2fx\n", mod == am ? "am" : "rm", dist == soft ? "soft" : "hard",
+                                     oversampling.c_str(), floatNs, doubleNs, mixedNs, doubleNs / floatNs, mixedNs / doubleNs);
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    // noise bursts with stretches of digital silence in between, the sort of thing most tracks of a
+    // big session are doing most of the time
+    std::vector<std::vector<float>> makeGappedStimulus (int numChannels, int numSamples, double sampleRate)
+    {
+        auto audio = makeStimulus (noiseStimulus, numChannels, numSamples, sampleRate);
+        const int period = (int) (sampleRate * 0.75);
+
+        for (auto& channel : audio)
+            for (int i = 0; i < numSamples; ++i)
+                if (i % period >= period / 3)
+                    channel[(size_t) i] = 0.0f;
+
+        return audio;
+    }
+
+    // the idle fast paths against the full chain: skipping silence only changes the LFO phases and the
+    // envelopes in the last few bits, the neutral path not at all. A full bypass has to put out exactly
+    // the input delayed by the latency, the same at any block size, without a step going in or out
+    bool runIdleVerify (const BenchOptions& options)
+    {
+        const int verifyBlockSizes[] = { 64, 300, 2048 };
+        const OversamplingTier tiers[] = { { 1, iirOversampling }, { 4, iirOversampling }, { 4, firOversampling } };
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) (sampleRate * 4.0);
+        const auto gapped = makeGappedStimulus (2, numSamples, sampleRate);
+        const auto noise = makeStimulus (noiseStimulus, 2, numSamples, sampleRate);
+        bool allPassed = true;
+
+        const auto seconds = [sampleRate] (double time) { return (long long) (time * sampleRate); };
+
+        std::printf ("\nidle fast paths at %g Hz, compared with the full chain (fast paths off)\n", sampleRate);
+        std::printf ("%6s %-7s %6s %22s %14s %14s %6s\n", "block", "tier", "tail", "silent gaps", "neutral", "neutral linked", "result");
+
+        for (const auto& tier : tiers)
+        {
+            // frequency changes in the gaps, so some of them are skipped while the LFOs are ramping
+            AutomationTimeline gapTimeline;
+            gapTimeline.add (seconds (0.4), modFreqParam, 900.0);
+            gapTimeline.add (seconds (1.2), pulserFreqParam, 7.0);
+            gapTimeline.add (seconds (1.9), modTypeParam, am);
+            gapTimeline.add (seconds (2.7), modFreqParam, 0.0);
+
+            // every stage neutral between 0.5 and 2.5 seconds, the level followers settle in between
+            AutomationTimeline neutralTimeline;
+            neutralTimeline.add (0, modFreqParam, 0.0);
+            neutralTimeline.add (0, pulserFreqParam, 0.0);
+            neutralTimeline.add (seconds (0.5), overdriveParam, 1.0);
+            neutralTimeline.add (seconds (2.5), overdriveParam, 8.0);
+            neutralTimeline.add (seconds (3.2), pulserFreqParam, 3.0);
+
+            for (int blockSize : verifyBlockSizes)
+            {
+                const auto render = [&] (const std::vector<std::vector<float>>& input, AutomationTimeline& timeline, bool fastPaths, bool linked)
+                {
+                    MultiEffectCore core;
+                    core.setOverdrive (8.0);
+                    core.setDistMix (0.7);
+                    core.setLevelLink (linked);
+                    core.setIdleFastPaths (fastPaths);
+                    core.setOversampling (tier.factor, tier.filter);
+                    core.prepare (sampleRate);
+
+                    return std::make_pair (renderWithTimeline (core, input, blockSize, timeline), core.getTailSamples());
+                };
+
+                const auto gaps = render (gapped, gapTimeline, true, false);
+                const auto gapDiff = compareRenders (gaps.first, render (gapped, gapTimeline, false, false).first);
+                const auto neutralDiff = compareRenders (render (noise, neutralTimeline, true, false).first, render (noise, neutralTimeline, false, false).first);
+                const auto linkedDiff = compareRenders (render (noise, neutralTimeline, true, true).first, render (noise, neutralTimeline, false, true).first);
+
+                const bool passed = gapDiff.relativeErrorDb < -120.0 && neutralDiff.maxDiff == 0.0 && linkedDiff.maxDiff == 0.0
+                                     && (tier.factor > 1) == (gaps.second > 0);
+                allPassed = allPassed && passed;
+
+                std::printf ("%6d %-7s %6d %11.3g / %6.1f dB %14.3g %14.3g %6s\n", blockSize, tier.getName().c_str(), gaps.second,
+                             gapDiff.maxDiff, gapDiff.relativeErrorDb, neutralDiff.maxDiff, linkedDiff.maxDiff, passed ? "ok" : "FAIL");
+            }
+        }
+
+        std::printf ("\nbypass crossfade at %g Hz, bypassed from 1 to 2.5 seconds, output compared with 32-sample blocks\n", sampleRate);
+        std::printf ("%6s %-7s %8s %16s %14s %20s %6s\n", "block", "tier", "latency", "bypassed vs in", "vs 32 block", "largest step/limit", "result");
+
+        for (const auto& tier : tiers)
+        {
+            AutomationTimeline timeline;
+            timeline.add (seconds (1.0), bypassParam, 1.0);
+            timeline.add (seconds (2.5), bypassParam, 0.0);
+
+            const auto render = [&] (int blockSize, bool bypass)
+            {
+                MultiEffectCore core;
+                core.setOverdrive (8.0);
+                core.setOversampling (tier.factor, tier.filter);
+                core.prepare (sampleRate);
+
+                AutomationTimeline none;
+                return std::make_pair (renderWithTimeline (core, noise, blockSize, bypass ? timeline : none), core.getLatencySamples());
+            };
+
+            const auto expected = render (32, true).first;
+            const auto unbypassed = render (32, false).first;
+
+            // a crossfade can't step further than either of the signals it fades between, plus a
+            // little for the fade itself
+            const auto largestStep = [] (const std::vector<std::vector<float>>& audio)
+            {
+                double step = 0.0;
+
+                for (const auto& channel : audio)
+                    for (size_t i = 1; i < channel.size(); ++i)
+                        step = std::max (step, (double) std::abs (channel[i] - channel[i - 1]));
+
+                return step;
+            };
+
+            const double stepLimit = std::max (largestStep (unbypassed), largestStep (noise)) + 0.01;
+            const double step = largestStep (expected);
+
+            for (int blockSize : { 64, 300, 2048 })
+            {
+                const auto bypassed = render (blockSize, true);
+                const int latency = bypassed.second;
+                const auto start = (size_t) seconds (1.0 + MultiEffectCore::bypassRampSeconds);
+                const auto end = (size_t) seconds (2.5);
+
+                std::vector<std::vector<float>> held (2), delayed (2);
+
+                for (size_t channel = 0; channel < 2; ++channel)
+                {
+                    held[channel].assign (bypassed.first[channel].begin() + (long) start, bypassed.first[channel].begin() + (long) end);
+                    delayed[channel].assign (noise[channel].begin() + (long) start - latency, noise[channel].begin() + (long) end - latency);
+                }
+
+                const auto heldDiff = compareRenders (held, delayed);
+                const auto blockDiff = compareRenders (bypassed.first, expected);
+                const bool passed = heldDiff.maxDiff == 0.0 && blockDiff.maxDiff == 0.0 && step <= stepLimit;
+                allPassed = allPassed && passed;
+
+                std::printf ("%6d %-7s %8d %16.3g %14.3g %9.3f / %-8.3f %6s\n", blockSize, tier.getName().c_str(), latency,
+                             heldDiff.maxDiff, blockDiff.maxDiff, step, stepLimit, passed ? "ok" : "FAIL");
+            }
+        }
+
+        return allPassed;
+    }
+
+    // what an instance costs when there's nothing for it to do: silent input, every stage neutral, or
+    // bypassed, against the active chain, with the fast paths on and off. Then a session's worth of
+    // stereo instances, all idle or all active, against the time there is for each block
+    void runIdleSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const char* caseNames[] = { "active", "silent input", "neutral", "bypassed" };
+
+        if (options.csv)
+            std::printf ("case,oversampling,full_ns_per_sample,fast_ns_per_sample\n");
+        else
+            std::printf ("\nidle cost, stereo block %d at %g Hz with overdrive 8, ns/sample\n%-14s %10s %12s %12s %9s\n",
+                         blockSize, sampleRate, "case", "oversample", "fast paths off", "on", "speedup");
+
+        TestBuffer noiseBuffer (2, blockSize);
+        TestBuffer silentBuffer (2, blockSize);
+
+        for (auto& channel : silentBuffer.source)
+            std::fill (channel.begin(), channel.end(), 0.0f);
+
+        const double copyNs = timeCall ([&] { noiseBuffer.refill(); checksum += noiseBuffer.work[0][0]; }, options.minSeconds);
+        const double samplesPerCall = 2.0 * blockSize;
+
+        const auto setUp = [&] (MultiEffectCore& core, int idleCase, int factor, bool fastPaths)
+        {
+            core.setOverdrive (8.0);
+            core.setIdleFastPaths (fastPaths);
+            core.setOversampling (factor, iirOversampling);
+
+            if (idleCase == 2)
+            {
+                core.setModFreq (0.0);
+                core.setOverdrive (1.0);
+                core.setPulserFreq (0.0);
+            }
+
+            core.setBypassed (idleCase == 3);
+            core.prepare (sampleRate);
+        };
+
+        for (int idleCase = 0; idleCase < 4; ++idleCase)
+        {
+            for (auto factor : { 1, 4 })
+            {
+                auto& buffer = idleCase == 1 ? silentBuffer : noiseBuffer;
+                double nsPerSample[2];
+
+                for (int fastPaths = 0; fastPaths < 2; ++fastPaths)
+                {
+                    MultiEffectCore core;
+                    setUp (core, idleCase, factor, fastPaths != 0);
+
+                    // a couple of seconds in, so the crossfades are over and the level followers have settled
+                    for (int block = 0; block < (int) (sampleRate * 2.0) / blockSize; ++block)
+                        runStage (core, buffer, chainStage);
+
+                    nsPerSample[fastPaths] = std::max (1.0e-3, timeCall ([&] { runStage (core, buffer, chainStage); }, options.minSeconds) - copyNs) / samplesPerCall;
+                }
+
+                const std::string oversampling = factor > 1 ? std::to_string (factor) + "x iir" : std::string ("off");
+
+                if (options.csv)
+                    std::printf ("%s,%d,%.4f,%.4f\n", caseNames[idleCase], factor, nsPerSample[0], nsPerSample[1]);
+                else
+                    std::printf ("%-14s %10s %12.3f %12.3f %8.1fx\n", caseNames[idleCase], oversampling.c_str(), nsPerSample[0], nsPerSample[1],
+                                 nsPerSample[0] / nsPerSample[1]);
+            }
+        }
+
+        if (options.csv)
+            return;
+
+        // a template full of instances, most of which have nothing coming in
+        const int numInstances = 128;
+        const double budgetUs = 1.0e6 * blockSize / sampleRate;
+
+        std::printf ("\n%d stereo instances, us per block of %d (%.0f us available)\n%-14s %12s %12s\n",
+                     numInstances, blockSize, budgetUs, "input", "us/block", "of budget");
+
+        for (int idleCase = 0; idleCase < 2; ++idleCase)
+        {
+            std::vector<MultiEffectCore> cores ((size_t) numInstances);
+            auto& buffer = idleCase == 1 ? silentBuffer : noiseBuffer;
+
+            for (auto& core : cores)
+                setUp (core, idleCase, 1, true);
+
+            const auto processAll = [&]
+            {
+                for (auto& core : cores)
+                    runStage (core, buffer, chainStage);
+            };
+
+            for (int block = 0; block < 8; ++block)
+                processAll();
+
+            const double us = std::max (1.0e-3, timeCall (processAll, options.minSeconds) - copyNs * numInstances) / 1000.0;
+            std::printf ("%-14s %12.1f %11.1f%%\n", caseNames[idleCase], us, 100.0 * us / budgetUs);
+        }
+    }
+
+    // the CPU meter: timing the chain mustn't change what it puts out, each call gives one measurement
+    // whose sections add up to it, nothing goes missing through the queue between two threads, a full
+    // queue drops and counts the new measurements, and the statistics come out of known loads right
+    bool runCpuMeterVerify (const BenchOptions& options)
+    {
+        if (! CpuMeter::isCompiledIn)
+        {
+            std::printf ("\ncpu meter: compiled out (MFX_INSTRUMENTATION=0), skipped\n");
+            return true;
+        }
+
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) (sampleRate * 2.0);
+        const auto gapped = makeGappedStimulus (2, numSamples, sampleRate);
+        VerifyReport report;
+
+        std::printf ("\ncpu meter, 2 seconds at %g Hz\n", sampleRate);
+
+        for (auto blockSize : { 64, 300, 2048 })
+        {
+            MultiEffectCore timed, untimed;
+
+            for (auto* core : { &timed, &untimed })
+            {
+                core->setOverdrive (8.0);
+                core->setDistMix (0.7);
+                core->setOversampling (4, iirOversampling);
+                core->prepare (sampleRate, 2);
+            }
+
+            timed.getCpuMeter().setEnabled (true);
+
+            auto timedAudio = gapped;
+            std::vector<float*> pointers (timedAudio.size());
+            CpuStats stats;
+            int numBlocks = 0;
+            int numMeasurements = 0;
+            double worstMismatchNs = 0.0;
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                const int numThisTime = std::min (blockSize, numSamples - start);
+
+                for (size_t channel = 0; channel < timedAudio.size(); ++channel)
+                    pointers[channel] = timedAudio[channel].data() + start;
+
+                timed.process (pointers.data(), (int) pointers.size(), numThisTime);
+                ++numBlocks;
+
+                CpuMeasurement measurement;
+
+                while (timed.getCpuMeter().pop (measurement))
+                {
+                    double sum = 0.0;
+
+                    for (auto sectionNs : measurement.sectionNs)
+                        sum += sectionNs;
+
+                    worstMismatchNs = std::max (worstMismatchNs, std::abs (sum - measurement.elapsedNs));
+                    numMeasurements += measurement.numSamples == numThisTime ? 1 : 0;
+                    stats.add (measurement);
+                }
+            }
+
+            const auto untimedAudio = renderThroughCore (untimed, gapped, blockSize, false);
+            const auto diff = compareRenders (timedAudio, untimedAudio);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "block %d, max diff %g", blockSize, diff.maxDiff);
+            report.check ("output with timing on", diff.maxDiff == 0.0, detail);
+
+            // the sections are summed from the same clock readings as the whole call, so only the
+            // rounding of the conversion to nanoseconds is left
+            std::snprintf (detail, sizeof (detail), "%d of %d calls, sections off by %.3f ns", numMeasurements, numBlocks, worstMismatchNs);
+            report.check ("one measurement per call", numMeasurements == numBlocks && stats.getNumBlocks() == numBlocks && worstMismatchNs < 1.0, detail);
+        }
+
+        // a producer thread against a consumer thread through a small queue, retrying when it's full
+        {
+            const long long numItems = 2000000;
+            SpscQueue<long long> queue (64);
+            std::atomic<bool> producerDone { false };
+
+            std::thread producer ([&]
+            {
+                for (long long item = 0; item < numItems;)
+                    if (queue.push (item))
+                        ++item;
+
+                producerDone = true;
+            });
+
+            long long expected = 0;
+            long long outOfOrder = 0;
+            long long item;
+
+            while (expected < numItems && ! (producerDone && queue.getNumReady() == 0))
+            {
+                if (queue.pop (item))
+                {
+                    outOfOrder += item != expected ? 1 : 0;
+                    expected = item + 1;
+                }
+            }
+
+            producer.join();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%lld of %lld items, %lld out of order", expected, numItems, outOfOrder);
+            report.check ("spsc queue across threads", expected == numItems && outOfOrder == 0, detail);
+        }
+
+        // nobody reading: the queue fills up and the rest are counted as dropped
+        {
+            MultiEffectCore core;
+            core.prepare (sampleRate, 2);
+            core.getCpuMeter().setEnabled (true);
+
+            TestBuffer buffer (2, 64);
+            const int numExtra = 10;
+
+            for (int block = 0; block < CpuMeter::queueSize + numExtra; ++block)
+                runStage (core, buffer, chainStage);
+
+            CpuStats stats;
+            const int numTaken = stats.addFrom (core.getCpuMeter());
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d taken, %lld dropped", numTaken, core.getCpuMeter().getNumDropped());
+            report.check ("full queue drops and counts", numTaken == CpuMeter::queueSize && core.getCpuMeter().getNumDropped() == numExtra, detail);
+        }
+
+        // loads of 1% to 100% of a 1000 sample block, and one call that overruns it
+        {
+            CpuStats stats;
+            const double durationNs = 1000.0 * 1.0e9 / sampleRate;
+
+            for (int percent = 1; percent <= 100; ++percent)
+            {
+                CpuMeasurement measurement {};
+                measurement.numSamples = 1000;
+                measurement.sampleRate = sampleRate;
+                measurement.elapsedNs = durationNs * percent / 100.0;
+                measurement.sectionNs[distortionSection] = measurement.elapsedNs;
+                stats.add (measurement);
+            }
+
+            CpuMeasurement overrun {};
+            overrun.numSamples = 1000;
+            overrun.sampleRate = sampleRate;
+            overrun.elapsedNs = durationNs * 1.5;
+            stats.add (overrun);
+
+            const auto summary = stats.getBlockSummary();
+            const double expectedMean = (5050.0 + 150.0) / 101.0;
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "min %.2f avg %.2f max %.2f p99 %.2f, %lld overruns",
+                           summary.minimum, summary.mean, summary.maximum, summary.p99, stats.getNumOverruns());
+
+            // the percentile is only as good as the width of a histogram bin (4.7%)
+            report.check ("statistics of known loads", std::abs (summary.minimum - 1.0) < 1.0e-9 && std::abs (summary.maximum - 150.0) < 1.0e-9
+                                                  && std::abs (summary.mean - expectedMean) < 1.0e-9 && std::abs (summary.p99 / 100.0 - 1.0) < 0.03
+                                                  && stats.getNumOverruns() == 1 && stats.getSectionSummary (distortionSection).maximum == 100.0,
+                    detail);
+        }
+
+        return report.allPassed;
+    }
+
+    // what the timing costs, with the meter off and on, and a snapshot of what it measured
+    void runCpuMeterSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        if (! CpuMeter::isCompiledIn)
+        {
+            std::printf ("\ncpu meter: compiled out (MFX_INSTRUMENTATION=0)\n");
+            return;
+        }
+
+        if (options.csv)
+            std::printf ("case,channels,off_ns_per_sample,on_ns_per_sample\n");
+        else
+            std::printf ("\ncpu meter cost, block %d at %g Hz with overdrive 8, ns/sample\n%-16s %8s %10s %10s %9s\n",
+                         blockSize, sampleRate, "case", "channels", "meter off", "on", "overhead");
+
+        const char* caseNames[] = { "1x", "4x iir", "1x linked" };
+        CpuStats snapshot;
+
+        for (int testCase = 0; testCase < 3; ++testCase)
+        {
+            for (auto numChannels : { 2, 8 })
+            {
+                TestBuffer buffer (numChannels, blockSize);
+                const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+                double nsPerSample[2];
+
+                for (int metered = 0; metered < 2; ++metered)
+                {
+                    MultiEffectCore core;
+                    core.setOverdrive (8.0);
+                    core.setLevelLink (testCase == 2);
+                    core.setOversampling (testCase == 1 ? 4 : 1, iirOversampling);
+                    core.prepare (sampleRate, numChannels);
+                    core.getCpuMeter().setEnabled (metered != 0);
+
+                    // the stats are read after every call, the same as the editor would between blocks
+                    CpuStats stats;
+
+                    nsPerSample[metered] = std::max (1.0e-3, timeCall ([&]
+                    {
+                        runStage (core, buffer, chainStage);
+                        stats.addFrom (core.getCpuMeter());
+                    }, options.minSeconds) - copyNs) / (numChannels * (double) blockSize);
+
+                    if (testCase == 1 && numChannels == 2 && metered != 0)
+                        snapshot = stats;
+                }
+
+                if (options.csv)
+                    std::printf ("%s,%d,%.4f,%.4f\n", caseNames[testCase], numChannels, nsPerSample[0], nsPerSample[1]);
+                else
+                    std::printf ("%-16s %8d %10.3f %10.3f %8.1f%%\n", caseNames[testCase], numChannels, nsPerSample[0], nsPerSample[1],
+                                 100.0 * (nsPerSample[1] / nsPerSample[0] - 1.0));
+            }
+        }
+
+        if (! options.csv)
+            std::printf ("\nsnapshot of the 4x iir stereo run\n%s\n%s", snapshot.toText().c_str(), snapshot.toJson().c_str());
+    }
+
+    // the signal tap: tapping mustn't change the output, the peaks have to be those of the input and
+    // output of each call, the waveform has to be the mix of the output without a sample missing, the
+    // bulk queue has to hold up between two threads, and the analyser has to read a sine right
+    bool runSignalTapVerify (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) (sampleRate * 2.0);
+        const auto gapped = makeGappedStimulus (2, numSamples, sampleRate);
+        VerifyReport report;
+
+        std::printf ("\nsignal tap, 2 seconds at %g Hz\n", sampleRate);
+
+        for (auto blockSize : { 64, 300, 2048 })
+        {
+            MultiEffectCore tapped, untapped;
+
+            for (auto* core : { &tapped, &untapped })
+            {
+                core->setOverdrive (8.0);
+                core->setOversampling (2, iirOversampling);
+                core->prepare (sampleRate, 2);
+            }
+
+            tapped.getSignalTap().setEnabled (true);
+
+            auto audio = gapped;
+            std::vector<float*> pointers (audio.size());
+            std::vector<float> scope ((size_t) blockSize);
+            int wrongReadings = 0, wrongScopeSamples = 0, numScopeSamples = 0;
+            float lowestGain = LEVEL_GAIN_LIMIT, highestGain = 0.0f;
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                const int numThisTime = std::min (blockSize, numSamples - start);
+                float inputPeaks[2];
+
+                for (size_t channel = 0; channel < audio.size(); ++channel)
+                {
+                    pointers[channel] = audio[channel].data() + start;
+                    inputPeaks[channel] = MultiEffectCore::getMagnitude (pointers[channel], numThisTime);
+                }
+
+                tapped.process (pointers.data(), (int) pointers.size(), numThisTime);
+
+                MeterReading reading;
+                int numReadings = 0;
+
+                while (tapped.getSignalTap().popReading (reading))
+                {
+                    ++numReadings;
+
+                    for (int channel = 0; channel < 2; ++channel)
+                    {
+                        wrongReadings += reading.inputPeaks[channel] != inputPeaks[channel] ? 1 : 0;
+                        wrongReadings += reading.outputPeaks[channel] != MultiEffectCore::getMagnitude (pointers[(size_t) channel], numThisTime) ? 1 : 0;
+                        lowestGain = std::min (lowestGain, reading.makeUpGains[channel]);
+                        highestGain = std::max (highestGain, reading.makeUpGains[channel]);
+                    }
+                }
+
+                wrongReadings += numReadings != 1 || reading.numChannels != 2 || reading.numSamples != numThisTime ? 1 : 0;
+
+                const int numTaken = tapped.getSignalTap().popScope (scope.data(), blockSize);
+                numScopeSamples += numTaken;
+
+                for (int sample = 0; sample < numTaken; ++sample)
+                    wrongScopeSamples += scope[(size_t) sample] != (pointers[0][sample] + pointers[1][sample]) * 0.5f ? 1 : 0;
+            }
+
+            const auto untappedAudio = renderThroughCore (untapped, gapped, blockSize, false);
+            const auto diff = compareRenders (audio, untappedAudio);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "block %d, max diff %g", blockSize, diff.maxDiff);
+            report.check ("output with tap on", diff.maxDiff == 0.0, detail);
+
+            std::snprintf (detail, sizeof (detail), "%d wrong, gains %.3f to %.3f", wrongReadings, lowestGain, highestGain);
+            report.check ("peaks and make-up gains", wrongReadings == 0 && lowestGain > 0.0f && highestGain <= LEVEL_GAIN_LIMIT, detail);
+
+            std::snprintf (detail, sizeof (detail), "%d of %d samples, %d wrong", numScopeSamples, numSamples, wrongScopeSamples);
+            report.check ("scope samples", numScopeSamples == numSamples && wrongScopeSamples == 0, detail);
+        }
+
+        // runs of samples pushed and popped between two threads, in odd sizes so they wrap unevenly
+        {
+            const int numItems = 4000000;
+            SpscQueue<float> queue (1024);
+
+            std::thread producer ([&]
+            {
+                float run[97];
+
+                for (int next = 0; next < numItems;)
+                {
+                    const int numThisTime = std::min (97, numItems - next);
+
+                    for (int i = 0; i < numThisTime; ++i)
+                        run[i] = (float) ((next + i) % 65536);
+
+                    next += queue.push (run, numThisTime);
+                }
+            });
+
+            float run[61];
+            int received = 0, wrong = 0;
+
+            while (received < numItems)
+            {
+                const int numTaken = queue.pop (run, 61);
+
+                for (int i = 0; i < numTaken; ++i)
+                    wrong += run[i] != (float) ((received + i) % 65536) ? 1 : 0;
+
+                received += numTaken;
+            }
+
+            producer.join();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d of %d samples, %d wrong", received, numItems, wrong);
+            report.check ("bulk spsc queue across threads", received == numItems && wrong == 0, detail);
+        }
+
+        // a -6dBFS sine in the middle of a bin: the meters, the spectrum peak and where it is
+        {
+            const int bin = 85;
+            const double frequency = bin * sampleRate / SignalAnalyser::fftSize;
+            const int numSineSamples = SignalAnalyser::fftSize * 4;
+
+            MultiEffectCore core;
+            core.setModFreq (0.0);
+            core.setPulserFreq (0.0);
+            core.prepare (sampleRate, 1);
+            core.getSignalTap().setEnabled (true);
+
+            std::vector<float> sine ((size_t) numSineSamples);
+
+            for (int i = 0; i < numSineSamples; ++i)
+                sine[(size_t) i] = (float) (0.5 * std::sin (2.0 * 3.141592653589793238 * frequency * i / sampleRate));
+
+            SignalAnalyser analyser;
+            analyser.prepare (sampleRate);
+
+            for (int start = 0; start < numSineSamples; start += 512)
+            {
+                float* channel = sine.data() + start;
+                core.process (&channel, 1, 512);
+                analyser.takeFrom (core.getSignalTap());
+            }
+
+            const auto& spectrum = analyser.updateSpectrum();
+            const auto loudest = (int) (std::max_element (spectrum.begin(), spectrum.end()) - spectrum.begin());
+            const double expectedDb = 20.0 * std::log10 (0.5);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "bin %d at %.2f dB, meters %.2f / %.2f dB", loudest, spectrum[(size_t) loudest],
+                           analyser.getInputLevel (0), analyser.getOutputLevel (0));
+            report.check ("analyser on a sine", loudest == bin && std::abs (spectrum[(size_t) loudest] - expectedDb) < 0.05
+                                          && std::abs (analyser.getInputLevel (0) - expectedDb) < 0.01
+                                          && std::abs (analyser.getOutputLevel (0) - expectedDb) < 0.01,
+                    detail);
+        }
+
+        return report.allPassed;
+    }
+
+    // what the tap costs the audio thread, and what reading it costs the message thread per frame
+    void runSignalTapSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        if (options.csv)
+            std::printf ("channels,off_ns_per_sample,on_ns_per_sample\n");
+        else
+            std::printf ("\nsignal tap cost, block %d at %g Hz with overdrive 8, ns/sample\n%-10s %10s %10s %9s\n",
+                         blockSize, sampleRate, "channels", "tap off", "on", "overhead");
+
+        for (auto numChannels : { 1, 2, 8 })
+        {
+            TestBuffer buffer (numChannels, blockSize);
+            const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+            double nsPerSample[2];
+
+            for (int tapped = 0; tapped < 2; ++tapped)
+            {
+                MultiEffectCore core;
+                core.setOverdrive (8.0);
+                core.prepare (sampleRate, numChannels);
+                core.getSignalTap().setEnabled (tapped != 0);
+
+                // the queues are emptied after every call, as the editor would between its frames
+                SignalAnalyser analyser;
+                analyser.prepare (sampleRate);
+
+                nsPerSample[tapped] = std::max (1.0e-3, timeCall ([&]
+                {
+                    runStage (core, buffer, chainStage);
+                    analyser.takeFrom (core.getSignalTap());
+                }, options.minSeconds) - copyNs) / (numChannels * (double) blockSize);
+            }
+
+            if (options.csv)
+                std::printf ("%d,%.4f,%.4f\n", numChannels, nsPerSample[0], nsPerSample[1]);
+            else
+                std::printf ("%-10d %10.3f %10.3f %8.1f%%\n", numChannels, nsPerSample[0], nsPerSample[1], 100.0 * (nsPerSample[1] / nsPerSample[0] - 1.0));
+        }
+
+        if (options.csv)
+            return;
+
+        // one editor frame: take a frame's worth of audio out of the tap (the time includes putting it
+        // in), then work out the spectrum and the scope
+        const int framesPerSecond = 30;
+        const int samplesPerFrame = (int) (sampleRate / framesPerSecond);
+        const int numInstances = 30;
+
+        SignalTap tap;
+        tap.setEnabled (true);
+
+        TestBuffer buffer (2, samplesPerFrame);
+        const double gains[] = { 1.0, 1.0 };
+        SignalAnalyser analyser;
+        analyser.prepare (sampleRate);
+        std::vector<float> scope (1024);
+
+        const double takeNs = timeCall ([&]
+        {
+            tap.startBlock (buffer.sourcePointers.data(), 2, samplesPerFrame);
+            tap.endBlock (buffer.sourcePointers.data(), gains);
+            analyser.takeFrom (tap);
+        }, options.minSeconds);
+
+        const double analyseNs = timeCall ([&]
+        {
+            checksum += analyser.updateSpectrum()[10];
+            analyser.getScope (scope.data(), (int) scope.size());
+        }, options.minSeconds);
+
+        const double frameNs = takeNs + analyseNs;
+
+        // the audio thread's part on its own, which is too small to see reliably in the table above
+        TestBuffer block (2, blockSize);
+        std::vector<float> drained ((size_t) blockSize);
+
+        const double tapNs = timeCall ([&]
+        {
+            tap.startBlock (block.sourcePointers.data(), 2, blockSize);
+            tap.endBlock (block.sourcePointers.data(), gains);
+
+            MeterReading reading;
+
+            while (tap.popReading (reading))
+                checksum += reading.outputPeaks[0];
+
+            checksum += (float) tap.popScope (drained.data(), blockSize);
+        }, options.minSeconds);
+
+        std::printf ("\nthe tap on its own, stereo: %.3f ns/sample (including emptying its queues)\n", tapNs / (2.0 * blockSize));
+
+        std::printf ("\nanalysis per editor frame: %.1f us (%.1f taking the samples, %.1f spectrum and scope)\n"
+                     "%d editors at %d fps: %.1f%% of the message thread, drawing not included\n",
+                     frameNs / 1000.0, takeNs / 1000.0, analyseNs / 1000.0, numInstances, framesPerSecond,
+                     100.0 * frameNs * numInstances * framesPerSecond / 1.0e9);
+    }
+
+    //==============================================================================
+    // FNV-1a, worked out here rather than borrowed from PresetState, so the check also holds the
+    // binary format to what its documentation says
+    uint32_t getFnv1a (const uint8_t* data, size_t numBytes)
+    {
+        uint32_t hash = 2166136261u;
+
+        for (size_t byte = 0; byte < numBytes; ++byte)
+            hash = (hash ^ data[byte]) * 16777619u;
+
+        return hash;
+    }
+
+    void setFnv1a (std::vector<uint8_t>& data)
+    {
+        const uint32_t checksum = getFnv1a (data.data(), data.size() - 4);
+
+        for (int byte = 0; byte < 4; ++byte)
+            data[data.size() - 4 + (size_t) byte] = (uint8_t) (checksum >> (8 * byte));
+    }
+
+    // a state with every field set to something other than its default
+    PresetState makeRandomState (std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> unit (0.0, 1.0);
+        PresetState state;
+
+        state.set (modFreqField, unit (rng) * MOD_FREQ_LIMIT);
+        state.set (overdriveField, 1.0 + unit (rng) * (OVERDRIVE_LIMIT - 1.0));
+        state.set (pulserFreqField, unit (rng) * PULSER_FREQ_LIMIT);
+        state.set (modTypeField, unit (rng) < 0.5 ? rm : am);
+        state.set (distTypeField, unit (rng) < 0.5 ? soft : hard);
+        state.set (distMixField, unit (rng));
+        state.set (levelAttackField, 0.1 + unit (rng) * LEVEL_ATTACK_LIMIT);
+        state.set (levelReleaseField, 0.1 + unit (rng) * LEVEL_RELEASE_LIMIT);
+        state.set (levelDetectorField, unit (rng) < 0.5 ? peakLevel : rmsLevel);
+        state.set (levelLinkField, unit (rng) < 0.5 ? 1.0 : 0.0);
+        state.set (realtimeOversamplingField, 1 << (int) (unit (rng) * 4.0));
+        state.set (offlineOversamplingField, 1 << (int) (unit (rng) * 4.0));
+        state.set (programField, (int) (unit (rng) * PresetState::getNumPrograms()));
+        state.set (modEnabledField, unit (rng) < 0.5 ? 1.0 : 0.0);
+        state.set (distEnabledField, unit (rng) < 0.5 ? 1.0 : 0.0);
+        state.set (pulserEnabledField, unit (rng) < 0.5 ? 1.0 : 0.0);
+        state.set (stageOrderField, StageOrder::fromIndex ((int) (unit (rng) * StageOrder::getNumOrders())).getCode());
+        return state;
+    }
+
+    // the fields both contain, and whether they're the same once rounded to float like the formats do
+    bool statesMatch (const PresetState& state, const PresetState& expected)
+    {
+        for (int field = 0; field < numPresetFields; ++field)
+            if (state.contains ((presetField) field) != expected.contains ((presetField) field)
+                 || (float) state.get ((presetField) field) != (float) expected.get ((presetField) field))
+                return false;
+
+        return true;
+    }
+
+    // the biggest step from one sample to the next, over all the channels
+    float getLargestStep (const std::vector<std::vector<float>>& audio, int start, int end)
+    {
+        float largest = 0.0f;
+
+        for (const auto& channel : audio)
+            for (int i = std::max (1, start); i < end; ++i)
+                largest = std::max (largest, std::abs (channel[(size_t) i] - channel[(size_t) i - 1]));
+
+        return largest;
+    }
+
+    // the saved state's formats, the snapshot hand-over and the crossfade into a new program
+    bool runStateVerify (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        VerifyReport report;
+
+        std::printf ("\nsaved state and programs\n");
+
+        // every program, the defaults and random states through both formats
+        {
+            std::mt19937 rng (7);
+            std::vector<PresetState> states { PresetState() };
+            int wrongBinary = 0, wrongXml = 0, wrongSize = 0;
+
+            for (int program = 0; program < PresetState::getNumPrograms(); ++program)
+                states.push_back (PresetState::getProgram (program));
+
+            for (int i = 0; i < 1000; ++i)
+                states.push_back (makeRandomState (rng));
+
+            for (const auto& state : states)
+            {
+                uint8_t data[PresetState::maxBinarySize];
+                const int size = state.writeBinary (data);
+
+                PresetState fromBinary, fromXml;
+                fromBinary.set (modFreqField, 1.0);
+                fromXml.set (modFreqField, 1.0);
+
+                // a program leaves the oversampling out, and reading fills in the defaults
+                PresetState expected = state;
+
+                for (auto field : { realtimeOversamplingField, offlineOversamplingField })
+                    if (! state.contains (field))
+                        expected.set (field, PresetState().get (field));
+
+                wrongBinary += fromBinary.readBinary (data, (size_t) size) && statesMatch (fromBinary, expected) ? 0 : 1;
+                wrongXml += fromXml.readXml (state.toXml()) && statesMatch (fromXml, expected) ? 0 : 1;
+                wrongSize += (state.contains (realtimeOversamplingField) ? size != PresetState::maxBinarySize : size >= PresetState::maxBinarySize) ? 1 : 0;
+            }
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d states, %d binary / %d xml / %d sizes wrong", (int) states.size(), wrongBinary, wrongXml, wrongSize);
+            report.check ("binary and xml round trips", wrongBinary == 0 && wrongXml == 0 && wrongSize == 0, detail);
+        }
+
+        // damaged data is refused and leaves the state alone, newer versions are refused, fields the
+        // reader doesn't know are skipped and missing ones come back as the defaults
+        {
+            std::mt19937 rng (8);
+            const auto original = makeRandomState (rng);
+            std::vector<uint8_t> data ((size_t) PresetState::maxBinarySize);
+            data.resize ((size_t) original.writeBinary (data.data()));
+
+            int accepted = 0;
+
+            for (size_t byte = 0; byte < data.size(); ++byte)
+            {
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    auto damaged = data;
+                    damaged[byte] ^= (uint8_t) (1 << bit);
+
+                    PresetState state = original;
+                    accepted += state.readBinary (damaged.data(), damaged.size()) || ! statesMatch (state, original) ? 1 : 0;
+                }
+            }
+
+            for (size_t size = 0; size < data.size(); ++size)
+            {
+                PresetState state;
+                accepted += state.readBinary (data.data(), size) ? 1 : 0;
+            }
+
+            auto newer = data;
+            newer[4] = (uint8_t) (PresetState::formatVersion + 1);
+            setFnv1a (newer);
+
+            PresetState state;
+            const bool newerRefused = ! state.readBinary (newer.data(), newer.size())
+                                       && ! state.readXml ("<MultiEffectState version=\"2\" modFreq=\"10\"/>");
+
+            // an overdrive field from the future, and everything but the mod frequency missing
+            const std::vector<uint8_t> header { 'M', 'F', 'X', 'S', (uint8_t) PresetState::formatVersion, 2 };
+            std::vector<uint8_t> sparse (header);
+
+            for (auto entry : { std::make_pair (200, 3.0f), std::make_pair ((int) modFreqField, 1234.0f) })
+            {
+                uint32_t bits;
+                std::memcpy (&bits, &entry.second, sizeof (bits));
+                sparse.push_back ((uint8_t) entry.first);
+
+                for (int byte = 0; byte < 4; ++byte)
+                    sparse.push_back ((uint8_t) (bits >> (8 * byte)));
+            }
+
+            sparse.resize (sparse.size() + 4);
+            setFnv1a (sparse);
+
+            PresetState expected;
+            expected.set (modFreqField, 1234.0);
+
+            PresetState fromBinary = original, fromXml = original;
+            const bool sparseRead = fromBinary.readBinary (sparse.data(), sparse.size()) && statesMatch (fromBinary, expected)
+                                     && fromXml.readXml ("<?xml version=\"1.0\"?>\n<MultiEffectState version='1' futureField=\"3\" modFreq=\"1234\"/>")
+                                     && statesMatch (fromXml, expected);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d of %d damaged accepted, newer %s, sparse %s", accepted, (int) (data.size() * 9),
+                           newerRefused ? "refused" : "read", sparseRead ? "read" : "wrong");
+            report.check ("damaged, newer and sparse data", accepted == 0 && newerRefused && sparseRead, detail);
+        }
+
+        // a writer sets snapshots as fast as it can with every value the same number, and the audio
+        // thread's side must never see two numbers in one snapshot, or go backwards
+        {
+            const int numSnapshots = 1000000;
+            ParameterStore store;
+            std::atomic<bool> finished { false };
+
+            std::thread writer ([&]
+            {
+                ParameterSnapshot snapshot;
+                snapshot.mask = ParameterStore::allParameters;
+
+                for (int number = 1; number <= numSnapshots; ++number)
+                {
+                    std::fill (snapshot.values, snapshot.values + numParameters, (double) number);
+                    store.setSnapshot (snapshot);
+
+                    // lets the reader in now and then on a single core
+                    if (number % 1000 == 0)
+                        std::this_thread::yield();
+                }
+
+                finished = true;
+            });
+
+            int numTaken = 0, torn = 0, backwards = 0;
+            double last = 0.0;
+            ParameterSnapshot snapshot;
+
+            for (;;)
+            {
+                const bool wasFinished = finished.load();
+
+                while (store.takeSnapshot (snapshot))
+                {
+                    ++numTaken;
+                    torn += std::count (snapshot.values, snapshot.values + numParameters, snapshot.values[0]) != numParameters ? 1 : 0;
+                    backwards += snapshot.values[0] <= last ? 1 : 0;
+                    last = snapshot.values[0];
+                }
+
+                if (wasFinished)
+                    break;
+            }
+
+            writer.join();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d taken, %d torn, %d back, last %d of %d", numTaken, torn, backwards, (int) last, numSnapshots);
+            report.check ("snapshots across threads", numTaken > 0 && torn == 0 && backwards == 0 && last == numSnapshots, detail);
+        }
+
+        // a program set as one snapshot lands on the same sample as the same values set one by one
+        // before the block, at any block size
+        const auto input = makeStimulus (sineStimulus, 2, (int) (sampleRate * 1.5), sampleRate);
+
+        // on a block boundary near a peak of the sine, where cutting straight over would click the most
+        int changeSample = (int) (sampleRate * 0.5) / 64 * 64;
+
+        while (std::abs (input[0][(size_t) changeSample]) < 0.45f)
+            changeSample += 64;
+
+        const auto renderProgramChanges = [&] (int blockSize, bool asSnapshot, int fromProgram, int toProgram)
+        {
+            MultiEffectCore core;
+            core.setParameters (PresetState::getProgram (fromProgram).getParameters());
+            core.prepare (sampleRate, 2);
+
+            auto audio = input;
+            std::vector<float*> pointers (audio.size());
+            const int numSamples = (int) audio[0].size();
+            bool changed = false;
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                if (! changed && start >= changeSample)
+                {
+                    const auto snapshot = PresetState::getProgram (toProgram).getParameters();
+
+                    if (asSnapshot)
+                    {
+                        core.setParameters (snapshot);
+                    }
+                    else
+                    {
+                        core.setModFreq (snapshot.values[modFreqParam]);
+                        core.setOverdrive (snapshot.values[overdriveParam]);
+                        core.setPulserFreq (snapshot.values[pulserFreqParam]);
+                        core.setModType ((modType) (int) snapshot.values[modTypeParam]);
+                        core.setDistType ((distType) (int) snapshot.values[distTypeParam]);
+                        core.setDistMix (snapshot.values[distMixParam]);
+                        core.setLevelAttack (snapshot.values[levelAttackParam]);
+                        core.setLevelRelease (snapshot.values[levelReleaseParam]);
+                        core.setLevelDetector ((levelDetector) (int) snapshot.values[levelDetectorParam]);
+                        core.setLevelLink (snapshot.values[levelLinkParam] != 0.0);
+                        core.setModEnabled (snapshot.values[modEnabledParam] != 0.0);
+                        core.setDistEnabled (snapshot.values[distEnabledParam] != 0.0);
+                        core.setPulserEnabled (snapshot.values[pulserEnabledParam] != 0.0);
+                    }
+
+                    changed = true;
+                }
+
+                const int numThisTime = std::min (blockSize, numSamples - start);
+
+                for (size_t channel = 0; channel < audio.size(); ++channel)
+                    pointers[channel] = audio[channel].data() + start;
+
+                core.process (pointers.data(), (int) pointers.size(), numThisTime);
+            }
+
+            return audio;
+        };
+
+        for (auto blockSize : { 64, 300, 2048 })
+        {
+            double maxDiff = 0.0;
+
+            for (int program = 1; program < PresetState::getNumPrograms(); ++program)
+                maxDiff = std::max (maxDiff, compareRenders (renderProgramChanges (blockSize, true, program - 1, program),
+                                                             renderProgramChanges (blockSize, false, program - 1, program)).maxDiff);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "block %d, every program in turn, max diff %g", blockSize, maxDiff);
+            report.check ("snapshot vs single setters", maxDiff == 0.0, detail);
+        }
+
+        // going from one program to another on a sine, the steps from one sample to the next in the
+        // 100ms after the change stay close to the biggest ones the two programs make on their own.
+        // They can go a little over while the make-up gain catches up with a rising drive, but
+        // cutting straight from one program's output to the other's makes steps many times bigger
+        {
+            const int windowEnd = changeSample + 64 + (int) (sampleRate * 0.1);
+            float worstRatio = 0.0f, worstCutRatio = 0.0f;
+            std::string worstPair;
+
+            for (int from = 0; from < PresetState::getNumPrograms(); ++from)
+            {
+                for (int to = 0; to < PresetState::getNumPrograms(); ++to)
+                {
+                    if (from == to)
+                        continue;
+
+                    const auto changing = renderProgramChanges (64, true, from, to);
+                    const auto before = renderProgramChanges (64, true, from, from);
+                    const auto after = renderProgramChanges (64, true, to, to);
+
+                    // the steady part of each, after the make-up gain has settled
+                    const int settled = (int) (sampleRate * 0.25);
+                    const float steadyStep = std::max (getLargestStep (before, settled, (int) before[0].size()),
+                                                       getLargestStep (after, settled, (int) after[0].size()));
+                    const float ratio = getLargestStep (changing, changeSample, windowEnd) / steadyStep;
+
+                    for (size_t channel = 0; channel < after.size(); ++channel)
+                        worstCutRatio = std::max (worstCutRatio, std::abs (after[channel][(size_t) changeSample] - before[channel][(size_t) changeSample - 1]) / steadyStep);
+
+                    if (ratio > worstRatio)
+                    {
+                        worstRatio = ratio;
+                        worstPair = std::string (PresetState::getProgramName (from)) + " -> " + PresetState::getProgramName (to);
+                    }
+                }
+            }
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%.2fx steady (cut %.1fx), %s", worstRatio, worstCutRatio, worstPair.c_str());
+            report.check ("program changes crossfade", worstRatio <= 1.5f && worstRatio < worstCutRatio, detail);
+        }
+
+        return report.allPassed;
+    }
+
+    // saving and loading a session of many instances in either format, and what a program change
+    // costs the audio thread while it crossfades
+    void runStateSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        if (options.csv)
+            std::printf ("instances,format,save_us,load_us,bytes_per_instance\n");
+        else
+            std::printf ("\nsession save/load, microseconds for the whole session\n%-10s %-7s %10s %10s %10s %12s\n",
+                         "instances", "format", "save", "load", "bytes", "per instance");
+
+        for (auto numInstances : { 100, 500 })
+        {
+            std::vector<MultiEffectCore> cores ((size_t) numInstances);
+            std::mt19937 rng (9);
+
+            for (auto& core : cores)
+            {
+                const auto state = makeRandomState (rng);
+                core.setParameters (state.getParameters());
+                core.setStageOrder (StageOrder::fromCode ((int) state.get (stageOrderField)));
+            }
+
+            // the binary states go end to end in one buffer, the XML ones into strings
+            std::vector<uint8_t> session ((size_t) (numInstances * PresetState::maxBinarySize));
+            std::vector<int> sizes ((size_t) numInstances);
+            std::vector<std::string> xmlSession ((size_t) numInstances);
+
+            const auto getState = [] (const MultiEffectCore& core)
+            {
+                PresetState state;
+                state.setParameters (core.getParameters());
+                state.set (stageOrderField, core.getStageOrder().getCode());
+                return state;
+            };
+
+            const double binarySaveNs = timeCall ([&]
+            {
+                for (size_t instance = 0; instance < cores.size(); ++instance)
+                    sizes[instance] = getState (cores[instance]).writeBinary (session.data() + instance * PresetState::maxBinarySize);
+            }, options.minSeconds);
+
+            const double binaryLoadNs = timeCall ([&]
+            {
+                PresetState state;
+
+                for (size_t instance = 0; instance < cores.size(); ++instance)
+                    if (state.readBinary (session.data() + instance * PresetState::maxBinarySize, (size_t) sizes[instance]))
+                    {
+                        cores[instance].setParameters (state.getParameters());
+                        cores[instance].setStageOrder (StageOrder::fromCode ((int) state.get (stageOrderField)));
+                    }
+            }, options.minSeconds);
+
+            const double xmlSaveNs = timeCall ([&]
+            {
+                for (size_t instance = 0; instance < cores.size(); ++instance)
+                    xmlSession[instance] = getState (cores[instance]).toXml();
+            }, options.minSeconds);
+
+            const double xmlLoadNs = timeCall ([&]
+            {
+                PresetState state;
+
+                for (size_t instance = 0; instance < cores.size(); ++instance)
+                    if (state.readXml (xmlSession[instance]))
+                    {
+                        cores[instance].setParameters (state.getParameters());
+                        cores[instance].setStageOrder (StageOrder::fromCode ((int) state.get (stageOrderField)));
+                    }
+            }, options.minSeconds);
+
+            double binaryBytes = 0.0, xmlBytes = 0.0;
+
+            for (size_t instance = 0; instance < cores.size(); ++instance)
+            {
+                binaryBytes += sizes[instance];
+                xmlBytes += (double) xmlSession[instance].size();
+            }
+
+            const struct { const char* name; double saveNs, loadNs, bytes; } results[] =
+            {
+                { "binary", binarySaveNs, binaryLoadNs, binaryBytes / numInstances },
+                { "xml", xmlSaveNs, xmlLoadNs, xmlBytes / numInstances }
+            };
+
+            for (const auto& result : results)
+            {
+                if (options.csv)
+                    std::printf ("%d,%s,%.2f,%.2f,%.1f\n", numInstances, result.name, result.saveNs / 1000.0, result.loadNs / 1000.0, result.bytes);
+                else
+                    std::printf ("%-10d %-7s %10.1f %10.1f %10.1f %9.0f ns\n", numInstances, result.name, result.saveNs / 1000.0,
+                                 result.loadNs / 1000.0, result.bytes, (result.saveNs + result.loadNs) / numInstances);
+            }
+        }
+
+        if (options.csv)
+            return;
+
+        // the audio thread: blocks while the parameters glide and the types crossfade, against the
+        // same blocks once it's settled on the program switched to
+        TestBuffer buffer (2, blockSize);
+        const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+        const int blocksPerChange = (int) std::ceil (MultiEffectCore::parameterRampSeconds * sampleRate / blockSize);
+        const int programs[] = { 1, 6 };
+
+        MultiEffectCore crossfading, settled;
+        crossfading.prepare (sampleRate, 2);
+        settled.setParameters (PresetState::getProgram (programs[1]).getParameters());
+        settled.prepare (sampleRate, 2);
+
+        int change = 0;
+
+        const double crossfadeNs = timeCall ([&]
+        {
+            crossfading.setParameters (PresetState::getProgram (programs[change++ % 2]).getParameters());
+
+            for (int block = 0; block < blocksPerChange; ++block)
+                runStage (crossfading, buffer, chainStage);
+        }, options.minSeconds) / blocksPerChange - copyNs;
+
+        const double settledNs = timeCall ([&] { runStage (settled, buffer, chainStage); }, options.minSeconds) - copyNs;
+
+        std::printf ("\nprogram change (%s <-> %s), block %d at %g Hz: %.2f ns/sample while crossfading, %.2f settled\n",
+                     PresetState::getProgramName (programs[0]), PresetState::getProgramName (programs[1]), blockSize, sampleRate,
+                     crossfadeNs / (2.0 * blockSize), settledNs / (2.0 * blockSize));
+    }
+
+    // cost of the automation path: a parameter event per block that changes nothing, and
+    // continuous ramps on all three continuous parameters
+    void runAutomationSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        std::printf ("\nautomation overhead, rm/hard/pulse, block %d at %g Hz\n", blockSize, sampleRate);
+        std::printf ("%-8s %-26s %10s %10s\n", "lfo", "case", "ns/smp", "overhead");
+
+        TestBuffer buffer (2, blockSize);
+        const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+        const double samplesPerCall = (double) blockSize * buffer.getNumChannels();
+
+        for (auto backend : { exactLfo, wavetableLfo, rotatorLfo })
+        {
+            double staticNs = 0.0;
+
+            for (int automationCase = 0; automationCase < 3; ++automationCase)
+            {
+                MultiEffectCore core;
+                core.setLfoBackend (backend);
+                core.setOverdrive (8.0);
+                core.prepare (sampleRate);
+
+                long long numBlocks = 0;
+
+                const auto processBlock = [&]
+                {
+                    buffer.refill();
+
+                    // ramps are 50ms, so moving every parameter every other block keeps them ramping all the time
+                    const bool flip = (numBlocks++ / 2) % 2 == 0;
+                    const ParameterEvent unchanged[] = { { blockSize / 2, overdriveParam, 8.0 } };
+                    const ParameterEvent moving[] = { { 0, modFreqParam, flip ? 150.0 : 100.0 },
+                                                      { blockSize / 3, overdriveParam, flip ? 10.0 : 8.0 },
+                                                      { blockSize / 2, pulserFreqParam, flip ? 3.0 : 2.0 } };
+
+                    if (automationCase == 0)
+                        core.process (buffer.pointers.data(), buffer.getNumChannels(), blockSize);
+                    else if (automationCase == 1)
+                        core.process (buffer.pointers.data(), buffer.getNumChannels(), blockSize, unchanged, 1);
+                    else
+                        core.process (buffer.pointers.data(), buffer.getNumChannels(), blockSize, moving, 3);
+
+                    checksum += buffer.work[0][0];
+                };
+
+                const double nsPerSample = std::max (1.0e-3, timeCall (processBlock, options.minSeconds) - copyNs) / samplesPerCall;
+
+                if (automationCase == 0)
+                    staticNs = nsPerSample;
+
+                const char* caseNames[] = { "static", "event, no change", "continuous ramps" };
+                std::printf ("%-8s %-26s %10.3f %9.1f%%\n", getBackendName (backend), caseNames[automationCase], nsPerSample,
+                             100.0 * (nsPerSample - staticNs) / staticNs);
+            }
+        }
+    }
+
+    void runSpecialisationSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        std::printf ("\nspecialised vs runtime-flag kernels, block %d at %g Hz\n", blockSize, sampleRate);
+        std::printf ("%-16s %14s %14s %9s\n", "configuration", "runtime ns/smp", "special ns/smp", "speedup");
+
+        TestBuffer buffer (2, blockSize);
+        const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+        const double samplesPerCall = (double) blockSize * buffer.getNumChannels();
+
+        for (const auto& configuration : getAllConfigurations())
+        {
+            double nsPerSample[2];
+
+            for (int specialised = 0; specialised < 2; ++specialised)
+            {
+                MultiEffectCore core;
+                configuration.applyTo (core);
+                core.setSpecialisedProcessing (specialised != 0);
+                core.setIdleFastPaths (false);
+                core.prepare (sampleRate);
+
+                nsPerSample[specialised] = std::max (1.0e-3, timeCall ([&] { runStage (core, buffer, chainStage); }, options.minSeconds) - copyNs) / samplesPerCall;
+            }
+
+            std::printf ("%-16s %14.3f %14.3f %8.2fx\n", configuration.getName().c_str(), nsPerSample[0], nsPerSample[1], nsPerSample[0] / nsPerSample[1]);
+        }
+    }
+
+    //==============================================================================
+    // the batch renderer's pieces: the pool runs every task once whoever ends up with it, and a job
+    // streamed through files in small chunks comes out the same as the file rendered in memory
+    bool runBatchVerify (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        VerifyReport report;
+
+        std::printf ("\nbatch rendering\n");
+
+        // tasks of very different lengths, so the threads that finish early have to steal
+        {
+            const int numTasks = 200;
+            WorkStealingPool pool (4);
+            std::vector<std::atomic<int>> runs ((size_t) numTasks);
+            std::vector<std::atomic<int>> tasksPerThread ((size_t) pool.getNumThreads());
+
+            pool.run (numTasks, [&] (int task, int thread)
+            {
+                runs[(size_t) task]++;
+                tasksPerThread[(size_t) thread]++;
+
+                if (task % 4 == 0)
+                    std::this_thread::sleep_for (std::chrono::microseconds (200));
+            });
+
+            const int wrong = (int) std::count_if (runs.begin(), runs.end(), [] (const std::atomic<int>& count) { return count.load() != 1; });
+            const int fewest = std::min_element (tasksPerThread.begin(), tasksPerThread.end(),
+                                                 [] (const std::atomic<int>& a, const std::atomic<int>& b) { return a.load() < b.load(); })->load();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d tasks on %d threads, %d wrong, fewest %d", numTasks, pool.getNumThreads(), wrong, fewest);
+            report.check ("every task run once", wrong == 0, detail);
+        }
+
+        {
+            const auto directory = std::filesystem::temp_directory_path();
+            const auto inputPath = (directory / "mfx_bench_batch_in.wav").string();
+            const auto outputPath = (directory / "mfx_bench_batch_out.wav").string();
+
+            AudioFileData input;
+            input.sampleRate = sampleRate;
+            input.channels = makeStimulus (burstStimulus, 2, (int) (sampleRate * 2.0) + 123, sampleRate);
+
+            std::string error;
+            double maxDiff = 1.0;
+            int numFrames = 0;
+
+            if (writeWavFile (inputPath, input, 32, error))
+            {
+                // 1000 sample chunks of 300 sample blocks, with the 4x filters' latency to take off the start
+                RenderJob job { inputPath, outputPath, { "--oversample", "4", "--block", "300", "--mod-type", "am" } };
+                RenderResult result;
+                AudioFileData output;
+
+                MultiEffectCore core;
+                core.setOversampling (4, firOversampling);
+                core.setModType (am);
+                core.prepare (sampleRate, 2);
+
+                auto padded = input.channels;
+
+                for (auto& channel : padded)
+                    channel.resize (channel.size() + (size_t) core.getLatencySamples(), 0.0f);
+
+                auto expected = renderThroughCore (core, padded, 300, false);
+
+                for (auto& channel : expected)
+                    channel.erase (channel.begin(), channel.begin() + core.getLatencySamples());
+
+                if (runRenderJob (job, 1000, result, error) && readWavFile (outputPath, output, error) && output.getNumSamples() == input.getNumSamples())
+                {
+                    maxDiff = compareRenders (output.channels, expected).maxDiff;
+                    numFrames = output.getNumSamples();
+                }
+            }
+
+            std::remove (inputPath.c_str());
+            std::remove (outputPath.c_str());
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d frames, max diff %g %s", numFrames, maxDiff, error.c_str());
+            report.check ("streamed job vs in memory", maxDiff == 0.0, detail);
+        }
+
+        return report.allPassed;
+    }
+
+    //==============================================================================
+    // the output of a core set to start at a sample position, next to one that got there from the start
+    std::vector<std::vector<float>> getTail (const std::vector<std::vector<float>>& audio, int start)
+    {
+        std::vector<std::vector<float>> tail;
+
+        for (const auto& channel : audio)
+            tail.emplace_back (channel.begin() + start, channel.end());
+
+        return tail;
+    }
+
+    bool readFileBytes (const std::string& path, std::vector<char>& bytes)
+    {
+        std::ifstream stream (path, std::ios::binary);
+        bytes.assign (std::istreambuf_iterator<char> (stream), std::istreambuf_iterator<char>());
+        return stream.good() || stream.eof();
+    }
+
+    bool runPositionVerify (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) (sampleRate * 4.0);
+        VerifyReport report;
+
+        std::printf ("\nsample position\n");
+
+        const auto input = makeStimulus (burstStimulus, 2, numSamples, sampleRate);
+
+        const auto setUp = [&] (MultiEffectCore& core, lfoBackend backend, bool distortionOn)
+        {
+            core.setLfoBackend (backend);
+            core.setModType (am);
+            core.setModFreq (37.0);
+            core.setPulserFreq (3.0);
+            core.setOverdrive (8.0);
+            core.setDistEnabled (distortionOn);
+            core.setTanhApprox (exactTanh);
+            core.prepare (sampleRate, 2);
+        };
+
+        // with the distortion off and first, its make-up gain sees the same level going in and coming
+        // out, so the level followers make no difference and a core started partway through needs no
+        // pre-roll. Their envelopes still differ, which is why this one compares the output only
+        for (auto backend : { exactLfo, wavetableLfo, rotatorLfo })
+        {
+            const int start = (int) sampleRate + 77;
+
+            StageOrder order;
+            order.stages[0] = distStage;
+            order.stages[1] = modStage;
+            order.stages[2] = pulserStage;
+
+            MultiEffectCore whole, started;
+
+            for (auto* core : { &whole, &started })
+            {
+                core->setStageOrder (order);
+                setUp (*core, backend, false);
+            }
+
+            started.setSamplePosition (start);
+
+            const auto expected = getTail (renderThroughCore (whole, input, 512, false), start);
+            const auto output = renderThroughCore (started, getTail (input, start), 300, false);
+            const double maxDiff = compareRenders (output, expected).maxDiff;
+
+            char name[64], detail[128];
+            std::snprintf (name, sizeof (name), "started at %d, %s", start, getBackendName (backend));
+            std::snprintf (detail, sizeof (detail), "dist off and first, max diff %g", maxDiff);
+            report.check (name, maxDiff == 0.0, detail);
+        }
+
+        // a frequency glide lands the same way whatever the blocks, so the phases carry on alike
+        {
+            std::vector<std::vector<float>> outputs;
+            std::vector<uint64_t> hashes;
+
+            for (auto blockSize : { 16, 300, 2048 })
+            {
+                MultiEffectCore core;
+                setUp (core, rotatorLfo, true);
+                core.setModFreq (900.0);
+                core.setPulserFreq (7.5);
+
+                auto output = renderThroughCore (core, input, blockSize, false);
+                outputs.push_back (output[0]);
+                outputs.push_back (output[1]);
+                hashes.push_back (core.getStateHash());
+            }
+
+            double maxDiff = 0.0;
+
+            for (size_t i = 2; i < outputs.size(); ++i)
+                maxDiff = std::max (maxDiff, compareRenders (std::vector<std::vector<float>> { outputs[i] },
+                                                             std::vector<std::vector<float>> { outputs[i % 2] }).maxDiff);
+
+            const bool hashesMatch = hashes[1] == hashes[0] && hashes[2] == hashes[0];
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "blocks 16, 300, 2048: max diff %g, hashes %s", maxDiff, hashesMatch ? "match" : "differ");
+            report.check ("glide at any block size", maxDiff == 0.0 && hashesMatch, detail);
+        }
+
+        // the level followers need a pre-roll to settle. Long enough and the whole state matches,
+        // too short and the hash has to tell
+        {
+            const int blockSize = 512;
+            const int start = blockSize * 200;
+
+            MultiEffectCore whole;
+            setUp (whole, rotatorLfo, true);
+
+            auto head = input;
+
+            for (auto& channel : head)
+                channel.resize ((size_t) start);
+
+            renderThroughCore (whole, head, blockSize, false);
+            const auto wholeHash = whole.getStateHash();
+            const auto expected = renderThroughCore (whole, getTail (input, start), blockSize, false);
+
+            for (auto preRollBlocks : { 0, 188 })
+            {
+                const int preRollStart = start - preRollBlocks * blockSize;
+
+                MultiEffectCore section;
+                setUp (section, rotatorLfo, true);
+                section.setSamplePosition (preRollStart);
+
+                auto preRoll = getTail (input, preRollStart);
+
+                for (auto& channel : preRoll)
+                    channel.resize ((size_t) (start - preRollStart));
+
+                renderThroughCore (section, preRoll, blockSize, false);
+                const bool hashesMatch = section.getStateHash() == wholeHash;
+                const double maxDiff = compareRenders (renderThroughCore (section, getTail (input, start), blockSize, false), expected).maxDiff;
+
+                char name[64], detail[128];
+                std::snprintf (name, sizeof (name), "section, %d block pre-roll", preRollBlocks);
+                std::snprintf (detail, sizeof (detail), "hashes %s, max diff %g", hashesMatch ? "match" : "differ", maxDiff);
+                report.check (name, preRollBlocks == 0 ? (! hashesMatch && maxDiff > 0.0) : (hashesMatch && maxDiff == 0.0), detail);
+            }
+        }
+
+        // the same job rendered whole and in sections joined up, down to the byte
+        {
+            const auto directory = std::filesystem::temp_directory_path();
+            const auto inputPath = (directory / "mfx_bench_position_in.wav").string();
+            const auto wholePath = (directory / "mfx_bench_position_whole.wav").string();
+            const auto splitPath = (directory / "mfx_bench_position_split.wav").string();
+
+            AudioFileData audio;
+            audio.sampleRate = sampleRate;
+            audio.channels = input;
+
+            const std::vector<std::string> jobOptions { "--oversample", "2", "--os-filter", "iir", "--level-detector", "rms", "--bits", "24" };
+            const RenderJob wholeJob { inputPath, wholePath, jobOptions };
+            const RenderJob splitJob { inputPath, splitPath, jobOptions };
+
+            std::string error;
+            std::vector<RenderSection> sections;
+            RenderResult wholeResult, splitResult;
+            std::vector<char> wholeBytes, splitBytes;
+            bool joined = false;
+
+            if (writeWavFile (inputPath, audio, 32, error)
+                 && runRenderJob (wholeJob, 1000, wholeResult, error)
+                 && splitRenderJob (splitJob, 1.0, 0.5, 1000, sections, error))
+            {
+                joined = true;
+
+                for (auto& section : sections)
+                    joined = joined && runRenderSection (splitJob, section, 1000, error);
+
+                joined = joined && joinRenderSections (splitJob, sections, 1000, splitResult, error)
+                                && readFileBytes (wholePath, wholeBytes) && readFileBytes (splitPath, splitBytes);
+            }
+
+            std::remove (inputPath.c_str());
+            std::remove (wholePath.c_str());
+            std::remove (splitPath.c_str());
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d sections, %d rendered again, %zu bytes %s", splitResult.numSections, splitResult.numRerendered,
+                           splitBytes.size(), error.c_str());
+            report.check ("split job vs whole", joined && ! wholeBytes.empty() && splitBytes == wholeBytes, detail);
+        }
+
+        return report.allPassed;
+    }
+
+    //==============================================================================
+   #if MFX_REALTIME_GUARD
+    // a value within the parameter's range, for the events and setters thrown at the core
+    double getRandomValue (parameterId parameter, std::mt19937& rng)
+    {
+        std::uniform_real_distribution<double> unit (0.0, 1.0);
+
+        switch (parameter)
+        {
+            case modFreqParam:          return unit (rng) * MOD_FREQ_LIMIT;
+            case overdriveParam:        return 1.0 + unit (rng) * (OVERDRIVE_LIMIT - 1.0);
+            case pulserFreqParam:       return unit (rng) * PULSER_FREQ_LIMIT;
+            case modTypeParam:          return unit (rng) < 0.5 ? rm : am;
+            case distTypeParam:         return unit (rng) < 0.5 ? soft : hard;
+            case distMixParam:          return unit (rng);
+            case levelAttackParam:      return 0.1 + unit (rng) * LEVEL_ATTACK_LIMIT;
+            case levelReleaseParam:     return 0.1 + unit (rng) * LEVEL_RELEASE_LIMIT;
+            case levelDetectorParam:    return unit (rng) < 0.5 ? peakLevel : rmsLevel;
+            default:                    return unit (rng) < 0.5 ? 1.0 : 0.0;
+        }
+    }
+   #endif
+
+    bool runRealtimeVerify (const BenchOptions& options)
+    {
+        VerifyReport report;
+
+        std::printf ("\nreal-time safety of the audio thread\n");
+
+       #if MFX_REALTIME_GUARD
+        // the guard has to see what it's there to catch, or a clean run below means nothing
+        {
+            static std::vector<float>* volatile allocated = nullptr;
+            std::mutex mutex;
+
+            RealtimeGuard::clearViolations();
+
+            {
+                const RealtimeGuard::ScopedCheck check;
+                allocated = new std::vector<float> (16);
+                delete allocated;
+
+                const std::lock_guard<std::mutex> lock (mutex);
+            }
+
+            const int expected = RealtimeGuard::catchesLocks() ? 3 : 2;
+            const int caught = RealtimeGuard::getNumViolations();
+            RealtimeGuard::clearViolations();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "new, delete%s: %d calls caught", RealtimeGuard::catchesLocks() ? ", lock" : "", caught);
+            report.check ("guard catches violations", caught >= expected, detail);
+        }
+
+        // everything the host or the editor can do to the core between and during callbacks, with
+        // only the callbacks themselves checked. Re-preparing (a new layout or rate) is the one thing
+        // that may allocate, and the host does that with processing stopped, so it stays outside
+        {
+            struct Layout
+            {
+                double sampleRate;
+                int numChannels;
+                int oversampling;
+                oversamplingFilter filter;
+            };
+
+            const Layout layouts[] = { { 44100.0, 2, 1, iirOversampling }, { 48000.0, 1, 2, firOversampling }, { 96000.0, 6, 4, iirOversampling },
+                                       { 48000.0, 8, 8, firOversampling }, { 192000.0, 2, 1, firOversampling }, { 22050.0, 3, 2, iirOversampling } };
+
+            const int maxChannels = 8;
+            const int maxBlockSize = 4 * 512;
+            const int blocksPerLayout = options.onlyBlockSize > 0 ? 200 : 400;
+
+            std::mt19937 rng (2112);
+            std::uniform_real_distribution<float> noise (-1.0f, 1.0f);
+
+            std::vector<std::vector<float>> floatAudio ((size_t) maxChannels, std::vector<float> ((size_t) maxBlockSize));
+            std::vector<std::vector<double>> doubleAudio ((size_t) maxChannels, std::vector<double> ((size_t) maxBlockSize));
+            std::vector<float*> floatChannels;
+            std::vector<double*> doubleChannels;
+
+            for (int channel = 0; channel < maxChannels; ++channel)
+            {
+                floatChannels.push_back (floatAudio[(size_t) channel].data());
+                doubleChannels.push_back (doubleAudio[(size_t) channel].data());
+            }
+
+            std::vector<ParameterSnapshot> programs;
+
+            for (int program = 0; program < PresetState::getNumPrograms(); ++program)
+                programs.push_back (PresetState::getProgram (program).getParameters());
+
+            std::vector<ParameterEvent> events (64);
+            long numBlocks = 0;
+            bool finite = true;
+
+            RealtimeGuard::clearViolations();
+
+            for (const auto& layout : layouts)
+            {
+                MultiEffectCore core;
+                core.setOversampling (layout.oversampling, layout.filter);
+                core.setAdaptiveQuality (true);
+                core.prepare (layout.sampleRate, layout.numChannels);
+                core.getCpuMeter().setEnabled (true);
+                core.getSignalTap().setEnabled (true);
+
+                for (int block = 0; block < blocksPerLayout; ++block)
+                {
+                    // now and then a block of silence, so the idle paths come and go as well
+                    const bool silent = rng() % 8 == 0;
+                    const int numSamples = 1 + (int) (rng() % (rng() % 4 == 0 ? maxBlockSize : 512));
+
+                    for (int channel = 0; channel < layout.numChannels; ++channel)
+                    {
+                        for (int sample = 0; sample < numSamples; ++sample)
+                        {
+                            const float value = silent ? 0.0f : noise (rng);
+                            floatAudio[(size_t) channel][(size_t) sample] = value;
+                            doubleAudio[(size_t) channel][(size_t) sample] = value;
+                        }
+                    }
+
+                    const RealtimeGuard::ScopedCheck check;
+
+                    // setters and program changes, as if from the message thread just before the callback
+                    for (int numSets = (int) (rng() % 4); --numSets >= 0;)
+                    {
+                        switch (rng() % 12)
+                        {
+                            case 0:     core.setModFreq (getRandomValue (modFreqParam, rng)); break;
+                            case 1:     core.setOverdrive (getRandomValue (overdriveParam, rng)); break;
+                            case 2:     core.setPulserFreq (getRandomValue (pulserFreqParam, rng)); break;
+                            case 3:     core.setModType (rng() % 2 == 0 ? rm : am); break;
+                            case 4:     core.setDistType (rng() % 2 == 0 ? soft : hard); break;
+                            case 5:     core.setDistMix (getRandomValue (distMixParam, rng)); break;
+                            case 6:     core.setLevelRelease (getRandomValue (levelReleaseParam, rng)); break;
+                            case 7:     core.setLevelLink (rng() % 2 == 0); break;
+                            case 8:     core.setBypassed (rng() % 4 == 0); break;
+                            case 9:     core.setParameters (programs[rng() % programs.size()]); break;
+                            case 10:    core.setStageOrder (StageOrder::fromIndex ((int) (rng() % (unsigned int) StageOrder::getNumOrders()))); break;
+                            default:    core.setModEnabled (rng() % 2 == 0); break;
+                        }
+                    }
+
+                    if (rng() % 16 == 0)
+                        core.setLfoBackend ((lfoBackend) (exactLfo + (int) (rng() % 3)));
+
+                    if (rng() % 16 == 0)
+                        core.setChannelLanes (1 + (int) (rng() % LfoOscillator::maxLanes));
+
+                    // the quality tiers come and go, and now and then it's all switched back to full
+                    if (rng() % 16 == 0)
+                        core.getQualityGovernor().setShare (rng() % 2 == 0 ? 1.0e-6 : 1.0);
+
+                    if (rng() % 32 == 0)
+                        core.setAdaptiveQuality (rng() % 4 != 0);
+
+                    int numEvents = 0;
+
+                    if (rng() % 2 == 0)
+                    {
+                        numEvents = (int) (rng() % events.size());
+                        int offset = 0;
+
+                        for (int index = 0; index < numEvents; ++index)
+                        {
+                            offset = std::min (numSamples - 1, offset + (int) (rng() % 64));
+                            const auto parameter = (parameterId) (rng() % numParameters);
+                            events[(size_t) index] = { offset, parameter, getRandomValue (parameter, rng) };
+                        }
+                    }
+
+                    // the host may hand over fewer channels than were prepared
+                    const int numChannels = 1 + (int) (rng() % (unsigned int) layout.numChannels);
+
+                    if (rng() % 2 == 0)
+                    {
+                        core.process (floatChannels.data(), numChannels, numSamples, events.data(), numEvents);
+                        finite = finite && std::isfinite (floatAudio[0][(size_t) numSamples - 1]);
+                    }
+                    else
+                    {
+                        core.process (doubleChannels.data(), numChannels, numSamples, events.data(), numEvents);
+                        finite = finite && std::isfinite (doubleAudio[0][(size_t) numSamples - 1]);
+                    }
+
+                    ++numBlocks;
+                }
+            }
+
+            const int numViolations = RealtimeGuard::getNumViolations();
+
+            if (numViolations > 0)
+                RealtimeGuard::printViolations (stdout, 8);
+
+            RealtimeGuard::clearViolations();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%ld blocks, %d layouts: %d violations%s", numBlocks, (int) std::size (layouts), numViolations,
+                           finite ? "" : ", output not finite");
+            report.check ("fuzzed callbacks", numViolations == 0 && finite, detail);
+        }
+       #else
+        (void) options;
+        report.check ("guard not built in", true, "skipped (MFX_REALTIME_GUARD is off)");
+       #endif
+
+        return report.allPassed;
+    }
+
+    //==============================================================================
+    // a core with only the pulser on, at its fastest unless it's given a frequency
+    void setUpPulserOnly (MultiEffectCore& core, lfoBackend backend, int controlInterval, double pulserFreq = PULSER_FREQ_LIMIT)
+    {
+        core.setModFreq (0.0);
+        core.setOverdrive (1.0);
+        core.setPulserFreq (pulserFreq);
+        core.setLfoBackend (backend);
+        core.setPulserControlInterval (controlInterval);
+    }
+
+    bool runPulserVerify (const BenchOptions& options)
+    {
+        VerifyReport report;
+
+        std::printf ("\npulser at the control rate\n");
+
+        // with a constant input the output is the pulser's gain, which has to be within the stated
+        // bound of the one worked out every sample (itself within 1e-13 of the exact sine)
+        for (auto sampleRate : { 22050.0, 44100.0, 96000.0, 192000.0 })
+        {
+            if (options.onlySampleRate > 0.0 && sampleRate != options.onlySampleRate)
+                continue;
+
+            const std::vector<std::vector<double>> input (1, std::vector<double> ((size_t) (sampleRate * 2.0), 1.0));
+
+            const auto render = [&] (int controlInterval)
+            {
+                MultiEffectCore core;
+                setUpPulserOnly (core, exactLfo, controlInterval);
+                core.prepare (sampleRate, 1);
+                return renderThroughCore (core, input, 512, false);
+            };
+
+            const auto expected = render (1);
+            double worstDiff = 0.0, worstRatio = 0.0;
+            bool withinBound = true;
+
+            for (auto controlInterval : { 16, 32, 64 })
+            {
+                const double maxDiff = compareRenders (render (controlInterval), expected).maxDiff;
+                const double bound = std::pow (LfoOscillator::twoPi * PULSER_FREQ_LIMIT * controlInterval / sampleRate, 4.0) / 768.0;
+
+                withinBound = withinBound && maxDiff <= bound + 1.0e-12;
+                worstDiff = std::max (worstDiff, maxDiff);
+                worstRatio = std::max (worstRatio, maxDiff / bound);
+            }
+
+            char name[64], detail[128];
+            std::snprintf (name, sizeof (name), "gain error at %g Hz", sampleRate);
+            std::snprintf (detail, sizeof (detail), "every 16, 32, 64: max diff %.3g, %.2f of the bound", worstDiff, worstRatio);
+            report.check (name, withinBound, detail);
+        }
+
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int numSamples = (int) (sampleRate * 3.0);
+        const auto input = makeStimulus (burstStimulus, 2, numSamples, sampleRate);
+
+        // the curve only depends on the position, and a glide switches to every sample and back on
+        // the same samples whatever the blocks
+        {
+            std::vector<std::vector<std::vector<float>>> outputs;
+            std::vector<uint64_t> hashes;
+
+            for (auto blockSize : { 16, 300, 2048 })
+            {
+                MultiEffectCore core;
+                setUpPulserOnly (core, rotatorLfo, 32, PULSER_FREQ_INIT);
+                core.setModFreq (MOD_FREQ_INIT);
+                core.setOverdrive (8.0);
+                core.prepare (sampleRate, 2);
+
+                auto timeline = makeTimeline ({ pulserFreqParam, modFreqParam }, 12, numSamples, 31);
+                outputs.push_back (renderWithTimeline (core, input, blockSize, timeline));
+                hashes.push_back (core.getStateHash());
+            }
+
+            const double maxDiff = std::max (compareRenders (outputs[1], outputs[0]).maxDiff, compareRenders (outputs[2], outputs[0]).maxDiff);
+            const bool hashesMatch = hashes[1] == hashes[0] && hashes[2] == hashes[0];
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "glides, blocks 16, 300, 2048: max diff %g, hashes %s", maxDiff, hashesMatch ? "match" : "differ");
+            report.check ("every 32 at any block size", maxDiff == 0.0 && hashesMatch, detail);
+        }
+
+        // the reference chain takes the same curve for each channel as the kernel shares between them
+        {
+            MultiEffectCore fused, reference;
+
+            for (auto* core : { &fused, &reference })
+            {
+                core->setModType (am);
+                core->setOverdrive (8.0);
+                core->setTanhApprox (exactTanh);
+                core->setPulserFreq (7.0);
+                core->setPulserControlInterval (64);
+                core->prepare (sampleRate, 2);
+            }
+
+            const auto fusedOut = renderThroughCore (fused, input, 300, false);
+            const auto referenceOut = renderThroughCore (reference, input, 300, true, MultiEffectCore::subBlockSize);
+            const double maxDiff = compareRenders (fusedOut, referenceOut).maxDiff;
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "every 64, whole chain: max diff %g", maxDiff);
+            report.check ("kernel vs reference chain", maxDiff == 0.0, detail);
+        }
+
+        return report.allPassed;
+    }
+
+    // what the pulser costs per sample at the audio rate and the control rate, as the difference
+    // between the chain with and without it (the rest of it neutral, with the idle paths off so the
+    // rest of the work stays the same)
+    void runPulserSuite (const BenchOptions& options)
+    {
+        struct PulserCase
+        {
+            const char* name;
+            lfoBackend backend;
+            int controlInterval;
+        };
+
+        const PulserCase cases[] = { { "exact, every sample", exactLfo, 1 }, { "rotator, every sample", rotatorLfo, 1 },
+                                     { "every 16", rotatorLfo, 16 }, { "every 32", rotatorLfo, 32 }, { "every 64", rotatorLfo, 64 } };
+
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+
+        std::printf ("\npulser cost, block %d at %g Hz\n", blockSize, sampleRate);
+        std::printf ("%8s %-22s %12s %10s\n", "channels", "pulser", "ns/sample", "vs exact");
+
+        for (auto numChannels : { 2, 8 })
+        {
+            TestBuffer buffer (numChannels, blockSize);
+            const double samplesPerCall = (double) blockSize * numChannels;
+
+            double exactNs = 0.0;
+
+            for (const auto& pulserCase : cases)
+            {
+                MultiEffectCore withPulser, without;
+
+                for (auto* core : { &withPulser, &without })
+                {
+                    setUpPulserOnly (*core, pulserCase.backend, pulserCase.controlInterval, core == &withPulser ? PULSER_FREQ_INIT : 0.0);
+                    core->setIdleFastPaths (false);
+                    core->prepare (sampleRate, numChannels);
+                }
+
+                // the fastest of a few goes at each, taken in turns, as the difference is small
+                double withNs = 1.0e30, withoutNs = 1.0e30;
+
+                for (int round = 0; round < 5; ++round)
+                {
+                    withNs = std::min (withNs, timeCall ([&] { runStage (withPulser, buffer, chainStage); }, options.minSeconds));
+                    withoutNs = std::min (withoutNs, timeCall ([&] { runStage (without, buffer, chainStage); }, options.minSeconds));
+                }
+
+                const double ns = std::max (0.0, withNs - withoutNs) / samplesPerCall;
+
+                if (pulserCase.controlInterval == 1 && pulserCase.backend == exactLfo)
+                    exactNs = ns;
+
+                std::printf ("%8d %-22s %12.3f %9.1fx\n", numChannels, pulserCase.name, ns, ns > 0.0 ? exactNs / ns : 0.0);
+            }
+        }
+    }
+
+    //==============================================================================
+    // the governor on made-up timings first, then a core that's pushed all the way down and back up
+    // again by its share of the callback: nothing changes while it's held at full quality, the
+    // lighter oversampling lines up with the full one, and no change of tier jumps further from
+    // one sample to the next than the signal itself does
+    bool runQualityVerify (const BenchOptions& options)
+    {
+        VerifyReport report;
+
+        std::printf ("\nadaptive quality\n");
+
+        {
+            QualityGovernor governor;
+            governor.prepare (48000.0);
+
+            const double blockSeconds = 512.0 / 48000.0;
+
+            // how long blocks of the load took to get to the tier, or -1 if they didn't
+            const auto run = [&] (double load, double maxSeconds, qualityTier tier)
+            {
+                for (double seconds = blockSeconds; seconds < maxSeconds; seconds += blockSeconds)
+                    if (governor.update (load * blockSeconds, 512) == tier)
+                        return seconds;
+
+                return -1.0;
+            };
+
+            const double down = run (0.8, 2.0, minimumQuality);
+            const double up = run (0.1, 10.0, fullQuality);
+
+            // one overrun against plenty of headroom isn't enough
+            const bool spikeIgnored = governor.update (3.0 * blockSeconds, 512) == fullQuality;
+
+            // a step up that doesn't last doubles the wait for the next one
+            // (after long enough at full quality that stepping down doesn't count against it)
+            governor.setLowestTier (reducedQuality);
+            run (0.1, 5.0, reducedQuality);
+            const bool reduced = run (0.8, 2.0, reducedQuality) > 0.0;
+            const double firstTry = run (0.1, 10.0, fullQuality);
+            const bool backDown = run (0.8, 2.0, reducedQuality) > 0.0;
+            const double secondTry = run (0.1, 10.0, fullQuality);
+
+            const double holdUp = QualityGovernor::holdUpSeconds;
+            const bool passed = down > 0.0 && down < 1.0 && up > 3.0 * holdUp && up < 3.0 * holdUp + 0.5 && spikeIgnored
+                                 && reduced && backDown && firstTry < holdUp + 0.5 && secondTry > 2.0 * holdUp && secondTry < 2.0 * holdUp + 0.5;
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "down %.2fs, up %.2fs, retry %.2fs then %.2fs", down, up, firstTry, secondTry);
+            report.check ("governor on made-up loads", passed, detail);
+        }
+
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int blockSize = 256;
+        const int numSamples = (int) (sampleRate * 10.0);
+        const auto input = makeStimulus (sineStimulus, 2, numSamples, sampleRate);
+
+        // the exact LFO, the pulser every sample, the Pade tanh and 4x oversampling, so every tier
+        // has something to give up. The share is next to nothing for the first second, which takes
+        // it straight down, and the whole callback after that
+        const auto render = [&] (bool adaptive, bool holdAtFull, std::vector<qualityTier>& tiers, MultiEffectCore& core)
+        {
+            core.setModFreq (0.0);
+            core.setDistType (soft);
+            core.setOverdrive (4.0);
+            core.setPulserFreq (PULSER_FREQ_INIT);
+            core.setLfoBackend (exactLfo);
+            core.setTanhApprox (padeTanh);
+            core.setOversampling (4, iirOversampling);
+            core.setAdaptiveQuality (adaptive);
+            core.prepare (sampleRate, 2);
+
+            if (holdAtFull)
+                core.getQualityGovernor().setLowestTier (fullQuality);
+
+            auto audio = input;
+            float* pointers[2];
+
+            for (int start = 0; start < numSamples; start += blockSize)
+            {
+                const int numThisTime = std::min (blockSize, numSamples - start);
+                core.getQualityGovernor().setShare (start < (int) sampleRate ? 1.0e-6 : 1.0);
+
+                for (int channel = 0; channel < 2; ++channel)
+                    pointers[channel] = audio[(size_t) channel].data() + start;
+
+                core.process (pointers, 2, numThisTime);
+                tiers.push_back (core.getQualityTier());
+            }
+
+            return audio;
+        };
+
+        std::vector<qualityTier> fixedTiers, heldTiers, tiers;
+        MultiEffectCore fixedCore, heldCore, core;
+
+        const auto expected = render (false, false, fixedTiers, fixedCore);
+        const auto held = render (true, true, heldTiers, heldCore);
+        const auto output = render (true, false, tiers, core);
+
+        {
+            const double maxDiff = compareRenders (held, expected).maxDiff;
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "adaptive, held at full quality: max diff %g", maxDiff);
+            report.check ("full quality unchanged", maxDiff == 0.0, detail);
+        }
+
+        const bool reachedMinimum = std::find (tiers.begin(), tiers.end(), minimumQuality) != tiers.end();
+        const auto& governor = core.getQualityGovernor();
+
+        {
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%lld steps down, %lld up, ends at %s", governor.getNumStepsDown(), governor.getNumStepsUp(),
+                           QualityGovernor::getTierName (tiers.back()));
+            report.check ("steps down and back up", reachedMinimum && governor.getNumStepsDown() >= 3 && governor.getNumStepsUp() >= 3
+                                               && tiers.back() == fullQuality, detail);
+        }
+
+        // with the lighter oversampling settled, only the filters and the tanh are left between them
+        {
+            const int settleBlocks = (int) (sampleRate * 0.2) / blockSize;
+            double errorEnergy = 0.0, signalEnergy = 0.0;
+            int numSettled = 0, run = 0;
+
+            for (size_t block = 0; block < tiers.size(); ++block)
+            {
+                run = tiers[block] == minimumQuality ? run + 1 : 0;
+
+                if (run <= settleBlocks)
+                    continue;
+
+                ++numSettled;
+
+                for (size_t channel = 0; channel < 2; ++channel)
+                {
+                    for (size_t i = block * blockSize; i < std::min ((block + 1) * blockSize, (size_t) numSamples); ++i)
+                    {
+                        const double diff = (double) output[channel][i] - (double) expected[channel][i];
+                        errorEnergy += diff * diff;
+                        signalEnergy += (double) expected[channel][i] * expected[channel][i];
+                    }
+                }
+            }
+
+            const double errorDb = numSettled > 0 ? 10.0 * std::log10 (errorEnergy / signalEnergy) : 0.0;
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "at minimum quality: %.1f dB from full, %d blocks", errorDb, numSettled);
+            report.check ("light path lines up", numSettled > 0 && errorDb < -30.0, detail);
+        }
+
+        {
+            double expectedJump = 0.0, worstJump = 0.0;
+
+            for (size_t channel = 0; channel < 2; ++channel)
+            {
+                for (size_t i = 1; i < (size_t) numSamples; ++i)
+                {
+                    expectedJump = std::max (expectedJump, (double) std::abs (expected[channel][i] - expected[channel][i - 1]));
+                    worstJump = std::max (worstJump, (double) std::abs (output[channel][i] - output[channel][i - 1]));
+                }
+            }
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "largest step %.4f, %.4f at full quality", worstJump, expectedJump);
+            report.check ("tier changes click-free", worstJump <= expectedJump * 1.1, detail);
+        }
+
+        // turning it off goes straight back to full quality, at the next block
+        {
+            core.getQualityGovernor().setShare (1.0e-6);
+            auto audio = input;
+            float* pointers[2] = { audio[0].data(), audio[1].data() };
+            int block = 0;
+
+            for (; block * blockSize < (int) sampleRate && core.getQualityTier() != minimumQuality; ++block)
+                core.process (pointers, 2, blockSize);
+
+            const bool wentDown = core.getQualityTier() == minimumQuality;
+            core.setAdaptiveQuality (false);
+            core.process (pointers, 2, blockSize);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "down in %d blocks, then %s quality", block, QualityGovernor::getTierName (core.getQualityTier()));
+            report.check ("off means full quality", wentDown && core.getQualityTier() == fullQuality, detail);
+        }
+
+        return report.allPassed;
+    }
+
+    //==============================================================================
+    std::string getStageOrderName (const StageOrder& order)
+    {
+        std::string name;
+
+        for (auto stage : order.stages)
+            name += std::string (name.empty() ? "" : ">") + StageOrder::getStageName (stage);
+
+        return name;
+    }
+
+    // every stage order with every combination of stages switched on, specialised and runtime-flag
+    // kernels against the reference chain, per channel and linked. Then the order and index codes,
+    // and orders swapped from a second thread while the audio thread keeps processing
+    bool runStageOrderVerify (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 300;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        VerifyReport report;
+
+        std::printf ("\nstage order, block %d at %g Hz, am/soft, overdrive 8, exact tanh\n", blockSize, sampleRate);
+
+        const auto input = makeStimulus (burstStimulus, 2, (int) (sampleRate * 0.5), sampleRate);
+        std::vector<std::vector<float>> defaultOut, reversedOut;
+
+        for (int index = 0; index < StageOrder::getNumOrders(); ++index)
+        {
+            const auto order = StageOrder::fromIndex (index);
+            double maxDiff = 0.0;
+            int numRenders = 0;
+
+            for (int enabled = 0; enabled < 8; ++enabled)
+            {
+                for (auto linked : { false, true })
+                {
+                    MultiEffectCore specialised, generic, reference;
+
+                    for (auto* core : { &specialised, &generic, &reference })
+                    {
+                        core->setModType (am);
+                        core->setDistType (soft);
+                        core->setOverdrive (8.0);
+                        core->setTanhApprox (exactTanh);
+                        core->setLevelDetector (linked ? rmsLevel : peakLevel);
+                        core->setLevelLink (linked);
+                        core->setModEnabled ((enabled & 1) != 0);
+                        core->setDistEnabled ((enabled & 2) != 0);
+                        core->setPulserEnabled ((enabled & 4) != 0);
+                        core->setStageOrder (order);
+                        core->prepare (sampleRate);
+                    }
+
+                    generic.setSpecialisedProcessing (false);
+
+                    const auto specialisedOut = renderThroughCore (specialised, input, blockSize, false);
+                    const auto genericOut = renderThroughCore (generic, input, blockSize, false);
+                    const auto referenceOut = renderThroughCore (reference, input, blockSize, true, MultiEffectCore::subBlockSize);
+
+                    maxDiff = std::max ({ maxDiff, compareRenders (specialisedOut, genericOut).maxDiff,
+                                          compareRenders (specialisedOut, referenceOut).maxDiff });
+                    numRenders += 3;
+
+                    if (enabled == 7 && ! linked && index == 0)
+                        defaultOut = specialisedOut;
+                    else if (enabled == 7 && ! linked && index == StageOrder::getNumOrders() - 1)
+                        reversedOut = specialisedOut;
+                }
+            }
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d renders, max diff %g", numRenders, maxDiff);
+            report.check (getStageOrderName (order).c_str(), maxDiff == 0.0, detail);
+        }
+
+        // a check that the order really is being followed, rather than the three paths agreeing on the default
+        {
+            const auto diff = compareRenders (reversedOut, defaultOut);
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "reversed vs default %.1f dB apart", diff.relativeErrorDb);
+            report.check ("orders sound different", diff.relativeErrorDb > -20.0, detail);
+        }
+
+        {
+            int wrong = 0;
+
+            for (int index = 0; index < StageOrder::getNumOrders(); ++index)
+            {
+                const auto order = StageOrder::fromIndex (index);
+                wrong += order.isValid() && order.getIndex() == index && StageOrder::fromCode (order.getCode()) == order ? 0 : 1;
+            }
+
+            // codes missing a stage get it put on the end, broken ones give the default
+            const StageOrder distFirst = StageOrder::fromCode (0x12);
+            const bool padded = distFirst.stages[0] == distStage && distFirst.stages[1] == modStage && distFirst.stages[2] == pulserStage;
+            const bool refused = StageOrder::fromCode (0x111) == StageOrder() && StageOrder::fromCode (0xf) == StageOrder()
+                                  && StageOrder::fromCode (-1) == StageOrder() && StageOrder::fromIndex (99) == StageOrder();
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%d orders, %d wrong, default code %d", StageOrder::getNumOrders(), wrong, StageOrder().getCode());
+            report.check ("order codes", wrong == 0 && padded && refused, detail);
+        }
+
+        // the message thread keeps swapping the order while the audio thread processes. Nothing is
+        // locked, the output has to stay finite and the last order set is the one that ends up in use
+        {
+            MultiEffectCore core;
+            core.setOverdrive (8.0);
+            core.prepare (sampleRate);
+
+            TestBuffer buffer (2, 64);
+            std::atomic<bool> running { true };
+            std::atomic<int> lastIndex { 0 };
+            long numSwaps = 0;
+
+            std::thread messageThread ([&]
+            {
+                while (running.load())
+                {
+                    const int index = (int) (numSwaps++ % StageOrder::getNumOrders());
+                    core.setStageOrder (StageOrder::fromIndex (index));
+                    lastIndex = index;
+
+                    if (numSwaps % 16 == 0)
+                        std::this_thread::yield();
+                }
+            });
+
+            bool finite = true;
+            const auto endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds (200);
+
+            while (std::chrono::steady_clock::now() < endTime)
+            {
+                runStage (core, buffer, chainStage);
+
+                for (const auto& channel : buffer.work)
+                    finite = finite && std::all_of (channel.begin(), channel.end(), [] (float sample) { return std::isfinite (sample); });
+            }
+
+            running = false;
+            messageThread.join();
+
+            // the audio thread picks the last one up at the start of its next block
+            runStage (core, buffer, chainStage);
+
+            char detail[128];
+            std::snprintf (detail, sizeof (detail), "%ld swaps, %s", numSwaps, finite ? "finite" : "not finite");
+            report.check ("orders swapped across threads", finite && numSwaps > 0 && core.getStageOrder() == StageOrder::fromIndex (lastIndex), detail);
+        }
+
+        return report.allPassed;
+    }
+
+    // each order with every stage on, and what it costs to set an order on the message thread
+    void runStageOrderSuite (const BenchOptions& options)
+    {
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+
+        std::printf ("\nstage orders, rm/hard/pulse, block %d at %g Hz\n", blockSize, sampleRate);
+        std::printf ("%-16s %10s\n", "order", "ns/smp");
+
+        TestBuffer buffer (2, blockSize);
+        const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, options.minSeconds);
+        const double samplesPerCall = (double) blockSize * buffer.getNumChannels();
+
+        for (int index = 0; index < StageOrder::getNumOrders(); ++index)
+        {
+            MultiEffectCore core;
+            core.setOverdrive (8.0);
+            core.setStageOrder (StageOrder::fromIndex (index));
+            core.setIdleFastPaths (false);
+            core.prepare (sampleRate);
+
+            const double nsPerSample = std::max (1.0e-3, timeCall ([&] { runStage (core, buffer, chainStage); }, options.minSeconds) - copyNs) / samplesPerCall;
+            std::printf ("%-16s %10.3f\n", getStageOrderName (StageOrder::fromIndex (index)).c_str(), nsPerSample);
+        }
+
+        MultiEffectCore core;
+        int index = 0;
+        const double setNs = timeCall ([&] { core.setStageOrder (StageOrder::fromIndex (index++ % StageOrder::getNumOrders())); }, options.minSeconds);
+
+        std::printf ("setStageOrder() %.0f ns, on the calling thread (the orders are compiled once per process)\n", setNs);
+    }
+
+    //==============================================================================
+    // golden output: every configuration through every processing path, against files recorded by a
+    // build that's known to be right. Exact tanh, as the reference chain has no other
+    const stimulusType goldenStimuli[] = { sineStimulus, sweepStimulus, noiseStimulus, silenceStimulus, impulseStimulus };
+    const double goldenSampleRates[] = { 44100.0, 48000.0, 96000.0 };
+    const double goldenStimulusSeconds = 0.1;
+
+    // the stimuli one after another, so the state carries over from each into the next, through the
+    // silence and the idle path as well
+    std::vector<std::vector<float>> makeGoldenStimulus (double sampleRate)
+    {
+        std::vector<std::vector<float>> channels (2);
+
+        for (auto stimulus : goldenStimuli)
+        {
+            const auto part = makeStimulus (stimulus, 2, (int) (sampleRate * goldenStimulusSeconds), sampleRate);
+
+            for (size_t channel = 0; channel < channels.size(); ++channel)
+                channels[channel].insert (channels[channel].end(), part[channel].begin(), part[channel].end());
+        }
+
+        return channels;
+    }
+
+    // one way through the core. The golden files are recorded with the first one, the plainest of the
+    // fused ones: scalar clipping, the runtime-flag kernel, a channel at a time, no idle skipping
+    struct GoldenPath
+    {
+        const char* name;
+        int blockSize;
+        bool useReference;
+        bool specialised;
+        int channelLanes;
+        bool idleFastPaths;
+        instructionSet instructions;
+    };
+
+    std::vector<GoldenPath> getGoldenPaths()
+    {
+        std::vector<GoldenPath> paths { { "plain", 512, false, false, 1, false, scalarInstructions },
+                                        { "reference", 512, true, false, 1, false, scalarInstructions } };
+
+        for (auto set : allInstructionSets)
+            if (Waveshaper::isSupported (set))
+                paths.push_back ({ Waveshaper::getName (set), 512, false, true, 4, true, set });
+
+        const auto best = Waveshaper::getInstructionSet();
+
+        paths.push_back ({ "runtime flags", 512, false, false, 4, true, best });
+        paths.push_back ({ "1 lane", 512, false, true, 1, true, best });
+        paths.push_back ({ "8 lanes", 512, false, true, 8, true, best });
+        paths.push_back ({ "no idle paths", 512, false, true, 4, false, best });
+        paths.push_back ({ "block 16", 16, false, true, 4, true, best });
+        paths.push_back ({ "block 300", 300, false, true, 4, true, best });
+        paths.push_back ({ "block 4096", 4096, false, true, 4, true, best });
+
+        return paths;
+    }
+
+    std::string getGoldenFileName (double sampleRate, const ChainConfiguration& configuration, int oversampling)
+    {
+        auto name = configuration.getName();
+        std::replace (name.begin(), name.end(), '/', '_');
+        std::replace (name.begin(), name.end(), '-', 'x');
+
+        return std::to_string ((int) sampleRate) + "_" + name + "_os" + std::to_string (oversampling) + ".wav";
+    }
+
+    bool runGoldenSuite (const BenchOptions& options)
+    {
+        const instructionSet originalSet = Waveshaper::getInstructionSet();
+        const auto paths = getGoldenPaths();
+        const std::filesystem::path directory (options.goldenPath);
+        int numRecorded = 0, numMissing = 0;
+        bool allPassed = true;
+
+        if (options.record)
+            std::filesystem::create_directories (directory);
+
+        std::printf ("\ngolden output in %s, %s, tolerance %g\n", directory.string().c_str(),
+                     options.record ? "recording" : "comparing", options.tolerance);
+        std::printf ("%6s %-16s %3s %-18s %12s %6s\n", "rate", "configuration", "os", "worst path", "max diff", "result");
+
+        for (auto sampleRate : goldenSampleRates)
+        {
+            if (options.onlySampleRate > 0.0 && sampleRate != options.onlySampleRate)
+                continue;
+
+            const auto input = makeGoldenStimulus (sampleRate);
+
+            for (const auto& configuration : getAllConfigurations())
+            {
+                for (auto oversampling : { 1, 4 })
+                {
+                    const auto render = [&] (const GoldenPath& path)
+                    {
+                        Waveshaper::setInstructionSet (path.instructions);
+
+                        MultiEffectCore core;
+                        configuration.applyTo (core);
+                        core.setOversampling (oversampling, firOversampling);
+                        core.setTanhApprox (exactTanh);
+                        core.setSpecialisedProcessing (path.specialised);
+                        core.setChannelLanes (path.channelLanes);
+                        core.setIdleFastPaths (path.idleFastPaths);
+                        core.prepare (sampleRate, 2);
+
+                        return renderThroughCore (core, input, path.blockSize, path.useReference, MultiEffectCore::subBlockSize);
+                    };
+
+                    const auto fileName = getGoldenFileName (sampleRate, configuration, oversampling);
+                    const auto filePath = (directory / fileName).string();
+                    std::string error;
+                    AudioFileData golden;
+
+                    if (options.record)
+                    {
+                        golden.sampleRate = sampleRate;
+                        golden.channels = render (paths.front());
+
+                        if (writeWavFile (filePath, golden, 32, error))
+                            ++numRecorded;
+                        else
+                            std::printf ("%s\n", error.c_str());
+
+                        allPassed = allPassed && error.empty();
+                        continue;
+                    }
+
+                    if (! readWavFile (filePath, golden, error) || golden.getNumChannels() != 2 || golden.getNumSamples() != (int) input[0].size())
+                    {
+                        ++numMissing;
+                        allPassed = false;
+                        continue;
+                    }
+
+                    double worstDiff = 0.0;
+                    const char* worstPath = "-";
+
+                    for (const auto& path : paths)
+                    {
+                        // the reference chain has no oversampling
+                        if (path.useReference && oversampling > 1)
+                            continue;
+
+                        const double maxDiff = compareRenders (render (path), golden.channels).maxDiff;
+
+                        // NaN counts as the worst there is
+                        if (! (maxDiff <= worstDiff))
+                        {
+                            worstDiff = maxDiff;
+                            worstPath = path.name;
+                        }
+                    }
+
+                    const bool passed = worstDiff <= options.tolerance;
+                    allPassed = allPassed && passed;
+
+                    std::printf ("%6g %-16s %3d %-18s %12.3g %6s\n", sampleRate, configuration.getName().c_str(), oversampling,
+                                 worstPath, worstDiff, passed ? "ok" : "FAIL");
+                }
+            }
+        }
+
+        Waveshaper::setInstructionSet (originalSet);
+
+        if (options.record)
+            std::printf ("%d golden files recorded\n", numRecorded);
+
+        if (numMissing > 0)
+            std::printf ("%d golden files missing or the wrong length, record them with --record from a build that's known to be right\n", numMissing);
+
+        return allPassed;
+    }
+
+    //==============================================================================
+    // throughput against a baseline recorded on the same machine. Each case is timed a few times for
+    // at least 100ms and the fastest kept, since a run can only be slowed down by whatever else the
+    // machine is doing
+    struct PerfCase
+    {
+        std::string name;
+        double nsPerSample;
+    };
+
+    bool readBaseline (const std::string& path, std::vector<PerfCase>& cases)
+    {
+        std::ifstream stream (path);
+
+        if (! stream)
+            return false;
+
+        std::string line;
+
+        while (std::getline (stream, line))
+        {
+            const auto comma = line.rfind (',');
+
+            if (comma == std::string::npos || line.compare (0, 5, "case,") == 0)
+                continue;
+
+            cases.push_back ({ line.substr (0, comma), std::atof (line.c_str() + comma + 1) });
+        }
+
+        return true;
+    }
+
+    bool writeBaseline (const std::string& path, const std::vector<PerfCase>& cases)
+    {
+        std::ofstream stream (path);
+        stream << "case,ns_per_sample\n";
+
+        char line[256];
+
+        for (const auto& perfCase : cases)
+        {
+            std::snprintf (line, sizeof (line), "%s,%.4f\n", perfCase.name.c_str(), perfCase.nsPerSample);
+            stream << line;
+        }
+
+        return stream.good();
+    }
+
+    bool runPerfSuite (const BenchOptions& options)
+    {
+        const double sampleRate = options.onlySampleRate > 0.0 ? options.onlySampleRate : 48000.0;
+        const int blockSize = options.onlyBlockSize > 0 ? options.onlyBlockSize : 512;
+        const int numRuns = 5;
+        const double minSeconds = std::max (options.minSeconds, 0.1);
+        std::vector<PerfCase> cases, baseline;
+        std::vector<std::unique_ptr<MultiEffectCore>> cores;
+        std::vector<std::unique_ptr<TestBuffer>> buffers;
+
+        const auto addCase = [&] (const std::string& name, int numChannels) -> MultiEffectCore&
+        {
+            cases.push_back ({ name, 0.0 });
+            cores.push_back (std::make_unique<MultiEffectCore>());
+            buffers.push_back (std::make_unique<TestBuffer> (numChannels, blockSize));
+            cores.back()->setOverdrive (8.0);
+            return *cores.back();
+        };
+
+        for (const auto& configuration : getAllConfigurations())
+            configuration.applyTo (addCase (configuration.getName(), 2));
+
+        for (auto backend : { exactLfo, wavetableLfo })
+            addCase (std::string ("lfo ") + getBackendName (backend), 2).setLfoBackend (backend);
+
+        for (auto filter : { iirOversampling, firOversampling })
+            addCase (filter == iirOversampling ? "4x iir" : "4x fir", 2).setOversampling (4, filter);
+
+        addCase ("8 channels linked", 8).setLevelLink (true);
+
+        for (size_t i = 0; i < cases.size(); ++i)
+            cores[i]->prepare (sampleRate, buffers[i]->getNumChannels());
+
+        // every case once per run, so a machine that slows down for a while slows them all down alike
+        for (int run = 0; run < numRuns; ++run)
+        {
+            for (size_t i = 0; i < cases.size(); ++i)
+            {
+                auto& buffer = *buffers[i];
+                const double copyNs = timeCall ([&] { buffer.refill(); checksum += buffer.work[0][0]; }, minSeconds * 0.1);
+                const double ns = std::max (0.0, timeCall ([&] { runStage (*cores[i], buffer, chainStage); }, minSeconds) - copyNs);
+                const double nsPerSample = ns / (double) (blockSize * buffer.getNumChannels());
+
+                cases[i].nsPerSample = run == 0 ? nsPerSample : std::min (cases[i].nsPerSample, nsPerSample);
+            }
+        }
+
+        if (options.record)
+        {
+            const bool written = writeBaseline (options.baselinePath, cases);
+            std::printf ("\n%d cases at %d samples, %g Hz %s %s\n", (int) cases.size(), blockSize, sampleRate,
+                         written ? "recorded to" : "couldn't be written to", options.baselinePath.c_str());
+            return written;
+        }
+
+        if (! readBaseline (options.baselinePath, baseline))
+        {
+            std::printf ("\ncan't read the baseline %s, record one with --record\n", options.baselinePath.c_str());
+            return false;
+        }
+
+        std::printf ("\nthroughput vs %s at %d samples, %g Hz, fastest of %d, fails above +%g%%\n", options.baselinePath.c_str(),
+                     blockSize, sampleRate, numRuns, options.maxRegressionPercent);
+
+        if (options.csv)
+            std::printf ("case,ns_per_sample,baseline_ns_per_sample,change_percent,result\n");
+        else
+            std::printf ("%-20s %12s %12s %9s %6s\n", "case", "ns/sample", "baseline", "change", "result");
+
+        bool allPassed = true;
+
+        for (const auto& perfCase : cases)
+        {
+            const auto match = std::find_if (baseline.begin(), baseline.end(), [&] (const PerfCase& b) { return b.name == perfCase.name; });
+            const bool known = match != baseline.end() && match->nsPerSample > 0.0;
+            const double change = known ? (perfCase.nsPerSample / match->nsPerSample - 1.0) * 100.0 : 0.0;
+            const bool passed = change <= options.maxRegressionPercent;
+            const char* result = ! known ? "new" : (passed ? "ok" : "FAIL");
+            allPassed = allPassed && passed;
+
+            if (options.csv)
+                std::printf ("%s,%.4f,%.4f,%.1f,%s\n", perfCase.name.c_str(), perfCase.nsPerSample, known ? match->nsPerSample : 0.0, change, result);
+            else
+                std::printf ("%-20s %12.3f %12.3f %+8.1f%% %6s\n", perfCase.name.c_str(), perfCase.nsPerSample, known ? match->nsPerSample : 0.0, change, result);
+        }
+
+        return allPassed;
+    }
+
+    void printUsage()
+    {
+        std::printf ("usage: mfx_bench [options]\n"
+                     "  --suite <name>      stages, oscillator, waveshaper, aliasing, specialisation, automation,\n"
+                     "                      channels, precision, idle, cpu, tap, state, order, pulser, verify, golden, perf\n"
+                     "                      or all (default all; golden and perf only with the paths below)\n"
+                     "  --min-time <ms>     minimum measuring time per case (default 10)\n"
+                     "  --block <samples>   only run this block size\n"
+                     "  --rate <Hz>         only run this sample rate\n"
+                     "  --csv               machine-readable output\n"
+                     "  --golden <dir>      the golden output files the golden suite compares every path with\n"
+                     "  --tolerance <x>     largest difference from the golden output that passes (default 1e-6)\n"
+                     "  --baseline <file>   the throughput baseline (CSV) the perf suite compares with\n"
+                     "  --max-regression <percent>   slowdown from the baseline that fails a perf case (default 10)\n"
+                     "  --record            writes the golden files or the baseline instead of comparing\n");
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+
+        if (option == "--csv")
+        {
+            options.csv = true;
+        }
+        else if (i + 1 < argc && option == "--suite")
+        {
+            options.suite = argv[++i];
+        }
+        else if (i + 1 < argc && option == "--min-time")
+        {
+            options.minSeconds = std::atof (argv[++i]) / 1000.0;
+        }
+        else if (i + 1 < argc && option == "--block")
+        {
+            options.onlyBlockSize = std::atoi (argv[++i]);
+        }
+        else if (i + 1 < argc && option == "--rate")
+        {
+            options.onlySampleRate = std::atof (argv[++i]);
+        }
+        else if (i + 1 < argc && option == "--golden")
+        {
+            options.goldenPath = argv[++i];
+        }
+        else if (i + 1 < argc && option == "--tolerance")
+        {
+            options.tolerance = std::atof (argv[++i]);
+        }
+        else if (i + 1 < argc && option == "--baseline")
+        {
+            options.baselinePath = argv[++i];
+        }
+        else if (i + 1 < argc && option == "--max-regression")
+        {
+            options.maxRegressionPercent = std::atof (argv[++i]);
+        }
+        else if (option == "--record")
+        {
+            options.record = true;
+        }
+        else
+        {
+            printUsage();
+            return option == "--help" ? 0 : 1;
+        }
+    }
+
+    if (options.suite == "all" || options.suite == "stages")
+        runStageSuite (options);
+
+    if (options.suite == "all" || options.suite == "oscillator")
+        runOscillatorSuite (options);
+
+    if (options.suite == "all" || options.suite == "waveshaper")
+        runWaveshaperSuite (options);
+
+    if (options.suite == "all" || options.suite == "aliasing")
+        runAliasingSuite (options);
+
+    if (options.suite == "all" || options.suite == "specialisation")
+        runSpecialisationSuite (options);
+
+    if (options.suite == "all" || options.suite == "automation")
+        runAutomationSuite (options);
+
+    if (options.suite == "all" || options.suite == "channels")
+        runChannelSuite (options);
+
+    if (options.suite == "all" || options.suite == "precision")
+        runPrecisionSuite (options);
+
+    if (options.suite == "all" || options.suite == "idle")
+        runIdleSuite (options);
+
+    if (options.suite == "all" || options.suite == "cpu")
+        runCpuMeterSuite (options);
+
+    if (options.suite == "all" || options.suite == "tap")
+        runSignalTapSuite (options);
+
+    if (options.suite == "all" || options.suite == "state")
+        runStateSuite (options);
+
+    if (options.suite == "all" || options.suite == "order")
+        runStageOrderSuite (options);
+
+    if (options.suite == "all" || options.suite == "pulser")
+        runPulserSuite (options);
+
+    bool passed = true;
+
+    if (options.suite == "all" || options.suite == "verify")
+    {
+        passed = runVerifySuite (options);
+        passed = runConfigurationVerify (options) && passed;
+        passed = runParameterVerify (options) && passed;
+        passed = runAutomationVerify (options) && passed;
+        passed = runOversamplingVerify (options) && passed;
+        passed = runLaneVerify (options) && passed;
+        passed = runPrecisionVerify (options) && passed;
+        passed = runIdleVerify (options) && passed;
+        passed = runCpuMeterVerify (options) && passed;
+        passed = runSignalTapVerify (options) && passed;
+        passed = runStateVerify (options) && passed;
+        passed = runStageOrderVerify (options) && passed;
+        passed = runBatchVerify (options) && passed;
+        passed = runPositionVerify (options) && passed;
+        passed = runRealtimeVerify (options) && passed;
+        passed = runPulserVerify (options) && passed;
+        passed = runQualityVerify (options) && passed;
+    }
+
+    if ((options.suite == "golden" || options.suite == "perf") && (options.suite == "golden" ? options.goldenPath : options.baselinePath).empty())
+    {
+        std::fprintf (stderr, "the %s suite needs %s\n", options.suite.c_str(), options.suite == "golden" ? "--golden <dir>" : "--baseline <file>");
+        return 1;
+    }
+
+    if ((options.suite == "all" || options.suite == "golden") && ! options.goldenPath.empty())
+        passed = runGoldenSuite (options) && passed;
+
+    if ((options.suite == "all" || options.suite == "perf") && ! options.baselinePath.empty())
+        passed = runPerfSuite (options) && passed;
+
+    // the checksum keeps the optimiser from throwing the processing away
+    return (passed && checksum != 12345.0f) ? 0 : 1;
+}
@@ -0,0 +1,780 @@
+/*
+  ==============================================================================
+
+    HostMain.cpp
+    mfx_host: a stand-in host that runs many instances of the core at a real
+    buffer size across a pool of threads, to see how the CPU and the memory
+    scale with the size of the session, and how close each callback comes to
+    its deadline with the rest of the machine busy.
+
+  ==============================================================================
+*/
+
+#include "HostThreadPool.h"
+#include "DSP/CpuMeter.h"
+#include "DSP/MultiEffectCore.h"
+#include "DSP/PresetState.h"
+#include "DSP/SharedTables.h"
+#include "DSP/SignalTap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined (__GLIBC__)
+ #include <malloc.h>
+ #include <unistd.h>
+#endif
+
+#if defined (__linux__) || defined (__APPLE__)
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+#if defined (__linux__)
+ #include <sys/prctl.h>
+#endif
+
+// what the plugin editor's timer runs at (DISPLAY_FRAME_RATE in PluginEditor.h) and its size
+#define EDITOR_FRAME_RATE 30
+#define EDITOR_WIDTH 880
+#define EDITOR_HEIGHT 520
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    void printUsage()
+    {
+        std::printf ("usage: mfx_host [options]\n"
+                     "  Runs each number of instances in turn, every instance on one of the built-in programs\n"
+                     "  (taking turns), processing noise one callback at a time across the threads.\n"
+                     "  --instances <list>      comma separated instance counts (default 1,8,32,100,300)\n"
+                     "  --block <samples>       callback size (default 64)\n"
+                     "  --rate <Hz>             sample rate (default 48000)\n"
+                     "  --channels <n>          channels per instance (default 2)\n"
+                     "  --threads <n>           threads the instances are spread over, including the callback's\n"
+                     "                          own (default: one per hardware thread)\n"
+                     "  --seconds <s>           audio timed for each instance count, after a quarter of that\n"
+                     "                          to warm up (default 2)\n"
+                     "  --oversampling <n>      distortion oversampling factor, 1, 2, 4 or 8 (default 1)\n"
+                     "  --fir                   linear-phase oversampling filters instead of the IIR ones\n"
+                     "  --realtime              a callback every block's worth of time instead of back to back,\n"
+                     "                          reporting how long each one took against its deadline\n"
+                     "with --realtime:\n"
+                     "  --editors <n>           open editors, each reading the meters, scope, spectrum and CPU\n"
+                     "                          figures of an instance and drawing a frame, %d times a second\n"
+                     "  --changes <per second>  parameter changes from another thread, with program and stage\n"
+                     "                          order changes among them, spread over the instances\n"
+                     "  --busy <n>              threads of other work, each going through 8 MB of memory flat out\n"
+                     "  --priority              runs the callback and the pool on SCHED_FIFO, the way hosts run\n"
+                     "                          their audio threads (needs the privilege, carries on without)\n"
+                     "  --max-missed <n>        exits non-zero if more callbacks than this miss (default 0)\n"
+                     "  --adaptive              lets every instance step its quality down under load, its share\n"
+                     "                          of the callback being the threads over the instances\n",
+                     EDITOR_FRAME_RATE);
+    }
+
+    struct HostOptions
+    {
+        std::vector<int> instanceCounts { 1, 8, 32, 100, 300 };
+        int blockSize = 64;
+        double sampleRate = 48000.0;
+        int numChannels = 2;
+        int numThreads = (int) std::max (1u, std::thread::hardware_concurrency());
+        double seconds = 2.0;
+        int oversampling = 1;
+        oversamplingFilter filter = iirOversampling;
+
+        bool realtime = false;
+        int numEditors = 0;
+        double changesPerSecond = 0.0;
+        int numBusyThreads = 0;
+        bool priority = false;
+        long long maxMissed = 0;
+        bool adaptive = false;
+    };
+
+    bool parseOptions (int argc, char* argv[], HostOptions& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string option = argv[i];
+
+            if (i + 1 < argc && option == "--instances")
+            {
+                options.instanceCounts.clear();
+                std::stringstream list (argv[++i]);
+                std::string item;
+
+                while (std::getline (list, item, ','))
+                    if (std::atoi (item.c_str()) > 0)
+                        options.instanceCounts.push_back (std::atoi (item.c_str()));
+
+                if (options.instanceCounts.empty())
+                    return false;
+            }
+            else if (i + 1 < argc && option == "--block")
+                options.blockSize = std::max (1, std::atoi (argv[++i]));
+            else if (i + 1 < argc && option == "--rate")
+                options.sampleRate = std::max (8000.0, std::atof (argv[++i]));
+            else if (i + 1 < argc && option == "--channels")
+                options.numChannels = std::max (1, std::atoi (argv[++i]));
+            else if (i + 1 < argc && option == "--threads")
+                options.numThreads = std::max (1, std::atoi (argv[++i]));
+            else if (i + 1 < argc && option == "--seconds")
+                options.seconds = std::max (0.01, std::atof (argv[++i]));
+            else if (i + 1 < argc && option == "--oversampling")
+                options.oversampling = std::max (1, std::atoi (argv[++i]));
+            else if (option == "--fir")
+                options.filter = firOversampling;
+            else if (option == "--realtime")
+                options.realtime = true;
+            else if (i + 1 < argc && option == "--editors")
+                options.numEditors = std::max (0, std::atoi (argv[++i]));
+            else if (i + 1 < argc && option == "--changes")
+                options.changesPerSecond = std::max (0.0, std::atof (argv[++i]));
+            else if (i + 1 < argc && option == "--busy")
+                options.numBusyThreads = std::max (0, std::atoi (argv[++i]));
+            else if (option == "--priority")
+                options.priority = true;
+            else if (i + 1 < argc && option == "--max-missed")
+                options.maxMissed = std::max (0LL, std::atoll (argv[++i]));
+            else if (option == "--adaptive")
+                options.adaptive = true;
+            else
+                return false;
+        }
+
+        // the background load only means something against a callback that has a deadline
+        return options.realtime || (options.numEditors == 0 && options.changesPerSecond == 0.0 && options.numBusyThreads == 0
+                                     && ! options.priority && ! options.adaptive);
+    }
+
+    // bytes the allocator has handed out and not had back, or -1 where that can't be asked
+    long long getHeapInUse()
+    {
+       #if defined (__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        return (long long) mallinfo2().uordblks;
+       #else
+        return -1;
+       #endif
+    }
+
+    long long getCacheSize (int level)
+    {
+       #if defined (__GLIBC__) && defined (_SC_LEVEL2_CACHE_SIZE)
+        return (long long) sysconf (level == 2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+       #else
+        (void) level;
+        return 0;
+       #endif
+    }
+
+    // the calling thread, and the threads it starts from then on, go on SCHED_FIFO
+    bool raisePriority()
+    {
+       #if defined (__linux__) || defined (__APPLE__)
+        sched_param parameters {};
+        parameters.sched_priority = std::max (1, sched_get_priority_max (SCHED_FIFO) - 10);
+        return pthread_setschedparam (pthread_self(), SCHED_FIFO, &parameters) == 0;
+       #else
+        return false;
+       #endif
+    }
+
+    // the background threads would inherit the callback's priority otherwise
+    void lowerPriority()
+    {
+       #if defined (__linux__) || defined (__APPLE__)
+        sched_param parameters {};
+        pthread_setschedparam (pthread_self(), SCHED_OTHER, &parameters);
+       #endif
+    }
+
+    // one plugin instance as the host sees it: the core and the buffers it's handed each callback
+    struct Instance
+    {
+        std::unique_ptr<MultiEffectCore> core;
+        std::vector<std::vector<float>> buffers;
+        std::vector<float*> pointers;
+        int inputOffset = 0;
+    };
+
+    struct RunResult
+    {
+        double cpuSeconds = 0.0;
+        double wallSeconds = 0.0;
+        double worstCallbackSeconds = 0.0;
+        int numCallbacks = 0;
+        long long numMissed = 0;
+        long long heapPerInstance = -1;     // the core's allocations and the host's buffers for it
+    };
+
+    std::vector<float> makeNoise (int numSamples)
+    {
+        // the same noise every run, about -12 dBFS
+        std::vector<float> noise ((size_t) numSamples);
+        unsigned int state = 12345;
+
+        for (auto& sample : noise)
+        {
+            state = state * 1664525u + 1013904223u;
+            sample = 0.25f * ((float) (state >> 8) / 8388608.0f - 1.0f);
+        }
+
+        return noise;
+    }
+
+    //==============================================================================
+    // the instances of one run and the callback that feeds and processes them
+    class Session
+    {
+    public:
+        Session (const HostOptions& options, int numInstances, const std::vector<float>& noise)
+            : mOptions (options), mNoise (noise), mInstances ((size_t) numInstances),
+              mMaxOffset (std::max (1, (int) noise.size() - options.blockSize - options.numChannels))
+        {
+            const long long heapBefore = getHeapInUse();
+
+            for (int index = 0; index < numInstances; ++index)
+            {
+                auto& instance = mInstances[(size_t) index];
+                const auto program = PresetState::getProgram (index % PresetState::getNumPrograms());
+
+                instance.core = std::make_unique<MultiEffectCore>();
+                instance.core->setParameters (program.getParameters());
+                instance.core->setStageOrder (StageOrder::fromCode ((int) program.get (stageOrderField)));
+                instance.core->setOversampling (options.oversampling, options.filter);
+                instance.core->setAdaptiveQuality (options.adaptive);
+                instance.core->prepare (options.sampleRate, options.numChannels);
+                instance.core->getQualityGovernor().setShare (std::min (1.0, (double) options.numThreads / numInstances));
+
+                for (int channel = 0; channel < options.numChannels; ++channel)
+                    instance.buffers.emplace_back ((size_t) options.blockSize, 0.0f);
+
+                for (auto& buffer : instance.buffers)
+                    instance.pointers.push_back (buffer.data());
+
+                // a different stretch of the noise for each one, so they're not all in step
+                instance.inputOffset = (int) (((long long) index * 7919) % mMaxOffset);
+            }
+
+            const long long heapAfter = getHeapInUse();
+
+            if (heapBefore >= 0 && heapAfter >= 0)
+                mHeapPerInstance = (heapAfter - heapBefore) / numInstances - (long long) sizeof (MultiEffectCore);
+        }
+
+        int getNumInstances() const                         { return (int) mInstances.size(); }
+        MultiEffectCore& getCore (int index)                { return *mInstances[(size_t) index].core; }
+        long long getHeapPerInstance() const                { return mHeapPerInstance; }
+
+        // one callback: what the host does for each instance is hand it its input and let it process
+        void runCallback (HostThreadPool& pool)
+        {
+            pool.run (getNumInstances(), mProcessInstance);
+            mPosition += mOptions.blockSize;
+        }
+
+    private:
+        const HostOptions& mOptions;
+        const std::vector<float>& mNoise;
+        std::vector<Instance> mInstances;
+        const int mMaxOffset;
+        long long mHeapPerInstance = -1;
+        long long mPosition = 0;
+
+        const std::function<void (int)> mProcessInstance = [this] (int index)
+        {
+            auto& instance = mInstances[(size_t) index];
+            const int start = (int) ((instance.inputOffset + mPosition) % mMaxOffset);
+
+            for (int channel = 0; channel < mOptions.numChannels; ++channel)
+                std::copy (mNoise.begin() + start + channel, mNoise.begin() + start + channel + mOptions.blockSize, instance.buffers[(size_t) channel].begin());
+
+            instance.core->process (instance.pointers.data(), mOptions.numChannels, mOptions.blockSize);
+        };
+    };
+
+    RunResult runInstances (const HostOptions& options, int numInstances, HostThreadPool& pool, const std::vector<float>& noise)
+    {
+        RunResult result;
+        Session session (options, numInstances, noise);
+        result.heapPerInstance = session.getHeapPerInstance();
+
+        const double deadline = options.blockSize / options.sampleRate;
+        const int numWarmUpCallbacks = (int) std::ceil (options.seconds * 0.25 / deadline);
+        const int numTimedCallbacks = (int) std::ceil (options.seconds / deadline);
+
+        for (int callback = 0; callback < numWarmUpCallbacks; ++callback)
+            session.runCallback (pool);
+
+        const std::clock_t cpuStart = std::clock();
+        const auto wallStart = Clock::now();
+
+        for (int callback = 0; callback < numTimedCallbacks; ++callback)
+        {
+            const auto callbackStart = Clock::now();
+            session.runCallback (pool);
+            const double seconds = std::chrono::duration<double> (Clock::now() - callbackStart).count();
+
+            result.worstCallbackSeconds = std::max (result.worstCallbackSeconds, seconds);
+            result.numMissed += seconds > deadline ? 1 : 0;
+        }
+
+        result.cpuSeconds = (double) (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        result.wallSeconds = std::chrono::duration<double> (Clock::now() - wallStart).count();
+        result.numCallbacks = numTimedCallbacks;
+        return result;
+    }
+
+    //==============================================================================
+    // what an open editor does on its timer (FinalMultiEffectEditor::timerCallback()): takes what the
+    // tap has queued, updates the meters, scope and spectrum, redraws, and turns the CPU measurements
+    // into text four times a second. The drawing is a plain software fill of a frame the editor's
+    // size, which stands in for JUCE's renderer touching about as much memory
+    class EditorLoad
+    {
+    public:
+        EditorLoad (MultiEffectCore& core, double sampleRate)
+            : mCore (core), mFrame ((size_t) EDITOR_WIDTH * EDITOR_HEIGHT), mScope ((size_t) EDITOR_WIDTH)
+        {
+            mAnalyser.prepare (sampleRate);
+            mCore.getSignalTap().setEnabled (true);
+            mCore.getCpuMeter().setEnabled (true);
+        }
+
+        ~EditorLoad()
+        {
+            mCore.getSignalTap().setEnabled (false);
+            mCore.getCpuMeter().setEnabled (false);
+        }
+
+        void runFrame()
+        {
+            if (mAnalyser.takeFrom (mCore.getSignalTap()) > 0)
+            {
+                mAnalyser.getScope (mScope.data(), (int) mScope.size());
+                draw (mAnalyser.updateSpectrum());
+            }
+
+            if (++mNumFrames % (EDITOR_FRAME_RATE / 4) == 0)
+            {
+                mCpuStats.addFrom (mCore.getCpuMeter());
+                mCpuText = mCpuStats.toText();
+            }
+        }
+
+    private:
+        MultiEffectCore& mCore;
+        SignalAnalyser mAnalyser;
+        CpuStats mCpuStats;
+        std::string mCpuText;
+        std::vector<uint32_t> mFrame;
+        std::vector<float> mScope;
+        long long mNumFrames = 0;
+
+        void draw (const std::vector<float>& spectrum)
+        {
+            std::fill (mFrame.begin(), mFrame.end(), 0xff202020u);
+
+            // the scope in the top half, the spectrum in the bottom half
+            const int half = EDITOR_HEIGHT / 2;
+
+            for (int x = 0; x < EDITOR_WIDTH; ++x)
+            {
+                const int y = std::min (half - 1, std::max (0, (int) ((0.5f - 0.5f * mScope[(size_t) x]) * (float) (half - 1))));
+                mFrame[(size_t) (y * EDITOR_WIDTH + x)] = 0xff40ff40u;
+
+                const int bin = std::min ((int) spectrum.size() - 1, (int) std::pow ((double) spectrum.size(), (double) x / EDITOR_WIDTH));
+                const float level = std::max (0.0f, 1.0f + spectrum[(size_t) bin] / -SignalAnalyser::floorDb);
+                const int top = EDITOR_HEIGHT - (int) (level * (float) (half - 1)) - 1;
+
+                for (int row = top; row < EDITOR_HEIGHT; ++row)
+                    mFrame[(size_t) (row * EDITOR_WIDTH + x)] = 0xff4080ffu;
+            }
+        }
+    };
+
+    // the threads that compete with the callback, started with a run's instances and stopped with them
+    class BackgroundLoad
+    {
+    public:
+        BackgroundLoad (const HostOptions& options, Session& session)
+        {
+            // one each at most, as only one thread may read a tap or a CPU meter
+            for (int editor = 0; editor < std::min (options.numEditors, session.getNumInstances()); ++editor)
+                mEditors.push_back (std::make_unique<EditorLoad> (session.getCore (editor), options.sampleRate));
+
+            for (auto& editor : mEditors)
+            {
+                mThreads.emplace_back ([this, &editor]
+                {
+                    lowerPriority();
+                    auto next = Clock::now();
+
+                    while (! mQuit.load (std::memory_order_relaxed))
+                    {
+                        editor->runFrame();
+                        mNumFrames.fetch_add (1, std::memory_order_relaxed);
+
+                        next += std::chrono::microseconds (1000000 / EDITOR_FRAME_RATE);
+                        std::this_thread::sleep_until (next);
+                    }
+                });
+            }
+
+            // only one thread may set snapshots and orders, so all the changes come from this one
+            if (options.changesPerSecond > 0.0)
+            {
+                mThreads.emplace_back ([this, &session, rate = options.changesPerSecond]
+                {
+                    lowerPriority();
+                    runChanges (session, rate);
+                });
+            }
+
+            for (int thread = 0; thread < options.numBusyThreads; ++thread)
+            {
+                mThreads.emplace_back ([this]
+                {
+                    lowerPriority();
+                    std::vector<uint64_t> memory ((8 << 20) / sizeof (uint64_t), 1);
+                    uint64_t sum = 0;
+
+                    while (! mQuit.load (std::memory_order_relaxed))
+                        for (size_t i = 0; i < memory.size(); i += 8)
+                            sum += memory[i] += sum;
+
+                    mBusyChecksum.fetch_add (sum, std::memory_order_relaxed);
+                });
+            }
+        }
+
+        ~BackgroundLoad()
+        {
+            mQuit.store (true, std::memory_order_relaxed);
+
+            for (auto& thread : mThreads)
+                thread.join();
+        }
+
+        long long getNumFrames() const      { return mNumFrames.load (std::memory_order_relaxed); }
+        long long getNumChanges() const     { return mNumChanges.load (std::memory_order_relaxed); }
+
+    private:
+        std::vector<std::unique_ptr<EditorLoad>> mEditors;
+        std::vector<std::thread> mThreads;
+        std::atomic<bool> mQuit { false };
+        std::atomic<long long> mNumFrames { 0 }, mNumChanges { 0 };
+        std::atomic<uint64_t> mBusyChecksum { 0 };
+
+        // a burst every millisecond, as many as the rate adds up to, the way a host flushes automation
+        void runChanges (Session& session, double changesPerSecond)
+        {
+            std::mt19937 rng (1);
+            std::uniform_real_distribution<double> unit (0.0, 1.0);
+            std::vector<ParameterSnapshot> programs;
+
+            for (int program = 0; program < PresetState::getNumPrograms(); ++program)
+                programs.push_back (PresetState::getProgram (program).getParameters());
+
+            auto next = Clock::now();
+            double owed = 0.0;
+
+            while (! mQuit.load (std::memory_order_relaxed))
+            {
+                for (owed += changesPerSecond / 1000.0; owed >= 1.0; owed -= 1.0)
+                {
+                    auto& core = session.getCore ((int) (rng() % (unsigned int) session.getNumInstances()));
+
+                    switch (rng() % 12)
+                    {
+                        case 0:     core.setModFreq (unit (rng) * MOD_FREQ_LIMIT); break;
+                        case 1:     core.setOverdrive (1.0 + unit (rng) * (OVERDRIVE_LIMIT - 1.0)); break;
+                        case 2:     core.setPulserFreq (unit (rng) * PULSER_FREQ_LIMIT); break;
+                        case 3:     core.setModType (rng() % 2 == 0 ? rm : am); break;
+                        case 4:     core.setDistType (rng() % 2 == 0 ? soft : hard); break;
+                        case 5:     core.setDistMix (unit (rng)); break;
+                        case 6:     core.setLevelRelease (0.1 + unit (rng) * LEVEL_RELEASE_LIMIT); break;
+                        case 7:     core.setLevelLink (rng() % 2 == 0); break;
+                        case 8:     core.setPulserEnabled (rng() % 2 == 0); break;
+                        case 9:     core.setParameters (programs[rng() % programs.size()]); break;
+                        case 10:    core.setStageOrder (StageOrder::fromIndex ((int) (rng() % (unsigned int) StageOrder::getNumOrders()))); break;
+                        default:    core.setModEnabled (rng() % 2 == 0); break;
+                    }
+
+                    mNumChanges.fetch_add (1, std::memory_order_relaxed);
+                }
+
+                next += std::chrono::milliseconds (1);
+                std::this_thread::sleep_until (next);
+            }
+        }
+    };
+
+    //==============================================================================
+    // in microseconds
+    struct Distribution
+    {
+        double minimum, mean, p50, p90, p99, p999, maximum, deviation;
+    };
+
+    Distribution getDistribution (std::vector<double> values)
+    {
+        Distribution distribution {};
+
+        if (values.empty())
+            return distribution;
+
+        std::sort (values.begin(), values.end());
+        const auto at = [&] (double fraction) { return values[(size_t) std::min ((double) values.size() - 1.0, std::floor (fraction * (double) values.size()))]; };
+
+        double sum = 0.0, sumOfSquares = 0.0;
+
+        for (auto value : values)
+        {
+            sum += value;
+            sumOfSquares += value * value;
+        }
+
+        distribution.minimum = values.front();
+        distribution.maximum = values.back();
+        distribution.mean = sum / (double) values.size();
+        distribution.deviation = std::sqrt (std::max (0.0, sumOfSquares / (double) values.size() - distribution.mean * distribution.mean));
+        distribution.p50 = at (0.5);
+        distribution.p90 = at (0.9);
+        distribution.p99 = at (0.99);
+        distribution.p999 = at (0.999);
+        return distribution;
+    }
+
+    void printDistribution (const char* name, const std::vector<double>& values)
+    {
+        const auto d = getDistribution (values);
+        std::printf ("%-12s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, d.minimum, d.mean, d.p50, d.p90, d.p99, d.p999, d.maximum, d.deviation);
+    }
+
+    // every callback in turn, each one woken a block's worth of time after the last was due, the way
+    // an audio driver's period comes round. A callback misses when it isn't finished by the time the
+    // next one is due. After a miss the schedule moves on to the next period still to come, as a
+    // driver would after a dropout, so one late callback isn't counted again for every one after it
+    long long runRealtime (const HostOptions& options, int numInstances, HostThreadPool& pool, const std::vector<float>& noise)
+    {
+        Session session (options, numInstances, noise);
+        BackgroundLoad load (options, session);
+
+        const auto period = std::chrono::duration_cast<Clock::duration> (std::chrono::duration<double> (options.blockSize / options.sampleRate));
+        const double periodMicroseconds = 1.0e6 * options.blockSize / options.sampleRate;
+        const int numWarmUpCallbacks = (int) std::ceil (options.seconds * 0.25 * options.sampleRate / options.blockSize);
+        const int numTimedCallbacks = (int) std::ceil (options.seconds * options.sampleRate / options.blockSize);
+
+        // wake-up is how late the callback started, processing how long it took, and response the
+        // two together, which is what has to fit in the period
+        std::vector<double> wakeUps, processing, responses;
+        wakeUps.reserve ((size_t) numTimedCallbacks);
+        processing.reserve ((size_t) numTimedCallbacks);
+        responses.reserve ((size_t) numTimedCallbacks);
+
+        long long numMissed = 0, numDropped = 0;
+        int missRun = 0, longestMissRun = 0;
+        auto due = Clock::now() + period;
+
+        for (int callback = 0; callback < numWarmUpCallbacks + numTimedCallbacks; ++callback)
+        {
+            std::this_thread::sleep_until (due);
+
+            const auto start = Clock::now();
+            session.runCallback (pool);
+            const auto end = Clock::now();
+
+            const bool missed = end > due + period;
+
+            if (callback >= numWarmUpCallbacks)
+            {
+                wakeUps.push_back (std::chrono::duration<double, std::micro> (start - due).count());
+                processing.push_back (std::chrono::duration<double, std::micro> (end - start).count());
+                responses.push_back (std::chrono::duration<double, std::micro> (end - due).count());
+
+                numMissed += missed ? 1 : 0;
+                missRun = missed ? missRun + 1 : 0;
+                longestMissRun = std::max (longestMissRun, missRun);
+            }
+
+            for (due += period; end > due + period; due += period)
+                numDropped += callback >= numWarmUpCallbacks ? 1 : 0;
+        }
+
+        std::printf ("\n%d instance%s: %d callbacks of %.0f us", numInstances, numInstances == 1 ? "" : "s", numTimedCallbacks, periodMicroseconds);
+
+        if (options.numEditors > 0)
+            std::printf (", %lld editor frames", load.getNumFrames());
+
+        if (options.changesPerSecond > 0.0)
+            std::printf (", %lld parameter changes", load.getNumChanges());
+
+        std::printf ("\n%-12s %9s %9s %9s %9s %9s %9s %9s %9s\n", "us", "min", "mean", "p50", "p90", "p99", "p99.9", "max", "stdev");
+        printDistribution ("wake-up", wakeUps);
+        printDistribution ("processing", processing);
+        printDistribution ("response", responses);
+
+        // the response as a share of the period, in tenths, and everything past it
+        long long bins[11] = {};
+
+        for (auto response : responses)
+            ++bins[std::min (10, std::max (0, (int) (response / periodMicroseconds * 10.0)))];
+
+        for (int bin = 0; bin <= 10; ++bin)
+        {
+            if (bins[bin] == 0)
+                continue;
+
+            const double share = (double) bins[bin] / (double) responses.size();
+            const std::string bar ((size_t) std::ceil (share * 50.0), '#');
+
+            if (bin < 10)
+                std::printf ("  %3d-%3d%%  %8lld  %s\n", bin * 10, bin * 10 + 10, bins[bin], bar.c_str());
+            else
+                std::printf ("     >100%%  %8lld  %s\n", bins[bin], bar.c_str());
+        }
+
+        std::printf ("missed %lld of %d (%.3f%%), longest run %d, %lld periods skipped after them\n", numMissed, numTimedCallbacks,
+                     100.0 * (double) numMissed / numTimedCallbacks, longestMissRun, numDropped);
+
+        if (options.adaptive)
+        {
+            int numAtTier[numQualityTiers] = {};
+            long long numStepsDown = 0, numStepsUp = 0;
+
+            for (int index = 0; index < session.getNumInstances(); ++index)
+            {
+                auto& core = session.getCore (index);
+                ++numAtTier[core.getQualityTier()];
+                numStepsDown += core.getQualityGovernor().getNumStepsDown();
+                numStepsUp += core.getQualityGovernor().getNumStepsUp();
+            }
+
+            std::printf ("quality at the end:");
+
+            for (int tier = 0; tier < numQualityTiers; ++tier)
+                std::printf ("%s %d %s", tier == 0 ? "" : ",", numAtTier[tier], QualityGovernor::getTierName ((qualityTier) tier));
+
+            std::printf ("; %lld steps down, %lld up\n", numStepsDown, numStepsUp);
+        }
+
+        std::fflush (stdout);
+
+        return numMissed;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    HostOptions options;
+
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    // the first core made builds what every instance shares, which isn't any one instance's memory
+    MultiEffectCore().prepare (options.sampleRate, options.numChannels);
+
+    // before the pool, so its threads inherit it. A real-time thread isn't held back by the timer
+    // slack, the others are, so trim that too for the sleeps between callbacks
+    bool raisedPriority = false;
+
+    if (options.realtime)
+    {
+       #if defined (__linux__)
+        prctl (PR_SET_TIMERSLACK, 1UL);
+       #endif
+
+        if (options.priority)
+            raisedPriority = raisePriority();
+    }
+
+    HostThreadPool pool (options.numThreads);
+    const auto noise = makeNoise ((int) options.sampleRate + options.blockSize + options.numChannels);
+    const double deadline = options.blockSize / options.sampleRate;
+
+    std::printf ("%d channels, block %d at %g Hz (%.0f us per callback), %d threads, %g s timed per run, oversampling %dx %s\n",
+                 options.numChannels, options.blockSize, options.sampleRate, deadline * 1.0e6, pool.getNumThreads(), options.seconds,
+                 options.oversampling, options.filter == firOversampling ? "fir" : "iir");
+
+    if (options.realtime)
+    {
+        std::printf ("paced callbacks, %d editors at %d fps, %g parameter changes/s, %d busy threads, %s%s\n", options.numEditors,
+                     EDITOR_FRAME_RATE, options.changesPerSecond, options.numBusyThreads,
+                     raisedPriority ? "SCHED_FIFO" : (options.priority ? "normal priority (SCHED_FIFO refused)" : "normal priority"),
+                     options.adaptive ? ", adaptive quality" : "");
+
+        long long numMissed = 0;
+
+        for (const int numInstances : options.instanceCounts)
+            numMissed += runRealtime (options, numInstances, pool, noise);
+
+        if (numMissed > options.maxMissed)
+        {
+            std::fprintf (stderr, "%lld callbacks missed their deadline (%lld allowed)\n", numMissed, options.maxMissed);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    std::printf ("\n%10s %9s %12s %8s %10s %10s %7s %9s %11s\n", "instances", "cpu %rt", "ns/smp/inst", "scaling",
+                 "mean us", "worst us", "missed", "heap KB", "working MB");
+
+    double firstNsPerSample = 0.0;
+    long long heapPerInstance = -1;
+
+    for (const int numInstances : options.instanceCounts)
+    {
+        const auto result = runInstances (options, numInstances, pool, noise);
+        const double audioSeconds = result.numCallbacks * deadline;
+        const double numSamples = audioSeconds * options.sampleRate * options.numChannels * numInstances;
+        const double nsPerSample = result.cpuSeconds * 1.0e9 / numSamples;
+
+        if (firstNsPerSample == 0.0)
+            firstNsPerSample = nsPerSample;
+
+        if (result.heapPerInstance >= 0)
+            heapPerInstance = result.heapPerInstance;
+
+        // everything the instances own: what a callback has to pull through the caches
+        const double workingBytes = (double) numInstances * (double) (sizeof (MultiEffectCore) + (size_t) std::max (0LL, result.heapPerInstance));
+
+        std::printf ("%10d %8.1f%% %12.3f %7.2fx %10.1f %10.1f %7lld %9.1f %11.2f\n", numInstances, 100.0 * result.cpuSeconds / audioSeconds,
+                     nsPerSample, nsPerSample / firstNsPerSample, 1.0e6 * result.wallSeconds / result.numCallbacks,
+                     1.0e6 * result.worstCallbackSeconds, result.numMissed, result.heapPerInstance / 1024.0, workingBytes / (1024.0 * 1024.0));
+        std::fflush (stdout);
+    }
+
+    std::printf ("\nper instance: %zu bytes of core", sizeof (MultiEffectCore));
+
+    if (heapPerInstance >= 0)
+        std::printf (" + %lld bytes on the heap = %.1f KB", heapPerInstance, (sizeof (MultiEffectCore) + (size_t) heapPerInstance) / 1024.0);
+
+    std::printf ("\nshared by every instance: %d tables, %zu bytes\n", SharedTables::getNumTables(), SharedTables::getNumBytes());
+
+    const long long level2 = getCacheSize (2), level3 = getCacheSize (3);
+
+    if (level2 > 0 || level3 > 0)
+        std::printf ("caches: L2 %lld KB, L3 %lld KB\n", level2 / 1024, level3 / 1024);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+  ==============================================================================
+
+    HostThreadPool.h
+    Runs a batch of small tasks across threads that stay up between batches,
+    the way a host spreads its plugin instances over its audio threads.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+/**
+    WorkStealingPool starts its threads for every run(), which is nothing next to rendering
+    a file but far too much for each audio callback. These threads wait between batches, and
+    within one they take the next task index off a shared counter, so a thread that gets a
+    cheap instance just goes on to the next one. The calling thread is one of the workers,
+    and run() returns once every task is done and no worker is still looking at the batch.
+
+    Waking the workers takes a lock, so like a lot of real hosts' this isn't realtime safe in
+    the strict sense. What it costs is in mfx_host's callback times, as a host's would be.
+*/
+class HostThreadPool
+{
+public:
+    // numThreadsToUse includes the calling thread
+    explicit HostThreadPool (int numThreadsToUse)
+        : mNumThreads (std::max (1, numThreadsToUse))
+    {
+        for (int thread = 1; thread < mNumThreads; ++thread)
+            mThreads.emplace_back ([this] { runWorker(); });
+    }
+
+    ~HostThreadPool()
+    {
+        {
+            const std::lock_guard<std::mutex> guard (mLock);
+            mQuit = true;
+        }
+
+        mWake.notify_all();
+
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    int getNumThreads() const   { return mNumThreads; }
+
+    // runs task (taskIndex) for every index up to numTasks, and returns once they're all done
+    void run (int numTasks, const std::function<void (int)>& task)
+    {
+        mNextTask.store (0, std::memory_order_relaxed);
+        mNumDone.store (0, std::memory_order_relaxed);
+
+        {
+            const std::lock_guard<std::mutex> guard (mLock);
+            mTask = &task;
+            mNumTasks = numTasks;
+            ++mBatch;
+        }
+
+        mWake.notify_all();
+        work (task, numTasks);
+
+        while (mNumDone.load (std::memory_order_acquire) < numTasks)
+            std::this_thread::yield();
+
+        // a worker that wakes from here on finds nothing to join, and the ones that did join
+        // are let finish before the counters are reset for the next batch
+        {
+            const std::lock_guard<std::mutex> guard (mLock);
+            mTask = nullptr;
+        }
+
+        while (mNumBusy.load (std::memory_order_acquire) > 0)
+            std::this_thread::yield();
+    }
+
+    HostThreadPool (const HostThreadPool&) = delete;
+    HostThreadPool& operator= (const HostThreadPool&) = delete;
+
+private:
+    const int mNumThreads;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mLock;
+    std::condition_variable mWake;
+    const std::function<void (int)>* mTask = nullptr;
+    int mNumTasks = 0;
+    long long mBatch = 0;
+    bool mQuit = false;
+
+    std::atomic<int> mNextTask { 0 };
+    std::atomic<int> mNumDone { 0 };
+    std::atomic<int> mNumBusy { 0 };
+
+    void work (const std::function<void (int)>& task, int numTasks)
+    {
+        for (int index = mNextTask.fetch_add (1, std::memory_order_relaxed); index < numTasks;
+             index = mNextTask.fetch_add (1, std::memory_order_relaxed))
+        {
+            task (index);
+            mNumDone.fetch_add (1, std::memory_order_release);
+        }
+    }
+
+    void runWorker()
+    {
+        long long lastBatch = 0;
+
+        for (;;)
+        {
+            const std::function<void (int)>* task = nullptr;
+            int numTasks = 0;
+
+            {
+                std::unique_lock<std::mutex> lock (mLock);
+                mWake.wait (lock, [&] { return mQuit || (mBatch != lastBatch && mTask != nullptr); });
+
+                if (mQuit)
+                    return;
+
+                lastBatch = mBatch;
+                task = mTask;
+                numTasks = mNumTasks;
+                mNumBusy.fetch_add (1, std::memory_order_relaxed);
+            }
+
+            work (*task, numTasks);
+            mNumBusy.fetch_sub (1, std::memory_order_release);
+        }
+    }
+};
@@ -0,0 +1,333 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+    Catches the audio thread allocating, locking or making a system call.
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined (__linux__) && defined (__GLIBC__)
+ #define MFX_INTERPOSE 1
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <semaphore.h>
+ #include <time.h>
+ #include <unistd.h>
+#elif defined (__APPLE__)
+ #define MFX_INTERPOSE 0
+ #include <execinfo.h>
+#else
+ #define MFX_INTERPOSE 0
+#endif
+
+namespace
+{
+    struct Violation
+    {
+        const char* what;
+        int numFrames;
+        void* frames[RealtimeGuard::maxFrames];
+    };
+
+    Violation violations[RealtimeGuard::maxViolations];
+    std::atomic<int> numViolations { 0 };
+
+    // plain ints, so the thread-locals need no constructor that could itself allocate
+    thread_local int checkDepth = 0;
+    thread_local bool recording = false;
+
+    void record (const char* what)
+    {
+        if (checkDepth == 0 || recording)
+            return;
+
+        // the stack trace may allocate the first time, which mustn't be recorded in turn
+        recording = true;
+        const int index = numViolations.fetch_add (1);
+
+        if (index < RealtimeGuard::maxViolations)
+        {
+            auto& violation = violations[index];
+            violation.what = what;
+            violation.numFrames = 0;
+
+           #if defined (__GLIBC__) || defined (__APPLE__)
+            violation.numFrames = backtrace (violation.frames, RealtimeGuard::maxFrames);
+           #endif
+        }
+
+        recording = false;
+    }
+
+   #if MFX_INTERPOSE
+    // the next definition along, libc's. Looked up without a guarded static, which would lock
+    template <typename FunctionType>
+    FunctionType getReal (std::atomic<void*>& cache, const char* name)
+    {
+        void* function = cache.load (std::memory_order_relaxed);
+
+        if (function == nullptr)
+        {
+            function = dlsym (RTLD_NEXT, name);
+            cache.store (function, std::memory_order_relaxed);
+        }
+
+        return reinterpret_cast<FunctionType> (function);
+    }
+
+    #define MFX_REAL(name) getReal<decltype (&name)> (real_##name, #name)
+    #define MFX_DECLARE_REAL(name) std::atomic<void*> real_##name { nullptr };
+
+    MFX_DECLARE_REAL (pthread_mutex_lock)
+    MFX_DECLARE_REAL (pthread_rwlock_rdlock)
+    MFX_DECLARE_REAL (pthread_rwlock_wrlock)
+    MFX_DECLARE_REAL (pthread_cond_wait)
+    MFX_DECLARE_REAL (pthread_cond_timedwait)
+    MFX_DECLARE_REAL (sem_wait)
+    MFX_DECLARE_REAL (read)
+    MFX_DECLARE_REAL (write)
+    MFX_DECLARE_REAL (close)
+    MFX_DECLARE_REAL (nanosleep)
+    MFX_DECLARE_REAL (usleep)
+    MFX_DECLARE_REAL (sched_yield)
+   #endif
+}
+
+//==============================================================================
+RealtimeGuard::ScopedCheck::ScopedCheck()
+{
+    ++checkDepth;
+}
+
+RealtimeGuard::ScopedCheck::~ScopedCheck()
+{
+    --checkDepth;
+}
+
+bool RealtimeGuard::catchesLocks()
+{
+    return MFX_INTERPOSE != 0;
+}
+
+int RealtimeGuard::getNumViolations()
+{
+    return numViolations.load();
+}
+
+void RealtimeGuard::clearViolations()
+{
+    numViolations.store (0);
+}
+
+void RealtimeGuard::printViolations (std::FILE* file, int maxToPrint)
+{
+    const int total = numViolations.load();
+    const int numToPrint = std::min ({ total, maxToPrint, maxViolations });
+
+    for (int index = 0; index < numToPrint; ++index)
+    {
+        const auto& violation = violations[index];
+        std::fprintf (file, "%s on the audio thread, from:\n", violation.what);
+        std::fflush (file);
+
+        // the first two frames are record() and the hook
+       #if defined (__GLIBC__) || defined (__APPLE__)
+        if (violation.numFrames > 2)
+            backtrace_symbols_fd (violation.frames + 2, violation.numFrames - 2, fileno (file));
+        else
+       #endif
+            std::fprintf (file, "  (no stack trace)\n");
+    }
+
+    if (total > numToPrint)
+        std::fprintf (file, "and %d more\n", total - numToPrint);
+}
+
+//==============================================================================
+#if MFX_INTERPOSE
+
+// glibc's allocator under its internal names, so these can pass every call on without a lookup
+extern "C"
+{
+    void* __libc_malloc (size_t size);
+    void* __libc_calloc (size_t count, size_t size);
+    void* __libc_realloc (void* pointer, size_t size);
+    void* __libc_memalign (size_t alignment, size_t size);
+    void __libc_free (void* pointer);
+
+    void* malloc (size_t size)
+    {
+        record ("malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size)
+    {
+        record ("calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* pointer, size_t size)
+    {
+        record ("realloc");
+        return __libc_realloc (pointer, size);
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size)
+    {
+        record ("aligned_alloc");
+        return __libc_memalign (alignment, size);
+    }
+
+    int posix_memalign (void** pointer, size_t alignment, size_t size)
+    {
+        record ("posix_memalign");
+        *pointer = __libc_memalign (alignment, size);
+        return *pointer != nullptr || size == 0 ? 0 : ENOMEM;
+    }
+
+    void free (void* pointer)
+    {
+        if (pointer != nullptr)
+            record ("free");
+
+        __libc_free (pointer);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        record ("pthread_mutex_lock");
+        return MFX_REAL (pthread_mutex_lock) (mutex);
+    }
+
+    int pthread_rwlock_rdlock (pthread_rwlock_t* lock) noexcept
+    {
+        record ("pthread_rwlock_rdlock");
+        return MFX_REAL (pthread_rwlock_rdlock) (lock);
+    }
+
+    int pthread_rwlock_wrlock (pthread_rwlock_t* lock) noexcept
+    {
+        record ("pthread_rwlock_wrlock");
+        return MFX_REAL (pthread_rwlock_wrlock) (lock);
+    }
+
+    int pthread_cond_wait (pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        record ("pthread_cond_wait");
+        return MFX_REAL (pthread_cond_wait) (condition, mutex);
+    }
+
+    int pthread_cond_timedwait (pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* time)
+    {
+        record ("pthread_cond_timedwait");
+        return MFX_REAL (pthread_cond_timedwait) (condition, mutex, time);
+    }
+
+    int sem_wait (sem_t* semaphore)
+    {
+        record ("sem_wait");
+        return MFX_REAL (sem_wait) (semaphore);
+    }
+
+    ssize_t read (int descriptor, void* buffer, size_t numBytes)
+    {
+        record ("read");
+        return MFX_REAL (read) (descriptor, buffer, numBytes);
+    }
+
+    ssize_t write (int descriptor, const void* buffer, size_t numBytes)
+    {
+        record ("write");
+        return MFX_REAL (write) (descriptor, buffer, numBytes);
+    }
+
+    int close (int descriptor)
+    {
+        record ("close");
+        return MFX_REAL (close) (descriptor);
+    }
+
+    int nanosleep (const struct timespec* duration, struct timespec* remaining)
+    {
+        record ("nanosleep");
+        return MFX_REAL (nanosleep) (duration, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        record ("usleep");
+        return MFX_REAL (usleep) (microseconds);
+    }
+
+    int sched_yield() noexcept
+    {
+        record ("sched_yield");
+        return MFX_REAL (sched_yield)();
+    }
+}
+
+#else
+
+// elsewhere the C++ allocations are the ones that can be caught portably
+void* operator new (std::size_t size)
+{
+    record ("operator new");
+
+    if (auto* pointer = std::malloc (size > 0 ? size : 1))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    return operator new (size);
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    record ("operator new");
+    return std::malloc (size > 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new (size, tag);
+}
+
+void operator delete (void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        record ("operator delete");
+
+    std::free (pointer);
+}
+
+void operator delete[] (void* pointer) noexcept
+{
+    operator delete (pointer);
+}
+
+void operator delete (void* pointer, std::size_t) noexcept
+{
+    operator delete (pointer);
+}
+
+void operator delete[] (void* pointer, std::size_t) noexcept
+{
+    operator delete (pointer);
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Catches the audio thread allocating, locking or making a system call.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdio>
+
+//==============================================================================
+/**
+    While a ScopedCheck is alive on a thread, every allocation or free, every blocking lock and
+    every system call that can block made on that thread is recorded with a stack trace, however
+    deep in a library it happens. A real-time audio callback mustn't do any of them: each one can
+    end up waiting on another thread or on the kernel for longer than a block lasts.
+
+    It works by interposing malloc and free, the pthread locks and waits and a few system calls
+    (on Linux), or by replacing the global operator new and delete (elsewhere), so it's only built
+    into the tools (MFX_REALTIME_GUARD) and costs every call a thread-local test there. Recording
+    doesn't allocate: the first maxViolations go into a fixed table and the rest are only counted.
+*/
+class RealtimeGuard
+{
+public:
+    class ScopedCheck
+    {
+    public:
+        ScopedCheck();
+        ~ScopedCheck();
+
+        ScopedCheck (const ScopedCheck&) = delete;
+        ScopedCheck& operator= (const ScopedCheck&) = delete;
+    };
+
+    // allocations are caught everywhere, locks and system calls only where they can be interposed
+    static bool catchesLocks();
+
+    static int getNumViolations();
+    static void clearViolations();
+
+    // what the first maxToPrint violations were and where they came from. Not from inside a ScopedCheck
+    static void printViolations (std::FILE* file, int maxToPrint);
+
+    static constexpr int maxViolations = 64;
+    static constexpr int maxFrames = 24;
+};
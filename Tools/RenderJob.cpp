@@ -0,0 +1,630 @@
+/*
+  ==============================================================================
+
+    RenderJob.cpp
+
+  ==============================================================================
+*/
+
+#include "RenderJob.h"
+#include "DSP/MultiEffectCore.h"
+#include "DSP/PresetState.h"
+#include "AutomationTimeline.h"
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+namespace
+{
+    const char* const optionNames[] =
+    {
+        "--mod-type", "--dist-type", "--mod-freq", "--overdrive", "--pulser-freq", "--dist-mix", "--level-attack",
+        "--level-release", "--level-detector", "--level-link", "--order", "--oversample", "--os-filter", "--lfo",
+        "--tanh", "--pulser-rate", "--precision", "--program", "--state", "--automate", "--block", "--cpu-report", "--bits"
+    };
+
+    // what the options set apart from the core's parameters
+    struct RenderSettings
+    {
+        int blockSize = 512;
+        int bitsPerSample = 32;
+        int oversamplingFactor = 1;
+        oversamplingFilter filter = firOversampling;
+        bool useDouble = false;
+        std::string cpuReportPath;
+        std::vector<std::string> automation;
+    };
+
+    // the binary format, or the XML if it isn't that
+    bool readStateFile (const std::string& path, PresetState& state)
+    {
+        std::ifstream file (path, std::ios::binary);
+
+        if (! file)
+            return false;
+
+        const std::string data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char>());
+        return state.readBinary (data.data(), data.size()) || state.readXml (data);
+    }
+
+    // parses "<param>@<seconds>=<value>", the type parameters also take rm/am, soft/hard, peak/rms and on/off
+    bool addAutomationPoint (AutomationTimeline& timeline, const std::string& text, double sampleRate)
+    {
+        const auto at = text.find ('@');
+        const auto equals = text.find ('=', at);
+        parameterId parameter;
+
+        if (at == std::string::npos || equals == std::string::npos
+             || ! AutomationTimeline::getParameterId (text.substr (0, at), parameter))
+            return false;
+
+        const double seconds = std::atof (text.substr (at + 1, equals - at - 1).c_str());
+        const std::string valueText = text.substr (equals + 1);
+        double value = std::atof (valueText.c_str());
+
+        if (valueText == "rm" || valueText == "am")
+            value = valueText == "am" ? am : rm;
+        else if (valueText == "soft" || valueText == "hard")
+            value = valueText == "soft" ? soft : hard;
+        else if (valueText == "peak" || valueText == "rms")
+            value = valueText == "rms" ? rmsLevel : peakLevel;
+        else if (valueText == "on" || valueText == "off")
+            value = valueText == "on" ? 1.0 : 0.0;
+
+        timeline.add ((long long) std::llround (std::max (0.0, seconds) * sampleRate), parameter, value);
+        return true;
+    }
+
+    // parses "pulse,mod" and the like. The stages listed are switched on and go first, in that
+    // order, the rest are switched off and follow in their usual order
+    bool setStageOrder (MultiEffectCore& core, const std::string& text)
+    {
+        int code = 0;
+        int numListed = 0;
+        bool listed[numEffectStages] = {};
+
+        for (size_t start = 0; start <= text.size(); )
+        {
+            const auto comma = std::min (text.find (',', start), text.size());
+            std::string name = text.substr (start, comma - start);
+            std::transform (name.begin(), name.end(), name.begin(), [] (char c) { return (char) std::tolower ((unsigned char) c); });
+
+            // the same names as StageOrder::getStageName(), in lower case
+            int stage = 0;
+
+            while (stage < numEffectStages && name != (stage == modStage ? "mod" : (stage == distStage ? "dist" : "pulse")))
+                ++stage;
+
+            if (stage == numEffectStages || listed[stage])
+                return false;
+
+            listed[stage] = true;
+            code |= (stage + 1) << (4 * numListed++);
+            start = comma + 1;
+        }
+
+        core.setStageOrder (StageOrder::fromCode (code));
+        core.setModEnabled (listed[modStage]);
+        core.setDistEnabled (listed[distStage]);
+        core.setPulserEnabled (listed[pulserStage]);
+        return true;
+    }
+
+    bool applyOption (MultiEffectCore& core, RenderSettings& settings, const std::string& option, const std::string& value, std::string& error)
+    {
+        if (option == "--mod-type")
+            core.setModType (value == "am" ? am : rm);
+        else if (option == "--dist-type")
+            core.setDistType (value == "soft" ? soft : hard);
+        else if (option == "--mod-freq")
+            core.setModFreq (std::atof (value.c_str()));
+        else if (option == "--overdrive")
+            core.setOverdrive (std::atof (value.c_str()));
+        else if (option == "--pulser-freq")
+            core.setPulserFreq (std::atof (value.c_str()));
+        else if (option == "--dist-mix")
+            core.setDistMix (std::atof (value.c_str()));
+        else if (option == "--level-attack")
+            core.setLevelAttack (std::atof (value.c_str()));
+        else if (option == "--level-release")
+            core.setLevelRelease (std::atof (value.c_str()));
+        else if (option == "--level-detector")
+            core.setLevelDetector (value == "rms" ? rmsLevel : peakLevel);
+        else if (option == "--level-link")
+            core.setLevelLink (value == "on");
+        else if (option == "--order")
+        {
+            if (! setStageOrder (core, value))
+            {
+                error = "can't read stage order " + value;
+                return false;
+            }
+        }
+        else if (option == "--oversample")
+            settings.oversamplingFactor = std::atoi (value.c_str());
+        else if (option == "--os-filter")
+            settings.filter = value == "iir" ? iirOversampling : firOversampling;
+        else if (option == "--lfo")
+            core.setLfoBackend (value == "exact" ? exactLfo : (value == "wavetable" ? wavetableLfo : rotatorLfo));
+        else if (option == "--tanh")
+            core.setTanhApprox (value == "exact" ? exactTanh : (value == "polynomial" ? polynomialTanh : padeTanh));
+        else if (option == "--pulser-rate")
+            core.setPulserControlInterval (std::atoi (value.c_str()));
+        else if (option == "--precision")
+            settings.useDouble = value == "double";
+        else if (option == "--program")
+        {
+            const int program = std::atoi (value.c_str());
+
+            if (program < 0 || program >= PresetState::getNumPrograms())
+            {
+                error = "there's no program " + value;
+                return false;
+            }
+
+            core.setParameters (PresetState::getProgram (program).getParameters());
+        }
+        else if (option == "--state")
+        {
+            PresetState state;
+
+            if (! readStateFile (value, state))
+            {
+                error = "can't read state " + value;
+                return false;
+            }
+
+            core.setParameters (state.getParameters());
+            core.setStageOrder (StageOrder::fromCode ((int) state.get (stageOrderField)));
+            settings.oversamplingFactor = (int) state.get (offlineOversamplingField);
+        }
+        else if (option == "--automate")
+            settings.automation.push_back (value);
+        else if (option == "--block")
+            settings.blockSize = std::max (1, std::atoi (value.c_str()));
+        else if (option == "--bits")
+            settings.bitsPerSample = std::atoi (value.c_str());
+        else if (option == "--cpu-report")
+            settings.cpuReportPath = value;
+        else
+        {
+            error = "unknown option " + option;
+            return false;
+        }
+
+        return true;
+    }
+
+    // the host blocks of one chunk, in float or double, with the events from the timeline
+    template <typename SampleType>
+    void renderChunk (MultiEffectCore& core, AutomationTimeline& timeline, std::vector<SampleType*>& pointers,
+                      std::vector<std::vector<SampleType>>& channels, long long chunkStart, int numFrames, int blockSize,
+                      CpuStats& cpuStats)
+    {
+        for (int start = 0; start < numFrames; start += blockSize)
+        {
+            const int numThisTime = std::min (blockSize, numFrames - start);
+
+            for (size_t channel = 0; channel < channels.size(); ++channel)
+                pointers[channel] = channels[channel].data() + start;
+
+            timeline.process (core, pointers.data(), (int) channels.size(), chunkStart + start, numThisTime);
+            cpuStats.addFrom (core.getCpuMeter());
+        }
+    }
+
+    // everything a render needs apart from the core
+    struct RenderContext
+    {
+        WavReader reader;
+        RenderSettings settings;
+        AutomationTimeline timeline;
+        CpuStats cpuStats;
+
+        // whole blocks to a chunk, so the blocks fall where they would if the file were processed in one go
+        int chunkSize = 0;
+
+        std::vector<std::vector<float>> channels;
+        std::vector<float*> pointers;
+        std::vector<std::vector<double>> doubleChannels;
+        std::vector<double*> doublePointers;
+    };
+
+    // opens the input, applies the options to the core and prepares it
+    bool setUpRender (const RenderJob& job, int chunkFrames, MultiEffectCore& core, RenderContext& context, std::string& error)
+    {
+        if (! checkRenderOptions (job.options, error))
+            return false;
+
+        auto& reader = context.reader;
+        auto& settings = context.settings;
+
+        if (! reader.open (job.inputPath, error))
+            return false;
+
+        if (reader.getNumChannels() > MultiEffectCore::maxChannels)
+        {
+            error = job.inputPath + " has " + std::to_string (reader.getNumChannels()) + " channels, at most "
+                  + std::to_string (MultiEffectCore::maxChannels) + " are supported";
+            return false;
+        }
+
+        for (size_t i = 0; i < job.options.size(); i += 2)
+            if (! applyOption (core, settings, job.options[i], job.options[i + 1], error))
+                return false;
+
+        if (! settings.cpuReportPath.empty() && ! CpuMeter::isCompiledIn)
+        {
+            error = "--cpu-report needs a build with MFX_INSTRUMENTATION on";
+            return false;
+        }
+
+        for (const auto& point : settings.automation)
+        {
+            if (! addAutomationPoint (context.timeline, point, reader.getSampleRate()))
+            {
+                error = "can't read automation point " + point;
+                return false;
+            }
+        }
+
+        core.setOversampling (settings.oversamplingFactor, settings.filter);
+        core.prepare (reader.getSampleRate(), reader.getNumChannels());
+
+        // the meter is read after every block, so its queue never fills up
+        core.getCpuMeter().setEnabled (! settings.cpuReportPath.empty());
+
+        const int numChannels = reader.getNumChannels();
+        const int blockSize = settings.blockSize;
+        context.chunkSize = std::max (1, (std::max (1, chunkFrames) + blockSize - 1) / blockSize) * blockSize;
+
+        context.channels.assign ((size_t) numChannels, std::vector<float> ((size_t) context.chunkSize));
+        context.pointers.resize ((size_t) numChannels);
+        context.doubleChannels.assign ((size_t) (settings.useDouble ? numChannels : 0), std::vector<double> ((size_t) context.chunkSize));
+        context.doublePointers.resize (context.doubleChannels.size());
+
+        for (size_t channel = 0; channel < context.channels.size(); ++channel)
+            context.pointers[channel] = context.channels[channel].data();
+
+        return true;
+    }
+
+    // renders the core's samples from start to end a chunk at a time, from the reader's position on
+    // (past the end of the file the input is silent). The output from keepFrom on goes to the
+    // writer, if there is one. Returns false if a write failed
+    bool renderRange (MultiEffectCore& core, RenderContext& context, long long start, long long end,
+                      WavWriter* writer, long long keepFrom)
+    {
+        auto& channels = context.channels;
+        auto& pointers = context.pointers;
+        const int blockSize = context.settings.blockSize;
+
+        for (long long chunkStart = start; chunkStart < end; chunkStart += context.chunkSize)
+        {
+            const int numThisTime = (int) std::min ((long long) context.chunkSize, end - chunkStart);
+            const int numRead = context.reader.read (pointers.data(), numThisTime);
+
+            for (auto& channel : channels)
+                std::fill (channel.begin() + numRead, channel.begin() + numThisTime, 0.0f);
+
+            // in double each chunk is converted on the way in and on the way out, like a host with a
+            // 64-bit mix bus would, and nothing in between is rounded to float
+            if (context.settings.useDouble)
+            {
+                auto& doubleChannels = context.doubleChannels;
+
+                for (size_t channel = 0; channel < channels.size(); ++channel)
+                    std::copy (channels[channel].begin(), channels[channel].begin() + numThisTime, doubleChannels[channel].begin());
+
+                renderChunk (core, context.timeline, context.doublePointers, doubleChannels, chunkStart, numThisTime, blockSize, context.cpuStats);
+
+                for (size_t channel = 0; channel < channels.size(); ++channel)
+                    std::transform (doubleChannels[channel].begin(), doubleChannels[channel].begin() + numThisTime, channels[channel].begin(),
+                                    [] (double sample) { return (float) sample; });
+            }
+            else
+            {
+                renderChunk (core, context.timeline, pointers, channels, chunkStart, numThisTime, blockSize, context.cpuStats);
+            }
+
+            const int numToDrop = (int) std::min ((long long) numThisTime, std::max (0LL, keepFrom - chunkStart));
+
+            for (size_t channel = 0; channel < channels.size(); ++channel)
+                pointers[channel] = channels[channel].data() + numToDrop;
+
+            const bool written = writer == nullptr || writer->write (pointers.data(), numThisTime - numToDrop);
+
+            for (size_t channel = 0; channel < channels.size(); ++channel)
+                pointers[channel] = channels[channel].data();
+
+            if (! written)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+//==============================================================================
+void printRenderOptions()
+{
+    std::printf ("  --mod-type rm|am        modulation type (default rm)\n"
+                 "  --dist-type soft|hard   clipping type (default hard)\n"
+                 "  --mod-freq <Hz>         modulation frequency, 0 - %g (default %g)\n"
+                 "  --overdrive <x>         overdrive gain, 1 - %g (default %g)\n"
+                 "  --pulser-freq <Hz>      pulser frequency, 0 - %g (default %g)\n"
+                 "  --dist-mix <0-1>        distortion wet/dry mix (default %g)\n"
+                 "  --level-attack <ms>     attack of the make-up gain level followers (default %g)\n"
+                 "  --level-release <ms>    release of the make-up gain level followers (default %g)\n"
+                 "  --level-detector peak|rms   level the make-up gain follows (default peak)\n"
+                 "  --level-link on|off     one make-up gain for all channels (default off)\n"
+                 "  --order <stages>        the stages that are on, in the order they run, from mod, dist and pulse\n"
+                 "                          (default mod,dist,pulse). The ones left out are switched off\n"
+                 "  --oversample 1|2|4|8    oversampling of the clipping (default 1)\n"
+                 "  --os-filter iir|fir     oversampling filters (default fir)\n"
+                 "  --lfo exact|wavetable|rotator   LFO backend (default rotator)\n"
+                 "  --tanh exact|pade|polynomial    soft clip tanh (default pade)\n"
+                 "  --pulser-rate <samples>   works the pulser LFO out every 1 - 256 samples, a power of two\n"
+                 "                          (default 1, every sample)\n"
+                 "  --precision float|double   processing precision (default float)\n"
+                 "  --program <n>           one of the built-in programs (listed below)\n"
+                 "  --state <file>          a saved state, binary or XML, including its render oversampling.\n"
+                 "                          Options are applied in order, so the ones after these override them\n"
+                 "  --automate <param>@<seconds>=<value>   sample-accurate parameter change, can be repeated.\n"
+                 "                          param is mod-freq, overdrive, pulser-freq, dist-mix, mod-type, dist-type,\n"
+                 "                          level-attack, level-release, level-detector, level-link, mod-on,\n"
+                 "                          dist-on, pulser-on or bypass\n"
+                 "  --block <samples>       processing block size (default 512)\n"
+                 "  --cpu-report <file.json>   times the render and writes the CPU figures to a file\n"
+                 "  --bits 16|24|32         output bit depth, 32 is float (default 32)\n",
+                 MOD_FREQ_LIMIT, MOD_FREQ_INIT, OVERDRIVE_LIMIT, OVERDRIVE_INIT, PULSER_FREQ_LIMIT, PULSER_FREQ_INIT, DIST_MIX_INIT,
+                 LEVEL_ATTACK_INIT, LEVEL_RELEASE_INIT);
+
+    std::printf ("programs:");
+
+    for (int program = 0; program < PresetState::getNumPrograms(); ++program)
+        std::printf ("%s %d %s", program == 0 ? "" : ",", program, PresetState::getProgramName (program));
+
+    std::printf ("\n");
+}
+
+bool checkRenderOptions (const std::vector<std::string>& options, std::string& error)
+{
+    for (size_t i = 0; i < options.size(); i += 2)
+    {
+        if (std::find (std::begin (optionNames), std::end (optionNames), options[i]) == std::end (optionNames))
+        {
+            error = "unknown option " + options[i];
+            return false;
+        }
+
+        if (i + 1 >= options.size())
+        {
+            error = "missing value for " + options[i];
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool runRenderJob (const RenderJob& job, int chunkFrames, RenderResult& result, std::string& error)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // on the heap, the batch renderer's worker threads don't have a main thread's stack
+    auto core = std::make_unique<MultiEffectCore>();
+    RenderContext context;
+
+    if (! setUpRender (job, chunkFrames, *core, context, error))
+        return false;
+
+    const auto& reader = context.reader;
+    const auto& settings = context.settings;
+    WavWriter writer;
+
+    if (! writer.open (job.outputPath, reader.getSampleRate(), reader.getNumChannels(), settings.bitsPerSample, reader.getNumFrames(), error))
+        return false;
+
+    // the latency's worth of extra samples is rendered and dropped from the start
+    const int latency = core->getLatencySamples();
+    renderRange (*core, context, 0, reader.getNumFrames() + latency, &writer, latency);
+
+    if (! writer.close (error))
+        return false;
+
+    if (! settings.cpuReportPath.empty())
+    {
+        std::ofstream report (settings.cpuReportPath);
+        report << context.cpuStats.toJson();
+
+        if (! report)
+        {
+            error = "can't write " + settings.cpuReportPath;
+            return false;
+        }
+
+        result.cpuStatsText = context.cpuStats.toText();
+    }
+
+    result.numFrames = reader.getNumFrames();
+    result.numChannels = reader.getNumChannels();
+    result.sampleRate = reader.getSampleRate();
+    result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+//==============================================================================
+bool canSplitRenderJob (const RenderJob& job)
+{
+    for (size_t i = 0; i < job.options.size(); i += 2)
+        if (job.options[i] == "--automate" || job.options[i] == "--cpu-report")
+            return false;
+
+    return true;
+}
+
+bool splitRenderJob (const RenderJob& job, double sectionSeconds, double preRollSeconds, int chunkFrames,
+                     std::vector<RenderSection>& sections, std::string& error)
+{
+    auto core = std::make_unique<MultiEffectCore>();
+    RenderContext context;
+
+    if (! setUpRender (job, chunkFrames, *core, context, error))
+        return false;
+
+    // whole chunks to a section, the last one takes what's left over
+    const double sampleRate = context.reader.getSampleRate();
+    const long long chunkSize = context.chunkSize;
+    const long long numToRender = context.reader.getNumFrames() + core->getLatencySamples();
+    const long long sectionFrames = std::max (chunkSize, (long long) (sectionSeconds * sampleRate) / chunkSize * chunkSize);
+    const long long numSections = std::max (1LL, numToRender / sectionFrames);
+    const long long preRollFrames = (long long) std::ceil (std::max (0.0, preRollSeconds) * sampleRate);
+
+    sections.clear();
+
+    for (long long i = 0; i < numSections; ++i)
+    {
+        RenderSection section;
+        section.start = i * sectionFrames;
+        section.end = i == numSections - 1 ? numToRender : (i + 1) * sectionFrames;
+        section.preRollFrames = std::min (preRollFrames, section.start);
+        section.sampleRate = sampleRate;
+        section.partPath = job.outputPath + ".part" + std::to_string (i);
+        sections.push_back (section);
+    }
+
+    return true;
+}
+
+bool runRenderSection (const RenderJob& job, RenderSection& section, int chunkFrames, std::string& error)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    auto core = std::make_unique<MultiEffectCore>();
+    RenderContext context;
+
+    if (! setUpRender (job, chunkFrames, *core, context, error))
+        return false;
+
+    WavWriter writer;
+
+    if (! writer.open (section.partPath, context.reader.getSampleRate(), context.reader.getNumChannels(), 32, section.end - section.start, error))
+        return false;
+
+    // the pre-roll starts on a whole block, so every block falls where it would in one go. The
+    // first section drops the latency's worth at the start, like runRenderJob()
+    const int blockSize = context.settings.blockSize;
+    const long long renderStart = std::max (0LL, section.start - section.preRollFrames) / blockSize * blockSize;
+    const long long keepFrom = std::max (section.start, (long long) core->getLatencySamples());
+
+    core->setSamplePosition (renderStart);
+    context.reader.seek (renderStart);
+
+    renderRange (*core, context, renderStart, section.start, nullptr, 0);
+    section.startHash = core->getStateHash();
+
+    renderRange (*core, context, section.start, section.end, &writer, keepFrom);
+    section.endHash = core->getStateHash();
+
+    if (! writer.close (error))
+        return false;
+
+    section.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+bool joinRenderSections (const RenderJob& job, std::vector<RenderSection>& sections, int chunkFrames,
+                         RenderResult& result, std::string& error)
+{
+    const auto startTime = std::chrono::steady_clock::now();
+
+    const auto removeParts = [&sections]
+    {
+        for (const auto& section : sections)
+            std::remove (section.partPath.c_str());
+    };
+
+    result.numSections = (int) sections.size();
+    result.numRerendered = 0;
+
+    // each seam in turn, so the section before it is known to be right by the time it's checked
+    for (size_t i = 1; i < sections.size(); ++i)
+    {
+        auto& section = sections[i];
+
+        while (section.startHash != sections[i - 1].endHash)
+        {
+            // from the start of the file it's rendering the same samples as the sections before it,
+            // so only something that isn't deterministic could get here
+            if (section.preRollFrames >= section.start)
+            {
+                error = job.outputPath + ": section " + std::to_string (i) + " doesn't carry on from the one before it";
+                removeParts();
+                return false;
+            }
+
+            section.preRollFrames = std::min (section.start, std::max ((long long) chunkFrames, section.preRollFrames * 2));
+            ++result.numRerendered;
+
+            if (! runRenderSection (job, section, chunkFrames, error))
+            {
+                removeParts();
+                return false;
+            }
+        }
+    }
+
+    // the input's header gives the format, the settings give the bit depth
+    auto core = std::make_unique<MultiEffectCore>();
+    RenderContext context;
+
+    if (! setUpRender (job, chunkFrames, *core, context, error))
+    {
+        removeParts();
+        return false;
+    }
+
+    const auto& reader = context.reader;
+    WavWriter writer;
+
+    if (! writer.open (job.outputPath, reader.getSampleRate(), reader.getNumChannels(), context.settings.bitsPerSample, reader.getNumFrames(), error))
+    {
+        removeParts();
+        return false;
+    }
+
+    for (const auto& section : sections)
+    {
+        WavReader part;
+
+        if (! part.open (section.partPath, error))
+        {
+            removeParts();
+            return false;
+        }
+
+        while (const int numRead = part.read (context.pointers.data(), context.chunkSize))
+            if (! writer.write (context.pointers.data(), numRead))
+                break;
+    }
+
+    removeParts();
+
+    if (! writer.close (error))
+        return false;
+
+    result.numFrames = reader.getNumFrames();
+    result.numChannels = reader.getNumChannels();
+    result.sampleRate = reader.getSampleRate();
+    result.seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    RenderJob.h
+    One file through MultiEffectCore with mfx_render's options, streamed a
+    chunk at a time. mfx_render runs one, mfx_batch runs a list of them and
+    can split the long ones into sections that render side by side.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// how many frames are read, processed and written at a time, rounded up to whole blocks
+#define RENDER_CHUNK_FRAMES 65536
+
+// how long each section of a split job renders for before its output is kept, in seconds, so its
+// filters and level followers settle into the state the section before it left them in
+#define RENDER_PRE_ROLL_SECONDS 2.0
+
+//==============================================================================
+struct RenderJob
+{
+    std::string inputPath;
+    std::string outputPath;
+
+    // "--option", "value" pairs as they'd be given to mfx_render, applied in order
+    std::vector<std::string> options;
+};
+
+struct RenderResult
+{
+    long long numFrames = 0;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+
+    // wall clock time for the whole job, reading and writing included
+    double seconds = 0.0;
+
+    // the CPU figures as text, if the options asked for a CPU report
+    std::string cpuStatsText;
+
+    // for a split job, how many sections it was rendered in, and how many times a section had to be
+    // rendered again because it didn't carry on from the one before
+    int numSections = 1;
+    int numRerendered = 0;
+
+    double getAudioSeconds() const          { return sampleRate > 0.0 ? (double) numFrames / sampleRate : 0.0; }
+    double getRealtimeMultiple() const      { return seconds > 0.0 ? getAudioSeconds() / seconds : 0.0; }
+};
+
+// part of a split job. Positions are in the core's samples, which run the latency ahead of the
+// output file's frames. The section's output is from start to end, but its core starts preRollFrames
+// before that (from silence, at that position), and its output is kept in a part file until the
+// sections are joined
+struct RenderSection
+{
+    long long start = 0;
+    long long end = 0;
+    long long preRollFrames = 0;
+    double sampleRate = 0.0;
+    std::string partPath;
+
+    // the core's state hash at start (after the pre-roll) and at end. A section carries on exactly
+    // from the one before it when its start hash is that one's end hash
+    uint64_t startHash = 0;
+    uint64_t endHash = 0;
+
+    // wall clock time of the last render of the section
+    double seconds = 0.0;
+
+    double getAudioSeconds() const          { return sampleRate > 0.0 ? (double) (end - start) / sampleRate : 0.0; }
+};
+
+// the option lines of mfx_render's usage and the programs, mfx_batch takes the same options
+void printRenderOptions();
+
+// every option has to be one that's known and have a value. Nothing is opened, so a whole job
+// list can be checked before any of it renders
+bool checkRenderOptions (const std::vector<std::string>& options, std::string& error);
+
+// renders the job in chunks of chunkFrames, so it takes the same memory however long the file is.
+// The output is shifted back by the latency, the way a host compensates for it in a bounce
+bool runRenderJob (const RenderJob& job, int chunkFrames, RenderResult& result, std::string& error);
+
+//==============================================================================
+// a job can be split as long as its settings don't change over time. An automated frequency moves
+// the phase of the LFOs from then on, which a section starting later couldn't know about, and the
+// CPU report is for a single render
+bool canSplitRenderJob (const RenderJob& job);
+
+// cuts the job into sections of about sectionSeconds, each with preRollSeconds of pre-roll. A job
+// shorter than two sections comes back as one section
+bool splitRenderJob (const RenderJob& job, double sectionSeconds, double preRollSeconds, int chunkFrames,
+                     std::vector<RenderSection>& sections, std::string& error);
+
+// renders one section into its part file. The sections of a job can render at the same time
+bool runRenderSection (const RenderJob& job, RenderSection& section, int chunkFrames, std::string& error);
+
+// checks every seam, renders a section that doesn't carry on from the one before it again with
+// twice the pre-roll (back to the start of the file if need be, where it's bound to), then joins
+// the parts into the job's output and deletes them. The output is identical to runRenderJob()'s
+bool joinRenderSections (const RenderJob& job, std::vector<RenderSection>& sections, int chunkFrames,
+                         RenderResult& result, std::string& error);
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    RenderMain.cpp
+    mfx_render: runs a WAV file through MultiEffectCore offline.
+
+  ==============================================================================
+*/
+
+#include "RenderJob.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void printUsage()
+    {
+        std::printf ("usage: mfx_render <input.wav> <output.wav> [options]\n");
+        printRenderOptions();
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    const RenderJob job { argv[1], argv[2], std::vector<std::string> (argv + 3, argv + argc) };
+    RenderResult result;
+    std::string error;
+
+    if (! checkRenderOptions (job.options, error))
+    {
+        std::fprintf (stderr, "%s\n", error.c_str());
+        printUsage();
+        return 1;
+    }
+
+    if (! runRenderJob (job, RENDER_CHUNK_FRAMES, result, error))
+    {
+        std::fprintf (stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf ("rendered %lld samples x %d channels at %g Hz -> %s\n", result.numFrames, result.numChannels, result.sampleRate, job.outputPath.c_str());
+
+    if (! result.cpuStatsText.empty())
+        std::printf ("%s", result.cpuStatsText.c_str());
+
+    return 0;
+}
@@ -0,0 +1,511 @@
+/*
+  ==============================================================================
+
+    WavFile.cpp
+
+  ==============================================================================
+*/
+
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if MFX_WAV_MMAP
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr uint16_t formatPcm = 1;
+    constexpr uint16_t formatFloat = 3;
+    constexpr uint16_t formatExtensible = 0xfffe;
+
+    // the size fields of a plain WAV are 32 bits, RF64 sets them to this and keeps the real ones in "ds64"
+    constexpr uint32_t rf64Size = 0xffffffffu;
+
+    // the header of a plain WAV, and of an RF64 one with its ds64 chunk
+    constexpr int wavHeaderSize = 44;
+    constexpr int rf64HeaderSize = 80;
+
+    // how much of a mapped file is read before the pages behind it are handed back
+    constexpr size_t mappedReleaseBytes = 4 << 20;
+
+    uint32_t readLE32 (const unsigned char* p)
+    {
+        return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+    }
+
+    uint64_t readLE64 (const unsigned char* p)
+    {
+        return (uint64_t) readLE32 (p) | ((uint64_t) readLE32 (p + 4) << 32);
+    }
+
+    uint16_t readLE16 (const unsigned char* p)
+    {
+        return (uint16_t) (p[0] | (p[1] << 8));
+    }
+
+    void writeLE32 (std::ostream& out, uint32_t value)
+    {
+        const unsigned char bytes[4] = { (unsigned char) value, (unsigned char) (value >> 8),
+                                         (unsigned char) (value >> 16), (unsigned char) (value >> 24) };
+        out.write ((const char*) bytes, 4);
+    }
+
+    void writeLE64 (std::ostream& out, uint64_t value)
+    {
+        writeLE32 (out, (uint32_t) value);
+        writeLE32 (out, (uint32_t) (value >> 32));
+    }
+
+    void writeLE16 (std::ostream& out, uint16_t value)
+    {
+        const unsigned char bytes[2] = { (unsigned char) value, (unsigned char) (value >> 8) };
+        out.write ((const char*) bytes, 2);
+    }
+
+    float clampToUnity (float sample)
+    {
+        return sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+    }
+
+    void decodeFrames (const unsigned char* raw, int numFrames, float* const* channels, int numChannels, bool isFloat, int bitsPerSample)
+    {
+        const int bytesPerSample = bitsPerSample / 8;
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const auto* p = raw;
+                float sample = 0.0f;
+
+                if (isFloat)
+                {
+                    const auto bits = readLE32 (p);
+                    std::memcpy (&sample, &bits, 4);
+                }
+                else if (bitsPerSample == 16)
+                {
+                    sample = (float) (int16_t) readLE16 (p) / 32768.0f;
+                }
+                else if (bitsPerSample == 24)
+                {
+                    const auto value = (int32_t) ((uint32_t) p[0] << 8 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 24) >> 8;
+                    sample = (float) value / 8388608.0f;
+                }
+                else
+                {
+                    sample = (float) ((double) (int32_t) readLE32 (p) / 2147483648.0);
+                }
+
+                channels[channel][frame] = sample;
+                raw += bytesPerSample;
+            }
+        }
+    }
+
+    void encodeFrames (const float* const* channels, int numFrames, int numChannels, int bitsPerSample, unsigned char* p)
+    {
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const float sample = channels[channel][frame];
+
+                if (bitsPerSample == 32)
+                {
+                    std::memcpy (p, &sample, 4);
+                    p += 4;
+                }
+                else if (bitsPerSample == 16)
+                {
+                    const auto value = (int16_t) std::lrint (clampToUnity (sample) * 32767.0f);
+                    p[0] = (unsigned char) value;
+                    p[1] = (unsigned char) (value >> 8);
+                    p += 2;
+                }
+                else
+                {
+                    const auto value = (int32_t) std::lrint (clampToUnity (sample) * 8388607.0f);
+                    p[0] = (unsigned char) value;
+                    p[1] = (unsigned char) (value >> 8);
+                    p[2] = (unsigned char) (value >> 16);
+                    p += 3;
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+bool readWavFile (const std::string& path, AudioFileData& data, std::string& error)
+{
+    WavReader reader;
+
+    if (! reader.open (path, error))
+        return false;
+
+    const int numFrames = (int) std::min (reader.getNumFrames(), (long long) 0x7fffffff);
+    std::vector<float*> pointers ((size_t) reader.getNumChannels());
+
+    data.sampleRate = reader.getSampleRate();
+    data.channels.assign ((size_t) reader.getNumChannels(), std::vector<float> ((size_t) numFrames));
+
+    for (size_t channel = 0; channel < pointers.size(); ++channel)
+        pointers[channel] = data.channels[channel].data();
+
+    reader.read (pointers.data(), numFrames);
+    return true;
+}
+
+bool writeWavFile (const std::string& path, const AudioFileData& data, int bitsPerSample, std::string& error)
+{
+    WavWriter writer;
+
+    if (! writer.open (path, data.sampleRate, data.getNumChannels(), bitsPerSample, data.getNumSamples(), error))
+        return false;
+
+    std::vector<const float*> pointers;
+
+    for (const auto& channel : data.channels)
+        pointers.push_back (channel.data());
+
+    writer.write (pointers.data(), data.getNumSamples());
+    return writer.close (error);
+}
+
+//==============================================================================
+WavReader::~WavReader()
+{
+    close();
+}
+
+bool WavReader::open (const std::string& path, std::string& error)
+{
+    close();
+    mStream.open (path, std::ios::binary);
+
+    if (! mStream)
+    {
+        error = "can't open " + path;
+        return false;
+    }
+
+    mStream.seekg (0, std::ios::end);
+    const auto fileSize = (uint64_t) mStream.tellg();
+    mStream.seekg (0);
+
+    unsigned char header[12];
+
+    if (! mStream.read ((char*) header, 12) || (std::memcmp (header, "RIFF", 4) != 0 && std::memcmp (header, "RF64", 4) != 0)
+         || std::memcmp (header + 8, "WAVE", 4) != 0)
+    {
+        error = path + " is not a RIFF/WAVE file";
+        return false;
+    }
+
+    const bool isRf64 = std::memcmp (header, "RF64", 4) == 0;
+    uint64_t rf64DataSize = 0;
+    bool gotFormat = false;
+
+    unsigned char chunkHeader[8];
+
+    while (mStream.read ((char*) chunkHeader, 8))
+    {
+        const auto chunkSize = readLE32 (chunkHeader + 4);
+
+        if (std::memcmp (chunkHeader, "ds64", 4) == 0 && isRf64)
+        {
+            unsigned char ds64[16];
+
+            if (chunkSize < 16 || ! mStream.read ((char*) ds64, 16))
+                break;
+
+            rf64DataSize = readLE64 (ds64 + 8);
+            mStream.seekg (chunkSize - 16 + (chunkSize & 1), std::ios::cur);
+        }
+        else if (std::memcmp (chunkHeader, "fmt ", 4) == 0)
+        {
+            std::vector<unsigned char> fmt (chunkSize);
+
+            if (chunkSize < 16 || ! mStream.read ((char*) fmt.data(), chunkSize))
+                break;
+
+            mFormat = readLE16 (fmt.data());
+            mNumChannels = readLE16 (fmt.data() + 2);
+            mSampleRate = (double) readLE32 (fmt.data() + 4);
+            mBitsPerSample = readLE16 (fmt.data() + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format at the start of the sub-format GUID
+            if (mFormat == formatExtensible && chunkSize >= 26)
+                mFormat = readLE16 (fmt.data() + 24);
+
+            gotFormat = true;
+            mStream.seekg (chunkSize & 1, std::ios::cur);
+        }
+        else if (std::memcmp (chunkHeader, "data", 4) == 0)
+        {
+            if (! gotFormat || mNumChannels == 0)
+                break;
+
+            const bool isFloat = (mFormat == formatFloat && mBitsPerSample == 32);
+            const bool isPcm = (mFormat == formatPcm && (mBitsPerSample == 16 || mBitsPerSample == 24 || mBitsPerSample == 32));
+
+            if (! isFloat && ! isPcm)
+            {
+                error = path + ": unsupported sample format";
+                return false;
+            }
+
+            // a file that was cut short has as many whole frames as made it
+            const auto dataOffset = (uint64_t) mStream.tellg();
+            const auto dataSize = std::min (isRf64 && chunkSize == rf64Size ? rf64DataSize : (uint64_t) chunkSize, fileSize - dataOffset);
+            mNumFrames = (long long) (dataSize / (uint64_t) (mNumChannels * mBitsPerSample / 8));
+            mDataOffset = dataOffset;
+
+           #if MFX_WAV_MMAP
+            // only worth it, and only possible, if the whole file fits in the address space
+            if (fileSize <= (uint64_t) SIZE_MAX / 2)
+            {
+                const int fd = ::open (path.c_str(), O_RDONLY);
+
+                if (fd >= 0)
+                {
+                    void* mapped = ::mmap (nullptr, (size_t) fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                    ::close (fd);
+
+                    if (mapped != MAP_FAILED)
+                    {
+                        ::madvise (mapped, (size_t) fileSize, MADV_SEQUENTIAL);
+                        mMapped = static_cast<const unsigned char*> (mapped);
+                        mMappedSize = (size_t) fileSize;
+                        mStream.close();
+                    }
+                }
+            }
+           #endif
+
+            return true;
+        }
+        else
+        {
+            // chunks are padded to an even size
+            mStream.seekg (chunkSize + (chunkSize & 1), std::ios::cur);
+        }
+    }
+
+    error = path + ": missing fmt or data chunk";
+    return false;
+}
+
+void WavReader::close()
+{
+   #if MFX_WAV_MMAP
+    if (mMapped != nullptr)
+        ::munmap (const_cast<unsigned char*> (mMapped), mMappedSize);
+   #endif
+
+    mMapped = nullptr;
+    mMappedSize = mReleasedBytes = 0;
+    mDataOffset = 0;
+    mStream.close();
+    mStream.clear();
+    mNumChannels = 0;
+    mNumFrames = mPosition = 0;
+}
+
+int WavReader::read (float* const* channels, int numFrames)
+{
+    numFrames = (int) std::min ((long long) std::max (0, numFrames), mNumFrames - mPosition);
+
+    if (numFrames <= 0)
+        return 0;
+
+    const bool isFloat = mFormat == formatFloat;
+    const size_t frameSize = (size_t) (mNumChannels * mBitsPerSample / 8);
+
+    if (mMapped != nullptr)
+    {
+        const size_t start = (size_t) mDataOffset + (size_t) mPosition * frameSize;
+        decodeFrames (mMapped + start, numFrames, channels, mNumChannels, isFloat, mBitsPerSample);
+        mPosition += numFrames;
+
+       #if MFX_WAV_MMAP
+        // the pages that have been read won't be needed again
+        const auto pageSize = (size_t) ::sysconf (_SC_PAGESIZE);
+        const size_t readUpTo = (start + (size_t) numFrames * frameSize) / pageSize * pageSize;
+
+        if (readUpTo >= mReleasedBytes + mappedReleaseBytes)
+        {
+            ::madvise (const_cast<unsigned char*> (mMapped) + mReleasedBytes, readUpTo - mReleasedBytes, MADV_DONTNEED);
+            mReleasedBytes = readUpTo;
+        }
+       #endif
+
+        return numFrames;
+    }
+
+    mBuffer.resize ((size_t) numFrames * frameSize);
+    mStream.read ((char*) mBuffer.data(), (std::streamsize) mBuffer.size());
+
+    const int framesRead = (int) ((size_t) mStream.gcount() / frameSize);
+    decodeFrames (mBuffer.data(), framesRead, channels, mNumChannels, isFloat, mBitsPerSample);
+    mPosition += framesRead;
+
+    // the file got shorter while it was being read
+    if (framesRead < numFrames)
+        mNumFrames = mPosition;
+
+    return framesRead;
+}
+
+void WavReader::seek (long long frame)
+{
+    mPosition = std::min (std::max (0LL, frame), mNumFrames);
+
+    const auto offset = mDataOffset + (uint64_t) mPosition * (uint64_t) (mNumChannels * mBitsPerSample / 8);
+
+    if (mMapped != nullptr)
+    {
+       #if MFX_WAV_MMAP
+        // pages are handed back from the new position on
+        const auto pageSize = (size_t) ::sysconf (_SC_PAGESIZE);
+        mReleasedBytes = (size_t) offset / pageSize * pageSize;
+       #endif
+        return;
+    }
+
+    mStream.clear();
+    mStream.seekg ((std::streamoff) offset);
+}
+
+//==============================================================================
+WavWriter::~WavWriter()
+{
+    std::string error;
+    close (error);
+}
+
+bool WavWriter::open (const std::string& path, double sampleRate, int numChannels, int bitsPerSample,
+                      long long expectedNumFrames, std::string& error)
+{
+    if (bitsPerSample != 16 && bitsPerSample != 24 && bitsPerSample != 32)
+    {
+        error = "bit depth must be 16, 24 or 32";
+        return false;
+    }
+
+    mStream.open (path, std::ios::binary);
+
+    if (! mStream)
+    {
+        error = "can't create " + path;
+        return false;
+    }
+
+    const auto bytesPerSample = (uint16_t) (bitsPerSample / 8);
+
+    mPath = path;
+    mNumChannels = numChannels;
+    mBitsPerSample = bitsPerSample;
+    mNumFrames = 0;
+    mIsRf64 = (uint64_t) expectedNumFrames * (uint64_t) (numChannels * bytesPerSample) > rf64Size - rf64HeaderSize;
+
+    // the sizes are filled in by close()
+    if (mIsRf64)
+    {
+        mStream.write ("RF64", 4);
+        writeLE32 (mStream, rf64Size);
+        mStream.write ("WAVE", 4);
+
+        mStream.write ("ds64", 4);
+        writeLE32 (mStream, 28);
+        writeLE64 (mStream, 0);
+        writeLE64 (mStream, 0);
+        writeLE64 (mStream, 0);
+        writeLE32 (mStream, 0);
+    }
+    else
+    {
+        mStream.write ("RIFF", 4);
+        writeLE32 (mStream, 0);
+        mStream.write ("WAVE", 4);
+    }
+
+    mStream.write ("fmt ", 4);
+    writeLE32 (mStream, 16);
+    writeLE16 (mStream, bitsPerSample == 32 ? formatFloat : formatPcm);
+    writeLE16 (mStream, (uint16_t) numChannels);
+    writeLE32 (mStream, (uint32_t) sampleRate);
+    writeLE32 (mStream, (uint32_t) sampleRate * (uint32_t) numChannels * bytesPerSample);
+    writeLE16 (mStream, (uint16_t) (numChannels * bytesPerSample));
+    writeLE16 (mStream, (uint16_t) bitsPerSample);
+
+    mStream.write ("data", 4);
+    writeLE32 (mStream, mIsRf64 ? rf64Size : 0);
+
+    return true;
+}
+
+bool WavWriter::write (const float* const* channels, int numFrames)
+{
+    if (! mStream.is_open() || numFrames <= 0)
+        return numFrames == 0;
+
+    mBuffer.resize ((size_t) numFrames * (size_t) (mNumChannels * mBitsPerSample / 8));
+    encodeFrames (channels, numFrames, mNumChannels, mBitsPerSample, mBuffer.data());
+    mStream.write ((const char*) mBuffer.data(), (std::streamsize) mBuffer.size());
+    mNumFrames += numFrames;
+
+    return (bool) mStream;
+}
+
+bool WavWriter::close (std::string& error)
+{
+    if (! mStream.is_open())
+        return true;
+
+    const auto dataSize = (uint64_t) mNumFrames * (uint64_t) (mNumChannels * mBitsPerSample / 8);
+    bool ok = true;
+
+    // the data chunk is padded to an even size, like every other chunk
+    if ((dataSize & 1) != 0)
+        mStream.put (0);
+
+    const auto paddedSize = dataSize + (dataSize & 1);
+
+    if (mIsRf64)
+    {
+        mStream.seekp (20);
+        writeLE64 (mStream, rf64HeaderSize - 8 + paddedSize);
+        writeLE64 (mStream, dataSize);
+        writeLE64 (mStream, (uint64_t) mNumFrames);
+    }
+    else if (paddedSize > rf64Size - wavHeaderSize)
+    {
+        error = mPath + " got bigger than a WAV file can be";
+        ok = false;
+    }
+    else
+    {
+        mStream.seekp (4);
+        writeLE32 (mStream, (uint32_t) (wavHeaderSize - 8 + paddedSize));
+        mStream.seekp (40);
+        writeLE32 (mStream, (uint32_t) dataSize);
+    }
+
+    if (ok && ! mStream)
+    {
+        error = "write to " + mPath + " failed";
+        ok = false;
+    }
+
+    mStream.close();
+    return ok;
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    WavFile.h
+    Minimal RIFF/WAVE reader and writer for the headless tools, so they don't
+    need juce_audio_formats.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// the reader maps the file into memory where the platform can, and reads it in chunks otherwise
+#if defined (__unix__) || defined (__APPLE__)
+ #define MFX_WAV_MMAP 1
+#else
+ #define MFX_WAV_MMAP 0
+#endif
+
+//==============================================================================
+struct AudioFileData
+{
+    double sampleRate = 44100.0;
+    std::vector<std::vector<float>> channels;
+
+    int getNumChannels() const  { return (int) channels.size(); }
+    int getNumSamples() const   { return channels.empty() ? 0 : (int) channels[0].size(); }
+};
+
+// reads 16/24/32-bit integer PCM or 32-bit float files, returns false and fills in error on failure
+bool readWavFile (const std::string& path, AudioFileData& data, std::string& error);
+
+// bitsPerSample of 16 or 24 writes integer PCM, 32 writes IEEE float
+bool writeWavFile (const std::string& path, const AudioFileData& data, int bitsPerSample, std::string& error);
+
+//==============================================================================
+/**
+    Reads a file a chunk at a time, so it takes the same memory however long the file is.
+    RF64 files (the 64-bit sizes that WAVs over 4 GB need) are read as well.
+
+    Where there's mmap() the data chunk is mapped rather than read, and the pages behind the
+    read position are handed back as it goes, so they don't pile up either.
+*/
+class WavReader
+{
+public:
+    WavReader() = default;
+    ~WavReader();
+
+    bool open (const std::string& path, std::string& error);
+    void close();
+
+    double getSampleRate() const        { return mSampleRate; }
+    int getNumChannels() const          { return mNumChannels; }
+    long long getNumFrames() const      { return mNumFrames; }
+    bool isMapped() const               { return mMapped != nullptr; }
+
+    // reads up to numFrames into the channels, returns how many there were (0 at the end)
+    int read (float* const* channels, int numFrames);
+
+    // moves the read position to frame (clamped to the file), for reading part of it
+    void seek (long long frame);
+
+private:
+    std::ifstream mStream;
+    std::vector<unsigned char> mBuffer;
+
+    const unsigned char* mMapped = nullptr;
+    size_t mMappedSize = 0;
+    size_t mReleasedBytes = 0;
+    uint64_t mDataOffset = 0;
+
+    double mSampleRate = 0.0;
+    int mNumChannels = 0;
+    int mFormat = 0;
+    int mBitsPerSample = 0;
+    long long mNumFrames = 0;
+    long long mPosition = 0;
+
+    WavReader (const WavReader&) = delete;
+    WavReader& operator= (const WavReader&) = delete;
+};
+
+//==============================================================================
+/**
+    Writes a file a chunk at a time. The sizes in the header are filled in by close().
+
+    The file is a plain WAV unless expectedNumFrames says the data won't fit in one, in which
+    case it's RF64. A plain WAV that ends up bigger than 4 GB anyway fails in close().
+*/
+class WavWriter
+{
+public:
+    WavWriter() = default;
+    ~WavWriter();
+
+    // bitsPerSample of 16 or 24 writes integer PCM, 32 writes IEEE float
+    bool open (const std::string& path, double sampleRate, int numChannels, int bitsPerSample,
+               long long expectedNumFrames, std::string& error);
+
+    bool write (const float* const* channels, int numFrames);
+
+    // finishes the header, returns false if anything failed to write
+    bool close (std::string& error);
+
+    long long getNumFramesWritten() const   { return mNumFrames; }
+
+private:
+    std::ofstream mStream;
+    std::vector<unsigned char> mBuffer;
+    std::string mPath;
+
+    int mNumChannels = 0;
+    int mBitsPerSample = 0;
+    bool mIsRf64 = false;
+    long long mNumFrames = 0;
+
+    WavWriter (const WavWriter&) = delete;
+    WavWriter& operator= (const WavWriter&) = delete;
+};
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    WorkStealingPool.h
+    Runs a list of tasks over a fixed number of threads. Each thread has its
+    own queue and steals from the others once it runs dry.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//==============================================================================
+/**
+    The tasks are dealt out round robin, so each thread starts on the first of its share.
+    A thread takes from the front of its own queue and steals from the back of the others,
+    so with the tasks sorted biggest first the owners work through the big ones and the
+    thieves pick up the small ones at the end, which keeps the threads finishing together.
+
+    The tasks are all known when run() starts and none are added, so a thread that finds
+    every queue empty is done. Each queue has its own lock and it's only held to take a task,
+    which is nothing next to rendering a file.
+*/
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool (int numThreadsToUse)
+        : mNumThreads (std::max (1, numThreadsToUse))
+    {
+    }
+
+    int getNumThreads() const   { return mNumThreads; }
+
+    // runs task (taskIndex, threadIndex) for every index up to numTasks, and returns once they're all done
+    void run (int numTasks, const std::function<void (int, int)>& task)
+    {
+        std::vector<std::unique_ptr<Queue>> queues;
+
+        for (int thread = 0; thread < mNumThreads; ++thread)
+            queues.push_back (std::make_unique<Queue>());
+
+        for (int index = 0; index < numTasks; ++index)
+            queues[(size_t) (index % mNumThreads)]->tasks.push_back (index);
+
+        const auto work = [&] (int thread)
+        {
+            int index;
+
+            while (takeOwn (*queues[(size_t) thread], index) || steal (queues, thread, index))
+                task (index, thread);
+        };
+
+        std::vector<std::thread> threads;
+
+        for (int thread = 1; thread < mNumThreads; ++thread)
+            threads.emplace_back (work, thread);
+
+        // the calling thread is one of the workers
+        work (0);
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    static bool takeOwn (Queue& queue, int& index)
+    {
+        const std::lock_guard<std::mutex> guard (queue.lock);
+
+        if (queue.tasks.empty())
+            return false;
+
+        index = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    // tries the others in turn, starting with the next one along
+    static bool steal (std::vector<std::unique_ptr<Queue>>& queues, int thief, int& index)
+    {
+        for (size_t offset = 1; offset < queues.size(); ++offset)
+        {
+            auto& victim = *queues[((size_t) thief + offset) % queues.size()];
+            const std::lock_guard<std::mutex> guard (victim.lock);
+
+            if (! victim.tasks.empty())
+            {
+                index = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    int mNumThreads;
+};